@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/**
+ * @brief HDR-style log-linear histogram of latencies in nanoseconds
+ * @details values below 2 * c_sub_bucket_half are counted exactly, above them every power of 2 range is split into
+ * c_sub_bucket_half linear sub buckets, the recorded value is off by less than 1 / c_sub_bucket_half (~1.6%).
+ * Fixed memory, recording is an increment, histograms of several threads are merged at the end
+ */
+class LatencyHistogram {
+public:
+    inline static constexpr uint64_t c_sub_bucket_half = 64;
+
+private:
+    inline static constexpr int c_sub_bucket_half_bits = std::countr_zero(c_sub_bucket_half);
+    inline static constexpr size_t c_bucket_count      = 2 * c_sub_bucket_half + (64 - c_sub_bucket_half_bits) * c_sub_bucket_half;
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_count_;
+    uint64_t min_;
+    uint64_t max_;
+    double sum_;
+
+    static auto indexOf_(uint64_t value)
+        -> size_t
+    {
+        if (value < 2 * c_sub_bucket_half)
+        {
+            return static_cast<size_t>(value);
+        }
+        auto shift = std::bit_width(value) - 1 - c_sub_bucket_half_bits; // >= 1
+        auto sub   = (value >> shift) - c_sub_bucket_half;                // [0, c_sub_bucket_half)
+        return static_cast<size_t>(2 * c_sub_bucket_half + (shift - 1) * c_sub_bucket_half + sub);
+    }
+
+    /**
+     * @brief the highest value counted in the bucket @c index
+     */
+    static auto highestValueOf_(size_t index)
+        -> uint64_t
+    {
+        if (index < 2 * c_sub_bucket_half)
+        {
+            return index;
+        }
+        auto shift = (index - 2 * c_sub_bucket_half) / c_sub_bucket_half + 1;
+        auto sub   = (index - 2 * c_sub_bucket_half) % c_sub_bucket_half + c_sub_bucket_half;
+        return ((sub + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram()
+        : counts_(c_bucket_count)
+        , total_count_ {0}
+        , min_ {UINT64_MAX}
+        , max_ {0}
+        , sum_ {0}
+    {
+    }
+
+    void record(uint64_t valueNs)
+    {
+        ++counts_[indexOf_(valueNs)];
+        ++total_count_;
+        min_ = std::min(min_, valueNs);
+        max_ = std::max(max_, valueNs);
+        sum_ += static_cast<double>(valueNs);
+    }
+
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < c_bucket_count; ++i)
+        {
+            counts_[i] += other.counts_[i];
+        }
+        total_count_ += other.total_count_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+        sum_ += other.sum_;
+    }
+
+    [[nodiscard]] auto getCount() const
+        -> uint64_t { return total_count_; }
+
+    [[nodiscard]] auto getMax() const
+        -> uint64_t { return max_; }
+
+    [[nodiscard]] auto getMin() const
+        -> uint64_t { return total_count_ == 0 ? 0 : min_; }
+
+    [[nodiscard]] auto getMean() const
+        -> double { return total_count_ == 0 ? 0 : sum_ / static_cast<double>(total_count_); }
+
+    /**
+     * @param percentile in [0, 100]
+     */
+    [[nodiscard]] auto valueAtPercentile(double percentile) const
+        -> uint64_t
+    {
+        auto wanted = static_cast<uint64_t>(percentile / 100 * static_cast<double>(total_count_) + 0.5);
+        wanted      = std::clamp<uint64_t>(wanted, 1, std::max<uint64_t>(total_count_, 1));
+        auto seen   = uint64_t {0};
+        for (size_t i = 0; i < c_bucket_count; ++i)
+        {
+            seen += counts_[i];
+            if (seen >= wanted)
+            {
+                return std::min(highestValueOf_(i), max_);
+            }
+        }
+        return max_;
+    }
+
+    /**
+     * @brief the percentile distribution in the HdrHistogram text format, values in microseconds,
+     * the percentiles get denser towards the tail: 5 ticks per halving of the distance to 100%
+     */
+    void printPercentileTable(std::FILE* out) const
+    {
+        std::fprintf(out, "%12s %14s %10s %14s\n\n", "Value(us)", "Percentile", "TotalCount", "1/(1-Percentile)");
+        auto seen       = uint64_t {0};
+        auto next_ratio = 0.0; // the next reported percentile / 100
+        auto half       = 0.5;
+        for (size_t i = 0; i < c_bucket_count and seen < total_count_; ++i)
+        {
+            if (counts_[i] == 0)
+            {
+                continue;
+            }
+            seen += counts_[i];
+            auto ratio = static_cast<double>(seen) / static_cast<double>(total_count_);
+            if (ratio < next_ratio and seen < total_count_)
+            {
+                continue;
+            }
+            auto value = static_cast<double>(std::min(highestValueOf_(i), max_)) / 1000;
+            if (seen == total_count_)
+            {
+                std::fprintf(out, "%12.3f %14.12f %10lu\n", value, 1.0, seen);
+                break;
+            }
+            std::fprintf(out, "%12.3f %14.12f %10lu %14.2f\n", value, ratio, seen, 1 / (1 - ratio));
+            while (next_ratio <= ratio)
+            {
+                next_ratio += half / 5;
+                if (next_ratio >= 1 - half + 1e-12)
+                {
+                    half /= 2;
+                }
+            }
+        }
+        std::fprintf(out, "#[Mean = %.3f, Max = %.3f, Total count = %lu]\n", getMean() / 1000, static_cast<double>(max_) / 1000, total_count_);
+    }
+};
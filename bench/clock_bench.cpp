@@ -0,0 +1,119 @@
+/**
+ * @brief what the loop time saves: the cost of one clock read per source, and the clock reads per request of a ping-pong
+ * @details the ping-pong runs a client and an echo server on one loop, once per EventLoop::ClockSource. The reads the
+ * same work took before the loop time are counted from what it did: one per poll return, three per message callback
+ * (the receive time and the two ends of the callback timing) and one per write
+ * usage: clock_bench [round_trips=100000] [calls=10000000]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "common/coarseclock.h"
+#include "common/metrics.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <unistd.h>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template <typename Read>
+void measureCall(const char* name, long calls, Read read)
+{
+    auto sink  = int64_t {0};
+    auto start = Clock::now();
+    for (auto i = 0L; i < calls; ++i)
+    {
+        sink += read();
+    }
+    auto ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(calls);
+    std::printf("%-28s %6.2f ns/call  (%lld)\n", name, ns, static_cast<long long>(sink & 1));
+}
+
+void pingPong(EventLoop::ClockSource source, const char* name, int roundTrips)
+{
+    auto loop = EventLoop {};
+    loop.setClockSource(source);
+    auto port   = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "ClockEcho");
+    server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        conn->send(buf.readAllAsString());
+    });
+    server->start();
+
+    auto& iterations       = Cot::MetricsRegistry::GetInstance().GetCounter("net_loop_iterations_total", "");
+    auto iterations_before = uint64_t {0};
+    auto reads_before      = uint64_t {0};
+    auto start             = Clock::time_point {};
+    auto done              = 0;
+    auto client            = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "ClockClient");
+    client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            conn->setTcpNoDelay(true);
+            iterations_before = iterations.Value();
+            reads_before      = loop.getClockReadCount();
+            start             = Clock::now();
+            conn->send(std::string {"ping"});
+        }
+    });
+    client->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        buf.readAllAndDiscard();
+        if (++done < roundTrips)
+        {
+            conn->send(std::string {"ping"});
+            return;
+        }
+        auto seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        auto reads   = loop.getClockReadCount() - reads_before;
+        auto polls   = iterations.Value() - iterations_before;
+        auto traffic = conn->getTrafficStats();
+        // the server connection did the same number of callbacks and writes
+        auto former = polls + 2 * (3 * traffic.message_callbacks + traffic.writes);
+        std::printf("%-8s %8.0f round trips/s  clock reads per round trip %.2f, %.2f before the loop time\n",
+                    name,
+                    roundTrips / seconds,
+                    static_cast<double>(reads) / roundTrips,
+                    static_cast<double>(former) / roundTrips);
+        client->disconnect();
+        loop.runAfter(0.1, [&loop] { loop.quit(); });
+    });
+    client->connect();
+    loop.loop();
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto round_trips = argc > 1 ? std::atoi(argv[1]) : 100000;
+    auto calls       = argc > 2 ? std::atol(argv[2]) : 10000000L;
+
+    measureCall("Timestamp::now", calls, [] { return Timestamp::now().microSecondsSinceEpoch(); });
+    measureCall("Timestamp::nowCoarse", calls, [] { return Timestamp::nowCoarse().microSecondsSinceEpoch(); });
+    measureCall("steady_clock::now", calls, [] { return Clock::now().time_since_epoch().count(); });
+    measureCall("CoarseSteadyClock::now", calls, [] { return Cot::CoarseSteadyClock::now().time_since_epoch().count(); });
+    {
+        auto loop = EventLoop {};
+        measureCall("EventLoop::now", calls, [&loop] { return loop.now().microSecondsSinceEpoch(); });
+    }
+    std::printf("coarse clock resolution %lld ns\n", static_cast<long long>(Cot::CoarseSystemClock::Resolution().count()));
+
+    pingPong(EventLoop::ClockSource::Precise, "precise", round_trips);
+    pingPong(EventLoop::ClockSource::Coarse, "coarse", round_trips);
+    return 0;
+}
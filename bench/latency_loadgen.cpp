@@ -0,0 +1,322 @@
+/**
+ * @brief open-loop request/response latency load generator for any echo-style server, e.g. the EchoServer example
+ * @details every connection sends @c msg_size byte requests on a fixed schedule, @c rate requests per second in total,
+ * whether the previous responses are back or not. A request late on its schedule, because the loop was busy,
+ * is sent at once and its latency counts from the scheduled time, so that a server stall is not hidden by the client
+ * waiting for it (coordinated omission). The latencies from the actual send time are reported as well.
+ * The first 16 bytes of a request carry its scheduled and actual send time, the server must echo the bytes back.
+ * A request still unanswered one second after the end is lost, it is counted and recorded with the latency it had
+ * reached by then, so that the responses never coming back don't make the percentiles look better.
+ * usage: latency_loadgen [host=127.0.0.1] [port=2007] [connections=16] [threads=2] [rate=20000] [seconds=10]
+ *                        [msg_size=64] [percentile_table_file]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <latch>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LatencyHistogram.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+auto nowNs()
+    -> int64_t
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct RequestHeader
+{
+    int64_t scheduled_ns;
+    int64_t sent_ns;
+};
+
+/**
+ * @brief the histograms of the connections served by one loop, only touched in that loop
+ */
+struct Worker
+{
+    EventLoop* loop;
+    LatencyHistogram corrected;   // from the scheduled time
+    LatencyHistogram uncorrected; // from the actual send time
+    uint64_t sent     = 0;
+    uint64_t received = 0;
+    uint64_t lost     = 0; // unanswered when the grace period ran out
+};
+
+struct Session
+{
+    std::shared_ptr<TcpClient> client;
+    Worker* worker;
+    TcpConnectionPtr conn;
+    int64_t next_ns;     // the schedule of the next request
+    int64_t interval_ns; // between two requests of this connection
+    std::string request;
+    std::deque<RequestHeader> in_flight; // echoed in order, the front is answered first
+    bool expired = false;                // the late responses are not counted
+};
+
+struct Options
+{
+    std::string host;
+    uint16_t port;
+    int connections;
+    int threads;
+    double rate;
+    double seconds;
+    size_t msg_size;
+    const char* table_file;
+};
+
+class LoadGenerator {
+private:
+    EventLoop* const loop_;
+    const Options opts_;
+    EventLoopThreadPool pool_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    std::atomic<int> connected_;
+    std::atomic<int> closed_;
+    int64_t start_ns_;
+    int64_t end_ns_;
+
+    /**
+     * @brief send every request due by now, then sleep until the next one is due
+     */
+    void sendDue_(Session& session)
+    {
+        auto now = nowNs();
+        while (session.next_ns <= now and session.next_ns < end_ns_)
+        {
+            auto header = RequestHeader {.scheduled_ns = session.next_ns, .sent_ns = now};
+            std::memcpy(session.request.data(), &header, sizeof header);
+            session.conn->send(std::string_view {session.request});
+            session.in_flight.push_back(header);
+            ++session.worker->sent;
+            session.next_ns += session.interval_ns;
+        }
+        if (session.next_ns < end_ns_)
+        {
+            session.worker->loop->runAfter(static_cast<double>(session.next_ns - now) / 1e9, [this, &session] {
+                this->sendDue_(session);
+            });
+        }
+    }
+
+    void onResponse_(Session& session, Buffer& buf)
+    {
+        if (session.expired)
+        {
+            buf.readAllAndDiscard();
+            return;
+        }
+        auto now = nowNs();
+        while (buf.getReadableBytesCount() >= opts_.msg_size and not session.in_flight.empty())
+        {
+            auto header = RequestHeader {};
+            std::memcpy(&header, buf.getReadableSV().data(), sizeof header);
+            std::ignore = buf.readNAsString(opts_.msg_size);
+            session.in_flight.pop_front();
+            session.worker->corrected.record(static_cast<uint64_t>(now - header.scheduled_ns));
+            session.worker->uncorrected.record(static_cast<uint64_t>(now - header.sent_ns));
+            ++session.worker->received;
+        }
+    }
+
+    /**
+     * @brief the grace period is over, the requests still in flight are lost, recorded at their latency so far
+     */
+    void expire_(Session& session)
+    {
+        auto now = nowNs();
+        for (const auto& header : session.in_flight)
+        {
+            session.worker->corrected.record(static_cast<uint64_t>(now - header.scheduled_ns));
+            session.worker->uncorrected.record(static_cast<uint64_t>(now - header.sent_ns));
+        }
+        session.worker->lost += session.in_flight.size();
+        session.in_flight.clear();
+        session.expired = true;
+    }
+
+    /**
+     * @brief every connection is up, start the schedules, the connections are spread evenly over one interval
+     */
+    void startSchedules_()
+    {
+        start_ns_ = nowNs() + 10'000'000; // 10ms for the first timers to be armed
+        end_ns_   = start_ns_ + static_cast<int64_t>(opts_.seconds * 1e9);
+        for (size_t i = 0; i < sessions_.size(); ++i)
+        {
+            auto& session   = *sessions_[i];
+            session.next_ns = start_ns_ + session.interval_ns * static_cast<int64_t>(i) / static_cast<int64_t>(sessions_.size());
+            session.worker->loop->runTask([this, &session] { this->sendDue_(session); });
+        }
+        // the responses to the last requests have one second to come back
+        loop_->runAfter(opts_.seconds + 1.01, [this] {
+            for (auto& session : sessions_)
+            {
+                session->worker->loop->runTask([this, &s = *session] {
+                    this->expire_(s);
+                    s.client->disconnect();
+                });
+            }
+        });
+    }
+
+public:
+    LoadGenerator(EventLoop* loop, Options opts)
+        : loop_ {loop}
+        , opts_ {std::move(opts)}
+        , pool_ {loop, "LatencyLoadGen"}
+        , connected_ {0}
+        , closed_ {0}
+        , start_ns_ {0}
+        , end_ns_ {0}
+    {
+        pool_.setThreadNum(opts_.threads);
+    }
+
+    void start()
+    {
+        pool_.start();
+        for (auto* worker_loop : pool_.getAllLoops())
+        {
+            workers_.push_back(std::make_unique<Worker>(Worker {.loop = worker_loop}));
+        }
+        auto interval_ns = static_cast<int64_t>(1e9 * opts_.connections / opts_.rate);
+        for (auto i = 0; i < opts_.connections; ++i)
+        {
+            auto session         = std::make_unique<Session>();
+            session->worker      = workers_[static_cast<size_t>(i) % workers_.size()].get();
+            session->interval_ns = interval_ns;
+            session->request     = std::string(opts_.msg_size, 'r');
+            session->client      = std::make_shared<TcpClient>(session->worker->loop, opts_.host, opts_.port, "LoadGen#" + std::to_string(i));
+            auto& s              = *session;
+            s.client->setConnetionCallback([this, &s](const TcpConnectionPtr& conn) {
+                if (not conn->isConnected())
+                {
+                    return;
+                }
+                conn->setTcpNoDelay(true);
+                s.conn = conn;
+                if (++connected_ == opts_.connections)
+                {
+                    loop_->runTask([this] { this->startSchedules_(); });
+                }
+            });
+            s.client->setMessageCallback([this, &s](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+                this->onResponse_(s, buf);
+            });
+            s.client->setConnectionCloseCallback([this, &s](const TcpConnectionPtr&) {
+                s.conn.reset();
+                if (++closed_ == opts_.connections)
+                {
+                    loop_->runTask([this] { loop_->quit(); });
+                }
+            });
+            s.client->connect();
+            sessions_.push_back(std::move(session));
+        }
+    }
+
+    /**
+     * @brief after the loop quit, the worker loops are idle but still running, collect in them
+     */
+    void report()
+    {
+        auto corrected   = LatencyHistogram {};
+        auto uncorrected = LatencyHistogram {};
+        auto sent        = uint64_t {0};
+        auto received    = uint64_t {0};
+        auto lost        = uint64_t {0};
+        for (auto& worker : workers_)
+        {
+            auto done = std::latch {1};
+            worker->loop->runTask([&] {
+                corrected.merge(worker->corrected);
+                uncorrected.merge(worker->uncorrected);
+                sent += worker->sent;
+                received += worker->received;
+                lost += worker->lost;
+                done.count_down();
+            });
+            done.wait();
+        }
+
+        auto print_row = [](const char* name, const LatencyHistogram& h) {
+            std::printf("%-12s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                        name,
+                        static_cast<double>(h.valueAtPercentile(50)) / 1000,
+                        static_cast<double>(h.valueAtPercentile(90)) / 1000,
+                        static_cast<double>(h.valueAtPercentile(99)) / 1000,
+                        static_cast<double>(h.valueAtPercentile(99.9)) / 1000,
+                        static_cast<double>(h.valueAtPercentile(99.99)) / 1000,
+                        static_cast<double>(h.getMax()) / 1000);
+        };
+        std::printf("target %.0f req/s over %d connections, %.1f s, sent %lu, received %lu, lost %lu, "
+                    "achieved %.0f req/s\n",
+                    opts_.rate,
+                    opts_.connections,
+                    opts_.seconds,
+                    sent,
+                    received,
+                    lost,
+                    static_cast<double>(received) / opts_.seconds);
+        std::printf("%-12s %10s %10s %10s %10s %10s %10s\n", "latency(us)", "p50", "p90", "p99", "p99.9", "p99.99", "max");
+        print_row("corrected", corrected);
+        print_row("uncorrected", uncorrected);
+
+        if (opts_.table_file != nullptr)
+        {
+            if (auto* out = std::fopen(opts_.table_file, "w"); out != nullptr)
+            {
+                corrected.printPercentileTable(out);
+                std::fclose(out);
+            }
+        }
+    }
+};
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto opts = Options {
+        .host        = argc > 1 ? argv[1] : "127.0.0.1",
+        .port        = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 2007),
+        .connections = std::max(argc > 3 ? std::atoi(argv[3]) : 16, 1),
+        .threads     = std::max(argc > 4 ? std::atoi(argv[4]) : 2, 1), // the base loop only collects
+        .rate        = argc > 5 ? std::atof(argv[5]) : 20000,
+        .seconds     = argc > 6 ? std::atof(argv[6]) : 10,
+        .msg_size    = std::max<size_t>(argc > 7 ? std::atoi(argv[7]) : 64, sizeof(RequestHeader)),
+        .table_file  = argc > 8 ? argv[8] : nullptr,
+    };
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop = EventLoop {};
+    auto gen  = LoadGenerator {&loop, opts};
+    gen.start();
+    loop.loop();
+    gen.report();
+    return 0;
+}
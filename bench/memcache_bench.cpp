@@ -0,0 +1,345 @@
+/**
+ * @brief closed-loop throughput benchmark for the MemcacheServer example, or any memcached speaking the text protocol
+ * @details every connection first stores its share of the key space, then keeps @c depth requests in flight:
+ * a get of @c multi_get random keys with probability @c get_ratio, a set of one random key otherwise. A request
+ * is answered by exactly one END, STORED or error line, every answer is followed by a new request, the new requests
+ * of one message callback leave in one send. The window is measured from the moment every connection finished its
+ * preload, the result is printed as one line of JSON.
+ * usage: memcache_bench [host=127.0.0.1] [port=11211] [connections=16] [threads=2] [depth=16] [keyspace=100000]
+ *                       [value_size=100] [get_ratio=0.9] [multi_get=1] [seconds=10]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+auto nowNs()
+    -> int64_t
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+}
+
+struct Options
+{
+    std::string host;
+    uint16_t port;
+    int connections;
+    int threads;
+    int depth;
+    uint64_t keyspace;
+    size_t value_size;
+    double get_ratio;
+    int multi_get;
+    double seconds;
+};
+
+/**
+ * @brief only touched in the loop of its connection
+ */
+struct Session
+{
+    std::shared_ptr<TcpClient> client;
+    TcpConnectionPtr conn;
+    uint64_t rng;          // xorshift64
+    uint64_t preload_next; // the keys [preload_next, preload_end) are still to be stored
+    uint64_t preload_end;
+    uint64_t preload_pending = 0; // stores sent and not answered yet
+    bool preloaded           = false;
+    bool stopping            = false;
+    std::string out;
+    // within the measured window
+    uint64_t gets   = 0;
+    uint64_t sets   = 0;
+    uint64_t hits   = 0; // VALUE lines
+    uint64_t errors = 0;
+};
+
+class MemcacheBench {
+private:
+    EventLoop* const loop_;
+    const Options opts_;
+    EventLoopThreadPool pool_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    const std::string value_;
+    std::atomic<int> preloaded_;
+    std::atomic<int> closed_;
+    std::atomic<int64_t> start_ns_; // 0 until every connection is preloaded
+    const int64_t window_ns_;
+
+    auto nextRandom_(Session& session)
+        -> uint64_t
+    {
+        session.rng ^= session.rng << 13;
+        session.rng ^= session.rng >> 7;
+        session.rng ^= session.rng << 17;
+        return session.rng;
+    }
+
+    void appendSet_(Session& session, uint64_t key)
+    {
+        session.out += "set key:";
+        session.out += std::to_string(key);
+        session.out += " 0 0 ";
+        session.out += std::to_string(value_.size());
+        session.out += "\r\n";
+        session.out += value_;
+        session.out += "\r\n";
+    }
+
+    void appendRequest_(Session& session)
+    {
+        if (session.preload_next < session.preload_end)
+        {
+            appendSet_(session, session.preload_next++);
+            ++session.preload_pending;
+            return;
+        }
+        auto dice = static_cast<double>(nextRandom_(session) % 1'000'000) / 1e6;
+        if (dice >= opts_.get_ratio)
+        {
+            appendSet_(session, nextRandom_(session) % opts_.keyspace);
+            return;
+        }
+        session.out += "get";
+        for (auto i = 0; i < opts_.multi_get; ++i)
+        {
+            session.out += " key:";
+            session.out += std::to_string(nextRandom_(session) % opts_.keyspace);
+        }
+        session.out += "\r\n";
+    }
+
+    /**
+     * @return the number of answered requests in @c buf, the partial answer at the end stays
+     */
+    auto parseAnswers_(Session& session, Buffer& buf, bool measuring)
+        -> int
+    {
+        auto answered = 0;
+        while (true)
+        {
+            const auto* crlf = reinterpret_cast<const char*>(buf.findCrLf());
+            if (crlf == nullptr)
+            {
+                break;
+            }
+            auto line     = std::string_view {buf.getReadableSV().data(), crlf};
+            auto line_len = line.size() + 2;
+            if (line.starts_with("VALUE "))
+            {
+                // VALUE <key> <flags> <bytes> [<cas>]
+                auto bytes_pos = line.find(' ', line.find(' ', 6) + 1) + 1;
+                auto bytes     = std::strtoul(line.data() + bytes_pos, nullptr, 10);
+                if (buf.getReadableBytesCount() < line_len + bytes + 2)
+                {
+                    break;
+                }
+                buf.readNAndDiscard(line_len + bytes + 2);
+                session.hits += measuring ? 1 : 0;
+                continue;
+            }
+            if (line == "END")
+            {
+                session.gets += measuring ? 1 : 0;
+            }
+            else if (line == "STORED")
+            {
+                session.sets += measuring ? 1 : 0;
+            }
+            else
+            {
+                ++session.errors;
+                LOG_WARN_FMT(log, "unexpected answer: {}", line);
+            }
+            if (session.preload_pending > 0)
+            {
+                --session.preload_pending;
+            }
+            buf.readNAndDiscard(line_len);
+            ++answered;
+        }
+        return answered;
+    }
+
+    void onMessage_(Session& session, Buffer& buf)
+    {
+        auto now       = nowNs();
+        auto start     = start_ns_.load(std::memory_order_relaxed);
+        auto end       = start + window_ns_;
+        auto measuring = start != 0 and now >= start and now < end;
+        auto answered  = parseAnswers_(session, buf, measuring);
+
+        if (not session.preloaded and session.preload_next == session.preload_end and session.preload_pending == 0)
+        {
+            session.preloaded = true;
+            if (++preloaded_ == opts_.connections)
+            {
+                loop_->runTask([this] { this->startWindow_(); });
+            }
+        }
+        if (start != 0 and now >= end)
+        {
+            session.stopping = true;
+        }
+        if (session.stopping)
+        {
+            return;
+        }
+        if (answered == 0)
+        {
+            return;
+        }
+        session.out.clear();
+        for (auto i = 0; i < answered; ++i)
+        {
+            appendRequest_(session);
+        }
+        session.conn->send(std::string_view {session.out});
+    }
+
+    void startWindow_()
+    {
+        start_ns_.store(nowNs());
+        loop_->runAfter(opts_.seconds + 0.5, [this] {
+            for (auto& session : sessions_)
+            {
+                session->client->disconnect();
+            }
+        });
+    }
+
+public:
+    MemcacheBench(EventLoop* loop, Options opts)
+        : loop_ {loop}
+        , opts_ {std::move(opts)}
+        , pool_ {loop, "MemcacheBench"}
+        , value_(opts_.value_size, 'v')
+        , preloaded_ {0}
+        , closed_ {0}
+        , start_ns_ {0}
+        , window_ns_ {static_cast<int64_t>(opts_.seconds * 1e9)}
+    {
+        pool_.setThreadNum(opts_.threads);
+    }
+
+    void start()
+    {
+        pool_.start();
+        auto share = opts_.keyspace / static_cast<uint64_t>(opts_.connections);
+        for (auto i = 0; i < opts_.connections; ++i)
+        {
+            auto session          = std::make_unique<Session>();
+            session->rng          = 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(i + 1);
+            session->preload_next = share * static_cast<uint64_t>(i);
+            session->preload_end  = i + 1 == opts_.connections ? opts_.keyspace : share * static_cast<uint64_t>(i + 1);
+            session->client       = std::make_shared<TcpClient>(pool_.getNextLoop(), opts_.host, opts_.port, "MemcacheBench#" + std::to_string(i));
+            auto& s               = *session;
+            s.client->setConnetionCallback([this, &s](const TcpConnectionPtr& conn) {
+                if (not conn->isConnected())
+                {
+                    return;
+                }
+                conn->setTcpNoDelay(true);
+                s.conn = conn;
+                s.out.clear();
+                for (auto k = 0; k < opts_.depth; ++k)
+                {
+                    this->appendRequest_(s);
+                }
+                conn->send(std::string_view {s.out});
+            });
+            s.client->setMessageCallback([this, &s](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+                this->onMessage_(s, buf);
+            });
+            s.client->setConnectionCloseCallback([this, &s](const TcpConnectionPtr&) {
+                s.conn.reset();
+                if (++closed_ == opts_.connections)
+                {
+                    loop_->runTask([this] { loop_->quit(); });
+                }
+            });
+            s.client->connect();
+            sessions_.push_back(std::move(session));
+        }
+    }
+
+    /**
+     * @brief after the loop quit, every connection is closed and its counters final
+     */
+    void report() const
+    {
+        auto gets = uint64_t {0}, sets = uint64_t {0}, hits = uint64_t {0}, errors = uint64_t {0};
+        for (const auto& session : sessions_)
+        {
+            gets += session->gets;
+            sets += session->sets;
+            hits += session->hits;
+            errors += session->errors;
+        }
+        auto ops = static_cast<double>(gets + sets);
+        std::printf("{\"bench\": \"memcache\", \"connections\": %d, \"threads\": %d, \"depth\": %d, \"keyspace\": %lu, "
+                    "\"value_size\": %zu, \"get_ratio\": %.2f, \"multi_get\": %d, \"seconds\": %.3f, "
+                    "\"ops_per_s\": %.0f, \"gets_per_s\": %.0f, \"sets_per_s\": %.0f, \"keys_per_s\": %.0f, "
+                    "\"hit_ratio\": %.3f, \"errors\": %lu}\n",
+                    opts_.connections,
+                    opts_.threads,
+                    opts_.depth,
+                    opts_.keyspace,
+                    opts_.value_size,
+                    opts_.get_ratio,
+                    opts_.multi_get,
+                    opts_.seconds,
+                    ops / opts_.seconds,
+                    static_cast<double>(gets) / opts_.seconds,
+                    static_cast<double>(sets) / opts_.seconds,
+                    static_cast<double>(gets * static_cast<uint64_t>(opts_.multi_get) + sets) / opts_.seconds,
+                    gets == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(gets * static_cast<uint64_t>(opts_.multi_get)),
+                    errors);
+    }
+};
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto opts = Options {
+        .host        = argc > 1 ? argv[1] : "127.0.0.1",
+        .port        = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 11211),
+        .connections = std::max(argc > 3 ? std::atoi(argv[3]) : 16, 1),
+        .threads     = std::max(argc > 4 ? std::atoi(argv[4]) : 2, 1),
+        .depth       = std::max(argc > 5 ? std::atoi(argv[5]) : 16, 1),
+        .keyspace    = std::max<uint64_t>(argc > 6 ? std::strtoul(argv[6], nullptr, 10) : 100000, 1),
+        .value_size  = argc > 7 ? static_cast<size_t>(std::atol(argv[7])) : 100,
+        .get_ratio   = argc > 8 ? std::atof(argv[8]) : 0.9,
+        .multi_get   = std::max(argc > 9 ? std::atoi(argv[9]) : 1, 1),
+        .seconds     = argc > 10 ? std::atof(argv[10]) : 10,
+    };
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop  = EventLoop {};
+    auto bench = MemcacheBench {&loop, opts};
+    bench.start();
+    loop.loop();
+    bench.report();
+    return 0;
+}
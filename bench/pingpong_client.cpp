@@ -0,0 +1,148 @@
+/**
+ * @brief pingpong throughput benchmark, modelled on the muduo one
+ * @details every session sends one block of @c block_size bytes on connect, then echoes back whatever it receives,
+ * the pingpong_server does the same, so @c sessions blocks bounce between them. After @c seconds every session is
+ * shut down, the result is printed as one line of JSON, the bytes and the blocks read by the client side while the clock
+ * ran, the ramp-up before every session is connected and the drain after the shutdown are not counted.
+ * usage: pingpong_client [host=127.0.0.1] [port=33333] [threads=1] [block_size=16384] [sessions=100] [seconds=10]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief one connection, its counters are only written in its loop thread and read by the main loop for the snapshots
+ */
+struct Session
+{
+    std::shared_ptr<TcpClient> client;
+    std::atomic<uint64_t> bytes_read    = 0;
+    std::atomic<uint64_t> messages_read = 0; // message callbacks
+};
+
+struct Totals
+{
+    uint64_t bytes    = 0;
+    uint64_t messages = 0;
+};
+
+auto snapshot(const std::vector<Session>& all)
+    -> Totals
+{
+    auto totals = Totals {};
+    for (const auto& session : all)
+    {
+        totals.bytes += session.bytes_read.load(std::memory_order_relaxed);
+        totals.messages += session.messages_read.load(std::memory_order_relaxed);
+    }
+    return totals;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto host       = std::string {argc > 1 ? argv[1] : "127.0.0.1"};
+    auto port       = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 33333);
+    auto threads    = argc > 3 ? std::atoi(argv[3]) : 1;
+    auto block_size = static_cast<size_t>(argc > 4 ? std::atoi(argv[4]) : 16384);
+    auto sessions   = argc > 5 ? std::atoi(argv[5]) : 100;
+    auto seconds    = argc > 6 ? std::atof(argv[6]) : 10.0;
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop = EventLoop {};
+    auto pool = EventLoopThreadPool {&loop, "PingPongClient"};
+    pool.setThreadNum(threads);
+    pool.start();
+
+    auto message   = std::string(block_size, 'p');
+    auto all       = std::vector<Session>(static_cast<size_t>(sessions));
+    auto connected = std::atomic<int> {0};
+    auto closed    = std::atomic<int> {0};
+    auto started   = Clock::time_point {};
+    auto elapsed   = 0.0;
+    auto before    = Totals {};
+    auto after     = Totals {};
+
+    auto stop_all = [&] {
+        elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+        after   = snapshot(all);
+        for (auto& session : all)
+        {
+            session.client->disconnect();
+        }
+    };
+    for (auto i = 0; i < sessions; ++i)
+    {
+        auto& session  = all[static_cast<size_t>(i)];
+        session.client = std::make_shared<TcpClient>(pool.getNextLoop(), host, port, "PingPong#" + std::to_string(i));
+        session.client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+            if (not conn->isConnected())
+            {
+                return;
+            }
+            conn->setTcpNoDelay(true);
+            conn->send(message);
+            // the clock starts once every session is up
+            if (++connected == sessions)
+            {
+                loop.runTask([&] {
+                    started = Clock::now();
+                    before  = snapshot(all);
+                    loop.runAfter(seconds, stop_all);
+                });
+            }
+        });
+        session.client->setMessageCallback([&session](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+            // a single writer, no read-modify-write needed
+            session.messages_read.store(session.messages_read.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            session.bytes_read.store(session.bytes_read.load(std::memory_order_relaxed) + buf.getReadableBytesCount(),
+                                     std::memory_order_relaxed);
+            conn->send(buf.getReadableSV());
+            buf.readAllAndDiscard();
+        });
+        session.client->setConnectionCloseCallback([&](const TcpConnectionPtr&) {
+            if (++closed == sessions)
+            {
+                loop.runTask([&loop] { loop.quit(); });
+            }
+        });
+        session.client->connect();
+    }
+    loop.loop();
+
+    auto bytes    = after.bytes - before.bytes;
+    auto messages = after.messages - before.messages;
+    auto mb = static_cast<double>(bytes) / 1024 / 1024;
+    std::printf("{\"bench\": \"pingpong\", \"threads\": %d, \"block_size\": %zu, \"sessions\": %d, \"seconds\": %.3f, "
+                "\"bytes\": %lu, \"mb_per_s\": %.2f, \"blocks_per_s\": %.0f, \"msgs_per_s\": %.0f, \"avg_msg_size\": %.0f}\n",
+                threads,
+                block_size,
+                sessions,
+                elapsed,
+                bytes,
+                mb / elapsed,
+                static_cast<double>(bytes) / static_cast<double>(block_size) / elapsed,
+                static_cast<double>(messages) / elapsed,
+                messages > 0 ? static_cast<double>(bytes) / static_cast<double>(messages) : 0.0);
+    return 0;
+}
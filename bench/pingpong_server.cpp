@@ -0,0 +1,40 @@
+/**
+ * @brief echo server side of the pingpong throughput benchmark, see pingpong_client
+ * usage: pingpong_server [port=33333] [threads=1]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto port    = static_cast<uint16_t>(argc > 1 ? std::atoi(argv[1]) : 33333);
+    auto threads = argc > 2 ? std::atoi(argv[2]) : 1;
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop   = EventLoop {};
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {port}, "PingPongServer");
+    server->setConnectionEstablishedCallback([](const TcpConnectionPtr& conn) {
+        conn->setTcpNoDelay(true);
+    });
+    server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        conn->send(buf.getReadableSV());
+        buf.readAllAndDiscard();
+    });
+    server->setThreadNum(threads);
+    server->start();
+    std::fprintf(stderr, "pingpong_server listening on %u with %d threads\n", port, threads);
+    loop.loop();
+    return 0;
+}
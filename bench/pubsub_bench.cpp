@@ -0,0 +1,264 @@
+/**
+ * @brief PubSubHub fan-out throughput, one publisher to many subscribers of one topic
+ * @details an in-process TcpServer subscribes every connection that sends "sub <topic>\r\n" to the hub, the
+ * subscribers are TcpClients on their own loops counting the "\r\n" terminated messages they receive. A publisher
+ * thread calls PubSubHub::publish as fast as it can while no more than @c window messages are in flight towards the
+ * slowest case, i.e. published * subscribers - received < window * subscribers. The result is printed as one line of
+ * JSON: published messages per second and the deliveries per second they make, messages/s x subscribers, along with
+ * the loop batches per publication and the drops of the slow-subscriber policy.
+ * usage: pubsub_bench [subscribers=100] [server_threads=4] [client_threads=4] [seconds=3] [payload=64] [window=64]
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <latch>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/InetAddress.h"
+#include "net/PubSubHub.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t c_port           = 19010;
+constexpr std::string_view c_topic = "bench";
+
+struct Options
+{
+    int subscribers;
+    int server_threads;
+    int client_threads;
+    double seconds;
+    size_t payload;
+    uint64_t window;
+};
+
+/**
+ * @brief the subscribing side of the hub, only "sub <topic>\r\n" is understood
+ */
+class HubServer {
+private:
+    PubSubHub hub_; // outlives the server loops, which may still run its delivery tasks
+    std::shared_ptr<TcpServer> server_;
+
+public:
+    HubServer(EventLoop* loop, int threads)
+        : server_ {std::make_shared<TcpServer>(loop, InetAddress {c_port, true}, "PubSubBenchServer")}
+    {
+        server_->setThreadNum(threads);
+        server_->setConnectionCloseCallback([this](const TcpConnectionPtr& conn) { hub_.unsubscribeAll(conn); });
+        server_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+            while (const auto* crlf = reinterpret_cast<const char*>(buf.findCrLf()))
+            {
+                auto line = std::string_view {buf.getReadableSV().data(), crlf};
+                if (line.starts_with("sub "))
+                {
+                    hub_.subscribe(conn, line.substr(4));
+                }
+                buf.readNAndDiscard(line.size() + 2);
+            }
+        });
+    }
+
+    void start() { server_->start(); }
+
+    auto getHub()
+        -> PubSubHub& { return hub_; }
+};
+
+class PubSubBench {
+private:
+    EventLoop* const loop_;
+    const Options options_;
+    PubSubHub& hub_;
+    EventLoopThreadPool pool_;
+    std::vector<std::shared_ptr<TcpClient>> clients_;
+    std::atomic<uint64_t> received_;
+    std::atomic<int> closed_;
+    std::atomic<bool> publishing_;
+    std::thread publisher_;
+    uint64_t published_;
+    double elapsed_;
+
+    /**
+     * @brief count the messages, one per "\r\n"
+     */
+    void onMessage_(Buffer& buf)
+    {
+        auto sv       = buf.getReadableSV();
+        auto messages = uint64_t {0};
+        auto consumed = size_t {0};
+        for (const auto* p = sv.data(); (p = static_cast<const char*>(std::memchr(p, '\n', sv.data() + sv.size() - p))) != nullptr; ++p)
+        {
+            ++messages;
+            consumed = static_cast<size_t>(p - sv.data()) + 1;
+        }
+        buf.readNAndDiscard(consumed);
+        received_.fetch_add(messages, std::memory_order_relaxed);
+    }
+
+    void waitSubscribed_()
+    {
+        if (hub_.getSubscriberCount(c_topic) < static_cast<size_t>(options_.subscribers))
+        {
+            loop_->runAfter(0.01, [this] { this->waitSubscribed_(); });
+            return;
+        }
+        publishing_.store(true);
+        publisher_ = std::thread {[this] { this->publish_(); }};
+        loop_->runAfter(options_.seconds, [this] { this->finish_(); });
+    }
+
+    /**
+     * @brief in the publisher thread, a fresh payload for every message as a real publisher would have
+     */
+    void publish_()
+    {
+        auto body        = "msg " + std::string {c_topic} + " " + std::string(options_.payload, 'p') + "\r\n";
+        auto subscribers = static_cast<uint64_t>(options_.subscribers);
+        auto start       = Clock::now();
+        auto published   = uint64_t {0};
+        while (publishing_.load(std::memory_order_relaxed))
+        {
+            if (published * subscribers - received_.load(std::memory_order_relaxed) >= options_.window * subscribers)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            hub_.publish(c_topic, std::make_shared<const std::string>(body));
+            ++published;
+        }
+        elapsed_   = std::chrono::duration<double>(Clock::now() - start).count();
+        published_ = published;
+    }
+
+    void finish_()
+    {
+        auto received_at_stop = received_.load();
+        publishing_.store(false);
+        publisher_.join();
+        auto stats = hub_.getStats();
+        // every publication is handed to each server loop having subscribers
+        auto handoffs = static_cast<double>(stats.published) * std::min(options_.server_threads, options_.subscribers);
+        std::printf("{\"bench\": \"pubsub\", \"subscribers\": %d, \"server_threads\": %d, \"client_threads\": %d, "
+                    "\"payload\": %zu, \"window\": %lu, \"seconds\": %.3f, \"messages_per_s\": %.0f, "
+                    "\"deliveries_per_s\": %.0f, \"received_per_s\": %.0f, \"publications_per_loop_batch\": %.2f, "
+                    "\"dropped\": %lu, \"disconnected\": %lu}\n",
+                    options_.subscribers,
+                    options_.server_threads,
+                    options_.client_threads,
+                    options_.payload,
+                    options_.window,
+                    elapsed_,
+                    static_cast<double>(published_) / elapsed_,
+                    static_cast<double>(stats.deliveries) / elapsed_,
+                    static_cast<double>(received_at_stop) / elapsed_,
+                    stats.loop_batches == 0 ? 0.0 : handoffs / static_cast<double>(stats.loop_batches),
+                    stats.dropped,
+                    stats.disconnected);
+        std::fflush(stdout);
+        for (auto& client : clients_)
+        {
+            client->disconnect();
+        }
+    }
+
+public:
+    PubSubBench(EventLoop* loop, PubSubHub& hub, Options options)
+        : loop_ {loop}
+        , options_ {options}
+        , hub_ {hub}
+        , pool_ {loop, "PubSubBench"}
+        , received_ {0}
+        , closed_ {0}
+        , publishing_ {false}
+        , published_ {0}
+        , elapsed_ {0}
+    {
+        pool_.setThreadNum(options_.client_threads);
+    }
+
+    void start()
+    {
+        pool_.start();
+        for (auto i = 0; i < options_.subscribers; ++i)
+        {
+            auto client = std::make_shared<TcpClient>(pool_.getNextLoop(), InetAddress {c_port, true}, "PubSubBench#" + std::to_string(i));
+            client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+                conn->send("sub " + std::string {c_topic} + "\r\n");
+            });
+            client->setMessageCallback([this](const TcpConnectionPtr&, Buffer& buf, Timestamp) { this->onMessage_(buf); });
+            client->setConnectionCloseCallback([this](const TcpConnectionPtr&) {
+                if (++closed_ == options_.subscribers)
+                {
+                    loop_->runTask([this] { loop_->quit(); });
+                }
+            });
+            clients_.push_back(std::move(client));
+        }
+        for (auto& client : clients_)
+        {
+            client->connect();
+        }
+        waitSubscribed_();
+    }
+
+    /**
+     * @brief the clients are destroyed in their loops, which are still running
+     */
+    void stop()
+    {
+        for (auto& client : clients_)
+        {
+            auto* loop = const_cast<EventLoop*>(client->getLoop());
+            auto done  = std::latch {1};
+            loop->runTask([&] {
+                client.reset();
+                done.count_down();
+            });
+            done.wait();
+        }
+    }
+};
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto options = Options {
+        .subscribers    = std::max(argc > 1 ? std::atoi(argv[1]) : 100, 1),
+        .server_threads = std::max(argc > 2 ? std::atoi(argv[2]) : 4, 1),
+        .client_threads = std::max(argc > 3 ? std::atoi(argv[3]) : 4, 1),
+        .seconds        = argc > 4 ? std::atof(argv[4]) : 3.0,
+        .payload        = static_cast<size_t>(argc > 5 ? std::atol(argv[5]) : 64),
+        .window         = static_cast<uint64_t>(std::max(argc > 6 ? std::atol(argv[6]) : 64, 1L)),
+    };
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop   = EventLoop {};
+    auto server = HubServer {&loop, options.server_threads};
+    server.start();
+    auto bench = PubSubBench {&loop, server.getHub(), options};
+    bench.start();
+    loop.loop();
+    bench.stop();
+    return 0;
+}
@@ -0,0 +1,399 @@
+/**
+ * @brief proxy throughput, TcpRelay splice forwarding against the copying path through the connection buffers
+ * @details everything runs in process: the sources blast @c chunk_kb chunks through a proxy into a sink discarding
+ * them, one upstream connection to the sink per source connection. The copying proxy forwards from the message
+ * callback by send() and stops reading a side whose peer's output buffer is above the high watermark, the splice
+ * proxy hands both connections to a TcpRelay. The modes are measured one after another for @c seconds each, one line
+ * of JSON per mode: the bytes per second reaching the sink and the process CPU seconds per GB forwarded.
+ * usage: relay_bench [connections=8] [proxy_threads=2] [seconds=3] [chunk_kb=64] [modes=copy,splice]
+ */
+#include <algorithm>
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <latch>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <sys/resource.h>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpRelay.h"
+#include "net/TcpServer.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t c_sink_port       = 19100;
+constexpr uint16_t c_proxy_port      = 19101; // + the index of the mode
+constexpr size_t c_high_watermark    = 1024 * 1024;
+constexpr std::string_view c_modes[] = {"copy", "splice"};
+
+auto cpuSeconds()
+    -> double
+{
+    auto usage = rusage {};
+    ::getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](const timeval& tv) { return static_cast<double>(tv.tv_sec) + static_cast<double>(tv.tv_usec) / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+/**
+ * @brief discards and counts everything
+ */
+class Sink {
+private:
+    std::shared_ptr<TcpServer> server_;
+    std::atomic<uint64_t> received_;
+
+public:
+    Sink(EventLoop* loop, int threads)
+        : server_ {std::make_shared<TcpServer>(loop, InetAddress {c_sink_port, true}, "RelayBenchSink")}
+        , received_ {0}
+    {
+        server_->setThreadNum(threads);
+        server_->setMessageCallback([this](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+            received_.fetch_add(buf.getReadableBytesCount(), std::memory_order_relaxed);
+            buf.readAllAndDiscard();
+        });
+    }
+
+    void start() { server_->start(); }
+
+    auto getReceived() const
+        -> uint64_t { return received_.load(std::memory_order_relaxed); }
+};
+
+/**
+ * @brief one upstream connection to the sink per downstream connection, in the loop of the downstream one
+ */
+class Proxy {
+private:
+    struct Session
+    {
+        std::shared_ptr<TcpClient> client;
+        TcpConnectionPtr upstream;
+    };
+
+    std::shared_ptr<TcpServer> server_;
+    const bool splice_;
+
+    /**
+     * @brief pause reading @c reader while @c writer has more than the high watermark to send
+     */
+    static void linkBackpressure_(const TcpConnectionPtr& writer, const TcpConnectionPtr& reader)
+    {
+        auto weak_reader = std::weak_ptr<TcpConnection> {reader};
+        auto pause = [weak_reader](const TcpConnectionPtr&, size_t) {
+            if (auto conn = weak_reader.lock(); conn != nullptr)
+            {
+                conn->stopRead();
+            }
+        };
+        writer->setHighWaterMarkCallback(pause, c_high_watermark);
+        writer->setWriteCompleteCallback([weak_reader](const TcpConnectionPtr&) {
+            if (auto conn = weak_reader.lock(); conn != nullptr and not conn->IsReading())
+            {
+                conn->startRead();
+            }
+        });
+    }
+
+    void onUpstream_(const TcpConnectionPtr& downstream, const TcpConnectionPtr& upstream)
+    {
+        std::any_cast<const std::shared_ptr<Session>&>(downstream->getContext())->upstream = upstream;
+        if (splice_)
+        {
+            if (std::make_shared<TcpRelay>(downstream, upstream)->start())
+            {
+                return;
+            }
+            LOG_WARN_FMT(log, "relay_bench - TcpRelay failed to start, copying");
+        }
+        linkBackpressure_(downstream, upstream);
+        linkBackpressure_(upstream, downstream);
+        // the client speaks first here, nothing is read before the upstream connection is up
+        downstream->startRead();
+    }
+
+    void onConnection_(const TcpConnectionPtr& downstream)
+    {
+        downstream->stopRead();
+        auto session = std::make_shared<Session>();
+        downstream->setContext(session);
+        session->client = std::make_shared<TcpClient>(downstream->getLoop(), InetAddress {c_sink_port, true}, downstream->getName() + "-up");
+        auto weak_down  = std::weak_ptr<TcpConnection> {downstream};
+        session->client->setConnetionCallback([this, weak_down](const TcpConnectionPtr& upstream) {
+            if (auto down = weak_down.lock(); down != nullptr and down->isConnected())
+            {
+                this->onUpstream_(down, upstream);
+                return;
+            }
+            upstream->forceClose();
+        });
+        session->client->setMessageCallback([weak_down](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+            if (auto down = weak_down.lock(); down != nullptr)
+            {
+                down->send(buf.getReadableSV());
+            }
+            buf.readAllAndDiscard();
+        });
+        session->client->setConnectionCloseCallback([weak_down](const TcpConnectionPtr&) {
+            if (auto down = weak_down.lock(); down != nullptr)
+            {
+                down->shutdown();
+            }
+        });
+        session->client->connect();
+    }
+
+    void onClose_(const TcpConnectionPtr& downstream)
+    {
+        auto session = std::any_cast<std::shared_ptr<Session>>(downstream->getContext());
+        if (session->upstream != nullptr)
+        {
+            session->upstream->forceClose();
+        }
+        // after the queued close of the upstream connection, which goes through the client
+        downstream->getLoop()->queueTask([client = std::move(session->client)] {});
+        session->upstream.reset();
+    }
+
+public:
+    Proxy(EventLoop* loop, uint16_t port, int threads, bool splice)
+        : server_ {std::make_shared<TcpServer>(loop, InetAddress {port, true}, splice ? "RelayBenchSplice" : "RelayBenchCopy")}
+        , splice_ {splice}
+    {
+        server_->setThreadNum(threads);
+        server_->setConnectionEstablishedCallback([this](const TcpConnectionPtr& conn) { this->onConnection_(conn); });
+        server_->setConnectionCloseCallback([this](const TcpConnectionPtr& conn) { this->onClose_(conn); });
+        server_->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+            const auto& session = std::any_cast<const std::shared_ptr<Session>&>(conn->getContext());
+            session->upstream->send(buf.getReadableSV());
+            buf.readAllAndDiscard();
+        });
+    }
+
+    void start() { server_->start(); }
+};
+
+class RelayBench {
+private:
+    EventLoop* const loop_;
+    const Sink& sink_;
+    EventLoopThreadPool pool_;
+    const int connections_;
+    const double seconds_;
+    const std::vector<size_t> modes_;
+    const std::string chunk_;
+    std::vector<std::shared_ptr<TcpClient>> sources_;
+    std::atomic<bool> sending_;
+    std::atomic<int> connected_;
+    std::atomic<int> closed_;
+    size_t phase_;
+    uint64_t phase_received_;
+    double phase_cpu_;
+    Clock::time_point phase_start_;
+
+    void startPhase_()
+    {
+        auto port = static_cast<uint16_t>(c_proxy_port + modes_[phase_]);
+        sending_.store(true);
+        connected_.store(0);
+        closed_.store(0);
+        for (auto i = 0; i < connections_; ++i)
+        {
+            auto source = std::make_shared<TcpClient>(pool_.getNextLoop(), InetAddress {port, true}, "RelayBenchSource#" + std::to_string(i));
+            source->setConnetionCallback([this](const TcpConnectionPtr& conn) {
+                conn->send(std::string_view {chunk_});
+                conn->send(std::string_view {chunk_});
+                if (++connected_ == connections_)
+                {
+                    loop_->runTask([this] { this->measure_(); });
+                }
+            });
+            source->setWriteCompleteCallback([this](const TcpConnectionPtr& conn) {
+                if (sending_.load(std::memory_order_relaxed))
+                {
+                    conn->send(std::string_view {chunk_});
+                }
+            });
+            source->setConnectionCloseCallback([this](const TcpConnectionPtr&) {
+                if (++closed_ == connections_)
+                {
+                    loop_->runTask([this] { this->endPhase_(); });
+                }
+            });
+            sources_.push_back(std::move(source));
+        }
+        for (auto& source : sources_)
+        {
+            source->connect();
+        }
+    }
+
+    void measure_()
+    {
+        phase_received_ = sink_.getReceived();
+        phase_cpu_      = cpuSeconds();
+        phase_start_    = Clock::now();
+        loop_->runAfter(seconds_, [this] { this->report_(); });
+    }
+
+    void report_()
+    {
+        auto elapsed  = std::chrono::duration<double>(Clock::now() - phase_start_).count();
+        auto received = static_cast<double>(sink_.getReceived() - phase_received_);
+        auto cpu      = cpuSeconds() - phase_cpu_;
+        std::printf("{\"bench\": \"relay\", \"mode\": \"%s\", \"connections\": %d, \"chunk\": %zu, \"seconds\": %.3f, "
+                    "\"mb_per_s\": %.1f, \"gbit_per_s\": %.2f, \"cpu_s_per_gb\": %.3f}\n",
+                    c_modes[modes_[phase_]].data(),
+                    connections_,
+                    chunk_.size(),
+                    elapsed,
+                    received / elapsed / 1e6,
+                    received * 8 / elapsed / 1e9,
+                    received == 0 ? 0.0 : cpu / (received / 1e9));
+        std::fflush(stdout);
+        // the sources stop and half-close, the proxy forwards the FIN, the sink closes, then the proxy and the sources
+        sending_.store(false);
+        for (auto& source : sources_)
+        {
+            source->disconnect();
+        }
+    }
+
+    void endPhase_()
+    {
+        destroySources_();
+        if (++phase_ < modes_.size())
+        {
+            loop_->runAfter(0.2, [this] { this->startPhase_(); });
+            return;
+        }
+        loop_->quit();
+    }
+
+    /**
+     * @brief the clients are destroyed in their loops, which are still running
+     */
+    void destroySources_()
+    {
+        for (auto& source : sources_)
+        {
+            auto* loop = const_cast<EventLoop*>(source->getLoop());
+            auto done  = std::latch {1};
+            loop->runTask([&] {
+                source.reset();
+                done.count_down();
+            });
+            done.wait();
+        }
+        sources_.clear();
+    }
+
+public:
+    RelayBench(EventLoop* loop, const Sink& sink, int connections, double seconds, size_t chunk, std::vector<size_t> modes)
+        : loop_ {loop}
+        , sink_ {sink}
+        , pool_ {loop, "RelayBench"}
+        , connections_ {connections}
+        , seconds_ {seconds}
+        , modes_ {std::move(modes)}
+        , chunk_(chunk, 'r')
+        , sending_ {false}
+        , connected_ {0}
+        , closed_ {0}
+        , phase_ {0}
+        , phase_received_ {0}
+        , phase_cpu_ {0}
+    {
+        pool_.setThreadNum(2);
+    }
+
+    void start()
+    {
+        pool_.start();
+        startPhase_();
+    }
+};
+
+auto parseModes(std::string_view text)
+    -> std::vector<size_t>
+{
+    auto modes = std::vector<size_t> {};
+    for (size_t i = 0; i < std::size(c_modes); ++i)
+    {
+        if (text.find(c_modes[i]) != std::string_view::npos)
+        {
+            modes.push_back(i);
+        }
+    }
+    return modes;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto connections   = std::max(argc > 1 ? std::atoi(argv[1]) : 8, 1);
+    auto proxy_threads = std::max(argc > 2 ? std::atoi(argv[2]) : 2, 1);
+    auto seconds       = argc > 3 ? std::atof(argv[3]) : 3.0;
+    auto chunk         = static_cast<size_t>(std::max(argc > 4 ? std::atoi(argv[4]) : 64, 1)) * 1024;
+    auto modes         = parseModes(argc > 5 ? argv[5] : "copy,splice");
+    log->setLogLevel(LogLevel::WARN);
+    if (modes.empty())
+    {
+        std::printf("modes: copy, splice\n");
+        return 1;
+    }
+
+    auto loop = EventLoop {};
+
+    // the sink and the proxies accept in a loop of their own, the bench loop only drives the phases
+    auto base = EventLoopThreadPool {&loop, "RelayBenchBase"};
+    base.setThreadNum(1);
+    base.start();
+    auto* base_loop = base.getNextLoop();
+    auto sink       = std::unique_ptr<Sink> {};
+    auto proxies    = std::vector<std::unique_ptr<Proxy>> {};
+    auto ready      = std::latch {1};
+    base_loop->runTask([&] {
+        sink = std::make_unique<Sink>(base_loop, proxy_threads);
+        sink->start();
+        for (size_t i = 0; i < std::size(c_modes); ++i)
+        {
+            proxies.push_back(std::make_unique<Proxy>(base_loop, static_cast<uint16_t>(c_proxy_port + i), proxy_threads, c_modes[i] == "splice"));
+            proxies.back()->start();
+        }
+        ready.count_down();
+    });
+    ready.wait();
+
+    auto bench = RelayBench {&loop, *sink, connections, seconds, chunk, std::move(modes)};
+    bench.start();
+    loop.loop();
+
+    auto done = std::latch {1};
+    base_loop->runTask([&] {
+        proxies.clear();
+        sink.reset();
+        done.count_down();
+    });
+    done.wait();
+    return 0;
+}
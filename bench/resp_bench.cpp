@@ -0,0 +1,362 @@
+/**
+ * @brief RESP commands per second at several pipeline depths, RespClient against RespServer
+ * @details a RespServer with GET and SET over a striped map runs in process, unless a port is given, then the
+ * clients target that server, e.g. a redis-server. Every connection keeps @c depth commands in flight, 90% GET and
+ * 10% SET of random keys, the commands issued in one loop iteration leave in one write. The depths are measured one
+ * after another for @c seconds each, with a pause for the pipelines to drain in between, one line of JSON per depth.
+ * usage: resp_bench [threads=2] [connections=8] [seconds=3] [depths=1,16,128] [host=127.0.0.1] [port]
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/InetAddress.h"
+#include "net/RespClient.h"
+#include "net/RespServer.h"
+#include "net/TcpConnection.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint16_t c_default_port = 16379;
+constexpr uint64_t c_keyspace     = 10000;
+
+/**
+ * @brief GET and SET for the in-process server
+ */
+class StripedMap {
+private:
+    struct Stripe
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::string> map;
+    };
+    std::array<Stripe, 16> stripes_;
+
+    auto stripeOf_(std::string_view key)
+        -> Stripe& { return stripes_[std::hash<std::string_view> {}(key) % stripes_.size()]; }
+
+public:
+    void registerTo(RespServer& server)
+    {
+        server.registerCommand("GET", [this](const TcpConnectionPtr&, std::span<const std::string_view> args, RespWriter& reply) {
+            if (args.size() != 2)
+            {
+                reply.appendError("ERR wrong number of arguments for 'get' command");
+                return;
+            }
+            auto& stripe = stripeOf_(args[1]);
+            auto _       = std::lock_guard<std::mutex> {stripe.mutex};
+            if (auto it = stripe.map.find(std::string {args[1]}); it != stripe.map.end())
+            {
+                reply.appendBulkString(it->second);
+                return;
+            }
+            reply.appendNull();
+        });
+        server.registerCommand("SET", [this](const TcpConnectionPtr&, std::span<const std::string_view> args, RespWriter& reply) {
+            if (args.size() != 3)
+            {
+                reply.appendError("ERR wrong number of arguments for 'set' command");
+                return;
+            }
+            auto& stripe = stripeOf_(args[1]);
+            {
+                auto _ = std::lock_guard<std::mutex> {stripe.mutex};
+                stripe.map[std::string {args[1]}] = args[2];
+            }
+            reply.appendSimpleString("OK");
+        });
+    }
+};
+
+/**
+ * @brief one connection, only touched in its loop except the atomic counters
+ */
+struct Session
+{
+    std::unique_ptr<RespClient> client;
+    EventLoop* loop;
+    uint64_t rng;
+    int outstanding = 0;
+    std::string key;
+    std::atomic<uint64_t> replies {0};
+    std::atomic<uint64_t> errors {0};
+};
+
+class RespBench {
+private:
+    EventLoop* const loop_;
+    EventLoopThreadPool pool_;
+    std::vector<std::unique_ptr<Session>> sessions_;
+    const std::vector<int> depths_;
+    const double seconds_;
+    const int threads_;
+    const std::string value_;
+    std::atomic<int> depth_; // 0 while draining between two depths
+    std::atomic<int> connected_;
+    std::atomic<int> closed_;
+    size_t phase_;
+    uint64_t phase_replies_;
+    uint64_t phase_writes_;
+    Clock::time_point phase_start_;
+
+    void issue_(Session& session)
+    {
+        auto depth = depth_.load(std::memory_order_relaxed);
+        while (session.outstanding < depth)
+        {
+            session.rng ^= session.rng << 13;
+            session.rng ^= session.rng >> 7;
+            session.rng ^= session.rng << 17;
+            session.key = "key:" + std::to_string(session.rng % c_keyspace);
+            auto on_reply = [this, &session](RespValue&& reply) {
+                --session.outstanding;
+                session.replies.fetch_add(1, std::memory_order_relaxed);
+                if (reply.isError())
+                {
+                    session.errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                this->issue_(session);
+            };
+            if (session.rng % 10 == 0)
+            {
+                session.client->command({"SET", session.key, value_}, std::move(on_reply));
+            }
+            else
+            {
+                session.client->command({"GET", session.key}, std::move(on_reply));
+            }
+            ++session.outstanding;
+        }
+    }
+
+    /**
+     * @brief the sum over the sessions, the write counts are read in the session loops
+     */
+    void snapshot_(uint64_t& replies, uint64_t& writes)
+    {
+        replies = 0;
+        writes  = 0;
+        for (auto& session : sessions_)
+        {
+            replies += session->replies.load(std::memory_order_relaxed);
+            auto done = std::latch {1};
+            session->loop->runTask([&] {
+                writes += session->client->getWriteCount();
+                done.count_down();
+            });
+            done.wait();
+        }
+    }
+
+    void startPhase_()
+    {
+        depth_.store(depths_[phase_]);
+        snapshot_(phase_replies_, phase_writes_);
+        phase_start_ = Clock::now();
+        for (auto& session : sessions_)
+        {
+            session->loop->runTask([this, &s = *session] { this->issue_(s); });
+        }
+        loop_->runAfter(seconds_, [this] { this->endPhase_(); });
+    }
+
+    void endPhase_()
+    {
+        auto elapsed = std::chrono::duration<double>(Clock::now() - phase_start_).count();
+        auto replies = uint64_t {0};
+        auto writes  = uint64_t {0};
+        snapshot_(replies, writes);
+        depth_.store(0); // let the pipelines drain
+        replies -= phase_replies_;
+        writes -= phase_writes_;
+        std::printf("{\"bench\": \"resp\", \"depth\": %d, \"connections\": %zu, \"threads\": %d, \"seconds\": %.3f, "
+                    "\"commands_per_s\": %.0f, \"commands_per_write\": %.1f}\n",
+                    depths_[phase_],
+                    sessions_.size(),
+                    threads_,
+                    elapsed,
+                    static_cast<double>(replies) / elapsed,
+                    writes == 0 ? 0.0 : static_cast<double>(replies) / static_cast<double>(writes));
+        std::fflush(stdout);
+
+        if (++phase_ < depths_.size())
+        {
+            loop_->runAfter(0.2, [this] { this->startPhase_(); });
+            return;
+        }
+        loop_->runAfter(0.2, [this] {
+            for (auto& session : sessions_)
+            {
+                session->client->disconnect();
+            }
+        });
+    }
+
+public:
+    RespBench(EventLoop* loop, int threads, std::vector<int> depths, double seconds)
+        : loop_ {loop}
+        , pool_ {loop, "RespBench"}
+        , depths_ {std::move(depths)}
+        , seconds_ {seconds}
+        , threads_ {threads}
+        , value_(32, 'v')
+        , depth_ {0}
+        , connected_ {0}
+        , closed_ {0}
+        , phase_ {0}
+        , phase_replies_ {0}
+        , phase_writes_ {0}
+    {
+        pool_.setThreadNum(threads);
+    }
+
+    void start(const InetAddress& serverAddr, int connections)
+    {
+        pool_.start();
+        for (auto i = 0; i < connections; ++i)
+        {
+            auto session    = std::make_unique<Session>();
+            session->loop   = pool_.getNextLoop();
+            session->rng    = 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(i + 1);
+            session->client = std::make_unique<RespClient>(session->loop, serverAddr, "RespBench#" + std::to_string(i));
+            session->client->setConnectionCallback([this, connections](const TcpConnectionPtr& conn) {
+                if (conn->isConnected())
+                {
+                    if (++connected_ == connections)
+                    {
+                        loop_->runTask([this] { this->startPhase_(); });
+                    }
+                }
+                else if (++closed_ == connections)
+                {
+                    loop_->runTask([this] { loop_->quit(); });
+                }
+            });
+            sessions_.push_back(std::move(session));
+        }
+        for (auto& session : sessions_)
+        {
+            session->client->connect();
+        }
+    }
+
+    /**
+     * @brief the clients are destroyed in their loops, which are still running
+     */
+    void stop()
+    {
+        for (auto& session : sessions_)
+        {
+            auto done = std::latch {1};
+            session->loop->runTask([&] {
+                session->client.reset();
+                done.count_down();
+            });
+            done.wait();
+        }
+    }
+
+    [[nodiscard]] auto getErrors() const
+        -> uint64_t
+    {
+        auto errors = uint64_t {0};
+        for (const auto& session : sessions_)
+        {
+            errors += session->errors.load();
+        }
+        return errors;
+    }
+};
+
+auto parseDepths(const char* text)
+    -> std::vector<int>
+{
+    auto depths = std::vector<int> {};
+    for (const auto* p = text; *p != '\0';)
+    {
+        char* end  = nullptr;
+        auto depth = std::strtol(p, &end, 10);
+        if (end == p)
+        {
+            break;
+        }
+        depths.push_back(std::max(static_cast<int>(depth), 1));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return depths;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto threads     = std::max(argc > 1 ? std::atoi(argv[1]) : 2, 1);
+    auto connections = std::max(argc > 2 ? std::atoi(argv[2]) : 8, 1);
+    auto seconds     = argc > 3 ? std::atof(argv[3]) : 3.0;
+    auto depths      = parseDepths(argc > 4 ? argv[4] : "1,16,128");
+    auto host        = std::string {argc > 5 ? argv[5] : "127.0.0.1"};
+    auto external    = argc > 6;
+    auto port        = external ? static_cast<uint16_t>(std::atoi(argv[6])) : c_default_port;
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop = EventLoop {};
+
+    // the in-process server has its own loops, as many as the clients
+    auto server_base = std::unique_ptr<EventLoopThreadPool> {};
+    auto server      = std::unique_ptr<RespServer> {};
+    auto map         = StripedMap {};
+    if (not external)
+    {
+        server_base = std::make_unique<EventLoopThreadPool>(&loop, "RespBenchServerBase");
+        server_base->setThreadNum(1);
+        server_base->start();
+        auto* server_loop = server_base->getNextLoop();
+        auto ready        = std::latch {1};
+        server_loop->runTask([&] {
+            server = std::make_unique<RespServer>(server_loop, InetAddress {port, true}, "RespBenchServer");
+            server->setThreadNum(threads);
+            map.registerTo(*server);
+            server->start();
+            ready.count_down();
+        });
+        ready.wait();
+    }
+
+    auto bench = RespBench {&loop, threads, depths, seconds};
+    bench.start(InetAddress {host, port}, connections);
+    loop.loop();
+    bench.stop();
+    if (auto errors = bench.getErrors(); errors != 0)
+    {
+        std::printf("%lu error replies\n", errors);
+    }
+    if (server != nullptr)
+    {
+        auto done = std::latch {1};
+        server_base->getNextLoop()->runTask([&] {
+            server.reset();
+            done.count_down();
+        });
+        done.wait();
+    }
+    return 0;
+}
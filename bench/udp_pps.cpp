@@ -0,0 +1,127 @@
+/**
+ * @brief packets/sec over loopback: client sockets blast datagrams at a UdpServer which only counts them
+ * usage: udp_pps [server_threads=1] [client_sockets=1] [msg_size=64] [seconds=5] [batch_size=64]
+ */
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/InetAddress.h"
+#include "net/UdpServer.h"
+#include "net/UdpSocket.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+// datagrams queued per task, they leave with one sendmmsg
+constexpr int c_burst = 256;
+
+std::atomic<bool> g_running {true};
+
+struct Blaster
+{
+    UdpSocketPtr client;
+    InetAddress server;
+    std::string payload;
+};
+
+void blast(const std::shared_ptr<Blaster>& blaster)
+{
+    if (not g_running.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    for (auto i = 0; i < c_burst; ++i)
+    {
+        blaster->client->send(blaster->server, blaster->payload);
+    }
+    blaster->client->flush();
+    // queueTask rather than a loop, so the client loop still serves its sockets and timers
+    blaster->client->getLoop()->queueTask([blaster] {
+        blast(blaster);
+    });
+}
+
+auto argOr(int argc, char* argv[], int idx, int dflt)
+    -> int
+{
+    return argc > idx ? std::atoi(argv[idx]) : dflt;
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto server_threads = argOr(argc, argv, 1, 1);
+    auto client_num     = argOr(argc, argv, 2, 1);
+    auto msg_size       = argOr(argc, argv, 3, 64);
+    auto seconds        = argOr(argc, argv, 4, 5);
+    auto batch_size     = argOr(argc, argv, 5, static_cast<int>(UdpSocket::c_default_batch_size));
+    log->setLogLevel(LogLevel::WARN);
+
+    auto loop   = EventLoop {};
+    auto server = UdpServer {&loop, InetAddress {0, true}, "UdpPps"};
+    server.setThreadNum(server_threads);
+    server.setBatchSize(static_cast<size_t>(batch_size));
+    server.start();
+    auto server_addr = server.getSockets().front()->getLocalAddress();
+
+    auto client_pool = EventLoopThreadPool {&loop, "UdpPpsClient"};
+    client_pool.setThreadNum(client_num);
+    client_pool.start();
+    auto payload = std::string(static_cast<size_t>(msg_size), 'x');
+    auto clients = std::vector<UdpSocketPtr> {};
+    for (auto i = 0; i < client_num; ++i)
+    {
+        auto* client_loop = client_pool.getNextLoop();
+        clients.push_back(std::make_shared<UdpSocket>(client_loop, InetAddress {0, true}));
+    }
+    for (const auto& client : clients)
+    {
+        client->start();
+        auto blaster = std::make_shared<Blaster>(Blaster {client, server_addr, payload});
+        client->getLoop()->runTask([blaster] {
+            blast(blaster);
+        });
+    }
+
+    // skip the first second, the warm up
+    auto begin = UdpSocket::Stats {};
+    loop.runAfter(1.0, [&] { begin = server.getStats(); });
+    loop.runAfter(1.0 + seconds, [&] {
+        auto end  = server.getStats();
+        auto rx   = end.rx_datagrams - begin.rx_datagrams;
+        auto sent = uint64_t {0};
+        auto drop = uint64_t {0};
+        for (const auto& client : clients)
+        {
+            sent += client->getStats().tx_datagrams;
+            drop += client->getStats().tx_dropped;
+        }
+        std::printf("server_threads=%d clients=%d msg_size=%d batch=%d\n", server_threads, client_num, msg_size, batch_size);
+        std::printf("rx %.0f pkts/s, %.2f MB/s, %.1f datagrams per recvmmsg, truncated %lu\n",
+                    static_cast<double>(rx) / seconds,
+                    static_cast<double>(end.rx_bytes - begin.rx_bytes) / seconds / 1024 / 1024,
+                    static_cast<double>(rx) / static_cast<double>(std::max<uint64_t>(end.rx_syscalls - begin.rx_syscalls, 1)),
+                    end.rx_truncated);
+        std::printf("clients sent %lu, dropped %lu (client queue full)\n", sent, drop);
+        loop.quit();
+    });
+    loop.loop();
+
+    g_running = false;
+    for (const auto& client : clients)
+    {
+        client->stop();
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * @brief same-host request/response latency, unix domain socket vs loopback TCP
+ * @details one client sends a message, the echo server returns it, the next message leaves once the whole echo is back
+ * usage: unix_latency [msg_size=64] [round_trips=50000]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+auto percentile(const std::vector<double>& sorted, double p)
+    -> double
+{
+    auto idx = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+    return sorted[idx];
+}
+
+/**
+ * @return round trip latencies in microseconds
+ */
+auto measure(const InetAddress& addr, size_t msgSize, int roundTrips)
+    -> std::vector<double>
+{
+    auto loop   = EventLoop {};
+    auto server = std::make_shared<TcpServer>(&loop, addr, "LatencyEcho");
+    server->setThreadNum(1); // the server answers from another thread, as a separate process would
+    server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        conn->send(buf.readAllAsString());
+    });
+    server->start();
+
+    auto message   = std::string(msgSize, 'x');
+    auto latencies = std::vector<double> {};
+    latencies.reserve(static_cast<size_t>(roundTrips));
+    auto sent_at  = Clock::time_point {};
+    auto received = size_t {0};
+
+    auto client = std::make_shared<TcpClient>(&loop, addr, "LatencyClient");
+    client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            if (not conn->isUnix())
+            {
+                conn->setTcpNoDelay(true);
+            }
+            sent_at = Clock::now();
+            conn->send(message);
+        }
+    });
+    client->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        received += buf.getReadableBytesCount();
+        buf.readAllAndDiscard();
+        if (received < msgSize)
+        {
+            return;
+        }
+        received = 0;
+        latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent_at).count());
+        if (latencies.size() == static_cast<size_t>(roundTrips))
+        {
+            client->disconnect();
+            loop.runAfter(0.1, [&loop] { loop.quit(); });
+            return;
+        }
+        sent_at = Clock::now();
+        conn->send(message);
+    });
+    client->connect();
+    loop.loop();
+    return latencies;
+}
+
+void report(const char* transport, std::vector<double> latencies)
+{
+    if (latencies.empty())
+    {
+        std::printf("%-6s no result\n", transport);
+        return;
+    }
+    std::ranges::sort(latencies);
+    auto sum = 0.0;
+    for (auto latency : latencies)
+    {
+        sum += latency;
+    }
+    std::printf("%-6s round trips %zu  avg %.2f us  p50 %.2f us  p99 %.2f us  p99.9 %.2f us  max %.2f us\n",
+                transport,
+                latencies.size(),
+                sum / static_cast<double>(latencies.size()),
+                percentile(latencies, 0.50),
+                percentile(latencies, 0.99),
+                percentile(latencies, 0.999),
+                latencies.back());
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto msg_size    = static_cast<size_t>(argc > 1 ? std::atoi(argv[1]) : 64);
+    auto round_trips = argc > 2 ? std::atoi(argv[2]) : 50000;
+    log->setLogLevel(LogLevel::WARN);
+
+    std::printf("msg_size=%zu round_trips=%d\n", msg_size, round_trips);
+    report("tcp", measure(InetAddress {23458, true}, msg_size, round_trips));
+    auto unix_path = "@cotweb-unix-latency-" + std::to_string(::getpid());
+    report("unix", measure(InetAddress::fromUnixPath(unix_path), msg_size, round_trips));
+    return 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * @brief bulk send throughput and sender CPU cost, plain copying send() vs MSG_ZEROCOPY
+ * @details the client streams the same large payload over and over to a discarding server running in another thread,
+ * the next payload is queued from the write complete callback. The CPU time is the one of the sending loop thread only.
+ * Over loopback the kernel has to copy the pages to the receiver anyway, the completions are then reported as copied,
+ * run the sink on another host for the real zerocopy numbers.
+ * usage: zerocopy_send [payload_kb=1024] [total_mb=4096] [mode=both|copy|zerocopy]
+ */
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+auto threadCpuSeconds()
+    -> double
+{
+    auto ts = timespec {};
+    ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+void measure(bool zerocopy, size_t payloadBytes, uint64_t totalBytes)
+{
+    auto loop   = EventLoop {};
+    auto addr   = InetAddress {23459, true};
+    auto server = std::make_shared<TcpServer>(&loop, addr, "ZeroCopySink");
+    server->setThreadNum(1);
+    auto payload   = std::make_shared<const std::string>(payloadBytes, 'z');
+    auto queued    = uint64_t {0};
+    auto started   = Clock::time_point {};
+    auto cpu_start = 0.0;
+    auto seconds   = 0.0;
+    auto cpu       = 0.0;
+    auto stats     = TcpConnection::ZeroCopyStats {};
+    auto enabled   = false;
+    auto received  = std::atomic<uint64_t> {0};
+    auto sender    = TcpConnectionPtr {};
+
+    auto client = std::make_shared<TcpClient>(&loop, addr, "ZeroCopySender");
+    server->setMessageCallback([&](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+        auto bytes  = buf.getReadableBytesCount();
+        auto before = received.fetch_add(bytes);
+        buf.readAllAndDiscard();
+        if (before < totalBytes and before + bytes >= totalBytes) // everything arrived, once only
+        {
+            loop.runTask([&] {
+                seconds = std::chrono::duration<double>(Clock::now() - started).count();
+                cpu     = threadCpuSeconds() - cpu_start;
+                stats   = sender->getZeroCopyStats();
+                sender.reset();
+                client->disconnect();
+                loop.runAfter(0.1, [&loop] { loop.quit(); });
+            });
+        }
+    });
+    server->start();
+
+    auto send_next = [&](const TcpConnectionPtr& conn) {
+        if (queued < totalBytes)
+        {
+            queued += payload->size();
+            conn->sendZeroCopy(payload);
+        }
+    };
+    client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            sender    = conn;
+            enabled   = zerocopy and conn->enableZeroCopy();
+            started   = Clock::now();
+            cpu_start = threadCpuSeconds();
+            // two in flight, the socket never runs dry while the next one is queued
+            send_next(conn);
+            send_next(conn);
+        }
+    });
+    client->setWriteCompleteCallback(send_next);
+    client->connect();
+    loop.loop();
+
+    auto gb = static_cast<double>(received.load()) / 1e9;
+
+    std::printf("%-8s %.2f GB in %.2f s  %.2f GB/s  sender cpu %.3f s/GB",
+                zerocopy ? (enabled ? "zerocopy" : "zc-unsup") : "copy",
+                gb,
+                seconds,
+                gb / seconds,
+                cpu / gb);
+    if (zerocopy)
+    {
+        std::printf("  zc sends %lu completions %lu copied %lu fallback %lu",
+                    stats.zerocopy_sends,
+                    stats.completions,
+                    stats.copied,
+                    stats.fallback_sends);
+    }
+    std::printf("\n");
+}
+
+} // namespace
+
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto payload_bytes = static_cast<size_t>(argc > 1 ? std::atoi(argv[1]) : 1024) * 1024;
+    auto total_bytes   = static_cast<uint64_t>(argc > 2 ? std::atoll(argv[2]) : 4096) * 1024 * 1024;
+    auto mode          = std::string_view {argc > 3 ? argv[3] : "both"};
+    log->setLogLevel(LogLevel::WARN);
+
+    std::printf("payload=%zu KB total=%lu MB\n", payload_bytes / 1024, total_bytes / 1024 / 1024);
+    if (mode != "zerocopy")
+    {
+        measure(false, payload_bytes, total_bytes);
+    }
+    if (mode != "copy")
+    {
+        measure(true, payload_bytes, total_bytes);
+    }
+    return 0;
+}
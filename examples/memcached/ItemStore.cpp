@@ -0,0 +1,431 @@
+#include "ItemStore.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <utility>
+
+namespace {
+
+// memcached: an exptime beyond 30 days is an absolute unix time
+constexpr int64_t c_max_relative_exptime = 60 * 60 * 24 * 30;
+
+auto absoluteExptime(int64_t exptime)
+    -> int64_t
+{
+    if (exptime <= 0 or exptime > c_max_relative_exptime)
+    {
+        return exptime < 0 ? 1 : exptime; // negative: already expired
+    }
+    return ::time(nullptr) + exptime;
+}
+
+} // namespace
+
+ItemStore::ItemRef::~ItemRef()
+{
+    if (item_ != nullptr)
+    {
+        auto _ = std::lock_guard<std::mutex> {shard_->mutex};
+        --item_->refcount;
+        store_->freeIfUnused_(*shard_, item_);
+    }
+}
+
+ItemStore::ItemRef::ItemRef(ItemRef&& other) noexcept
+    : store_ {other.store_}
+    , shard_ {other.shard_}
+    , item_ {std::exchange(other.item_, nullptr)}
+{
+}
+
+auto ItemStore::ItemRef::operator=(ItemRef&& other) noexcept
+    -> ItemRef&
+{
+    if (this != &other)
+    {
+        auto dropped = std::move(*this); // released at the end of the scope
+        store_       = other.store_;
+        shard_       = other.shard_;
+        item_        = std::exchange(other.item_, nullptr);
+    }
+    return *this;
+}
+
+ItemStore::ItemStore(size_t memoryLimit, size_t shardCount)
+    : next_cas_ {1}
+    , memory_limit_ {memoryLimit}
+{
+    for (auto size = c_min_chunk; size < c_page_size; size = static_cast<size_t>(static_cast<double>(size) * c_growth_factor))
+    {
+        class_sizes_.push_back((size + 7) & ~size_t {7}); // the items stay 8 bytes aligned
+    }
+    class_sizes_.push_back(c_page_size);
+
+    shardCount      = std::max<size_t>(shardCount, 1);
+    auto page_limit = std::max<size_t>(memoryLimit / c_page_size / shardCount, 1);
+    for (size_t i = 0; i < shardCount; ++i)
+    {
+        auto shard        = std::make_unique<Shard>();
+        shard->page_limit = page_limit;
+        for (auto size : class_sizes_)
+        {
+            shard->classes.push_back(SlabClass {.chunk_size = size});
+        }
+        shards_.push_back(std::move(shard));
+    }
+}
+
+ItemStore::~ItemStore() = default; // the pages go with the shards, no ItemRef may be alive
+
+auto ItemStore::shardOf_(std::string_view key)
+    -> Shard&
+{
+    return *shards_[std::hash<std::string_view> {}(key) % shards_.size()];
+}
+
+auto ItemStore::classOf_(size_t itemSize) const
+    -> int
+{
+    auto it = std::ranges::lower_bound(class_sizes_, itemSize);
+    return it == class_sizes_.end() ? -1 : static_cast<int>(it - class_sizes_.begin());
+}
+
+auto ItemStore::allocate_(Shard& shard, int cls)
+    -> Item*
+{
+    auto& slab = shard.classes[static_cast<size_t>(cls)];
+    if (slab.free_chunks.empty() and shard.pages.size() < shard.page_limit)
+    {
+        cutPage_(shard, shard.pages.emplace_back(Page {.memory = std::unique_ptr<char[]> {new char[c_page_size]}}), cls);
+    }
+    if (slab.free_chunks.empty())
+    {
+        // out of pages, evict the least recently used unreferenced item of the same class
+        auto* victim = slab.lru_tail;
+        for (auto tries = 0; victim != nullptr and tries < c_max_eviction_tries; ++tries, victim = victim->prev)
+        {
+            if (victim->refcount == 0)
+            {
+                ++shard.evictions;
+                unlink_(shard, victim); // frees the chunk
+                break;
+            }
+        }
+    }
+    if (slab.free_chunks.empty() and not reclaimPage_(shard, cls))
+    {
+        return nullptr;
+    }
+    auto* chunk = slab.free_chunks.back();
+    slab.free_chunks.pop_back();
+    return reinterpret_cast<Item*>(chunk);
+}
+
+void ItemStore::cutPage_(Shard& shard, Page& page, int cls)
+{
+    auto& slab      = shard.classes[static_cast<size_t>(cls)];
+    page.slab_class = cls;
+    for (size_t offset = 0; offset + slab.chunk_size <= c_page_size; offset += slab.chunk_size)
+    {
+        // a free chunk is an unlinked item without reference, which tells it apart when the page is reclaimed
+        auto* item     = reinterpret_cast<Item*>(page.memory.get() + offset);
+        item->linked   = false;
+        item->refcount = 0;
+        slab.free_chunks.push_back(page.memory.get() + offset);
+    }
+}
+
+auto ItemStore::reclaimPage_(Shard& shard, int cls)
+    -> bool
+{
+    for (size_t n = 0; n < shard.pages.size(); ++n)
+    {
+        auto& page = shard.pages[(shard.next_reclaim + n) % shard.pages.size()];
+        if (page.slab_class == cls)
+        {
+            continue;
+        }
+        auto& owner = shard.classes[static_cast<size_t>(page.slab_class)];
+        auto* begin = page.memory.get();
+        auto* end   = begin + c_page_size - owner.chunk_size + 1; // past the start of the last chunk
+        auto busy   = false;
+        for (auto* chunk = begin; chunk < end and not busy; chunk += owner.chunk_size)
+        {
+            busy = reinterpret_cast<Item*>(chunk)->refcount != 0; // its memory is still being sent
+        }
+        if (busy)
+        {
+            continue;
+        }
+        for (auto* chunk = begin; chunk < end; chunk += owner.chunk_size)
+        {
+            if (auto* item = reinterpret_cast<Item*>(chunk); item->linked)
+            {
+                ++shard.evictions;
+                unlink_(shard, item);
+            }
+        }
+        std::erase_if(owner.free_chunks, [&](char* chunk) { return chunk >= begin and chunk < end; });
+        cutPage_(shard, page, cls);
+        ++shard.slabs_moved;
+        shard.next_reclaim = (shard.next_reclaim + n + 1) % shard.pages.size();
+        return true;
+    }
+    return false;
+}
+
+void ItemStore::link_(Shard& shard, Item* item)
+{
+    auto& slab   = shard.classes[item->slab_class];
+    item->linked = true;
+    item->prev   = nullptr;
+    item->next   = slab.lru_head;
+    if (slab.lru_head != nullptr)
+    {
+        slab.lru_head->prev = item;
+    }
+    slab.lru_head = item;
+    if (slab.lru_tail == nullptr)
+    {
+        slab.lru_tail = item;
+    }
+    shard.table[item->key()] = item;
+    ++shard.items;
+    shard.bytes += item->key_len + item->value_len;
+}
+
+void ItemStore::unlink_(Shard& shard, Item* item)
+{
+    assert(item->linked);
+    auto& slab = shard.classes[item->slab_class];
+    (item->prev != nullptr ? item->prev->next : slab.lru_head) = item->next;
+    (item->next != nullptr ? item->next->prev : slab.lru_tail) = item->prev;
+    shard.table.erase(item->key());
+    item->linked = false;
+    --shard.items;
+    shard.bytes -= item->key_len + item->value_len;
+    freeIfUnused_(shard, item);
+}
+
+void ItemStore::freeIfUnused_(Shard& shard, Item* item)
+{
+    if (not item->linked and item->refcount == 0)
+    {
+        shard.classes[item->slab_class].free_chunks.push_back(reinterpret_cast<char*>(item));
+    }
+}
+
+void ItemStore::touch_(Shard& shard, Item* item)
+{
+    auto& slab = shard.classes[item->slab_class];
+    if (slab.lru_head == item)
+    {
+        return;
+    }
+    item->prev->next                                           = item->next;
+    (item->next != nullptr ? item->next->prev : slab.lru_tail) = item->prev;
+    item->prev                                                 = nullptr;
+    item->next                                                 = slab.lru_head;
+    slab.lru_head->prev                                        = item;
+    slab.lru_head                                              = item;
+}
+
+auto ItemStore::find_(Shard& shard, std::string_view key)
+    -> Item*
+{
+    auto it = shard.table.find(key);
+    if (it == shard.table.end())
+    {
+        return nullptr;
+    }
+    auto* item = it->second;
+    if (item->exptime != 0 and item->exptime <= ::time(nullptr))
+    {
+        unlink_(shard, item);
+        return nullptr;
+    }
+    return item;
+}
+
+auto ItemStore::newItem_(Shard& shard, std::string_view key, uint32_t flags, int64_t exptime, std::string_view value)
+    -> std::expected<Item*, StoreResult>
+{
+    auto cls = classOf_(sizeof(Item) + key.size() + value.size() + 2);
+    if (cls < 0 or key.size() > c_max_key_len)
+    {
+        return std::unexpected {StoreResult::TooLarge};
+    }
+    auto* item = allocate_(shard, cls);
+    if (item == nullptr)
+    {
+        return std::unexpected {StoreResult::OutOfMemory};
+    }
+    item->cas        = next_cas_.fetch_add(1, std::memory_order_relaxed);
+    item->flags      = flags;
+    item->exptime    = exptime;
+    item->value_len  = static_cast<uint32_t>(value.size() + 2);
+    item->refcount   = 0;
+    item->key_len    = static_cast<uint8_t>(key.size());
+    item->slab_class = static_cast<uint8_t>(cls);
+    item->linked     = false;
+    std::memcpy(item->data(), key.data(), key.size());
+    std::memcpy(item->data() + key.size(), value.data(), value.size());
+    std::memcpy(item->data() + key.size() + value.size(), "\r\n", 2);
+    return item;
+}
+
+auto ItemStore::get(std::string_view key)
+    -> ItemRef
+{
+    auto& shard = shardOf_(key);
+    auto _      = std::lock_guard<std::mutex> {shard.mutex};
+    auto* item  = find_(shard, key);
+    if (item == nullptr)
+    {
+        ++shard.get_misses;
+        return ItemRef {};
+    }
+    ++shard.get_hits;
+    ++item->refcount;
+    touch_(shard, item);
+    return ItemRef {this, &shard, item};
+}
+
+auto ItemStore::store(StoreMode mode,
+                      std::string_view key,
+                      uint32_t flags,
+                      int64_t exptime,
+                      std::string_view value,
+                      uint64_t casUnique)
+    -> StoreResult
+{
+    auto& shard = shardOf_(key);
+    auto _      = std::lock_guard<std::mutex> {shard.mutex};
+    auto* old   = find_(shard, key);
+    switch (mode)
+    {
+        case StoreMode::Set:
+            break;
+        case StoreMode::Add:
+            if (old != nullptr)
+            {
+                touch_(shard, old);
+                return StoreResult::NotStored;
+            }
+            break;
+        case StoreMode::Replace:
+            if (old == nullptr)
+            {
+                return StoreResult::NotStored;
+            }
+            break;
+        case StoreMode::Cas:
+            if (old == nullptr)
+            {
+                return StoreResult::NotFound;
+            }
+            if (old->cas != casUnique)
+            {
+                return StoreResult::Exists;
+            }
+            break;
+    }
+
+    auto item = newItem_(shard, key, flags, absoluteExptime(exptime), value);
+    if (not item.has_value())
+    {
+        return item.error();
+    }
+    // look up again, the eviction may have taken the old item
+    if (auto it = shard.table.find(key); it != shard.table.end())
+    {
+        unlink_(shard, it->second);
+    }
+    link_(shard, *item);
+    return StoreResult::Stored;
+}
+
+auto ItemStore::remove(std::string_view key)
+    -> bool
+{
+    auto& shard = shardOf_(key);
+    auto _      = std::lock_guard<std::mutex> {shard.mutex};
+    auto* item  = find_(shard, key);
+    if (item == nullptr)
+    {
+        return false;
+    }
+    unlink_(shard, item);
+    return true;
+}
+
+auto ItemStore::incr(std::string_view key, uint64_t delta, bool decr)
+    -> std::expected<uint64_t, IncrError>
+{
+    auto& shard = shardOf_(key);
+    auto _      = std::lock_guard<std::mutex> {shard.mutex};
+    auto* item  = find_(shard, key);
+    if (item == nullptr)
+    {
+        return std::unexpected {IncrError::NotFound};
+    }
+    auto text       = item->valueWithCrLf().substr(0, item->valueBytes());
+    auto digits_len = text.find_last_not_of(' ') + 1; // an earlier in place decr padded the number by spaces
+    auto number     = uint64_t {0};
+    if (auto [end, ec] = std::from_chars(text.data(), text.data() + digits_len, number);
+        text.empty() or ec != std::errc {} or end != text.data() + digits_len)
+    {
+        return std::unexpected {IncrError::NotNumeric};
+    }
+    number = decr ? (number > delta ? number - delta : 0) : number + delta;
+
+    auto digits = std::array<char, 24> {};
+    auto length = std::to_chars(digits.begin(), digits.end(), number).ptr - digits.begin();
+    auto value  = std::string_view {digits.data(), static_cast<size_t>(length)};
+    if (value.size() <= text.size() and item->refcount == 0)
+    {
+        // in place, padded by spaces as memcached does
+        auto* dst = item->data() + item->key_len;
+        std::memcpy(dst, value.data(), value.size());
+        std::memset(dst + value.size(), ' ', text.size() - value.size());
+        item->cas = next_cas_.fetch_add(1, std::memory_order_relaxed);
+        touch_(shard, item);
+        return number;
+    }
+    auto flags   = item->flags;
+    auto exptime = item->exptime;
+    auto fresh   = newItem_(shard, key, flags, exptime, value);
+    if (not fresh.has_value())
+    {
+        return std::unexpected {IncrError::OutOfMemory};
+    }
+    if (auto it = shard.table.find(key); it != shard.table.end())
+    {
+        unlink_(shard, it->second);
+    }
+    link_(shard, *fresh);
+    return number;
+}
+
+auto ItemStore::getStats()
+    -> Stats
+{
+    auto stats = Stats {.limit_bytes = memory_limit_};
+    for (auto& shard : shards_)
+    {
+        auto _ = std::lock_guard<std::mutex> {shard->mutex};
+        stats.items += shard->items;
+        stats.bytes += shard->bytes;
+        stats.pages += shard->pages.size();
+        stats.get_hits += shard->get_hits;
+        stats.get_misses += shard->get_misses;
+        stats.evictions += shard->evictions;
+        stats.slabs_moved += shard->slabs_moved;
+    }
+    return stats;
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <expected>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief one cached item, living in a slab chunk: this header, the key, then the value with its trailing "\r\n",
+ * so that a get reply sends the value as it is
+ */
+struct Item
+{
+    Item* prev; // LRU of its slab class in its shard, the most recently used at the head
+    Item* next;
+    uint64_t cas;
+    uint32_t flags;
+    int64_t exptime;    // unix seconds, 0: never
+    uint32_t value_len; // with "\r\n"
+    uint32_t refcount;  // ItemRefs alive, the chunk is reused only when unlinked and no more referenced
+    uint8_t key_len;
+    uint8_t slab_class;
+    bool linked; // in the hash table and the LRU
+
+    [[nodiscard]] auto data() const
+        -> const char* { return reinterpret_cast<const char*>(this + 1); }
+
+    auto data()
+        -> char* { return reinterpret_cast<char*>(this + 1); }
+
+    [[nodiscard]] auto key() const
+        -> std::string_view { return {data(), key_len}; }
+
+    /**
+     * @brief the value and the "\r\n" after it
+     */
+    [[nodiscard]] auto valueWithCrLf() const
+        -> std::string_view { return {data() + key_len, value_len}; }
+
+    [[nodiscard]] auto valueBytes() const
+        -> uint32_t { return value_len - 2; }
+};
+
+/**
+ * @brief the in-memory key value store of the memcached example
+ * @details
+ * 1. the key space is split into shards by key hash, each behind its own mutex, so the loops of the server
+ *    rarely contend on the same lock
+ * 2. every shard owns its memory: 1MB pages cut into chunks of size classes growing by 1.25, no malloc per item.
+ *    Once the shard reached its share of the memory limit, storing an item evicts the least recently used item
+ *    of the same size class. If that class has nothing to evict, e.g. no page at all after the value sizes shifted,
+ *    a page of another class is taken over: its items are evicted and it is cut again for the class in need
+ * 3. a get returns a referencing ItemRef, the value is sent from the chunk itself, which is reused only after the
+ *    last reference is dropped
+ */
+class ItemStore {
+public:
+    inline static constexpr size_t c_page_size     = 1024 * 1024;
+    inline static constexpr size_t c_min_chunk     = 96;
+    inline static constexpr double c_growth_factor = 1.25;
+    inline static constexpr size_t c_max_key_len   = 250;
+    // evict at most so many referenced items at the LRU tail before giving up
+    inline static constexpr int c_max_eviction_tries = 5;
+
+    enum class StoreMode {
+        Set,
+        Add,     // only if absent
+        Replace, // only if present
+        Cas,     // only if present and not modified since the gets returning the cas
+    };
+
+    enum class StoreResult {
+        Stored,
+        NotStored, // add or replace condition failed
+        Exists,    // cas modified in the meantime
+        NotFound,  // cas of an absent key
+        TooLarge,
+        OutOfMemory,
+    };
+
+    enum class IncrError {
+        NotFound,
+        NotNumeric,
+        OutOfMemory,
+    };
+
+    struct Stats
+    {
+        uint64_t items;
+        uint64_t bytes; // keys and values
+        uint64_t pages;
+        uint64_t get_hits;
+        uint64_t get_misses;
+        uint64_t evictions;
+        uint64_t slabs_moved; // pages taken over by another class
+        uint64_t limit_bytes;
+    };
+
+private:
+    struct SlabClass
+    {
+        size_t chunk_size;
+        std::vector<char*> free_chunks;
+        Item* lru_head = nullptr;
+        Item* lru_tail = nullptr;
+    };
+
+    struct Page
+    {
+        std::unique_ptr<char[]> memory;
+        int slab_class;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string_view, Item*> table; // keys point into the items
+        std::vector<SlabClass> classes;
+        std::vector<Page> pages;
+        size_t page_limit;
+        size_t next_reclaim = 0; // the page tried first by the next reclaim, round-robin
+        uint64_t items       = 0;
+        uint64_t bytes       = 0;
+        uint64_t get_hits    = 0;
+        uint64_t get_misses  = 0;
+        uint64_t evictions   = 0;
+        uint64_t slabs_moved = 0;
+    };
+
+    std::vector<size_t> class_sizes_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::atomic<uint64_t> next_cas_;
+    const size_t memory_limit_;
+
+    auto shardOf_(std::string_view key)
+        -> Shard&;
+    auto classOf_(size_t itemSize) const
+        -> int; // -1 if larger than a page
+
+    /**
+     * @brief a free chunk of @c cls, from the free list, a new page or by eviction. With the shard locked
+     */
+    auto allocate_(Shard& shard, int cls)
+        -> Item*;
+    /**
+     * @brief cut @c page into free chunks of @c cls
+     */
+    void cutPage_(Shard& shard, Page& page, int cls);
+    /**
+     * @brief take a page of another class over for @c cls: the first one, round-robin, without a referenced item,
+     * its linked items are evicted
+     * @return false if every page of the other classes holds a referenced item
+     */
+    auto reclaimPage_(Shard& shard, int cls)
+        -> bool;
+    void link_(Shard& shard, Item* item);
+    void unlink_(Shard& shard, Item* item);
+    /**
+     * @brief give the chunk back if the item is unlinked and unreferenced
+     */
+    void freeIfUnused_(Shard& shard, Item* item);
+    void touch_(Shard& shard, Item* item);
+    /**
+     * @return the item of @c key, nullptr if absent or expired (then it is unlinked). With the shard locked
+     */
+    auto find_(Shard& shard, std::string_view key)
+        -> Item*;
+    auto newItem_(Shard& shard, std::string_view key, uint32_t flags, int64_t exptime, std::string_view value)
+        -> std::expected<Item*, StoreResult>;
+
+public:
+    /**
+     * @brief a reference keeping a found item's memory valid, the item may be replaced or deleted meanwhile
+     */
+    class ItemRef {
+        friend class ItemStore;
+
+    private:
+        ItemStore* store_;
+        Shard* shard_;
+        Item* item_;
+
+        ItemRef(ItemStore* store, Shard* shard, Item* item)
+            : store_ {store}
+            , shard_ {shard}
+            , item_ {item}
+        {
+        }
+
+    public:
+        ItemRef()
+            : store_ {nullptr}
+            , shard_ {nullptr}
+            , item_ {nullptr}
+        {
+        }
+        ~ItemRef();
+        ItemRef(const ItemRef&)                    = delete;
+        auto operator=(const ItemRef&) -> ItemRef& = delete;
+        ItemRef(ItemRef&& other) noexcept;
+        auto operator=(ItemRef&& other) noexcept -> ItemRef&;
+
+        explicit operator bool() const { return item_ != nullptr; }
+        auto operator->() const
+            -> const Item* { return item_; }
+    };
+
+    /**
+     * @param memoryLimit of all the pages together, at least one page per shard
+     */
+    ItemStore(size_t memoryLimit, size_t shardCount);
+    ~ItemStore();
+
+    ItemStore(const ItemStore&)                    = delete;
+    auto operator=(const ItemStore&) -> ItemStore& = delete;
+    ItemStore(ItemStore&&)                         = delete;
+    auto operator=(ItemStore&&) -> ItemStore&      = delete;
+
+    /**
+     * @brief the maximal value size storable with a key of @c keyLen bytes
+     */
+    [[nodiscard]] static auto maxValueSize(size_t keyLen)
+        -> size_t { return c_page_size - sizeof(Item) - keyLen - 2; }
+
+    /**
+     * @thread safe
+     */
+    auto get(std::string_view key)
+        -> ItemRef;
+
+    /**
+     * @param exptime memcached style: 0 never, up to 30 days relative seconds, otherwise unix time
+     * @thread safe
+     */
+    auto store(StoreMode mode,
+               std::string_view key,
+               uint32_t flags,
+               int64_t exptime,
+               std::string_view value,
+               uint64_t casUnique = 0)
+        -> StoreResult;
+
+    /**
+     * @thread safe
+     */
+    auto remove(std::string_view key)
+        -> bool;
+
+    /**
+     * @brief decr stops at 0, incr wraps around at 2^64
+     * @thread safe
+     */
+    auto incr(std::string_view key, uint64_t delta, bool decr)
+        -> std::expected<uint64_t, IncrError>;
+
+    [[nodiscard]] auto getStats()
+        -> Stats;
+};
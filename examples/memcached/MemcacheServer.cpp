@@ -0,0 +1,367 @@
+#include "MemcacheServer.h"
+
+#include <charconv>
+#include <format>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+/**
+ * @brief the replies of one message callback: status lines and value headers in one string,
+ * the values referenced in place, sent together by one TcpConnection::sendGathered
+ */
+class ReplyBatch {
+private:
+    struct Piece
+    {
+        std::string_view value; // empty data(): the text piece [text_offset, text_offset + text_len)
+        size_t text_offset;
+        size_t text_len;
+    };
+
+    std::string text_;
+    std::vector<Piece> pieces_;
+    std::vector<ItemStore::ItemRef> refs_;
+    std::vector<std::string_view> views_;
+
+    void textAppended_(size_t offset)
+    {
+        if (not pieces_.empty() and pieces_.back().value.data() == nullptr)
+        {
+            pieces_.back().text_len += text_.size() - offset;
+        }
+        else
+        {
+            pieces_.push_back(Piece {.value = {}, .text_offset = offset, .text_len = text_.size() - offset});
+        }
+    }
+
+public:
+    bool close_after = false;
+
+    void appendText(std::string_view text)
+    {
+        auto offset = text_.size();
+        text_.append(text);
+        textAppended_(offset);
+    }
+
+    template <typename... Args>
+    void appendFormat(std::format_string<Args...> fmt, Args&&... args)
+    {
+        auto offset = text_.size();
+        std::format_to(std::back_inserter(text_), fmt, std::forward<Args>(args)...);
+        textAppended_(offset);
+    }
+
+    /**
+     * @brief the value with its "\r\n", kept referenced until sent
+     */
+    void appendValue(ItemStore::ItemRef ref)
+    {
+        pieces_.push_back(Piece {.value = ref->valueWithCrLf(), .text_offset = 0, .text_len = 0});
+        refs_.push_back(std::move(ref));
+    }
+
+    void flush(const TcpConnectionPtr& conn)
+    {
+        if (pieces_.empty())
+        {
+            return;
+        }
+        views_.clear();
+        for (const auto& piece : pieces_)
+        {
+            views_.push_back(piece.value.data() != nullptr
+                                 ? piece.value
+                                 : std::string_view {text_}.substr(piece.text_offset, piece.text_len));
+        }
+        conn->sendGathered(views_);
+        pieces_.clear();
+        refs_.clear(); // the bytes the socket didn't take were copied by sendGathered
+        text_.clear();
+    }
+};
+
+// one per loop thread, only used inside a message callback
+thread_local ReplyBatch t_reply;
+thread_local std::vector<std::string_view> t_tokens;
+
+void tokenize(std::string_view line, std::vector<std::string_view>& tokens)
+{
+    tokens.clear();
+    auto pos = line.find_first_not_of(' ');
+    while (pos != std::string_view::npos)
+    {
+        auto end = line.find(' ', pos);
+        tokens.push_back(line.substr(pos, end == std::string_view::npos ? end : end - pos));
+        pos = line.find_first_not_of(' ', end);
+    }
+}
+
+template <typename Integer>
+auto parseNumber(std::string_view token, Integer& value)
+    -> bool
+{
+    auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    return ec == std::errc {} and end == token.data() + token.size();
+}
+
+auto storeModeOf(std::string_view command)
+    -> std::optional<ItemStore::StoreMode>
+{
+    if (command == "set")
+    {
+        return ItemStore::StoreMode::Set;
+    }
+    if (command == "add")
+    {
+        return ItemStore::StoreMode::Add;
+    }
+    if (command == "replace")
+    {
+        return ItemStore::StoreMode::Replace;
+    }
+    if (command == "cas")
+    {
+        return ItemStore::StoreMode::Cas;
+    }
+    return std::nullopt;
+}
+
+auto storeReply(ItemStore::StoreResult result)
+    -> std::string_view
+{
+    switch (result)
+    {
+        case ItemStore::StoreResult::Stored:
+            return "STORED\r\n";
+        case ItemStore::StoreResult::NotStored:
+            return "NOT_STORED\r\n";
+        case ItemStore::StoreResult::Exists:
+            return "EXISTS\r\n";
+        case ItemStore::StoreResult::NotFound:
+            return "NOT_FOUND\r\n";
+        case ItemStore::StoreResult::TooLarge:
+            return "SERVER_ERROR object too large for cache\r\n";
+        case ItemStore::StoreResult::OutOfMemory:
+            return "SERVER_ERROR out of memory storing object\r\n";
+    }
+    return "SERVER_ERROR\r\n";
+}
+
+} // namespace
+
+MemcacheServer::MemcacheServer(EventLoop* loop, const Options& options)
+    : server_ {std::make_shared<TcpServer>(loop, InetAddress {options.port}, "MemcacheServer")}
+    , store_ {options.memory_mb * 1024 * 1024, options.shard_count}
+    , start_time_ {Timestamp::now()}
+{
+    server_->setThreadNum(options.threads);
+    server_->setConnectionEstablishedCallback([](const TcpConnectionPtr& conn) {
+        conn->setTcpNoDelay(true);
+    });
+    server_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp receiveTime) {
+        this->onMessage_(conn, buf, receiveTime);
+    });
+}
+
+void MemcacheServer::start()
+{
+    server_->start();
+}
+
+void MemcacheServer::onMessage_(const TcpConnectionPtr& conn, Buffer& buf, Timestamp)
+{
+    auto& reply = t_reply;
+    while (not reply.close_after)
+    {
+        const auto* crlf = reinterpret_cast<const char*>(buf.findCrLf());
+        if (crlf == nullptr)
+        {
+            if (buf.getReadableBytesCount() > c_max_line_len)
+            {
+                reply.appendText("CLIENT_ERROR line too long\r\n");
+                reply.close_after = true;
+            }
+            break;
+        }
+        auto line = std::string_view {buf.getReadableSV().data(), crlf};
+        if (not processCommand_(conn, buf, line))
+        {
+            break; // the data block is incomplete
+        }
+    }
+    reply.flush(conn);
+    if (std::exchange(reply.close_after, false))
+    {
+        buf.readAllAndDiscard();
+        conn->shutdown();
+    }
+}
+
+auto MemcacheServer::processCommand_(const TcpConnectionPtr& conn, Buffer& buf, std::string_view line)
+    -> bool
+{
+    auto& reply  = t_reply;
+    auto& tokens = t_tokens;
+    tokenize(line, tokens);
+    auto line_len = line.size() + 2;
+    if (tokens.empty())
+    {
+        buf.readNAndDiscard(line_len);
+        reply.appendText("ERROR\r\n");
+        return true;
+    }
+
+    const auto command = tokens[0];
+    if ((command == "get" or command == "gets") and tokens.size() >= 2)
+    {
+        auto with_cas = command == "gets";
+        for (size_t i = 1; i < tokens.size(); ++i)
+        {
+            if (auto ref = store_.get(tokens[i]); ref)
+            {
+                if (with_cas)
+                {
+                    reply.appendFormat("VALUE {} {} {} {}\r\n", ref->key(), ref->flags, ref->valueBytes(), ref->cas);
+                }
+                else
+                {
+                    reply.appendFormat("VALUE {} {} {}\r\n", ref->key(), ref->flags, ref->valueBytes());
+                }
+                reply.appendValue(std::move(ref));
+            }
+        }
+        reply.appendText("END\r\n");
+        buf.readNAndDiscard(line_len); // the tokens point into the buffer until now
+        return true;
+    }
+
+    if (auto mode = storeModeOf(command); mode.has_value())
+    {
+        // <command> <key> <flags> <exptime> <bytes> [<cas unique>] [noreply]
+        auto is_cas  = *mode == ItemStore::StoreMode::Cas;
+        auto nparams = is_cas ? size_t {6} : size_t {5};
+        auto flags   = uint32_t {0};
+        auto exptime = int64_t {0};
+        auto bytes   = size_t {0};
+        auto cas     = uint64_t {0};
+        if (tokens.size() < nparams or tokens.size() > nparams + 1
+            or tokens[1].size() > ItemStore::c_max_key_len
+            or not parseNumber(tokens[2], flags)
+            or not parseNumber(tokens[3], exptime)
+            or not parseNumber(tokens[4], bytes)
+            or (is_cas and not parseNumber(tokens[5], cas)))
+        {
+            reply.appendText("CLIENT_ERROR bad command line format\r\n");
+            reply.close_after = true; // the data block can't be told apart from the next command
+            return true;
+        }
+        if (bytes > ItemStore::maxValueSize(tokens[1].size()))
+        {
+            reply.appendText("SERVER_ERROR object too large for cache\r\n");
+            reply.close_after = true;
+            return true;
+        }
+        if (buf.getReadableBytesCount() < line_len + bytes + 2)
+        {
+            return false;
+        }
+        auto noreply = tokens.size() == nparams + 1 and tokens.back() == "noreply";
+        auto data    = buf.getReadableSV().substr(line_len, bytes + 2);
+        if (not data.ends_with("\r\n"))
+        {
+            reply.appendText("CLIENT_ERROR bad data chunk\r\n");
+            reply.close_after = true;
+            return true;
+        }
+        auto result = store_.store(*mode, tokens[1], flags, exptime, data.substr(0, bytes), cas);
+        if (not noreply)
+        {
+            reply.appendText(storeReply(result));
+        }
+        buf.readNAndDiscard(line_len + bytes + 2);
+        return true;
+    }
+
+    auto noreply = tokens.back() == "noreply";
+    if (command == "delete" and (tokens.size() == 2 or (tokens.size() == 3 and noreply)))
+    {
+        auto deleted = store_.remove(tokens[1]);
+        if (not noreply)
+        {
+            reply.appendText(deleted ? "DELETED\r\n" : "NOT_FOUND\r\n");
+        }
+    }
+    else if ((command == "incr" or command == "decr") and (tokens.size() == 3 or (tokens.size() == 4 and noreply)))
+    {
+        auto delta = uint64_t {0};
+        if (not parseNumber(tokens[2], delta))
+        {
+            reply.appendText("CLIENT_ERROR invalid numeric delta argument\r\n");
+        }
+        else if (auto result = store_.incr(tokens[1], delta, command == "decr"); noreply)
+        {
+        }
+        else if (result.has_value())
+        {
+            reply.appendFormat("{}\r\n", *result);
+        }
+        else if (result.error() == ItemStore::IncrError::NotFound)
+        {
+            reply.appendText("NOT_FOUND\r\n");
+        }
+        else if (result.error() == ItemStore::IncrError::NotNumeric)
+        {
+            reply.appendText("CLIENT_ERROR cannot increment or decrement non-numeric value\r\n");
+        }
+        else
+        {
+            reply.appendText("SERVER_ERROR out of memory\r\n");
+        }
+    }
+    else if (command == "stats" and tokens.size() == 1)
+    {
+        auto stats  = store_.getStats();
+        auto uptime = static_cast<int64_t>(timeDifference(Timestamp::now(), start_time_));
+        reply.appendFormat("STAT pid {}\r\nSTAT uptime {}\r\nSTAT curr_items {}\r\nSTAT bytes {}\r\n"
+                           "STAT get_hits {}\r\nSTAT get_misses {}\r\nSTAT evictions {}\r\n"
+                           "STAT limit_maxbytes {}\r\nSTAT slab_pages {}\r\nSTAT slabs_moved {}\r\nEND\r\n",
+                           ::getpid(),
+                           uptime,
+                           stats.items,
+                           stats.bytes,
+                           stats.get_hits,
+                           stats.get_misses,
+                           stats.evictions,
+                           stats.limit_bytes,
+                           stats.pages,
+                           stats.slabs_moved);
+    }
+    else if (command == "version")
+    {
+        reply.appendText("VERSION 1.6.0-cotweb\r\n");
+    }
+    else if (command == "quit")
+    {
+        reply.close_after = true;
+    }
+    else
+    {
+        LOG_DEBUG_FMT(log, "MemcacheServer - unknown command from {}", conn->getPeerAddress().toIpPortRepr());
+        reply.appendText("ERROR\r\n");
+    }
+    buf.readNAndDiscard(line_len);
+    return true;
+}
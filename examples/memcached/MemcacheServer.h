@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "ItemStore.h"
+#include "net/Callbacks.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpServer.h"
+#include "net/Timestamp.h"
+
+/**
+ * @brief a cache server speaking the memcached text protocol: get, gets, set, add, replace, cas, delete, incr, decr,
+ * stats, version, quit
+ * @details the commands of one message callback are answered together: the status lines are collected in one
+ * string and the values are referenced in place in the ItemStore, then everything leaves with one gathered send
+ */
+class MemcacheServer {
+public:
+    struct Options
+    {
+        uint16_t port      = 11211;
+        int threads        = 4;
+        size_t memory_mb   = 1024;
+        size_t shard_count = 64;
+    };
+
+    // a command line longer than that without "\r\n" closes the connection
+    inline static constexpr size_t c_max_line_len = 2048;
+
+private:
+    std::shared_ptr<TcpServer> server_;
+    ItemStore store_;
+    const Timestamp start_time_;
+
+    void onMessage_(const TcpConnectionPtr& conn, Buffer& buf, Timestamp receiveTime);
+    /**
+     * @return false if the command waits for more bytes, its data block
+     */
+    auto processCommand_(const TcpConnectionPtr& conn, Buffer& buf, std::string_view line)
+        -> bool;
+
+public:
+    MemcacheServer(EventLoop* loop, const Options& options);
+
+    MemcacheServer(const MemcacheServer&)                    = delete;
+    auto operator=(const MemcacheServer&) -> MemcacheServer& = delete;
+    MemcacheServer(MemcacheServer&&)                         = delete;
+    auto operator=(MemcacheServer&&) -> MemcacheServer&      = delete;
+
+    void start();
+
+    auto getStore()
+        -> ItemStore& { return store_; }
+};
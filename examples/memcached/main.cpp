@@ -0,0 +1,42 @@
+#include <cstdlib>
+#include <unistd.h>
+
+#include "MemcacheServer.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+/**
+ * usage: MemcacheServer [port=11211] [threads=4] [memory_mb=1024] [shards=64]
+ */
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto options = MemcacheServer::Options {};
+    if (argc > 1)
+    {
+        options.port = static_cast<uint16_t>(std::atoi(argv[1]));
+    }
+    if (argc > 2)
+    {
+        options.threads = std::atoi(argv[2]);
+    }
+    if (argc > 3)
+    {
+        options.memory_mb = static_cast<size_t>(std::atol(argv[3]));
+    }
+    if (argc > 4)
+    {
+        options.shard_count = static_cast<size_t>(std::atol(argv[4]));
+    }
+    log->setLogLevel(LogLevel::WARN);
+    LOG_WARN_FMT(log, "MemcacheServer pid = {}, port = {}, {} threads, {} MB", ::getpid(), options.port, options.threads, options.memory_mb);
+
+    auto loop   = EventLoop {};
+    auto server = MemcacheServer {&loop, options};
+    server.start();
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "PubSubServer.h"
+
+#include <string>
+
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/TcpConnection.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+PubSubServer::PubSubServer(EventLoop* loop, const InetAddress& listenAddr, int threads, PubSubHub::Options options)
+    : server_ {std::make_shared<TcpServer>(loop, listenAddr, "PubSubServer")}
+    , hub_ {options}
+{
+    server_->setThreadNum(threads);
+    server_->setConnectionEstablishedCallback([this](const TcpConnectionPtr& conn) {
+        this->onConnection_(conn);
+    });
+    server_->setConnectionCloseCallback([this](const TcpConnectionPtr& conn) {
+        this->onClose_(conn);
+    });
+    server_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp receiveTime) {
+        this->onMessage_(conn, buf, receiveTime);
+    });
+}
+
+void PubSubServer::start()
+{
+    server_->start();
+}
+
+void PubSubServer::publish(std::string_view topic, std::string_view message)
+{
+    auto payload = std::make_shared<std::string>();
+    payload->reserve(topic.size() + message.size() + 7);
+    payload->append("msg ").append(topic).append(" ").append(message).append("\r\n");
+    hub_.publish(topic, std::move(payload));
+}
+
+void PubSubServer::onConnection_(const TcpConnectionPtr& conn)
+{
+    LOG_DEBUG_FMT(log, "PubSubServer - {} is UP", conn->getPeerAddress().toIpPortRepr());
+    conn->setTcpNoDelay(true);
+}
+
+void PubSubServer::onClose_(const TcpConnectionPtr& conn)
+{
+    LOG_DEBUG_FMT(log, "PubSubServer - {} is DOWN", conn->getPeerAddress().toIpPortRepr());
+    hub_.unsubscribeAll(conn);
+}
+
+void PubSubServer::onMessage_(const TcpConnectionPtr& conn, Buffer& buf, Timestamp)
+{
+    while (true)
+    {
+        const auto* crlf = reinterpret_cast<const char*>(buf.findCrLf());
+        if (crlf == nullptr)
+        {
+            if (buf.getReadableBytesCount() > c_max_line_len)
+            {
+                conn->send(std::string_view {"error line too long\r\n"});
+                buf.readAllAndDiscard();
+                conn->shutdown();
+            }
+            return;
+        }
+        auto line     = std::string_view {buf.getReadableSV().data(), crlf};
+        auto line_len = line.size() + 2;
+        auto keep     = processLine_(conn, line);
+        buf.readNAndDiscard(line_len);
+        if (not keep)
+        {
+            buf.readAllAndDiscard();
+            conn->shutdown();
+            return;
+        }
+    }
+}
+
+auto PubSubServer::processLine_(const TcpConnectionPtr& conn, std::string_view line)
+    -> bool
+{
+    auto space   = line.find(' ');
+    auto command = line.substr(0, space);
+    auto rest    = space == std::string_view::npos ? std::string_view {} : line.substr(space + 1);
+    if (command == "pub")
+    {
+        auto topic_end = rest.find(' ');
+        if (topic_end == 0 or topic_end == std::string_view::npos)
+        {
+            conn->send(std::string_view {"error bad pub\r\n"});
+            return false;
+        }
+        publish(rest.substr(0, topic_end), rest.substr(topic_end + 1));
+        return true;
+    }
+    if ((command == "sub" or command == "unsub") and not rest.empty() and rest.find(' ') == std::string_view::npos)
+    {
+        if (command == "sub")
+        {
+            hub_.subscribe(conn, rest);
+        }
+        else
+        {
+            hub_.unsubscribe(conn, rest);
+        }
+        return true;
+    }
+    conn->send(std::string_view {"error unknown command\r\n"});
+    return false;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string_view>
+
+#include "net/Callbacks.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/PubSubHub.h"
+#include "net/TcpServer.h"
+#include "net/Timestamp.h"
+
+/**
+ * @brief a topic fan-out server on PubSubHub, speaking lines:
+ * "sub <topic>\r\n", "unsub <topic>\r\n" and "pub <topic> <message>\r\n",
+ * the subscribers of the topic receive "msg <topic> <message>\r\n"
+ */
+class PubSubServer {
+public:
+    // a line longer than that without "\r\n" closes the connection
+    inline static constexpr size_t c_max_line_len = 64 * 1024;
+
+private:
+    std::shared_ptr<TcpServer> server_;
+    PubSubHub hub_;
+
+    void onConnection_(const TcpConnectionPtr& conn);
+    void onClose_(const TcpConnectionPtr& conn);
+    void onMessage_(const TcpConnectionPtr& conn, Buffer& buf, Timestamp receiveTime);
+    /**
+     * @return false if the connection is to be closed
+     */
+    auto processLine_(const TcpConnectionPtr& conn, std::string_view line)
+        -> bool;
+
+public:
+    PubSubServer(EventLoop* loop, const InetAddress& listenAddr, int threads, PubSubHub::Options options);
+
+    PubSubServer(const PubSubServer&)                    = delete;
+    auto operator=(const PubSubServer&) -> PubSubServer& = delete;
+    PubSubServer(PubSubServer&&)                         = delete;
+    auto operator=(PubSubServer&&) -> PubSubServer&      = delete;
+
+    void start();
+
+    /**
+     * @brief publish from the process itself, as a "pub" line does
+     * @thread safe
+     */
+    void publish(std::string_view topic, std::string_view message);
+
+    auto getHub()
+        -> PubSubHub& { return hub_; }
+};
@@ -0,0 +1,37 @@
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "PubSubServer.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+/**
+ * usage: PubSubServer [port=9010] [threads=4] [max_pending_kb=1024] [policy=drop|disconnect]
+ */
+auto main(int argc, char* argv[])
+    -> int
+{
+    auto port    = static_cast<uint16_t>(argc > 1 ? std::atoi(argv[1]) : 9010);
+    auto threads = argc > 2 ? std::atoi(argv[2]) : 4;
+    auto options = PubSubHub::Options {};
+    if (argc > 3)
+    {
+        options.max_pending_bytes = static_cast<size_t>(std::atol(argv[3])) * 1024;
+    }
+    if (argc > 4 and std::strcmp(argv[4], "disconnect") == 0)
+    {
+        options.policy = SlowSubscriberPolicy::Disconnect;
+    }
+    log->setLogLevel(LogLevel::WARN);
+    LOG_WARN_FMT(log, "PubSubServer pid = {}, port = {}, {} threads", ::getpid(), port, threads);
+
+    auto loop   = EventLoop {};
+    auto server = PubSubServer {&loop, InetAddress {port}, threads, options};
+    server.start();
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <ctime>
+
+namespace Cot {
+
+namespace CoarseClockDetail {
+
+inline auto Read(clockid_t id) noexcept
+    -> std::chrono::nanoseconds
+{
+    auto ts = timespec {};
+    ::clock_gettime(id, &ts);
+    return std::chrono::seconds {ts.tv_sec} + std::chrono::nanoseconds {ts.tv_nsec};
+}
+
+inline auto Resolution(clockid_t id) noexcept
+    -> std::chrono::nanoseconds
+{
+    auto ts = timespec {};
+    ::clock_getres(id, &ts);
+    return std::chrono::seconds {ts.tv_sec} + std::chrono::nanoseconds {ts.tv_nsec};
+}
+
+} // namespace CoarseClockDetail
+
+/**
+ * @brief std::chrono::system_clock read from CLOCK_REALTIME_COARSE: the time of the last scheduler tick
+ * @details the vDSO returns it without reading the TSC, several times cheaper than system_clock::now(), at the
+ * resolution of a tick (1-4ms, see Resolution()). Its time points are system_clock ones, e.g. for to_time_t()
+ */
+struct CoarseSystemClock
+{
+    using duration                  = std::chrono::system_clock::duration;
+    using rep                       = duration::rep;
+    using period                    = duration::period;
+    using time_point                = std::chrono::system_clock::time_point;
+    static constexpr bool is_steady = false;
+
+    static auto now() noexcept
+        -> time_point
+    {
+        return time_point {std::chrono::duration_cast<duration>(CoarseClockDetail::Read(CLOCK_REALTIME_COARSE))};
+    }
+
+    static auto Resolution() noexcept
+        -> std::chrono::nanoseconds
+    {
+        return CoarseClockDetail::Resolution(CLOCK_REALTIME_COARSE);
+    }
+};
+
+/**
+ * @brief std::chrono::steady_clock read from CLOCK_MONOTONIC_COARSE, the same trade as CoarseSystemClock
+ */
+struct CoarseSteadyClock
+{
+    using duration                  = std::chrono::steady_clock::duration;
+    using rep                       = duration::rep;
+    using period                    = duration::period;
+    using time_point                = std::chrono::steady_clock::time_point;
+    static constexpr bool is_steady = true;
+
+    static auto now() noexcept
+        -> time_point
+    {
+        return time_point {std::chrono::duration_cast<duration>(CoarseClockDetail::Read(CLOCK_MONOTONIC_COARSE))};
+    }
+
+    static auto Resolution() noexcept
+        -> std::chrono::nanoseconds
+    {
+        return CoarseClockDetail::Resolution(CLOCK_MONOTONIC_COARSE);
+    }
+};
+
+} // namespace Cot
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Cot {
+
+namespace MetricsDetail {
+
+inline constexpr size_t c_ShardCount = 16;
+
+/**
+ * @brief the shard of the calling thread, threads are spread over the shards round-robin on their first record
+ */
+inline auto ShardIndex()
+    -> size_t
+{
+    static auto s_next_shard        = std::atomic<size_t> {0};
+    thread_local const auto t_shard = s_next_shard.fetch_add(1, std::memory_order_relaxed) % c_ShardCount;
+    return t_shard;
+}
+
+} // namespace MetricsDetail
+
+/**
+ * @brief monotonic counter, one cache line per shard so that the threads recording don't share one
+ * @details Inc() is a relaxed fetch_add on the shard of the calling thread, Value() sums the shards
+ */
+class Counter {
+public:
+    Counter() = default;
+
+    Counter(const Counter&)                    = delete;
+    auto operator=(const Counter&) -> Counter& = delete;
+    Counter(Counter&&)                         = delete;
+    auto operator=(Counter&&) -> Counter&      = delete;
+
+    void Inc(uint64_t n = 1)
+    {
+        shards_[MetricsDetail::ShardIndex()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto Value() const
+        -> uint64_t;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value {0};
+    };
+    std::array<Shard, MetricsDetail::c_ShardCount> shards_;
+};
+
+/**
+ * @brief a value going up and down, e.g. the open connections
+ */
+class Gauge {
+public:
+    Gauge() = default;
+
+    Gauge(const Gauge&)                    = delete;
+    auto operator=(const Gauge&) -> Gauge& = delete;
+    Gauge(Gauge&&)                         = delete;
+    auto operator=(Gauge&&) -> Gauge&      = delete;
+
+    void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+    void Add(int64_t delta) { value_.fetch_add(delta, std::memory_order_relaxed); }
+
+    [[nodiscard]] auto Value() const
+        -> int64_t { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> value_ {0};
+};
+
+/**
+ * @brief distribution over fixed upper bounds, sharded like Counter
+ * @details Observe() finds the bucket by a binary search and makes two relaxed atomic updates, no allocation
+ */
+class Histogram {
+public:
+    struct Snapshot
+    {
+        std::vector<double> bounds;
+        std::vector<uint64_t> cumulative_counts; // one more than the bounds, the last for +Inf
+        double sum;
+    };
+
+    /**
+     * @param bounds the bucket upper bounds, ascending
+     */
+    explicit Histogram(std::vector<double> bounds);
+
+    Histogram(const Histogram&)                    = delete;
+    auto operator=(const Histogram&) -> Histogram& = delete;
+    Histogram(Histogram&&)                         = delete;
+    auto operator=(Histogram&&) -> Histogram&      = delete;
+
+    void Observe(double value);
+
+    [[nodiscard]] auto TakeSnapshot() const
+        -> Snapshot;
+
+    /**
+     * @brief 1us to 10s, for latencies in seconds
+     */
+    static auto LatencyBounds()
+        -> std::vector<double>;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<double> sum {0};
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;
+    };
+    const std::vector<double> bounds_;
+    std::array<Shard, MetricsDetail::c_ShardCount> shards_;
+};
+
+/**
+ * @brief process wide registry of the metrics, rendered in the Prometheus text format
+ * @details a metric is identified by its name and its labels, getting it again returns the same one, so the hot paths
+ * keep a reference got once and never come back here. The metrics live as long as the process, a value computed at
+ * scrape time from an object which may go away is registered by AddCallbackGauge() and removed with its handle
+ * @thread safe
+ */
+class MetricsRegistry {
+public:
+    using GaugeFunction = std::function<double()>;
+
+    /**
+     * @brief removes its callback gauge when destructed
+     */
+    class CallbackHandle {
+    public:
+        CallbackHandle() = default;
+        CallbackHandle(MetricsRegistry* registry, std::string name, uint64_t id);
+        ~CallbackHandle();
+
+        CallbackHandle(const CallbackHandle&)                    = delete;
+        auto operator=(const CallbackHandle&) -> CallbackHandle& = delete;
+        CallbackHandle(CallbackHandle&& other) noexcept;
+        auto operator=(CallbackHandle&& other) noexcept -> CallbackHandle&;
+
+    private:
+        MetricsRegistry* registry_ = nullptr;
+        std::string name_;
+        uint64_t id_ = 0;
+    };
+
+    static auto GetInstance()
+        -> MetricsRegistry&;
+
+    /**
+     * @param labels already formatted, e.g. by Label(), empty for none
+     */
+    auto GetCounter(std::string_view name, std::string_view help, std::string_view labels = {})
+        -> Counter&;
+    auto GetGauge(std::string_view name, std::string_view help, std::string_view labels = {})
+        -> Gauge&;
+    /**
+     * @brief the bounds of the first registration of @c name and @c labels are kept
+     */
+    auto GetHistogram(std::string_view name, std::string_view help, std::vector<double> bounds, std::string_view labels = {})
+        -> Histogram&;
+
+    /**
+     * @brief a gauge computed by @c fn at every scrape
+     * @attention @c fn is called in the scraping thread, holding the registry lock: it must be thread safe and must not
+     * register metrics
+     */
+    [[nodiscard]] auto AddCallbackGauge(std::string_view name, std::string_view help, std::string_view labels, GaugeFunction fn)
+        -> CallbackHandle;
+
+    /**
+     * @brief every metric in the Prometheus text exposition format, version 0.0.4
+     */
+    [[nodiscard]] auto RenderPrometheus() const
+        -> std::string;
+
+    /**
+     * @brief format a label pair as @c key="value", escaping the value; join several with a comma
+     */
+    static auto Label(std::string_view key, std::string_view value)
+        -> std::string;
+
+private:
+    enum class Type {
+        Counter,
+        Gauge,
+        Histogram,
+    };
+
+    struct CallbackGauge
+    {
+        std::string labels;
+        GaugeFunction fn;
+    };
+
+    struct Family
+    {
+        Type type;
+        std::string help;
+        // by labels
+        std::map<std::string, std::unique_ptr<Counter>, std::less<>> counters;
+        std::map<std::string, std::unique_ptr<Gauge>, std::less<>> gauges;
+        std::map<std::string, std::unique_ptr<Histogram>, std::less<>> histograms;
+        std::map<uint64_t, CallbackGauge> callbacks; // by id
+    };
+
+    static auto TypeName_(Type type)
+        -> std::string_view;
+    auto GetFamily_(std::string_view name, std::string_view help, Type type)
+        -> Family&;
+    void RemoveCallbackGauge_(const std::string& name, uint64_t id);
+
+    mutable std::mutex mtx_;
+    std::map<std::string, Family, std::less<>> families_;
+    uint64_t next_callback_id_ = 1;
+};
+
+} // namespace Cot
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/metrics.h"
+
+namespace Cot {
+
+/**
+ * @brief bounded work-stealing pool for the CPU-heavy work taken off the event loops, see EventLoop::offload()
+ * @details each worker has a deque of its own: the work submitted from outside the pool goes to them round-robin,
+ * the one submitted by a worker to its own deque. A worker takes from the front of its deque and, once it is empty,
+ * steals from the back of the others before sleeping. At most @c capacity tasks wait at once, TrySubmit() refuses
+ * more. The queue depth, the waits, the run times and the steals are recorded in the registry under the pool name
+ * @thread safe
+ */
+class OffloadPool {
+public:
+    using Task = std::function<void()>;
+
+    static constexpr size_t c_DefaultCapacity = 4096;
+
+    OffloadPool(std::string name, size_t threadCount, size_t capacity = c_DefaultCapacity);
+    /**
+     * @brief runs what is still queued, then joins the workers
+     */
+    ~OffloadPool();
+
+    OffloadPool(const OffloadPool&)                    = delete;
+    auto operator=(const OffloadPool&) -> OffloadPool& = delete;
+    OffloadPool(OffloadPool&&)                         = delete;
+    auto operator=(OffloadPool&&) -> OffloadPool&      = delete;
+
+    /**
+     * @return false if @c capacity tasks are waiting already, @c task is left untouched then
+     * @attention the task must not throw
+     */
+    auto TrySubmit(Task& task)
+        -> bool;
+
+    [[nodiscard]] auto GetQueueDepth() const
+        -> size_t { return queued_.load(std::memory_order_relaxed); }
+    [[nodiscard]] auto GetThreadCount() const
+        -> size_t { return workers_.size(); }
+    [[nodiscard]] auto GetName() const
+        -> const std::string& { return name_; }
+
+    /**
+     * @brief the pool of the loops without one of their own: a thread per core but one, at least one
+     */
+    static auto GetDefault()
+        -> const std::shared_ptr<OffloadPool>&;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        Task task;
+        Clock::time_point queued;
+    };
+
+    struct alignas(64) Worker
+    {
+        std::mutex mtx;
+        std::deque<Entry> entries;
+    };
+
+    void WorkerMain_(size_t index);
+    auto TakeOwn_(size_t index, Entry& entry)
+        -> bool;
+    auto Steal_(size_t index, Entry& entry)
+        -> bool;
+    void Run_(Entry& entry);
+
+    const std::string name_;
+    const size_t capacity_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> queued_; // counted before the push, so a worker may find it not there yet and look again
+    std::atomic<size_t> next_worker_;
+
+    std::mutex sleep_mtx_;
+    std::condition_variable wake_;
+    std::atomic<size_t> sleeping_;
+    bool stopping_; // under sleep_mtx_
+
+    Counter& submitted_;
+    Counter& refused_;
+    Counter& steals_;
+    Histogram& queue_wait_;
+    Histogram& run_time_;
+    MetricsRegistry::CallbackHandle depth_gauge_;
+
+    std::vector<std::jthread> threads_; // last, joined before the rest goes
+};
+
+} // namespace Cot
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "common/curthread.h"
+#include "common/fiber.h"
+#include "common/offloadpool.h"
+#include "scheduler.h"
+
+#include <cassert>
+#include <functional>
+#include <optional>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+
+namespace FiberT {
+
+/**
+ * @brief runs @c work on @c pool and holds the calling fiber until it is done, the other fibers of the thread run
+ * meanwhile; the same pool as EventLoop::offload()
+ * @details the work is submitted by a callback scheduled on this thread, which the scheduler only runs once the fiber
+ * is held, so the fiber is never made ready before it has yielded. When the pool is full, that callback runs the work
+ * itself
+ * @return the result of @c work, if it has one
+ * @attention from a fiber scheduled as a fiber, not as a callback: the scheduler reuses the fiber wrapping a callback
+ * once it yields. @c work must not throw
+ */
+template <typename Work>
+auto AwaitOffload(Cot::OffloadPool& pool, Work work)
+    -> std::invoke_result_t<Work&>
+{
+    using Result = std::invoke_result_t<Work&>;
+
+    auto* scheduler = CurThr::GetScheduler();
+    auto fiber      = CurThr::GetRunningFiber();
+    assert(scheduler != nullptr and fiber != nullptr);
+
+    auto result = std::conditional_t<std::is_void_v<Result>, bool, std::optional<Result>> {};
+    auto job    = Cot::OffloadPool::Task {[&] {
+        if constexpr (std::is_void_v<Result>)
+        {
+            work();
+        }
+        else
+        {
+            result.emplace(work());
+        }
+        fiber->SetState(FiberState::READY);
+        scheduler->Schedule(fiber);
+    }};
+    scheduler->Schedule(std::function<void()> {[&pool, &job] {
+                            if (not pool.TrySubmit(job))
+                            {
+                                job();
+                            }
+                        }},
+                        ::gettid());
+    CurThr::YieldToHold();
+
+    if constexpr (not std::is_void_v<Result>)
+    {
+        return std::move(*result);
+    }
+}
+
+} // namespace FiberT
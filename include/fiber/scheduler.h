@@ -4,6 +4,7 @@
 #include "common/alias.h"
 #include "common/thread.h"
 #include "common/fiber.h"
+#include "common/metrics.h"
 #include "scheduletask.h"
 
 #include <atomic>
@@ -141,6 +142,7 @@ private:
         bool need_tickle = tasks_.empty();
         if(fc != nullptr) {
             tasks_.emplace_back(fc, thread);
+            scheduled_metric_.Inc();
         }
         return need_tickle;
     }
@@ -172,6 +174,11 @@ private:
 
     bool stopping_ = false;
     bool use_root_thread_;
+
+    Cot::Counter& scheduled_metric_; // tasks scheduled
+    Cot::Counter& run_metric_;       // tasks taken by a thread to run
+    Cot::MetricsRegistry::CallbackHandle active_threads_gauge_;
+    Cot::MetricsRegistry::CallbackHandle idle_threads_gauge_;
 };
 
 } //namespace FiberT
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "EventFixedBuffer.hpp"
+#include "common/metrics.h"
 #include "logger/Logger.h"
 #include <algorithm>
 #include <vector>
@@ -20,6 +21,9 @@ public:
         , running_(false)
         , current_buffer_(std::make_unique<EventFixedBuffer<>>()) // 初始化双缓冲
         , next_buffer_(std::make_unique<EventFixedBuffer<>>())
+        , appended_metric_(Cot::MetricsRegistry::GetInstance().GetCounter("logger_async_events_total", "log events handed to the async loggers"))
+        , written_metric_(Cot::MetricsRegistry::GetInstance().GetCounter("logger_async_events_written_total", "log events written by the async logger threads"))
+        , dropped_metric_(Cot::MetricsRegistry::GetInstance().GetCounter("logger_async_events_dropped_total", "log events dropped for piling up faster than written"))
     {
         // 初始化备用缓冲列表，用于收集应用线程写满的缓冲
         buffers_to_write_.reserve(16);
@@ -41,6 +45,7 @@ public:
     void append(LogEvent event)
     {
         auto _ = std::lock_guard<std::mutex> {mutex_};
+        appended_metric_.Inc();
 
         // 尝试写入当前缓冲区（检查事件数量）
         if (current_buffer_->available() > 0)
@@ -139,6 +144,9 @@ private:
                     now};
                 auto time_point_str = std::format("{:%Y-%m-%d-%H-%M-%S}", zoned_time.get_local_time());
                 std::println("Dropper log messages at {}, {} larger buffer", time_point_str, buffers_to_process.size() - 2);
+                std::ranges::for_each(buffers_to_process.begin() + 2, buffers_to_process.end(), [this](const auto& buf) {
+                    this->dropped_metric_.Inc(buf->getEventSpan().size());
+                });
                 buffers_to_process.erase(
                     buffers_to_process.begin() + 2,
                     buffers_to_process.end());
@@ -151,6 +159,7 @@ private:
                 std::ranges::for_each(data, [this](const LogEvent& event) {
                     this->log(event);
                 });
+                written_metric_.Inc(data.size());
             }
 
             // 6. 清理并回收缓冲区
@@ -193,4 +202,9 @@ private:
     EventBufferPtr current_buffer_;                // 当前应用线程正在写入的缓冲区
     EventBufferPtr next_buffer_;                   // 备用缓冲区（用于减少应用线程等待时间）
     std::vector<EventBufferPtr> buffers_to_write_; // 已写满，等待后台线程写入的缓冲区列表
+
+    // shared by the async loggers
+    Cot::Counter& appended_metric_;
+    Cot::Counter& written_metric_;
+    Cot::Counter& dropped_metric_;
 };
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <utility>
 
 #include "common/alias.h"
+#include "common/coarseclock.h"
 #include "common/curthread.h"
 #include "logger/AppenderFacade.h"
 #include "LogEvent.h"
@@ -67,7 +68,7 @@ inline auto LogFMT(const Logger& logger, LogLevel loglevel, std::source_location
         std::this_thread::get_id(),
         CurThr::GetName(),
         0,
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
+        std::chrono::system_clock::to_time_t(Cot::CoarseSystemClock::now()), // whole seconds, a tick old is as good
         source_info};
         event.print(fmt, std::forward<Args>(args)...);
 
@@ -84,7 +85,7 @@ inline auto Log(const Logger& logger, LogLevel loglevel, std::source_location so
         std::this_thread::get_id(),
         CurThr::GetName(),
         0,
-        std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
+        std::chrono::system_clock::to_time_t(Cot::CoarseSystemClock::now()),
         source_info});
 }
 
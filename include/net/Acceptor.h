@@ -15,8 +15,13 @@ class Acceptor
 {
 public:
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress &)>;
+    using FdExhaustedCallback   = std::function<void()>;
 
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
+    /**
+     * @brief adopt an already bound, maybe already listening socket, e.g. inherited from the previous process by HotRestart
+     */
+    Acceptor(EventLoop *loop, int listenFd);
 
     ~Acceptor();
 
@@ -30,9 +35,25 @@ public:
      */
     void setNewConnectionCallback(const NewConnectionCallback &cb) { new_conn_callback_ = cb; }
 
+    /**
+     * @brief called when accept fails for lack of file descriptors, after the pending connection has been dropped
+     */
+    void setFdExhaustedCallback(const FdExhaustedCallback &cb) { fd_exhausted_callback_ = cb; }
+
     [[nodiscard]] auto listen() const
         -> bool { return listenning_; }
     void listenInOwnerThread();
+    /**
+     * @brief stop accepting, the socket stays open: the connections queued by the kernel are left to the other owners of the socket
+     */
+    void stopListeningInOwnerThread();
+    /**
+     * @brief accept again after stopListeningInOwnerThread(), the connections queued meanwhile are accepted first
+     */
+    void resumeListeningInOwnerThread();
+
+    [[nodiscard]] auto getListenFd() const
+        -> int { return accept_socket_.GetFd(); }
 
     void cleanChannelInOnwerLoop_();
 
@@ -50,6 +71,7 @@ private:
     Socket accept_socket_;
     Channel listen_channel_;
     NewConnectionCallback new_conn_callback_;
+    FdExhaustedCallback fd_exhausted_callback_;
     bool listenning_;
     int idle_fd_;
 };
\ No newline at end of file
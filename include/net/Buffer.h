@@ -90,6 +90,9 @@ public:
     auto readAllAndDiscard()
         -> void { retrieveAll_(); }
 
+    auto readNAndDiscard(size_t len)
+        -> void { retrieveN_(len); }
+
     auto readNAsString(size_t len)
         -> std::string
     {
@@ -272,6 +275,18 @@ public:
     auto writeFd(int fd, int* saveErrno)
         -> ssize_t;
 
+    /**
+     * @brief readFd for a unix domain socket, the fds passed by SCM_RIGHTS are appended to @c fds, owned by the caller
+     */
+    auto readFdWithRights(int fd, int* saveErrno, std::vector<int>* fds)
+        -> ssize_t;
+    /**
+     * @brief write at most @c maxBytes, with @c fds attached to the first byte by SCM_RIGHTS if not empty
+     * @attention the fds are not closed, the caller still owns them
+     */
+    auto writeFdWithRights(int fd, size_t maxBytes, std::span<const int> fds, int* saveErrno)
+        -> ssize_t;
+
 private:
     // vector底层数组首元素的地址 也就是数组的起始地址
 
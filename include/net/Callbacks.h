@@ -2,12 +2,15 @@
 
 #include <functional>
 #include <memory>
+#include <string>
 
 class Buffer;
 class TcpConnection;
 class Timestamp;
 
 using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+// immutable payload shared by reference, kept alive until the kernel no longer needs it, see TcpConnection::sendShared
+using SharedPayload = std::shared_ptr<const std::string>;
 //for the param `const TcpConnectionPtr&`, the context should make sure the lifetime of TcpConnectionPtr
 using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;
 using CloseCallback = std::function<void(const TcpConnectionPtr &)>;
@@ -20,6 +23,11 @@ using MessageCallback = std::function<void(const TcpConnectionPtr &,
 
 using  TimerCallback = std::function<void()> ;
 
+// a connect attempt failed with `savedErrno`, the connector may retry afterwards.
+// when the client resolves a hostname, a failed resolve is reported with the negative EAI_* code of getaddrinfo
+// (see gaiErrorCategory), or the errno for EAI_SYSTEM, and is retried with the same backoff
+using ConnectFailedCallback = std::function<void(int savedErrno)>;
+
 // the data has been read to (buf, len)
 
 void defaultConnectionCallback(const TcpConnectionPtr& conn);
@@ -29,6 +29,11 @@ public:
     using EventCallback = std::function<void()>;
 
     using ReadEventCallback = std::function<void(Timestamp)>;
+
+    /**
+     * @brief one plain function for all the events of the channel, called with the owner it was set with
+     */
+    using EventHandler = void (*)(void* owner, uint32_t receivedEvents, Timestamp receiveTime);
     enum State {
         // channel里的 fd 还没添加至Poller, channel本身也还没添加至EPoller
         New = -1,
@@ -50,6 +55,9 @@ private:
     std::weak_ptr<void> tie_;
     bool tied_;
 
+    EventHandler event_handler_;
+    void* handler_owner_;
+
     // 因为channel通道里可获知fd最终发生的具体的事件events，所以它负责调用具体事件的回调操作
     ReadEventCallback read_callback_;
     EventCallback write_callback_;
@@ -75,11 +83,38 @@ public:
      */
     void handleEvent(Timestamp receiveTime);
 
-    // 设置回调函数对象
-    void setReadCallback(ReadEventCallback cb) { read_callback_ = std::move(cb); }
-    void setWriteCallback(EventCallback cb) { write_callback_ = std::move(cb); }
-    void setCloseCallback(EventCallback cb) { close_callback_ = std::move(cb); }
-    void setErrorCallback(EventCallback cb) { error_callback_ = std::move(cb); }
+    // 设置回调函数对象, they replace the event handler
+    void setReadCallback(ReadEventCallback cb) { event_handler_ = nullptr; read_callback_ = std::move(cb); }
+    void setWriteCallback(EventCallback cb) { event_handler_ = nullptr; write_callback_ = std::move(cb); }
+    void setCloseCallback(EventCallback cb) { event_handler_ = nullptr; close_callback_ = std::move(cb); }
+    void setErrorCallback(EventCallback cb) { event_handler_ = nullptr; error_callback_ = std::move(cb); }
+
+    /**
+     * @brief dispatch the events to @c handler instead of the callbacks and the tie: one call through a function
+     * pointer per event, no std::function per event kind, no weak_ptr locked
+     * @details @c handler decodes the events with isCloseEvent() and the others in the order handleEvent() uses
+     * @attention @c owner must outlive every event the channel is handed, usually by staying alive until the loop
+     * iteration it unregisters the channel in is over
+     */
+    void setEventHandler(void* owner, EventHandler handler)
+    {
+        handler_owner_ = owner;
+        event_handler_ = handler;
+    }
+    [[nodiscard]] auto hasEventHandler() const
+        -> bool { return event_handler_ != nullptr; }
+
+    /**
+     * @brief POLLHUP without POLLIN: the peer is gone and nothing is left to read
+     */
+    static auto isCloseEvent(uint32_t events)
+        -> bool { return (events & EPOLLHUP) != NoneEvent and (events & EPOLLIN) == NoneEvent; }
+    static auto isErrorEvent(uint32_t events)
+        -> bool { return (events & EPOLLERR) != NoneEvent; }
+    static auto isReadEvent(uint32_t events)
+        -> bool { return (events & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) != NoneEvent; }
+    static auto isWriteEvent(uint32_t events)
+        -> bool { return (events & EPOLLOUT) != NoneEvent; }
 
     /**
      * @brief Tie this channel to the owner object managed by shared_ptr,prevent the owner object being destroyed in handleEvent.
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "net/Callbacks.h"
+#include "net/EventLoopThreadpool.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+
+class EventLoop;
+
+enum class ConnectionPoolPolicy {
+    LeastOutstanding,
+    PowerOfTwoChoices,
+};
+
+struct ConnectionPoolOptions
+{
+    int conns_per_upstream      = 4;
+    ConnectionPoolPolicy policy = ConnectionPoolPolicy::PowerOfTwoChoices;
+    int eject_after_failures    = 3;   // 连续失败多少次后摘除该 upstream
+    double eject_seconds        = 5.0; // 摘除时长
+};
+
+/**
+ * @brief client side pool of TcpClient, spanning several upstream addresses and several connections per upstream.
+ * @details
+ * 1. every connection is a TcpClient bound to one loop of the pool's EventLoopThreadPool, round-robin like TcpServer
+ * 2. acquire() picks a live connection by least-outstanding-request or power-of-two-choices, the returned Lease counts as one outstanding request until it is destroyed.
+ *    The connected slots are kept in a ready list by the connection and close callbacks, acquire() picks from it under a short lock without allocating
+ * 3. an upstream whose Connector keeps failing is ejected for a while, its connections are skipped by acquire()
+ * @attention setXXX / setThreadNum / start / stop must be called in the base loop thread, acquire() is thread safe after start()
+ */
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool> {
+public:
+    using Policy  = ConnectionPoolPolicy;
+    using Options = ConnectionPoolOptions;
+
+private:
+    struct Upstream
+    {
+        explicit Upstream(const InetAddress& address)
+            : addr {address}
+        {
+        }
+        const InetAddress addr;
+        std::atomic<int> consecutive_failures {0};
+        std::atomic<int64_t> ejected_until_us {0}; // 0 表示健康
+        std::atomic<uint64_t> ejection_count {0};
+    };
+
+    struct Slot
+    {
+        Upstream* upstream {nullptr};
+        std::shared_ptr<TcpClient> client;
+        std::atomic<int> outstanding {0};
+        TcpConnectionPtr conn; // while connected, guarded by ready_mutex_
+    };
+
+public:
+    /**
+     * @brief RAII handle of a picked connection, counts as one outstanding request of its slot until destroyed
+     */
+    class Lease {
+    private:
+        std::shared_ptr<Slot> slot_;
+        TcpConnectionPtr conn_;
+
+    public:
+        Lease() = default;
+        Lease(std::shared_ptr<Slot> slot, TcpConnectionPtr conn);
+        ~Lease();
+
+        Lease(const Lease&)                    = delete;
+        auto operator=(const Lease&) -> Lease& = delete;
+        Lease(Lease&& rhs) noexcept;
+        auto operator=(Lease&& rhs) noexcept -> Lease&;
+
+        [[nodiscard]] auto getConnection() const
+            -> const TcpConnectionPtr& { return conn_; }
+
+        explicit operator bool() const { return conn_ != nullptr; }
+
+        /**
+         * @brief finish the request early, the lease becomes empty
+         */
+        void release();
+    };
+
+private:
+    EventLoop* const base_loop_;
+    const std::string name_;
+    const Options options_;
+    std::shared_ptr<EventLoopThreadPool> threadpool_;
+
+    std::vector<std::unique_ptr<Upstream>> upstreams_;
+    std::vector<std::shared_ptr<Slot>> slots_; // fixed after start()
+    mutable std::mutex ready_mutex_;
+    std::vector<std::shared_ptr<Slot>> ready_; // the connected slots, reserved for all of them by start()
+
+    ConnectionCallback connection_callback_;
+    ConnectionCallback conn_close_callback_;
+    MessageCallback msg_callback_;
+    WriteCompleteCallback write_complete_callback_;
+
+    std::atomic<bool> started_;
+
+    /**
+     * @brief called in the loop of the failed client
+     */
+    void onConnectFailed_(Upstream* upstream, int savedErrno);
+    void onConnected_(Upstream* upstream);
+    /**
+     * @brief add the slot at @c index to the ready list, or take it out, called in the loop of its client
+     */
+    void markReady_(size_t index, const TcpConnectionPtr& conn);
+    void markDown_(size_t index);
+
+    [[nodiscard]] auto isEjected_(const Upstream& upstream, int64_t nowUs) const
+        -> bool;
+
+    /**
+     * @brief whether acquire() may pick @c slot, any ready slot when not @c healthyOnly
+     */
+    [[nodiscard]] auto isCandidate_(const Slot& slot, int64_t nowUs, bool healthyOnly) const
+        -> bool;
+    /**
+     * @attention the pickers run under ready_mutex_, on a non empty set of @c count candidates
+     */
+    [[nodiscard]] auto nthCandidate_(size_t n, int64_t nowUs, bool healthyOnly) const
+        -> const std::shared_ptr<Slot>&;
+    [[nodiscard]] auto pickLeastOutstanding_(int64_t nowUs, bool healthyOnly) const
+        -> const std::shared_ptr<Slot>&;
+    [[nodiscard]] auto pickPowerOfTwo_(int64_t nowUs, bool healthyOnly, size_t count) const
+        -> const std::shared_ptr<Slot>&;
+
+public:
+    ConnectionPool(EventLoop* baseLoop,
+                   std::vector<InetAddress> upstreams,
+                   std::string nameArg,
+                   Options options = Options {});
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&)                    = delete;
+    auto operator=(const ConnectionPool&) -> ConnectionPool& = delete;
+    ConnectionPool(ConnectionPool&&)                         = delete;
+    auto operator=(ConnectionPool&&) -> ConnectionPool&      = delete;
+
+    /**
+     * @brief number of IO threads the connections are spread across, 0 means all in base loop
+     * @attention must be called before start()
+     */
+    void setThreadNum(int numThreads) { threadpool_->setThreadNum(numThreads); }
+
+    void setConnectionCallback(ConnectionCallback cb) { connection_callback_ = std::move(cb); }
+    void setConnectionCloseCallback(ConnectionCallback cb) { conn_close_callback_ = std::move(cb); }
+    void setMessageCallback(MessageCallback cb) { msg_callback_ = std::move(cb); }
+    void setWriteCompleteCallback(WriteCompleteCallback cb) { write_complete_callback_ = std::move(cb); }
+
+    /**
+     * @brief start the loops and pre-connect every connection of every upstream, harmless to call it multiple times
+     */
+    void start();
+
+    /**
+     * @brief close all the connections, stop reconnecting and stop the io threads of the pool
+     * @details the closes run in the io loops before they end, acquire() returns empty leases from then on
+     */
+    void stop();
+
+    /**
+     * @brief pick a live connection of a healthy upstream, an empty lease if none is available
+     * @details if every upstream is ejected, fall back to any live connection
+     * @thread safe
+     */
+    auto acquire()
+        -> Lease;
+
+    [[nodiscard]] auto getName() const
+        -> const std::string& { return name_; }
+
+    /**
+     * @brief number of currently live connections
+     * @thread safe
+     */
+    [[nodiscard]] auto getLiveConnectionCount() const
+        -> size_t;
+
+    /**
+     * @brief number of upstreams currently ejected
+     * @thread safe
+     */
+    [[nodiscard]] auto getEjectedUpstreamCount() const
+        -> size_t;
+};
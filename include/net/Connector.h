@@ -18,6 +18,8 @@
 #include <atomic>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 class Channel;
 class EventLoop;
@@ -25,27 +27,56 @@ class EventLoop;
 /**
  * @tag inner implementation class, user invisible
  * @brief only reponsible for socket connection establishment, not for tcpconnection
+ * @details with several peer addresses, the connector races them Happy-Eyeballs style (RFC 8305):
+ * the addresses are tried in the given order, a new attempt starts every attempt delay or as soon as the previous one fails,
+ * the first socket that connects wins and every other attempt in flight is closed.
+ * Only when all the addresses failed, the whole race is retried with exponential backoff.
  */
 class Connector {
 public:
     using NewConnectionCallback = std::function<void(int sockFd)>;
+    using RetryCallback         = std::function<void()>;
+    using AddressStats          = ConnectAddressStats;
+
+    // the retry backoff, doubled after every failure up to the max
+    static inline constexpr int c_max_retry_delay_ms  = 30 * 1000;
+    static inline constexpr int c_init_retry_delay_ms = 500;
 
 private:
     enum States { Disconnected,
                   Connecting, // 已开始连接，在这里Socket connect是非阻塞的
                   Connected };// tcpconnection
-    static inline constexpr int c_max_retry_delay_ms  = 30 * 1000;
-    static inline constexpr int c_init_retry_delay_ms = 500;
+    // RFC 8305 recommended connection attempt delay
+    static inline constexpr int c_default_attempt_delay_ms = 250;
+
+    /**
+     * @brief one non-blocking connect in flight
+     */
+    struct Attempt
+    {
+        size_t addr_idx;
+        Timestamp started_at;
+        std::unique_ptr<Channel> channel;
+    };
 
     EventLoop* const loop_;
-    InetAddress peer_addr_;
+    std::vector<InetAddress> peer_addrs_; // in loop thread
+    size_t winner_idx_;
     std::weak_ptr<TcpClient> onwner_;
     std::atomic<bool> is_connect_canceled_; // atomic, 表示 Connector 是否保持连接, 即是否在尝试连接或重试或已连接
     std::atomic<States> state_;            // FIXME: use atomic variable
-    std::unique_ptr<Channel> channel_;
+    std::vector<Attempt> attempts_;        // 正在进行中的连接尝试
+    size_t next_addr_idx_;                 // 下一个待尝试的地址
     NewConnectionCallback new_connection_callback_;
+    ConnectFailedCallback connect_failed_callback_;
+    RetryCallback retry_callback_;
     int retry_delay_ms_;
+    int attempt_delay_ms_;
     Timer::Id retry_timer_id_;
+    Timer::Id attempt_timer_id_;
+
+    mutable std::mutex stats_mutex_;
+    std::vector<AddressStats> stats_;
 
     void setState_(States s) { state_ = s; }
     /**
@@ -58,25 +89,48 @@ private:
     void stopInLoop_();
 
     /**
-     * @brief 创建 socket + 发起非阻塞 connect
+     * @brief 创建 socket + 对下一个地址发起非阻塞 connect, 同步失败时立即尝试再下一个
+     */
+    void startNextAttempt_();
+    /**
+     * @brief 为进行中的 connect 注册可写事件
      */
-    void connectPeer_();
+    void watchAttempt_(int sockfd, size_t addrIdx);
+    void attemptWritableCB_(int sockfd);
+    void attemptErrorCB_(int sockfd);
     /**
-     * @brief socket 连接建立后，初始化 tcpconnection
+     * @brief 某个尝试失败, 关闭它, 并立即尝试下一个地址
      */
-    void postSocketConnected_(int sockfd);
-    void channelWriteCB_();
-    void channelErrorCB_();
+    void attemptFailed_(int sockfd, int savedErrno);
     /**
-     * @brief 关闭旧的sockfd并且重试
+     * @brief 关闭除 @c winnerFd 外所有进行中的尝试
      */
-    void retry_(int sockfd);
+    void cancelAttempts_(int winnerFd);
+    /**
+     * @brief 所有地址都失败了, 退避后重试
+     */
+    void raceFailed_();
+    void cancelAttemptTimer_();
+    /**
+     * @brief 一定间隔后重新开始整轮连接
+     */
+    void retry_();
+    void notifyConnectFailed_(int savedErrno);
 
-    auto removeAndResetChannel_() -> int;
     /**
-     * @brief 释放 Channel
+     * @brief take the attempt out of attempts_, its channel is unregistered and released after the current event handling
+     * @return the attempt without channel
+     */
+    auto removeAttempt_(int sockfd) -> Attempt;
+    /**
+     * @brief whether @c sockfd is still in attempts_, a canceled attempt may still be reported by the current poll
      */
-    void resetChannel_();
+    auto hasAttempt_(int sockfd) const -> bool;
+
+    void recordAttempt_(size_t addrIdx);
+    void recordSuccess_(size_t addrIdx, Timestamp startedAt);
+    void recordFailure_(size_t addrIdx);
+    void recordCanceled_(size_t addrIdx);
 
 public:
     Connector(const Connector&)                    = delete;
@@ -85,6 +139,10 @@ public:
     auto operator=(Connector&&) -> Connector&      = delete;
 
     Connector(EventLoop* loop, const InetAddress& peerAddr, std::weak_ptr<TcpClient> owner_);
+    /**
+     * @param peerAddrs ordered by preference, must not be empty
+     */
+    Connector(EventLoop* loop, std::vector<InetAddress> peerAddrs, std::weak_ptr<TcpClient> owner_);
     /**
      * @brief must call stop before ~Connector
      */
@@ -94,6 +152,29 @@ public:
     {
         new_connection_callback_ = cb;
     }
+
+    /**
+     * @brief called in loop thread each time a connect attempt fails, before retrying
+     */
+    void setConnectFailedCallback(const ConnectFailedCallback& cb)
+    {
+        connect_failed_callback_ = cb;
+    }
+
+    /**
+     * @brief called in loop thread instead of racing again once the retry delay expired, e.g. to resolve the host
+     * again: the callee refreshes the addresses by setServerAddresses() and calls resume()
+     * @attention must be called before start()
+     */
+    void setRetryCallback(RetryCallback cb) { retry_callback_ = std::move(cb); }
+
+    /**
+     * @brief delay before racing the next address while the previous attempt is still pending, 0 races all the
+     * addresses at once
+     * @attention must be called before start()
+     */
+    void setAttemptDelayMs(int delayMs) { attempt_delay_ms_ = delayMs; }
+
     /**
      * @brief 开始（或允许）连接流程
      * can be called in any thread
@@ -105,13 +186,41 @@ public:
      */
     void restart();
 
+    /**
+     * @brief race again after the retry callback, keeping the backoff, nothing if stopped meanwhile
+     * @attention in loop thread
+     */
+    void resume();
+
     /**
      * @brief 请求取消当前连接流程
      */
     void stop(); // can be called in any thread
 
+    /**
+     * @brief replace the addresses raced from the next start on, the statistics of the addresses kept are kept too
+     * @return false, nothing changed, while attempts are in flight or if @c peerAddrs is empty
+     * @attention in loop thread
+     */
+    auto setServerAddresses(std::vector<InetAddress> peerAddrs)
+        -> bool;
+
+    /**
+     * @brief the address connected last time, or the most preferred one if never connected
+     * @attention in loop thread, as the addresses may be replaced
+     */
     [[nodiscard]] auto getServerAddress() const
-        -> const InetAddress& { return peer_addr_; }
+        -> const InetAddress& { return peer_addrs_[winner_idx_]; }
+
+    [[nodiscard]] auto getServerAddresses() const
+        -> const std::vector<InetAddress>& { return peer_addrs_; }
+
+    /**
+     * @brief per address connect latency statistics
+     * @thread safe
+     */
+    [[nodiscard]] auto getConnectStats() const
+        -> std::vector<AddressStats>;
 };
 
-#endif // MUDUO_NET_CONNECTOR_H
\ No newline at end of file
+#endif // MUDUO_NET_CONNECTOR_H
@@ -6,6 +6,8 @@
 #include <mutex>
 #include <system_error>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "Timestamp.h"
@@ -15,6 +17,11 @@
 
 class Channel;
 class EPollPoller;
+class LoopLink;
+
+namespace Cot {
+class OffloadPool;
+} // namespace Cot
 
 // 事件循环类 主要包含了两个大模块 Channel Poller(epoll的抽象)
 /**
@@ -23,12 +30,31 @@ class EPollPoller;
 2. the life time of EventLoop object is same as the thread so that it no need to be a heap object
  */
 class EventLoop {
+    friend class LoopLink;
+    friend class EventLoopThreadPool;
+    friend class TimerQueue;
 
 public:
     using Clock     = std::chrono::steady_clock;
     using TimePoint = Clock::time_point;
     using Task      = std::function<void()>;
     using ChannelList = std::vector<Channel*>;
+
+    /**
+     * @brief the clock the loop time is read from
+     */
+    enum class ClockSource {
+        Precise, // gettimeofday(), 1us
+        Coarse,  // CLOCK_REALTIME_COARSE, cheaper but a scheduler tick (1-4ms) old
+    };
+
+    /**
+     * @brief what wakes the loop for its timers
+     */
+    enum class TimerMode {
+        Timerfd,     // a timerfd polled with the channels, 1us
+        PollTimeout, // the epoll_wait() timeout, no syscall per timer but 1ms
+    };
 private:
     /**
      * @brief 是否正在事件循环中
@@ -63,6 +89,19 @@ private:
     Timestamp last_poll_return_time_;
     // TimePoint last_poll_return_time_;
 
+    std::atomic<ClockSource> clock_source_;
+
+    /**
+     * @brief the loop time, read once per poll return, after each message callback, before the queued tasks run and before the next poll
+     */
+    Timestamp cached_now_;
+    uint64_t clock_reads_;
+
+    /**
+     * @brief the time spent between a poll return and the clock read right before the next poll
+     */
+    std::atomic<uint64_t> busy_us_;
+
     std::unique_ptr<EPollPoller> poller_;
     std::unique_ptr<TimerQueue> timer_queue_;
 
@@ -84,6 +123,33 @@ private:
     std::vector<Task> pending_tasks_;
     std::mutex mutex_;
 
+    /**
+     * @brief when the oldest task still in pending_tasks_ was queued, 0 if none is
+     */
+    std::atomic<int64_t> pending_since_us_;
+
+    /**
+     * @brief how long the last batch of pending tasks waited before running
+     */
+    std::atomic<int64_t> task_lag_us_;
+
+    /**
+     * @brief the SPSC rings to and from the other loops of a pool, see EventLoopThreadPool::runOnLoopFor(), in owner
+     * thread; a base loop has those of each pool it is the base of
+     */
+    std::vector<LoopLink*> inbound_links_;
+    std::vector<LoopLink*> outbound_links_;
+
+    /**
+     * @brief a link was posted to since the last drain, the wakeup for them all
+     */
+    std::atomic<bool> links_signalled_;
+
+    /**
+     * @brief where offload() runs the work, the default pool if null, in owner thread
+     */
+    std::shared_ptr<Cot::OffloadPool> offload_pool_;
+
     /**
      * @brief 通过eventfd唤醒loop所在的线程
      */
@@ -91,9 +157,37 @@ private:
 
     void wakeChannelReadCallback_() const; // 给eventfd返回的文件描述符wakeupFd_绑定的事件回调 当wakeup()时 即有事件发生时 调用handleRead()读wakeupFd_的8字节 同时唤醒阻塞的epoll_wait
     void runPendingTasks_();               // 执行上层回调
+    auto hasPendingTasks_()
+        -> bool;
+
+    /**
+     * @brief wake the loop to drain its inbound links, unless a wakeup is pending already
+     * @thread safe
+     */
+    void notifyLinks_();
+    /**
+     * @brief push what waits in the overflow of the outbound links, then run the tasks of the inbound ones
+     */
+    void runLinks_();
+    void attachLink_(LoopLink* link);
+    void detachLink_(LoopLink* link);
+
+    /**
+     * @brief submit @c job to the offload pool, or run it here when the pool is full
+     */
+    void offload_(Task job);
 
     void AbortNotInLoopThread_() const;
 
+    /**
+     * @brief the time from the clock source, bypassing the cache
+     * @thread safe
+     */
+    [[nodiscard]] auto readClock_() const
+        -> Timestamp;
+    [[nodiscard]] auto loopTimeOrClock_() const
+        -> Timestamp;
+
 public:
     EventLoop();
     ~EventLoop();
@@ -122,6 +216,44 @@ public:
     [[nodiscard]] auto getLastPollReturnTime() const
         -> TimePoint { return last_poll_return_time_.toTimePoint(); }
 
+    /**
+     * @brief the clock of now(), the timers and the task lag, Precise by default
+     * @thread safe
+     */
+    void setClockSource(ClockSource source);
+    [[nodiscard]] auto getClockSource() const
+        -> ClockSource { return clock_source_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief the loop time: the clock is read once when the poller returns and refreshed after each message callback
+     * and before the queued tasks, so the handlers of one iteration share a read instead of making their own
+     * @details like the loop time of libuv, the timers added in the loop thread count from it: a handler that runs long
+     * without the loop refreshing its time makes them fire that much later
+     * @attention in the owner thread only
+     */
+    [[nodiscard]] auto now() const
+        -> Timestamp { return cached_now_; }
+
+    /**
+     * @brief read the clock source into the loop time
+     * @attention in the owner thread only
+     */
+    auto refreshNow()
+        -> Timestamp;
+
+    /**
+     * @brief how stale a read of the clock source may be, in seconds: a tick for Coarse, 1us for Precise
+     */
+    [[nodiscard]] auto getClockResolution() const
+        -> double;
+
+    /**
+     * @brief the reads of the clock into the loop time so far, for benchmarks
+     * @attention in the owner thread only
+     */
+    [[nodiscard]] auto getClockReadCount() const
+        -> uint64_t { return clock_reads_; }
+
     /**
      * @brief Runs callback immediately in the loop thread.
      * It wakes up the loop, and run the cb.
@@ -138,6 +270,58 @@ public:
      */
     void queueTask(Task task);
 
+    /**
+     * @brief runs @c work on the offload pool, then @c continuation back in this loop, given the result of @c work if
+     * it has one
+     * @details the continuation is queued like queueTask(), so the loop keeps serving its channels and timers while the
+     * work runs. When the pool is full, the work runs here and now instead, slowing the loop down as backpressure; the
+     * continuation is queued all the same. The queue depth, the waits and the run times are in the metrics of the pool
+     * @attention in owner thread; neither @c work nor @c continuation may throw, and what they capture must outlive them
+     */
+    template <typename Work, typename Continuation>
+    void offload(Work work, Continuation continuation)
+    {
+        assertInOwnerThread();
+        offload_([this, work = std::move(work), continuation = std::move(continuation)]() mutable {
+            if constexpr (std::is_void_v<std::invoke_result_t<Work&>>)
+            {
+                work();
+                queueTask(std::move(continuation));
+            }
+            else
+            {
+                queueTask([result = work(), continuation = std::move(continuation)]() mutable {
+                    continuation(std::move(result));
+                });
+            }
+        });
+    }
+
+    /**
+     * @brief the pool offload() runs the work on, Cot::OffloadPool::GetDefault() if null
+     * @thread safe
+     */
+    void setOffloadPool(std::shared_ptr<Cot::OffloadPool> pool);
+
+    /**
+     * @brief how late the loop runs queued tasks: the wait of the last batch run, or the age of the oldest task still
+     * waiting when that is longer, so a loop stuck in a callback shows up before it gets back to its queue
+     * @details only refreshed by queued tasks, a loop nobody queues to keeps its last value
+     * @thread safe
+     */
+    [[nodiscard]] auto getTaskLagSeconds() const
+        -> double;
+
+    /**
+     * @brief the time the loop spent handling events, timers and tasks so far, out of the poller
+     * @details from each poll return to a clock read once the queued tasks of the iteration have run, right before
+     * the next poll. Sampled twice, the difference over the interval is how busy the loop was, see
+     * TcpServer::setRebalancing()
+     * @thread safe
+     */
+    [[nodiscard]] auto getBusySeconds() const
+        -> double { return static_cast<double>(busy_us_.load(std::memory_order_relaxed)) / 1e6; }
+
     // EventLoop的方法 => Poller的方法
     void updateChannel(Channel* channel);
     void removeChannel(Channel* channel);
@@ -185,5 +369,18 @@ public:
     ///
     void cancelTimer(Timer::Id timerId);
 
+    ///
+    /// Chooses what wakes the loop for the timers, the timerfd by default.
+    /// Safe to call from other threads.
+    ///
+    void setTimerMode(TimerMode mode);
+
+    ///
+    /// Lets the timers fire up to @c seconds late, so that the ones expiring within that window run in one wakeup
+    /// instead of one each. 0 by default.
+    /// Safe to call from other threads.
+    ///
+    void setTimerSlack(double seconds);
+
     static auto getEventLoopOfCurrentThread() -> EventLoop*;
 };
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "common/NamedJThread.h"
+#include <atomic>
 #include <functional>
 #include <string>
 
@@ -24,7 +25,7 @@ private:
     static auto getDefaultName_()
         -> std::string;
     void threadFunc_();
-    EventLoop *loop_;
+    std::atomic<EventLoop *> loop_; // published by the loop thread once the loop is constructed
     bool exiting_;
     NamedJThread thread_;
 };
\ No newline at end of file
@@ -1,14 +1,17 @@
 #pragma once
 
+#include "net/EventLoop.h"
 #include "net/EventLoopThread.h"
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 
-class EventLoop;
 class EventLoopThread;
+class LoopLink;
 
 class EventLoopThreadPool 
 {
@@ -16,7 +19,7 @@ public:
     using ThreadInitCallback = std::function<void(EventLoop *)>;
 
     EventLoopThreadPool(EventLoop *baseLoop, std::string nameArg);
-    ~EventLoopThreadPool() = default;// Don't delete loop, it's stack variable
+    ~EventLoopThreadPool(); // Don't delete loop, it's stack variable
 
     EventLoopThreadPool(const EventLoopThreadPool &) = delete;
     auto operator=(const EventLoopThreadPool &) -> EventLoopThreadPool & = delete;
@@ -27,6 +30,12 @@ public:
 
     // void start(ThreadInitCallback cb = nullptr);
     void start();
+    /**
+     * @brief quit and join the io threads, the tasks already queued to their loops run first; getNextLoop() returns
+     * the base loop afterwards
+     * @attention in the base loop thread, after start()
+     */
+    void stop();
 
     // 如果工作在多线程中，baseLoop_(mainLoop)会默认以轮询的方式分配Channel给subLoop
     auto getNextLoop()
@@ -35,6 +44,41 @@ public:
     auto getAllLoops()
         -> std::vector<EventLoop *>;
 
+    /**
+     * @brief the io loop owning @c key, by a consistent hash of the key over the io loops: the same key always lands
+     * on the same loop, so state sharded by it is only ever touched by that loop's thread
+     * @details the jump consistent hash, see jumpConsistentHash(); the base loop if there is no io thread
+     * @attention after start()
+     */
+    [[nodiscard]] auto getLoopForKey(uint64_t key) const
+        -> EventLoop *;
+    [[nodiscard]] auto getLoopForKey(std::string_view key) const
+        -> EventLoop *;
+
+    /**
+     * @brief run @c task in the loop owning @c key, then @c done back in the calling loop
+     * @details from a loop of the pool, the task goes over the SPSC ring from that loop to the owning one, no lock
+     * taken, and the tasks from one loop to another run in the order they were posted; the completions of the tasks
+     * run in one go come back over the reverse ring as a single task. Run right away, @c done included, if the
+     * calling loop owns the key. From any other thread, the task is queued to the owning loop like by
+     * EventLoop::queueTask(), and @c done is queued back to the calling thread's loop once the task has run, or run
+     * in the owning loop right after the task if the calling thread runs no loop
+     * @param done may be empty
+     * @attention the calling loop must outlive the task, as for the loops of the pool
+     * @thread safe
+     */
+    void runOnLoopFor(uint64_t key, EventLoop::Task task, EventLoop::Task done = {});
+    void runOnLoopFor(std::string_view key, EventLoop::Task task, EventLoop::Task done = {});
+
+    /**
+     * @brief Lamping and Veach: the bucket of @c key among @c buckets, with only 1/n of the keys moving to the new
+     * bucket when a bucket is added
+     */
+    static auto jumpConsistentHash(uint64_t key, int32_t buckets)
+        -> int32_t;
+
+    static constexpr size_t c_link_capacity = 1024; // tasks in flight per ring before the overflow
+
     [[nodiscard]] auto Started() const
         -> bool { return started_; }
     [[nodiscard]] auto getName() const
@@ -48,4 +92,12 @@ private:
     int next_; // 轮询的下标
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
     std::vector<EventLoop *> sub_loops_;
+
+    // the base loop then the sub loops, one LoopLink per ordered pair of them: from * size + to, none for a loop to itself
+    std::vector<EventLoop *> link_ends_;
+    std::vector<std::unique_ptr<LoopLink>> links_;
+
+    void makeLinks_();
+    [[nodiscard]] auto findLink_(const EventLoop *from, const EventLoop *to) const
+        -> LoopLink *;
 };
\ No newline at end of file
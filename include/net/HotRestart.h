@@ -0,0 +1,140 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <signal.h>
+#include <sys/types.h>
+
+#include "net/Callbacks.h"
+#include "net/InetAddress.h"
+#include "net/TcpServer.h"
+
+class EventLoop;
+class SignalHandler;
+
+/**
+ * @brief restart a server process without closing its listening sockets
+ * @details the old and the new process meet on the handoff unix socket:
+ * 1. the new process calls inheritFromPredecessor() at startup, it receives every listening fd of the old process
+ *    by SCM_RIGHTS, keyed by the TcpServer name. Both processes accept from the same kernel queues from then on
+ * 2. once its servers are started, the new process calls start(), which sends the drain signal to the old process
+ * 3. the old process, on the drain signal delivered by the SignalHandler, stops accepting and waits for its
+ *    connections to close, until the drain timeout. Then the drained callback runs, by default quitting the loop
+ * no connection is refused during the restart, the queued ones are accepted by the new process.
+ * The handoff socket itself is handed over as well, the next restart meets the new process there.
+ * A process started with no predecessor listening on the handoff socket starts cold.
+ *
+ * @code
+ *  auto hot = HotRestart {&loop, InetAddress::fromUnixPath("@myserver-hot-restart")};
+ *  hot.inheritFromPredecessor();
+ *  auto signals = SignalHandler {&loop};
+ *  hot.watchSignal(signals);
+ *  signals.start(); // before any thread is started, they inherit the blocked signal mask
+ *  auto server = hot.makeServer(InetAddress {8080}, "http");
+ *  server->start();
+ *  hot.start();
+ *  loop.loop();
+ * @endcode
+ * @attention the HotRestart must outlive the servers added to it, all in the loop thread
+ */
+class HotRestart {
+public:
+    inline static constexpr int c_default_drain_signal              = SIGUSR2;
+    inline static constexpr double c_default_drain_timeout_seconds  = 30.0;
+    inline static constexpr int c_default_inherit_timeout_ms        = 1000;
+
+private:
+    // the handoff socket travels with the servers' listening sockets under this reserved name
+    inline static constexpr std::string_view c_handoff_fd_name = "hot-restart-handoff";
+    inline static constexpr std::string_view c_handoff_request = "HANDOFF\n";
+
+    EventLoop* const loop_;
+    const InetAddress handoff_addr_;
+    std::unordered_map<std::string, int> inherited_fds_; // not taken yet
+    pid_t predecessor_pid_;                               // 0: started cold
+    std::vector<std::shared_ptr<TcpServer>> servers_;
+    std::shared_ptr<TcpServer> handoff_server_;
+    int drain_signal_;
+    double drain_timeout_seconds_;
+    std::function<void()> drained_callback_;
+    bool draining_;
+    size_t servers_draining_;
+
+    void handoffMessageCB_(const TcpConnectionPtr& conn, Buffer& buf);
+    /**
+     * @brief reply "<pid> <name>...\n" with the listening fds attached in the same order
+     */
+    void handOff_(const TcpConnectionPtr& conn);
+    void serverDrained_();
+
+public:
+    HotRestart(EventLoop* loop, InetAddress handoffAddr);
+    /**
+     * @brief closes the inherited fds never taken
+     */
+    ~HotRestart();
+
+    HotRestart(const HotRestart&)                    = delete;
+    auto operator=(const HotRestart&) -> HotRestart& = delete;
+    HotRestart(HotRestart&&)                         = delete;
+    auto operator=(HotRestart&&) -> HotRestart&      = delete;
+
+    /**
+     * @brief ask the process listening on the handoff socket for its listening sockets, blocking
+     * @return false if there is none or it doesn't answer in time, start cold then
+     */
+    auto inheritFromPredecessor(int timeoutMs = c_default_inherit_timeout_ms)
+        -> bool;
+
+    [[nodiscard]] auto hasPredecessor() const
+        -> bool { return predecessor_pid_ > 0; }
+
+    /**
+     * @return the inherited listening fd of the server @c name, the caller owns it, -1 if none
+     */
+    auto takeInheritedFd(const std::string& name)
+        -> int;
+
+    /**
+     * @brief a server on the inherited socket of the same name if any, otherwise bound to @c listenAddr, added to the handoff
+     */
+    auto makeServer(const InetAddress& listenAddr,
+                    std::string name,
+                    TcpServer::Option option = TcpServer::kNoReusePort)
+        -> std::shared_ptr<TcpServer>;
+
+    /**
+     * @brief hand the listening socket of @c server over to the successor under its name, and drain it on the drain signal
+     */
+    void addServer(std::shared_ptr<TcpServer> server);
+
+    void setDrainSignal(int signo) { drain_signal_ = signo; }
+    void setDrainTimeout(double seconds) { drain_timeout_seconds_ = seconds; }
+    /**
+     * @brief called in loop thread once every server is drained, quits the loop by default
+     */
+    void setDrainedCallback(std::function<void()> cb) { drained_callback_ = std::move(cb); }
+
+    /**
+     * @brief drain on the drain signal
+     * @attention must be called before signals.start()
+     */
+    void watchSignal(SignalHandler& signals);
+
+    /**
+     * @brief serve the handoff socket for the next process, and tell the predecessor to drain
+     * @attention call it once the servers are started, in loop thread
+     */
+    void start();
+
+    /**
+     * @brief stop accepting on every server and wait for the connections to close, what the drain signal does
+     * @attention must be called in loop thread
+     */
+    void drain();
+};
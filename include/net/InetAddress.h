@@ -4,10 +4,12 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <string>
+#include <string_view>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <variant>
 
-// 封装socket地址类型
+// 封装socket地址类型: IPv4, IPv6 or a unix domain socket path
 class InetAddress {
 public:
     /**
@@ -30,44 +32,54 @@ public:
         : addr_(addr)
     {
     }
+
+    explicit InetAddress(const struct sockaddr_un& addr)
+        : addr_(addr)
+    {
+    }
+
     explicit InetAddress(const sockaddr_storage& other)
     {
-        if (other.ss_family == AF_INET)
-        {
-            addr_ = *Sock::sockaddrCast<sockaddr_in>(&other);
-        }
-        else if (other.ss_family == AF_INET6)
-        {
-            addr_ = *Sock::sockaddrCast<sockaddr_in6>(&other);
-        }
-        else
-        {
-            //todo
-        }
+        SetSockAddr(Sock::sockaddrCast<sockaddr>(&other));
     }
 
     explicit InetAddress(const struct sockaddr* addr)
     {
-        if (addr->sa_family == AF_INET)
-        {
-            addr_ = *Sock::sockaddrCast<sockaddr_in>(addr);
-            return;
-        }
-        if (addr->sa_family == AF_INET6)
-        {
-            addr_ = *Sock::sockaddrCast<sockaddr_in6>(addr);
-            return;
-        }
-        // todo: error_handling
+        SetSockAddr(addr);
     }
 
+    /**
+     * @brief a unix domain stream socket address
+     * @param path a filesystem path, or an abstract name if it starts with '@'.
+     * the abstract name is padded with '\0' to the whole sun_path, the same on both sides as long as both use InetAddress
+     */
+    static auto fromUnixPath(std::string_view path)
+        -> InetAddress;
+
     [[nodiscard]] auto getFamily() const
         -> sa_family_t
     {
         if (addr_.index() == 0)
             return std::get<sockaddr_in>(addr_).sin_family;
-        return std::get<sockaddr_in6>(addr_).sin6_family;
+        if (addr_.index() == 1)
+            return std::get<sockaddr_in6>(addr_).sin6_family;
+        return std::get<sockaddr_un>(addr_).sun_family;
     }
+
+    [[nodiscard]] auto isUnix() const
+        -> bool { return addr_.index() == 2; }
+
+    /**
+     * @brief the unix socket path, '@' leading for an abstract name, empty if unnamed or not a unix address
+     */
+    [[nodiscard]] auto getUnixPath() const
+        -> std::string;
+
+    /**
+     * @brief the length to pass to bind/connect
+     */
+    [[nodiscard]] auto getSockLen() const
+        -> socklen_t { return Sock::sockaddrLen(getSockAddr()); }
     [[nodiscard]] auto toIpRepr() const
         -> std::string;
 
@@ -79,16 +91,21 @@ public:
     [[nodiscard]] auto getSockAddr() const
         -> const struct sockaddr*;
 
-    void SetSockAddr(struct sockaddr* addr)
+    void SetSockAddr(const struct sockaddr* addr)
     {
         if (addr->sa_family == AF_INET)
         {
-            std::get<sockaddr_in>(addr_) = *Sock::sockaddrCast<sockaddr_in>(addr);
+            addr_ = *Sock::sockaddrCast<sockaddr_in>(addr);
         }
         else if (addr->sa_family == AF_INET6)
         {
-            std::get<sockaddr_in6>(addr_) = *Sock::sockaddrCast<sockaddr_in6>(addr);
+            addr_ = *Sock::sockaddrCast<sockaddr_in6>(addr);
+        }
+        else if (addr->sa_family == AF_UNIX)
+        {
+            addr_ = *Sock::sockaddrCast<sockaddr_un>(addr);
         }
+        // todo: error_handling
     }
 
     [[nodiscard]] auto Ipv4NetEndian() const -> uint32_t;
@@ -97,7 +114,9 @@ public:
     {
         if (addr_.index() == 0)
             return std::get<sockaddr_in>(addr_).sin_port;
-        return std::get<sockaddr_in6>(addr_).sin6_port;
+        if (addr_.index() == 1)
+            return std::get<sockaddr_in6>(addr_).sin6_port;
+        return 0; // unix domain socket has no port
     }
 
     // resolve hostname to IP address, not changing port or sin_family
@@ -114,5 +133,5 @@ public:
     static auto GetPeerInetAddress(int sockfd) -> InetAddress;
 
 private:
-    std::variant<sockaddr_in, sockaddr_in6> addr_;
+    std::variant<sockaddr_in, sockaddr_in6, sockaddr_un> addr_;
 };
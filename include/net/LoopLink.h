@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+
+#include "net/EventLoop.h"
+#include "net/SpscRing.h"
+
+/**
+ * @brief one way hand-off of tasks from a loop to another of the same pool over an SpscRing, no lock on the way
+ * @details the tasks run in the order they were posted, a full ring keeps them in an overflow on the posting side
+ * until the other loop made room. The completions of a drained batch go back over the reverse link as a single task.
+ * Made by EventLoopThreadPool, see runOnLoopFor()
+ */
+class LoopLink {
+public:
+    struct Item
+    {
+        EventLoop::Task task;
+        EventLoop::Task done; // run back in the posting loop, may be empty
+    };
+
+    LoopLink(EventLoop* from, EventLoop* to, size_t capacity);
+
+    LoopLink(const LoopLink&)                    = delete;
+    auto operator=(const LoopLink&) -> LoopLink& = delete;
+    LoopLink(LoopLink&&)                         = delete;
+    auto operator=(LoopLink&&) -> LoopLink&      = delete;
+
+    void setReverse(LoopLink* reverse) { reverse_ = reverse; }
+
+    [[nodiscard]] auto getFrom() const
+        -> EventLoop* { return from_; }
+    [[nodiscard]] auto getTo() const
+        -> EventLoop* { return to_; }
+
+    /**
+     * @attention in the loop of getFrom()
+     */
+    void post(EventLoop::Task task, EventLoop::Task done = {});
+
+    /**
+     * @brief move what waits in the overflow into the ring, as far as it fits
+     * @attention in the loop of getFrom()
+     */
+    void flushOverflow();
+
+    /**
+     * @brief run the tasks in the ring, at most a ring's worth so that a busy poster can't hold the loop
+     * @attention in the loop of getTo()
+     * @return the tasks run
+     */
+    auto drain()
+        -> size_t;
+
+private:
+    EventLoop* const from_;
+    EventLoop* const to_;
+    LoopLink* reverse_;
+    SpscRing<Item> ring_;
+    std::deque<Item> overflow_;    // in the loop of from_, not empty once the ring was full
+    std::atomic<bool> overflowed_; // the loop of to_ wakes the one of from_ after making room
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "common/metrics.h"
+#include "net/Callbacks.h"
+#include "net/InetAddress.h"
+#include "net/TcpServer.h"
+
+class EventLoop;
+
+/**
+ * @brief admin endpoint: answers GET /metrics with the metrics registry in the Prometheus text format
+ * @details one request per connection, HTTP/1.0 or 1.1, closed after the response. The rendering runs in the loop of
+ * the endpoint, give it a loop of its own or a quiet one: a scrape takes the registry lock and reads every shard
+ */
+class MetricsServer {
+private:
+    std::shared_ptr<TcpServer> server_;
+    Cot::Counter& scrapes_;
+
+    void onMessage_(const TcpConnectionPtr& conn, Buffer& buf);
+
+public:
+    MetricsServer(EventLoop* loop, const InetAddress& listenAddr, std::string name = "metrics");
+
+    MetricsServer(const MetricsServer&)                    = delete;
+    auto operator=(const MetricsServer&) -> MetricsServer& = delete;
+    MetricsServer(MetricsServer&&)                         = delete;
+    auto operator=(MetricsServer&&) -> MetricsServer&      = delete;
+
+    void start() { server_->start(); }
+
+    auto getServer()
+        -> TcpServer& { return *server_; }
+};
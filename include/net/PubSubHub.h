@@ -0,0 +1,140 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "net/Callbacks.h"
+
+class EventLoop;
+
+enum class SlowSubscriberPolicy {
+    Drop,       // skip the messages the subscriber has no room for
+    Disconnect, // close the subscriber
+};
+
+struct PubSubHubOptions
+{
+    // a subscriber with more bytes than that waiting in its output buffer is slow
+    size_t max_pending_bytes    = 1024 * 1024;
+    SlowSubscriberPolicy policy = SlowSubscriberPolicy::Drop;
+};
+
+/**
+ * @brief topic fan-out to the TcpConnections subscribed to it, whatever loop they live in
+ * @details
+ * 1. the subscriptions are sharded by the loop of the subscriber, a shard is only touched in its loop
+ * 2. publish() wraps the message once into a refcounted publication and hands it to every loop having subscribers
+ *    of the topic, through the shard's inbox: the publications arriving while a loop is busy are delivered together
+ *    by a single task, one wakeup for the batch
+ * 3. in its loop the shard queues the payload to each local subscriber by sendShared(), by reference, written
+ *    directly when nothing is queued. A subscriber with more than max_pending_bytes queued is handled by the policy
+ * @attention subscribe / unsubscribe / unsubscribeAll in the loop of the connection, unsubscribeAll when it closes,
+ * the hub keeps the subscribed connections alive otherwise. publish() is thread safe.
+ * The hub may be destroyed before its loops: the drain tasks hold their shard by weak_ptr, a task left behind finds
+ * its shard gone and the undelivered publications are dropped
+ */
+class PubSubHub {
+public:
+    using Options = PubSubHubOptions;
+    using Policy  = SlowSubscriberPolicy;
+
+    struct Stats
+    {
+        uint64_t published;
+        uint64_t loop_batches; // inbox drain tasks run, each for one or more publications
+        uint64_t deliveries;
+        uint64_t dropped;
+        uint64_t disconnected;
+    };
+
+private:
+    struct Publication
+    {
+        std::string topic;
+        SharedPayload payload;
+    };
+    using PublicationPtr = std::shared_ptr<const Publication>;
+
+    struct LoopShard
+    {
+        EventLoop* loop;
+        size_t index;
+        Options options; // a copy, the drain task doesn't touch the hub
+        // in its loop
+        std::unordered_map<std::string, std::vector<TcpConnectionPtr>> subscribers;
+        std::unordered_map<const TcpConnection*, std::vector<std::string>> topics_of;
+        std::vector<PublicationPtr> draining;
+        // any thread
+        std::mutex inbox_mutex;
+        std::vector<PublicationPtr> inbox;
+        bool drain_queued = false;
+        std::atomic<uint64_t> loop_batches {0};
+        std::atomic<uint64_t> deliveries {0};
+        std::atomic<uint64_t> dropped {0};
+        std::atomic<uint64_t> disconnected {0};
+    };
+
+    const Options options_;
+    mutable std::shared_mutex registry_mutex_;
+    std::unordered_map<EventLoop*, size_t> shard_index_;
+    std::vector<std::shared_ptr<LoopShard>> shards_; // shared with the drain task running
+    std::unordered_map<std::string, std::vector<uint32_t>> topic_loops_; // topic -> subscribers per shard
+    std::atomic<uint64_t> published_;
+
+    auto shardOf_(EventLoop* loop)
+        -> LoopShard&;
+    void countSubscriber_(const std::string& topic, size_t shard, bool added);
+    void removeSubscriber_(LoopShard& shard, const TcpConnectionPtr& conn, const std::string& topic);
+    static void drainInbox_(LoopShard& shard);
+    static void deliver_(LoopShard& shard, const Publication& publication);
+
+public:
+    explicit PubSubHub(Options options = {});
+    ~PubSubHub();
+
+    PubSubHub(const PubSubHub&)                    = delete;
+    auto operator=(const PubSubHub&) -> PubSubHub& = delete;
+    PubSubHub(PubSubHub&&)                         = delete;
+    auto operator=(PubSubHub&&) -> PubSubHub&      = delete;
+
+    /**
+     * @details a connection subscribed to any topic is pinned to its loop, see TcpConnection::pinLoop()
+     * @return false if already subscribed
+     * @attention in the loop of @c conn
+     */
+    auto subscribe(const TcpConnectionPtr& conn, std::string_view topic)
+        -> bool;
+
+    /**
+     * @return false if not subscribed
+     * @attention in the loop of @c conn
+     */
+    auto unsubscribe(const TcpConnectionPtr& conn, std::string_view topic)
+        -> bool;
+
+    /**
+     * @attention in the loop of @c conn
+     */
+    void unsubscribeAll(const TcpConnectionPtr& conn);
+
+    /**
+     * @param payload the bytes sent to the subscribers as they are, framing included
+     * @return the number of loops the publication was handed to
+     * @thread safe
+     */
+    auto publish(std::string_view topic, SharedPayload payload)
+        -> size_t;
+
+    [[nodiscard]] auto getSubscriberCount(std::string_view topic) const
+        -> size_t;
+
+    [[nodiscard]] auto getStats() const
+        -> Stats;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @brief @c rate units per second with up to @c burst units at once, a zero rate means unlimited
+ */
+struct RateLimit
+{
+    double rate  = 0;
+    double burst = 0;
+
+    [[nodiscard]] auto isLimited() const
+        -> bool { return rate > 0; }
+};
+
+/**
+ * @brief token bucket of capacity @c burst refilled at @c rate per second
+ * @details kept as the time the bucket is full again (the GCRA form of the token bucket), a single atomic word: one
+ * bucket can be shared by the connections of several loops. The tokens are taken after the fact, the bytes are read
+ * already, so the bucket may go into debt: consume() tells how long the consumer should pause for the bucket to be
+ * back in budget.
+ * @thread safe
+ */
+class TokenBucket {
+private:
+    const double ns_per_token_;
+    const int64_t burst_ns_;
+    std::atomic<int64_t> full_at_ns_; // steady clock
+
+    static auto nowNs_()
+        -> int64_t;
+
+public:
+    explicit TokenBucket(RateLimit limit);
+
+    TokenBucket(const TokenBucket&)                    = delete;
+    auto operator=(const TokenBucket&) -> TokenBucket& = delete;
+    TokenBucket(TokenBucket&&)                         = delete;
+    auto operator=(TokenBucket&&) -> TokenBucket&      = delete;
+
+    /**
+     * @brief take @c tokens, whether they are there or not
+     * @return seconds until the bucket is out of debt, 0 if it is not in debt
+     */
+    auto consume(double tokens)
+        -> double;
+
+    /**
+     * @return seconds until the bucket is out of debt, without taking anything
+     */
+    [[nodiscard]] auto getWaitSeconds() const
+        -> double;
+};
+
+/**
+ * @brief the read pauses of the connections sharing it
+ */
+struct ThrottleCounters
+{
+    std::atomic<uint64_t> throttles {0};
+    std::atomic<uint64_t> throttled_us {0};
+};
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <expected>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#include "common/NamedJThread.h"
+#include "common/singleton.hpp"
+#include "net/InetAddress.h"
+
+class EventLoop;
+
+/**
+ * @brief error category of getaddrinfo(3), i.e. the EAI_XXX codes
+ */
+auto gaiErrorCategory()
+    -> const std::error_category&;
+
+/**
+ * @brief non-blocking hostname resolution for the event loops
+ * @details
+ * 1. getaddrinfo runs on the resolver's own threads, never on a loop thread, the result is handed back to the requesting loop through runTask
+ * 2. results are cached and shared across all loops, a positive entry lives for cache ttl and a failure for negative ttl.
+ *    getaddrinfo doesn't expose the record TTL, so the ttl is the resolver's configuration rather than the one of the DNS answer
+ * 3. concurrent lookups of the same host:port are coalesced into one getaddrinfo call
+ * 4. honours /etc/hosts and nsswitch.conf like any libc lookup, unless another lookup is set by setLookupFunction()
+ * @attention all the member functions are thread safe
+ */
+class Resolver {
+public:
+    using AddressList     = std::vector<InetAddress>;
+    using ResolveResult   = std::expected<AddressList, std::error_code>;
+    using ResolveCallback = std::function<void(const ResolveResult&)>;
+    using LookupFunction  = std::function<ResolveResult(const std::string& hostname, uint16_t port, bool ipv6)>;
+
+    inline static constexpr int c_default_thread_num      = 2;
+    inline static constexpr double c_default_cache_ttl    = 60.0;
+    inline static constexpr double c_default_negative_ttl = 5.0;
+
+private:
+    using Clock     = std::chrono::steady_clock;
+    using TimePoint = Clock::time_point;
+
+    struct CacheEntry
+    {
+        ResolveResult result;
+        TimePoint expire_at;
+    };
+
+    struct Waiter
+    {
+        EventLoop* loop;
+        ResolveCallback callback;
+    };
+
+    struct Request
+    {
+        std::string hostname;
+        uint16_t port;
+        bool ipv6;
+    };
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any cond_;
+    std::deque<Request> requests_;
+    // key: host:port, 正在解析的请求, 同一个 key 只发起一次 getaddrinfo
+    std::unordered_map<std::string, std::vector<Waiter>> inflight_;
+    std::unordered_map<std::string, CacheEntry> cache_;
+    std::chrono::duration<double> cache_ttl_;
+    std::chrono::duration<double> negative_ttl_;
+    LookupFunction lookup_; // empty: getaddrinfo
+
+    std::vector<NamedJThread> workers_;
+
+    static auto makeKey_(const std::string& hostname, uint16_t port, bool ipv6)
+        -> std::string;
+
+    void workerFunc_(std::stop_token st);
+
+    /**
+     * @brief blocking getaddrinfo, only called by workers
+     */
+    static auto doResolve_(const Request& request)
+        -> ResolveResult;
+
+    static void deliver_(EventLoop* loop, ResolveCallback cb, ResolveResult result);
+
+public:
+    explicit Resolver(int numThreads = c_default_thread_num);
+    ~Resolver();
+
+    Resolver(const Resolver&)                    = delete;
+    auto operator=(const Resolver&) -> Resolver& = delete;
+    Resolver(Resolver&&)                         = delete;
+    auto operator=(Resolver&&) -> Resolver&      = delete;
+
+    /**
+     * @brief resolve @c hostname asynchronously, @c cb always runs later in @c loop's thread, never inside this call
+     * @param ipv6 only look up AAAA records if true, otherwise A records
+     */
+    void resolve(std::string hostname, uint16_t port, EventLoop* loop, ResolveCallback cb, bool ipv6 = false);
+
+    /**
+     * @brief return the cached result if any and not expired
+     */
+    auto lookupCache(const std::string& hostname, uint16_t port, bool ipv6 = false) const
+        -> std::optional<ResolveResult>;
+
+    void setCacheTtl(double seconds);
+    void setNegativeTtl(double seconds);
+    void clearCache();
+
+    /**
+     * @brief look the hosts up by @c lookup instead of getaddrinfo, e.g. a fixed table for hermetic tests, called on the
+     * resolver threads; an empty one restores getaddrinfo
+     * @details the lookups already running finish with the former one, the cache is kept, see clearCache()
+     */
+    void setLookupFunction(LookupFunction lookup);
+};
+
+using ResolverMgr = Cot::Singleton<Resolver>;
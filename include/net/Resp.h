@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+#include <expected>
+#include <initializer_list>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class Buffer;
+
+/**
+ * @brief the type of a RESP value, by its prefix byte. RESP2 has the first five, RESP3 adds the rest
+ */
+enum class RespType : char {
+    SimpleString   = '+',
+    Error          = '-',
+    Integer        = ':',
+    BulkString     = '$',
+    Array          = '*',
+    Null           = '_', // also the RESP2 null bulk string and null array
+    Boolean        = '#',
+    Double         = ',',
+    BigNumber      = '(',
+    BulkError      = '!',
+    VerbatimString = '=', // str keeps the "txt:" format prefix
+    Map            = '%', // elements: key, value, key, value ...
+    Set            = '~',
+    Push           = '>',
+};
+
+struct RespValue
+{
+    RespType type = RespType::Null;
+    std::string str;                 // strings, errors, big numbers
+    int64_t integer = 0;             // Integer, Boolean as 0 / 1
+    double number   = 0.0;           // Double
+    std::vector<RespValue> elements; // Array, Map, Set, Push
+
+    [[nodiscard]] auto isError() const
+        -> bool { return type == RespType::Error or type == RespType::BulkError; }
+
+    [[nodiscard]] auto isNull() const
+        -> bool { return type == RespType::Null; }
+};
+
+enum class RespError {
+    Protocol, // a malformed line or an unknown type prefix inside an aggregate
+    TooLarge, // a line, a bulk string or an aggregate beyond the parser's limits
+    TooDeep,  // aggregates nested beyond the parser's limit
+};
+
+auto respErrorToString(RespError error)
+    -> std::string_view;
+
+/**
+ * @brief incremental RESP2 / RESP3 parser over a Buffer
+ * @details every complete token, a type line or a bulk payload, is consumed from the buffer as soon as it arrived,
+ * the aggregates under construction stay on the parser's stack. A value split across reads is thus never parsed
+ * twice, parse() only resumes where the last call stopped. Pipelined values come out one per call.
+ * A top level line not starting with a type prefix is an inline command (redis-cli over telnet), returned as an
+ * Array of BulkStrings split by spaces. RESP3 attributes are parsed and dropped.
+ * One parser per connection, after an error the connection should be closed, or the parser reset.
+ */
+class RespParser {
+public:
+    inline static constexpr size_t c_default_max_line      = 64 * 1024;
+    inline static constexpr int64_t c_default_max_bulk     = 512 * 1024 * 1024;
+    inline static constexpr int64_t c_default_max_elements = 1024 * 1024;
+    inline static constexpr size_t c_default_max_depth     = 32;
+
+private:
+    struct Frame
+    {
+        RespValue value;
+        int64_t remaining; // elements still to come
+        bool attribute;    // dropped once complete
+    };
+
+    std::vector<Frame> stack_;
+    int64_t bulk_len_; // payload length of the bulk whose header line is consumed, -1 if none
+    RespType bulk_type_;
+    size_t max_line_;
+    int64_t max_bulk_;
+    int64_t max_elements_;
+    size_t max_depth_;
+
+    /**
+     * @brief add a complete value to the aggregate on top of the stack, pop the completed aggregates
+     * @return the value if it completed a top level value
+     */
+    auto complete_(RespValue value)
+        -> std::optional<RespValue>;
+
+    /**
+     * @brief one type line, without its "\r\n"
+     */
+    auto parseLine_(std::string_view line)
+        -> std::expected<std::optional<RespValue>, RespError>;
+
+public:
+    RespParser();
+
+    void setMaxLine(size_t maxLine) { max_line_ = maxLine; }
+    void setMaxBulk(int64_t maxBulk) { max_bulk_ = maxBulk; }
+    void setMaxElements(int64_t maxElements) { max_elements_ = maxElements; }
+    void setMaxDepth(size_t maxDepth) { max_depth_ = maxDepth; }
+
+    /**
+     * @return the next complete top level value, std::nullopt if it needs more bytes
+     */
+    auto parse(Buffer& buf)
+        -> std::expected<std::optional<RespValue>, RespError>;
+
+    void reset();
+};
+
+/**
+ * @brief appends RESP encoded values to a string, the replies of a server or the commands of a client
+ * @details the RESP3 types degrade to their RESP2 form when the protocol is 2: a map to a flat array, a boolean to
+ * an integer, a double to a bulk string, null to the null bulk string
+ */
+class RespWriter {
+private:
+    std::string buf_;
+    int protocol_;
+
+public:
+    explicit RespWriter(int protocol = 2)
+        : protocol_ {protocol}
+    {
+    }
+
+    void setProtocol(int protocol) { protocol_ = protocol; }
+    [[nodiscard]] auto getProtocol() const
+        -> int { return protocol_; }
+
+    /**
+     * @brief a command as the Array of BulkStrings a server expects
+     */
+    void appendCommand(std::span<const std::string_view> args);
+    void appendCommand(std::initializer_list<std::string_view> args)
+    {
+        appendCommand(std::span<const std::string_view> {args.begin(), args.size()});
+    }
+
+    void appendSimpleString(std::string_view str);
+    /**
+     * @param message with its error code first, as "ERR ..." or "WRONGTYPE ..."
+     */
+    void appendError(std::string_view message);
+    void appendInteger(int64_t value);
+    void appendBulkString(std::string_view str);
+    void appendNull();
+    void appendBoolean(bool value);
+    void appendDouble(double value);
+    void appendArrayHeader(size_t count);
+    /**
+     * @param count of key value pairs
+     */
+    void appendMapHeader(size_t count);
+    void appendSetHeader(size_t count);
+    void appendValue(const RespValue& value);
+
+    [[nodiscard]] auto getBuffer() const
+        -> std::string_view { return buf_; }
+    [[nodiscard]] auto empty() const
+        -> bool { return buf_.empty(); }
+    void clear() { buf_.clear(); }
+    /**
+     * @brief move the encoded bytes out, the writer is empty afterwards
+     */
+    auto take()
+        -> std::string { return std::exchange(buf_, {}); }
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "net/Callbacks.h"
+#include "net/InetAddress.h"
+#include "net/Resp.h"
+
+class EventLoop;
+class TcpClient;
+
+/**
+ * @brief the reply to one command, a RespType::Error "ERR connection closed" if the connection went away first
+ */
+using RespReplyCallback = std::function<void(RespValue&& reply)>;
+
+/**
+ * @brief RESP client codec on TcpClient, the replies come back in command order and are matched to their callbacks
+ * @details the commands issued during one loop iteration are encoded into one buffer and leave with one send at the
+ * end of the iteration, so a pipeline filled from a message callback costs a single write. Commands issued before
+ * the connection is up are kept and sent once it is.
+ * @attention connect / disconnect / command are thread safe, the callbacks run in the loop
+ */
+class RespClient {
+private:
+    EventLoop* const loop_;
+    std::shared_ptr<TcpClient> client_;
+    // in loop thread
+    TcpConnectionPtr conn_;
+    RespParser parser_;
+    RespWriter out_;                        // encoded and not yet sent
+    std::deque<RespReplyCallback> pending_; // sent or in out_, in command order
+    bool flush_queued_;
+    uint64_t writes_; // sends of batched commands
+    ConnectionCallback connection_callback_;
+
+    void onConnection_(const TcpConnectionPtr& conn);
+    void onClose_(const TcpConnectionPtr& conn);
+    void onMessage_(const TcpConnectionPtr& conn, Buffer& buf);
+    void commandInOwnerLoop_(std::span<const std::string_view> args, RespReplyCallback cb);
+    void flush_();
+    void failPending_(std::string_view reason);
+
+public:
+    RespClient(EventLoop* loop, const InetAddress& serverAddr, std::string name);
+    RespClient(EventLoop* loop, std::string host, uint16_t port, std::string name);
+    ~RespClient();
+
+    RespClient(const RespClient&)                    = delete;
+    auto operator=(const RespClient&) -> RespClient& = delete;
+    RespClient(RespClient&&)                         = delete;
+    auto operator=(RespClient&&) -> RespClient&      = delete;
+
+    /**
+     * @brief called on connected and on disconnected, check conn->isConnected()
+     */
+    void setConnectionCallback(ConnectionCallback cb) { connection_callback_ = std::move(cb); }
+
+    void connect();
+    void disconnect();
+
+    /**
+     * @param args the command name first, copied before return
+     */
+    void command(std::span<const std::string_view> args, RespReplyCallback cb);
+    void command(std::initializer_list<std::string_view> args, RespReplyCallback cb)
+    {
+        command(std::span<const std::string_view> {args.begin(), args.size()}, std::move(cb));
+    }
+
+    /**
+     * @brief commands waiting for their replies
+     * @attention in loop thread
+     */
+    [[nodiscard]] auto getPendingCount() const
+        -> size_t { return pending_.size(); }
+
+    /**
+     * @brief number of sends the commands went out with so far
+     * @attention in loop thread
+     */
+    [[nodiscard]] auto getWriteCount() const
+        -> uint64_t { return writes_; }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "net/Callbacks.h"
+#include "net/InetAddress.h"
+#include "net/Resp.h"
+#include "net/TcpServer.h"
+
+class EventLoop;
+
+/**
+ * @param args the command name first, valid during the call only
+ * @param reply append exactly one reply, in the protocol version of the connection
+ */
+using RespCommandHandler = std::function<void(const TcpConnectionPtr& conn,
+                                              std::span<const std::string_view> args,
+                                              RespWriter& reply)>;
+
+/**
+ * @brief command dispatching skeleton of a RESP server on TcpServer
+ * @details
+ * 1. every connection has its RespParser, the pipelined commands of one read are parsed one by one and dispatched
+ *    to the handler registered for their name, case insensitive, in the loop of the connection
+ * 2. the replies of one read are collected in one RespWriter and leave with one send
+ * 3. PING, ECHO, HELLO (protocol 2 or 3), COMMAND and QUIT are built in, a registered handler overrides them
+ * 4. a protocol error is answered by an error reply, then the connection is closed
+ */
+class RespServer {
+private:
+    struct Session
+    {
+        RespParser parser;
+        int protocol = 2;
+        bool closing = false;
+    };
+
+    std::shared_ptr<TcpServer> server_;
+    std::unordered_map<std::string, RespCommandHandler> commands_; // by lower case name, read only after start()
+    std::atomic<uint64_t> commands_processed_;
+
+    void onConnection_(const TcpConnectionPtr& conn);
+    void onMessage_(const TcpConnectionPtr& conn, Buffer& buf, Timestamp receiveTime);
+    void dispatch_(const TcpConnectionPtr& conn, Session& session, std::span<const std::string_view> args, RespWriter& reply);
+    void registerBuiltins_();
+
+public:
+    RespServer(EventLoop* loop, const InetAddress& listenAddr, std::string name);
+
+    RespServer(const RespServer&)                    = delete;
+    auto operator=(const RespServer&) -> RespServer& = delete;
+    RespServer(RespServer&&)                         = delete;
+    auto operator=(RespServer&&) -> RespServer&      = delete;
+
+    /**
+     * @attention before start()
+     */
+    void setThreadNum(int numThreads) { server_->setThreadNum(numThreads); }
+
+    /**
+     * @brief the handler is called in the loops of the connections, concurrently if there are several
+     * @attention before start()
+     */
+    void registerCommand(std::string_view name, RespCommandHandler handler);
+
+    void start() { server_->start(); }
+
+    [[nodiscard]] auto getCommandsProcessed() const
+        -> uint64_t { return commands_processed_.load(std::memory_order_relaxed); }
+
+    auto getServer()
+        -> TcpServer& { return *server_; }
+};
@@ -1,3 +1,9 @@
+#pragma once
+
+#include <functional>
+#include <signal.h>
+#include <unordered_map>
+
 #include "net/EventLoop.h"
 #include "net/Channel.h"
 class SignalHandler{
@@ -9,6 +15,7 @@ private:
     sigset_t mask_;
     Uptr<Channel> channel_;
     SignalCallback signal_callback_;
+    std::unordered_map<int, SignalCallback> signal_callbacks_; // per signal, before signal_callback_
 
 public:
     explicit SignalHandler(EventLoop* loop);
@@ -19,6 +26,11 @@ public:
     ~SignalHandler();
 
     void addSignal(int signo);
+    /**
+     * @brief handle @c signo by @c cb instead of the common callback
+     * @attention must be called before start()
+     */
+    void addSignal(int signo, SignalCallback cb);
     void setCallback(SignalCallback cb);
 
     void start();
@@ -13,16 +13,23 @@
 
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <type_traits>
 
 namespace Sock {
 
 ///
-/// Creates a non-blocking socket file descriptor,
+/// Creates a non-blocking stream socket file descriptor, TCP or AF_UNIX by the family,
 /// abort if any error.
 auto createNonblockingOrDie(sa_family_t family)
     -> int;
 
+///
+/// Creates a non-blocking UDP socket file descriptor,
+/// abort if any error.
+auto createNonblockingDgramOrDie(sa_family_t family)
+    -> int;
+
 auto connect(int sockfd, const struct sockaddr& peer_addr)
     -> int;
 void BindOrDie(int sockfd, const struct sockaddr* addr);
@@ -37,6 +44,12 @@ auto Readv(int sockfd, const struct iovec* iov, int iovcnt)
 auto Write(int sockfd, const void* buf, size_t count)
     -> ssize_t;
 
+/// non-blocking batch receive/send of datagrams, see recvmmsg(2)/sendmmsg(2)
+auto RecvMmsg(int sockfd, struct mmsghdr* msgs, unsigned int vlen)
+    -> int;
+auto SendMmsg(int sockfd, struct mmsghdr* msgs, unsigned int vlen)
+    -> int;
+
 void close(int sockfd);
 
 void ShutdownWrite(int sockfd);
@@ -55,6 +68,9 @@ concept IsIpv4SocketAddr = std::is_same_v<std::decay_t<T>, struct sockaddr_in>;
 template <typename T>
 concept IsIpv6SocketAddr = std::is_same_v<std::decay_t<T>, struct sockaddr_in6>;
 
+template <typename T>
+concept IsUnixSocketAddr = std::is_same_v<std::decay_t<T>, struct sockaddr_un>;
+
 template <typename T>
 concept IsSockStorage = std::is_same_v<std::decay_t<T>, struct sockaddr_storage>;
 
@@ -64,6 +80,7 @@ concept IsGeneralSocketAddr = std::is_same_v<std::decay_t<T>, struct sockaddr>;
 template <typename T>
 concept IsSocketAddr = IsIpv4SocketAddr<T>
                        or IsIpv6SocketAddr<T>
+                       or IsUnixSocketAddr<T>
                        or IsGeneralSocketAddr<T>
                        or IsSockStorage<T>;
 
@@ -81,6 +98,11 @@ auto sockaddrCast(From* from_addr)
         return reinterpret_cast<To*>(from_addr);
 }
 
+/**
+ * @brief the address length to pass to bind/connect for the family of @c addr
+ */
+auto sockaddrLen(const struct sockaddr* addr) -> socklen_t;
+
 auto getLocalAddr(int sockfd) -> struct sockaddr_storage;
 
 auto getPeerAddr(int sockfd) -> struct sockaddr_storage;
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <utility>
+
+/**
+ * @brief bounded single producer single consumer queue
+ * @details the producer owns the tail, the consumer the head, each on its own cache line with a cached copy of the
+ * other index, so a push or a pop touches the shared line only when the cached index says the ring looks full or
+ * empty. No lock, no allocation after the construction
+ * @attention tryPush() from one thread, tryPop() from one other thread
+ */
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @param capacity rounded up to a power of two
+     */
+    explicit SpscRing(size_t capacity)
+        : mask_ {std::bit_ceil(std::max<size_t>(capacity, 2)) - 1}
+        , slots_ {std::make_unique<std::optional<T>[]>(mask_ + 1)}
+    {
+    }
+
+    SpscRing(const SpscRing&)                    = delete;
+    auto operator=(const SpscRing&) -> SpscRing& = delete;
+    SpscRing(SpscRing&&)                         = delete;
+    auto operator=(SpscRing&&) -> SpscRing&      = delete;
+
+    /**
+     * @return false if the ring is full, @c value is left untouched then
+     */
+    auto tryPush(T& value)
+        -> bool
+    {
+        auto tail = producer_.index.load(std::memory_order_relaxed);
+        if (tail - producer_.cached_other > mask_)
+        {
+            producer_.cached_other = consumer_.index.load(std::memory_order_acquire);
+            if (tail - producer_.cached_other > mask_)
+            {
+                return false;
+            }
+        }
+        slots_[tail & mask_].emplace(std::move(value));
+        producer_.index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    auto tryPop()
+        -> std::optional<T>
+    {
+        auto head = consumer_.index.load(std::memory_order_relaxed);
+        if (head == consumer_.cached_other)
+        {
+            consumer_.cached_other = producer_.index.load(std::memory_order_acquire);
+            if (head == consumer_.cached_other)
+            {
+                return std::nullopt;
+            }
+        }
+        auto& slot  = slots_[head & mask_];
+        auto result = std::move(slot);
+        slot.reset();
+        consumer_.index.store(head + 1, std::memory_order_release);
+        return result;
+    }
+
+    [[nodiscard]] auto getCapacity() const
+        -> size_t { return mask_ + 1; }
+
+private:
+    struct alignas(64) Side
+    {
+        std::atomic<size_t> index {0};
+        size_t cached_other = 0; // the last index of the other side seen
+    };
+
+    const size_t mask_;
+    std::unique_ptr<std::optional<T>[]> slots_;
+    Side producer_; // tail
+    Side consumer_; // head
+};
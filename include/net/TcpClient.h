@@ -4,11 +4,32 @@
 #include "TcpConnection.h"
 #include "net/InetAddress.h"
 #include <atomic>
+#include <functional>
 #include <memory>
+#include <vector>
 
 class Connector;
 using ConnectorPtr = std::unique_ptr<Connector>;
 
+/**
+ * @brief connect statistics of one server address
+ */
+struct ConnectAddressStats
+{
+    InetAddress addr;
+    uint64_t attempts {0};
+    uint64_t successes {0};
+    uint64_t failures {0};
+    uint64_t canceled {0}; // lost the race
+    double last_latency_ms {0.0};
+    double min_latency_ms {0.0};
+    double max_latency_ms {0.0};
+    double total_latency_ms {0.0}; // of the successful attempts
+
+    [[nodiscard]] auto avgLatencyMs() const
+        -> double { return successes == 0 ? 0.0 : total_latency_ms / static_cast<double>(successes); }
+};
+
 /**
  * @brief only thread-safe when use it in the same thread with loop
  */
@@ -23,6 +44,7 @@ private:
     ConnectionCallback conn_close_callback_;
     MessageCallback message_callback_;
     WriteCompleteCallback write_complete_callback_;
+    ConnectFailedCallback connect_failed_callback_;
     std::atomic<bool> retry_;       // atomic
     std::atomic<bool> willing_to_connect_;// 表示用户是否希望保持与服务端连接
     // std::atomic<bool> keep_connection_; // atomic, 客户端是否期望与服务器连接
@@ -30,13 +52,28 @@ private:
     int next_conn_id_;
     mutable std::mutex mutex_;
     TcpConnectionPtr connection_;
-    const InetAddress server_addr_;
+    std::vector<InetAddress> server_addrs_; // resolved in loop thread when constructed with a hostname
+    const std::string server_host_;
+    const uint16_t server_port_;
+    std::atomic<bool> resolving_;
+    int attempt_delay_ms_; // < 0 means the connector's default
+    std::atomic<Connector*> published_connector_; // connector_ for the other threads, once created
+    int resolve_retry_delay_ms_; // in loop, backoff of the next resolve after a failed one
 
 
     /// Not thread safe, but in loop
     void initTcpConnection_(int sockfd);
     /// Not thread safe, but in loop
     void removeConnection_(const TcpConnectionPtr& conn);
+    /// create the connector for server_addrs_ if not yet and start it
+    void startConnector_();
+    /// resolve server_host_ by the Resolver into server_addrs_ and the connector's addresses, report a failure to the
+    /// connect failed callback, then @c next in loop
+    void resolve_(std::function<void(bool resolved)> next);
+    /// resolve server_host_, then start the connector in loop
+    void resolveAndConnect_();
+    /// never resolved yet: resolve again after the backoff, as the connector does for refused connects
+    void retryResolve_();
 public:
     TcpClient(const TcpClient&)                    = delete;
     TcpClient(TcpClient&&)                         = delete;
@@ -48,7 +85,23 @@ public:
     TcpClient(EventLoop* loop,
               const InetAddress& serverAddr,
               std::string nameArg);
-    ~TcpClient(); // force out-line dtor, for std::unique_ptr members.
+    /**
+     * @brief the addresses are raced Happy-Eyeballs style, in the given order, the first connected one wins
+     */
+    TcpClient(EventLoop* loop,
+              std::vector<InetAddress> serverAddrs,
+              std::string nameArg);
+    /**
+     * @brief the @c host is resolved asynchronously on connect() without blocking the loop, see Resolver
+     * @details a failed resolve is reported to the connect failed callback and retried with backoff until disconnect().
+     * Every connect(), retry and reconnect resolves the host again, through the cache of the Resolver, so the client
+     * follows the host when its addresses change, keeping the former ones if the resolve fails
+     */
+    TcpClient(EventLoop* loop,
+              std::string host,
+              uint16_t port,
+              std::string nameArg);
+    ~TcpClient(); // force out-line dtor, for std::unique_ptr members. Force closes the connection
 
     void connect();
     void disconnect();
@@ -71,6 +124,15 @@ public:
         return name_;
     }
 
+    /// Delay before racing the next server address while the previous attempt is still pending, 0 races all at once.
+    /// Not thread safe, must be called before connect().
+    void setConnectAttemptDelayMs(int delayMs) { attempt_delay_ms_ = delayMs; }
+
+    /// Per server address connect statistics, empty before connect().
+    /// Thread safe.
+    auto getConnectStats() const
+        -> std::vector<ConnectAddressStats>;
+
     /// Set connection callback.
     /// Not thread safe.
     void setConnetionCallback(ConnectionCallback cb)
@@ -95,4 +157,11 @@ public:
     {
         write_complete_callback_ = std::move(cb);
     }
+
+    /// Set connect failed callback, called in loop thread for every failed attempt.
+    /// Not thread safe, must be called before connect().
+    void setConnectFailedCallback(ConnectFailedCallback cb)
+    {
+        connect_failed_callback_ = std::move(cb);
+    }
 };
@@ -2,13 +2,18 @@
 
 #include <any>
 #include <atomic>
+#include <deque>
 #include <memory>
+#include <span>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "net/Channel.h"
 #include "net/Buffer.h"
 #include "net/Callbacks.h"
 #include "net/InetAddress.h"
+#include "net/RateLimit.h"
 #include "net/Timestamp.h"
 #include "net/EventLoop.h"
 
@@ -28,6 +33,71 @@ class Socket;
 class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
     friend class TcpServer;
     friend class TcpClient;
+    friend class TcpRelay;
+
+public:
+    // below it MSG_ZEROCOPY costs more than the copy, the page pinning and the completion handling
+    inline static constexpr size_t c_default_zerocopy_threshold = 16 * 1024;
+    // pieces of one sendGathered() written directly by one writev, the rest are copied into the output buffer
+    inline static constexpr size_t c_max_gathered_iovecs = 64;
+    // pending output kept in memory before the rest goes to a spill file, see enableOutputSpill()
+    inline static constexpr size_t c_default_spill_threshold = 4 * 1024 * 1024;
+    // bytes given to one write(2) of the spill file
+    inline static constexpr size_t c_max_spill_write = 256 * 1024;
+
+    /**
+     * @brief the outcome of TcpServer::migrateConnection(), called in the loop owning the connection after it
+     */
+    using MigratedCallback = std::function<void(const TcpConnectionPtr&, bool migrated)>;
+
+    struct ZeroCopyStats
+    {
+        uint64_t zerocopy_sends;  // sendmsg(MSG_ZEROCOPY) calls
+        uint64_t completions;     // sends reported done by the error queue
+        uint64_t copied;          // of the completions, the kernel copied anyway, e.g. over loopback
+        uint64_t fallback_sends;  // payloads below the threshold, or ENOBUFS, sent by copy
+    };
+
+    struct SpillStats
+    {
+        uint64_t spills;        // spill files opened, once per excursion over the threshold
+        uint64_t spilled_bytes; // written to the spill files
+        uint64_t pending_bytes; // in the spill file, not sent yet
+    };
+
+    struct ThrottleStats
+    {
+        uint64_t throttles;       // reading paused for being over a read rate limit
+        double throttled_seconds; // of finished pauses
+        bool throttled;           // paused now
+    };
+
+    struct TrafficStats
+    {
+        Timestamp created;
+        Timestamp last_receive;      // invalid until the first bytes arrive
+        Timestamp last_send;         // invalid until the first bytes are written
+        uint64_t bytes_received;
+        uint64_t bytes_sent;         // written to the socket, not the ones still buffered
+        uint64_t reads;              // read calls, the one seeing the end of the stream included
+        uint64_t writes;             // write, writev and sendmsg calls, the ones would block included
+        uint64_t message_callbacks;
+        double callback_seconds;     // spent in the message callback, timed from the loop time so including the socket read
+    };
+
+    /**
+     * @brief TCP_INFO read by sampleTcpInfo()
+     */
+    struct TcpInfoSample
+    {
+        Timestamp sampled; // invalid if never sampled
+        uint32_t rtt_us;   // smoothed
+        uint32_t rttvar_us;
+        uint32_t snd_cwnd; // segments
+        uint32_t unacked;  // segments in flight
+        uint32_t lost;
+        uint32_t total_retrans;
+    };
 
 private:
     enum StateE {
@@ -41,7 +111,8 @@ private:
         Disconnecting
     };
 
-    EventLoop* const owner_loop_; // one connection owned by one loop only
+    // one connection owned by one loop at a time, TcpServer::migrateConnection() hands it to another
+    std::atomic<EventLoop*> owner_loop_;
     const std::string name_;
     std::atomic<StateE> state_;
     bool reading_;
@@ -65,12 +136,101 @@ private:
     Buffer input_buf_;  // 接收数据的缓冲区
     Buffer output_buf_; // 发送数据的缓冲区 用户send向outputBuffer_发
     std::any context_;
-    // FIXME: creationTime_, lastReceiveTime_
-    //        bytesReceived_, bytesSent_
+
+    /**
+     * @brief fds waiting to be attached to the byte at @c stream_offset of the output stream
+     */
+    struct PendingRights
+    {
+        uint64_t stream_offset;
+        std::vector<int> fds; // dup-ed, closed once sent
+    };
+    const bool is_unix_;                        // AF_UNIX connection, fds can be passed
+    uint64_t output_bytes_sent_;                // bytes of the output stream written to the socket so far
+    std::deque<PendingRights> pending_rights_;  // ordered by stream_offset
+    std::vector<int> received_fds_;             // not taken by the user yet
+
+    /**
+     * @brief a payload queued by reference, by sendShared() or sendZeroCopy()
+     */
+    struct PayloadSegment
+    {
+        SharedPayload payload;
+        size_t sent;         // bytes handed to the kernel
+        uint64_t buf_offset; // the output_buf_ bytes appended before it, to be written first
+        bool zerocopy;       // written by MSG_ZEROCOPY
+        WriteCompleteCallback on_written;
+    };
+    /**
+     * @brief a zerocopy send waiting for its completion, the kernel reads the payload pages until then
+     */
+    struct ZeroCopyInflight
+    {
+        uint32_t seq;
+        SharedPayload payload;
+    };
+    size_t zerocopy_threshold_;                // 0: zerocopy disabled
+    uint64_t output_buf_appended_;             // bytes ever appended to output_buf_
+    std::deque<PayloadSegment> payload_queue_; // not completely handed to the kernel yet
+    size_t payload_queue_bytes_;               // of payload_queue_ not handed yet
+    std::deque<ZeroCopyInflight> zc_inflight_; // ordered by seq
+    uint32_t zc_next_seq_;
+    ZeroCopyStats zc_stats_;
+
+    // the output beyond the threshold, in an unlinked temporary file, written after the output buffer and the payloads
+    // queued before it; the output sent meanwhile is appended to the file too, to keep the order
+    size_t spill_threshold_; // 0: spilling disabled
+    std::string spill_dir_;
+    int spill_fd_;           // -1: not spilling
+    uint64_t spill_written_; // bytes written to the file
+    uint64_t spill_sent_;    // of them, sent to the socket
+    std::deque<std::pair<uint64_t, WriteCompleteCallback>> spill_callbacks_; // of the spilled payloads, by end offset
+    SpillStats spill_stats_;
+
+    // read rate limiting, only when a limit is set
+    std::unique_ptr<TokenBucket> read_bytes_bucket_;
+    std::unique_ptr<TokenBucket> read_messages_bucket_;
+    std::shared_ptr<TokenBucket> shared_inbound_bucket_;      // the server's, for all its connections
+    std::shared_ptr<ThrottleCounters> shared_throttle_counters_;
+    bool throttled_;         // reading paused by the limits, independent of reading_
+    bool messages_charged_;  // chargeMessages() called by the running message callback
+    Timestamp throttled_since_;
+    uint64_t throttles_;
+    uint64_t throttled_us_;
+
+    // traffic, always counted, output_bytes_sent_ being the bytes sent
+    const Timestamp created_;
+    Timestamp last_receive_;
+    Timestamp last_send_;
+    uint64_t bytes_received_;
+    uint64_t reads_;
+    uint64_t writes_;
+    uint64_t message_callbacks_;
+    uint64_t callback_us_;
+    TcpInfoSample tcp_info_sample_;
+
+    uint32_t loop_pins_; // pinLoop() not undone by unpinLoop(), not migrated while any
+
+    /**
+     * @brief itself, from postConnectionCreate_() until the loop iteration it's closed in is over: while its channel
+     * may be handed events, so the handler and the callbacks given it need no weak_ptr locked per event. Released by
+     * a task queued by the close, run even if the loop quits meanwhile, or by destructConnectionInOnwerLoop_()
+     */
+    TcpConnectionPtr self_;
+
     void setState_(StateE state) { state_ = state; }
 
+    /**
+     * @brief the event handler of the socket channel
+     */
+    static void socketChannelEventHandler_(void* self, uint32_t events, Timestamp receiveTime);
+
     void socketChannelReadCB_(Timestamp receiveTime);
     void socketChannelWriteCB_();
+    /**
+     * @brief count a write call which returned @c n
+     */
+    void noteWritten_(ssize_t n);
 
     void socketChannelErrorCB_();
 
@@ -79,6 +239,51 @@ private:
      */
     void sendInOwnerLoop_(const void* data, size_t len);
     void sendInOwnerLoop_(std::string_view message);
+    void sendFdsInOwnerLoop_(std::string_view message, std::vector<int> fds);
+    void sendGatheredInOwnerLoop_(std::span<const std::string_view> pieces);
+    /**
+     * @brief queue the high watermark callback if appending @c appending bytes to the output buffer crosses it
+     */
+    void checkHighWatermark_(size_t appending);
+    /**
+     * @brief write the output buffer up to the next fds boundary, the fds go with the first byte of their message
+     */
+    auto writeOutputWithRights_(int* savedErrno)
+        -> ssize_t;
+    void closeUntakenFds_();
+    void sendZeroCopyInOwnerLoop_(SharedPayload payload);
+    void sendSharedInOwnerLoop_(SharedPayload payload, WriteCompleteCallback onWritten);
+    void queuePayload_(SharedPayload payload, size_t sent, bool zerocopy, WriteCompleteCallback onWritten);
+    /**
+     * @brief append to the output buffer, or to the spill file while spilling or if the buffer would go over the
+     * spill threshold
+     */
+    void appendOutput_(const char* data, size_t len);
+    /**
+     * @brief open the spill file, spilling is disabled if it cannot be created
+     */
+    auto startSpill_()
+        -> bool;
+    /**
+     * @brief append to the spill file, the connection is closed if it fails: the output cannot be kept in order then
+     */
+    auto spill_(const char* data, size_t len)
+        -> bool;
+    /**
+     * @brief one step of writing the spill file by sendfile(), closed once drained
+     */
+    auto writeOutputFromSpill_(int* savedErrno)
+        -> ssize_t;
+    void closeSpill_();
+    /**
+     * @brief one step of writing when payloads are queued: the copied bytes before the front payload, or the payload
+     */
+    auto writeOutputWithPayloads_(int* savedErrno)
+        -> ssize_t;
+    /**
+     * @brief read the zerocopy completions from the socket error queue and release the payloads
+     */
+    void readZeroCopyCompletions_();
 
     void shutdownInOwnerLoop_();
     void forceCloseInOwnerLoop_();
@@ -86,6 +291,13 @@ private:
         -> std::string_view;
     void startReadInOwnerLoop_();
     void stopReadInOwnerLoop_();
+    [[nodiscard]] auto isRateLimited_() const
+        -> bool { return read_bytes_bucket_ or read_messages_bucket_ or shared_inbound_bucket_; }
+    /**
+     * @brief charge the bytes of a read and the message to the buckets, pause reading while one is in debt
+     */
+    void chargeRead_(size_t bytes);
+    void resumeThrottled_();
 
     /* ======================== for tcpserver  ======================== */
     // called when TcpServer accepts a new connection
@@ -96,6 +308,33 @@ private:
     void destructConnectionInOnwerLoop_(); // should be called only once
     void socketChannelCloseCB_();
 
+    /**
+     * @brief run @c task in the owner loop, now when called there; a task that finds the connection migrated away
+     * by the time it runs follows it to its new loop
+     */
+    void runInOwnerLoop_(EventLoop::Task task);
+    void queueInOwnerLoop_(EventLoop::Task task);
+
+    /**
+     * @brief nothing in flight the old loop would have to finish: connected, not pinned to its loop, not throttled,
+     * nothing buffered or spilled for output, no zerocopy or fds pending, and its own event handler on the channel,
+     * e.g. not relayed
+     */
+    [[nodiscard]] auto isQuiescent_() const
+        -> bool;
+    /**
+     * @brief a relay can take the socket over: connected, not relayed yet, and no pending output but the output buffer,
+     * which the relay writes first. The queued payloads, the spill file, the zerocopy completions and the fds would be
+     * left behind by splice
+     */
+    [[nodiscard]] auto isRelayable_() const
+        -> bool;
+    /**
+     * @brief move the channel from this loop's poller to @c target's and hand the connection over to it
+     * @attention in a queued task of the owner loop, after the events of the iteration are handled
+     */
+    void migrateInOwnerLoop_(EventLoop* target, MigratedCallback cb);
+
 public:
     /**
      * @attention User should not create this object.
@@ -117,7 +356,7 @@ public:
         -> TcpConnection& = delete;
 
     auto getLoop() const
-        -> EventLoop* { return owner_loop_; }
+        -> EventLoop* { return owner_loop_.load(std::memory_order_acquire); }
 
     auto getName() const
         -> const std::string& { return name_; }
@@ -134,12 +373,39 @@ public:
     auto isDisconnected() const
         -> bool { return state_ == Disconnected; }
 
+    /**
+     * @brief bytes accepted by send() and not written to the socket yet
+     * @attention in loop thread
+     */
+    [[nodiscard]] auto getOutputBufferedBytes() const
+        -> size_t { return output_buf_.getReadableBytesCount() + payload_queue_bytes_ + (spill_written_ - spill_sent_); }
+
     // return true if success.
     auto getTcpInfo(struct tcp_info*) const
         -> bool;
     auto getTcpInfoString() const
         -> std::string;
 
+    /**
+     * @brief read TCP_INFO into the sample kept with the connection, TcpServer::setTcpInfoSampling() does it periodically
+     * @return false for a unix domain connection or if getsockopt fails, the last sample is kept then
+     * @attention in loop thread
+     */
+    auto sampleTcpInfo()
+        -> bool;
+
+    /**
+     * @attention in loop thread
+     */
+    [[nodiscard]] auto getTcpInfoSample() const
+        -> const TcpInfoSample& { return tcp_info_sample_; }
+
+    /**
+     * @attention in loop thread, TcpServer::collectConnectionStats() gathers them from any thread
+     */
+    [[nodiscard]] auto getTrafficStats() const
+        -> TrafficStats;
+
     // 发送数据, thread safe cause it the data only sends in owner loop thread
     void send(std::span<char> data);
     void send(std::string_view message);
@@ -152,7 +418,7 @@ public:
 
         if (state_ == Connected)
         {
-            if (owner_loop_->inOwnerThread())
+            if (getLoop()->inOwnerThread())
             {
                 sendInOwnerLoop_(&integer, sizeof(integer));
             }
@@ -161,11 +427,93 @@ public:
                 auto send_msg_task = [tcp_conn = shared_from_this(), integer]() -> void {
                     tcp_conn->sendInOwnerLoop_(&integer, sizeof(integer));
                 };
-                owner_loop_->runTask(send_msg_task);
+                runInOwnerLoop_(send_msg_task);
             }
         }
     }
 
+    /**
+     * @brief send the concatenation of @c pieces without building it: written by one writev when nothing is queued,
+     * only the part the socket doesn't take is copied into the output buffer
+     * @attention the pieces need only be valid during the call. thread safe, copied when called from another thread
+     */
+    void sendGathered(std::span<const std::string_view> pieces);
+
+    /**
+     * @brief send @c message with @c fds attached by SCM_RIGHTS, only for unix domain connections
+     * @details the fds are dup-ed, the caller keeps its own ones. They reach the peer together with the first byte of
+     * @c message, keeping the order with the other sends, the peer gets them by takeReceivedFds()
+     * @attention @c message must not be empty, at most 64 fds. thread safe
+     */
+    void sendFds(std::string_view message, std::span<const int> fds);
+
+    /**
+     * @brief the fds received so far by SCM_RIGHTS, the caller owns them and must close them
+     * @details an fd is available in the message callback which delivers the first byte of the message it was sent with,
+     * the fds not taken are closed with the connection
+     * @attention must be called in loop thread
+     */
+    auto takeReceivedFds()
+        -> std::vector<int>;
+
+    auto isUnix() const
+        -> bool { return is_unix_; }
+
+    /**
+     * @brief opt in MSG_ZEROCOPY for sendZeroCopy() of the payloads not smaller than @c threshold
+     * @return false if the socket doesn't support SO_ZEROCOPY, sendZeroCopy() copies then
+     * @attention call it in loop thread, e.g. in the connection callback
+     */
+    auto enableZeroCopy(size_t threshold = c_default_zerocopy_threshold)
+        -> bool;
+
+    /**
+     * @brief send @c payload without copying it to user space buffers or the kernel when zerocopy is enabled and
+     * the payload is large enough, otherwise the same as send()
+     * @details the payload is kept referenced until the kernel reports the completion on the socket error queue,
+     * the content must not change in the meantime. The order with the other sends is kept
+     * @thread safe
+     */
+    void sendZeroCopy(SharedPayload payload);
+
+    /**
+     * @brief send @c payload without copying it: the connection queues a reference, so the same payload may be sent
+     * to many connections, see TcpServer::broadcast(), and is freed once the last of them has written it
+     * @details written directly when nothing is queued, what the socket does not take is written from the payload
+     * later on, by MSG_ZEROCOPY if enableZeroCopy() and the payload is large enough. The order with the other sends
+     * is kept. The content must not change in the meantime
+     * @param onWritten called in loop thread once the whole payload is handed to the kernel, unlike the write complete
+     * callback which waits for all the output
+     * @thread safe
+     */
+    void sendShared(SharedPayload payload, WriteCompleteCallback onWritten = {});
+
+    /**
+     * @attention must be called in loop thread
+     */
+    auto getZeroCopyStats() const
+        -> ZeroCopyStats { return zc_stats_; }
+
+    /**
+     * @brief keep at most @c threshold bytes of pending output in memory, the output buffer and the queued shared
+     * payloads together: what a send would add beyond it goes to an
+     * unlinked temporary file in @c dir, written to the socket by sendfile() as it drains, so a slow peer costs disk
+     * instead of memory. The output sent while the file is not drained is appended to it too, keeping the order
+     * @details the file is closed once drained, the high watermark still counts the spilled bytes
+     * @return false for a unix domain connection, whose passed fds travel with the output buffer
+     * @attention in loop thread, e.g. in the connection callback. A zero threshold disables it for the output sent
+     * afterwards. The file is written synchronously by the loop thread, c_max_spill_write bytes per write(2): @c dir
+     * should be a local file system or a tmpfs, a slow disk stalls every connection of the loop
+     */
+    auto enableOutputSpill(size_t threshold = c_default_spill_threshold, std::string dir = "/tmp")
+        -> bool;
+
+    /**
+     * @attention must be called in loop thread
+     */
+    [[nodiscard]] auto getSpillStats() const
+        -> SpillStats;
+
     // 关闭连接, NOT thread safe, no simultaneous calling
     void shutdown();
     void forceClose();
@@ -175,6 +523,41 @@ public:
 
     void startRead();
     void stopRead();
+
+    /**
+     * @brief limit the reading of this connection, a zero rate lifts the limit
+     * @details the bytes of every read and the messages are taken from token buckets after the message callback, a
+     * connection over budget stops being read, the kernel buffers and then the TCP window hold the peer back, until a
+     * loop timer resumes it once the buckets are out of debt. A flooding peer costs no wakeup in the meantime.
+     * A message is one message callback unless the callback reports its own count by chargeMessages()
+     * @attention in loop thread
+     */
+    void setReadRateLimits(RateLimit bytesPerSecond, RateLimit messagesPerSecond);
+
+    /**
+     * @brief report @c count decoded messages to the messages per second limit, instead of one per message callback
+     * @attention in the message callback
+     */
+    void chargeMessages(size_t count);
+
+    /**
+     * @attention in loop thread
+     */
+    [[nodiscard]] auto getThrottleStats() const
+        -> ThrottleStats
+    {
+        return ThrottleStats {.throttles = throttles_, .throttled_seconds = static_cast<double>(throttled_us_) / 1e6, .throttled = throttled_};
+    }
+    /**
+     * @brief keep the connection on its loop, for state kept per loop, e.g. PubSubHub subscriptions:
+     * TcpServer::migrateConnection() refuses it and the rebalancer skips it until as many unpinLoop()
+     * @attention in loop thread
+     */
+    void pinLoop();
+    void unpinLoop();
+    [[nodiscard]] auto isLoopPinned() const
+        -> bool { return loop_pins_ != 0; }
+
     auto IsReading() const
         -> bool { return reading_; }; // NOT thread safe, may race with start/stopReadInLoop
 
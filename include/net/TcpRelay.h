@@ -0,0 +1,126 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "net/Callbacks.h"
+
+class TcpConnection;
+
+struct TcpRelayOptions
+{
+    // capacity of each direction's pipe, i.e. the bytes in flight between the two sockets
+    size_t pipe_size = 1024 * 1024;
+};
+
+/**
+ * @brief link two connections of one loop and forward the bytes of each to the other by splice(2), the payload never
+ * enters user space
+ * @details
+ * 1. every direction has its own pipe: the bytes are spliced from the source socket into the pipe, then from the
+ *    pipe into the destination socket. The relay takes over the socket events of both connections, their message
+ *    callbacks are not called anymore
+ * 2. backpressure: a direction reads its source only when its pipe is empty, when the destination doesn't take all
+ *    of the pipe the source stops being read until the destination is writable and the pipe drained
+ * 3. half-close: the EOF of a source is forwarded by shutting down the writing side of the destination once the pipe
+ *    is drained, the other direction keeps flowing. The connections are closed when both directions ended, or at
+ *    once when one of them is reset or closed
+ * 4. the bytes already in the input buffer of a connection when the relay starts are forwarded first, through the
+ *    output buffer of the other, as well as what the other had still to send
+ *
+ * @code
+ *  // in the connection callback of the upstream TcpClient, living in the loop of the downstream connection
+ *  auto relay = std::make_shared<TcpRelay>(downstream, upstream);
+ *  if (not relay->start()) { ... fall back to copying, or close }
+ * @endcode
+ * @attention both connections in the same loop, everything in that loop. The relay is kept alive by the connections
+ */
+class TcpRelay : public std::enable_shared_from_this<TcpRelay> {
+public:
+    using Options = TcpRelayOptions;
+
+    // splices per socket event and direction, level triggered epoll calls again for the rest
+    inline static constexpr int c_max_splices_per_event = 16;
+
+    struct Stats
+    {
+        uint64_t a_to_b_bytes;
+        uint64_t b_to_a_bytes;
+        uint64_t splices; // splice(2) calls moving bytes, both ways of both directions
+    };
+
+private:
+    struct Direction
+    {
+        TcpConnection* from;
+        TcpConnection* to;
+        std::array<int, 2> pipe {-1, -1}; // [0] read end, [1] write end
+        size_t in_pipe = 0;
+        bool eof       = false; // the source sent FIN
+        bool done      = false; // and the FIN was forwarded
+        uint64_t bytes = 0;
+    };
+
+    const Options options_;
+    std::weak_ptr<TcpConnection> a_;
+    std::weak_ptr<TcpConnection> b_;
+    std::array<Direction, 2> directions_; // [0] a to b, [1] b to a
+    uint64_t splices_;
+    bool started_;
+    bool finished_;
+    std::function<void()> finish_callback_;
+
+    /**
+     * @brief move bytes of @c dir until the source has nothing or the destination takes nothing
+     */
+    void pump_(Direction& dir);
+    /**
+     * @return false if the destination can't take more now
+     */
+    auto drainPipe_(Direction& dir)
+        -> bool;
+    void onReadable_(Direction& dir);
+    void onWritable_(Direction& dir);
+    void onClose_(TcpConnection* conn);
+    void setInterest_(Direction& dir, bool reading, bool writing);
+    /**
+     * @brief stop forwarding and close both connections
+     */
+    void finish_();
+
+public:
+    TcpRelay(const TcpConnectionPtr& a, const TcpConnectionPtr& b, Options options = {});
+    ~TcpRelay();
+
+    TcpRelay(const TcpRelay&)                    = delete;
+    auto operator=(const TcpRelay&) -> TcpRelay& = delete;
+    TcpRelay(TcpRelay&&)                         = delete;
+    auto operator=(TcpRelay&&) -> TcpRelay&      = delete;
+
+    /**
+     * @brief take over the connections and start forwarding
+     * @return false if the pipes couldn't be created, e.g. out of fds, or if a connection isn't connected or still has
+     * output only its own write path can send: queued shared payloads, a spill file, zerocopy sends not completed or
+     * fds to pass. The connections are left untouched then, start() may be tried again from their write complete
+     * callback. What is in the output buffers is fine, the relay sends it first
+     */
+    auto start()
+        -> bool;
+
+    /**
+     * @brief called once when the relay ends, before the connections are closed
+     */
+    void setFinishCallback(std::function<void()> cb) { finish_callback_ = std::move(cb); }
+
+    [[nodiscard]] auto isFinished() const
+        -> bool { return finished_; }
+
+    [[nodiscard]] auto getStats() const
+        -> Stats
+    {
+        return Stats {.a_to_b_bytes = directions_[0].bytes, .b_to_a_bytes = directions_[1].bytes, .splices = splices_};
+    }
+};
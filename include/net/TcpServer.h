@@ -9,12 +9,15 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "common/metrics.h"
 #include "EventLoop.h"
 #include "Acceptor.h"
 #include "Callbacks.h"
 #include "EventLoopThreadpool.h"
 #include "InetAddress.h"
+#include "RateLimit.h"
 #include "TcpConnection.h"
 
 /**
@@ -32,6 +35,40 @@ public:
         kReusePort,
     };
 
+    struct RateLimitStats
+    {
+        uint64_t accept_throttles;       // accepting paused for being over the accept rate
+        double accept_throttled_seconds; // of finished pauses
+        uint64_t read_throttles;         // connections paused reading, by their own limits or the inbound bandwidth
+        double read_throttled_seconds;   // of finished pauses, summed over the connections
+    };
+
+    struct AdmissionStats
+    {
+        uint64_t rejected_max_connections; // closed right after accept, the server was full
+        uint64_t shed_overloaded;          // closed right after accept, the loop it would go to was lagging
+        uint64_t fd_pressure_pauses;       // accepting paused for running short of file descriptors
+        uint64_t fd_exhausted;             // dropped by the acceptor, accept failed with EMFILE or ENFILE
+        double loop_lag_seconds;           // the worst task lag of the io loops
+    };
+
+    struct ConnectionStats
+    {
+        std::string name;
+        InetAddress peer;
+        TcpConnection::TrafficStats traffic;
+        TcpConnection::TcpInfoSample tcp_info; // see setTcpInfoSampling()
+    };
+    using ConnectionStatsCallback = std::function<void(std::vector<ConnectionStats>)>;
+    // whether broadcast() sends to a connection, called in its loop
+    using BroadcastFilter = std::function<bool(const TcpConnectionPtr&)>;
+
+    struct RebalanceStats
+    {
+        uint64_t migrations; // connections moved to another io loop, by hand or by the rebalancer
+        uint64_t refused;    // migrations given up, the connection was not quiescent
+    };
+
 private:
     /**
      * @brief tcpconnection name-> tcpconnection
@@ -58,11 +95,83 @@ private:
 
     int next_conn_id_;
     ConnectionMap connections_; // 保存所有的连接
+
+    bool draining_;                        // in base loop, no more accepting, waiting for the connections to close
+    std::function<void()> drained_callback_;
+
+    RateLimit conn_bytes_limit_;
+    RateLimit conn_messages_limit_;
+    std::unique_ptr<TokenBucket> accept_bucket_;
+    std::shared_ptr<TokenBucket> inbound_bucket_;
+    std::shared_ptr<ThrottleCounters> throttle_counters_;
+    Timestamp accept_throttled_since_;
+    std::atomic<uint64_t> accept_throttles_;
+    std::atomic<uint64_t> accept_throttled_us_;
+
+    // why accepting is paused, in base loop: it resumes once every reason is gone
+    static constexpr uint8_t c_paused_by_rate = 1;
+    static constexpr uint8_t c_paused_by_fds  = 2;
+    uint8_t accept_paused_;
+
+    size_t max_connections_;    // 0 for no limit
+    double fd_pressure_ratio_;  // of RLIMIT_NOFILE, 0 to pause only once accept fails
+    int fd_pressure_fd_;        // accepted fds from that one on mean pressure, from fd_pressure_ratio_ at start()
+    double lag_threshold_;      // seconds, 0 for no shedding
+    double lag_probe_interval_;
+    Timer::Id lag_probe_timer_id_;
+    std::atomic<uint64_t> rejected_max_connections_;
+    std::atomic<uint64_t> shed_overloaded_;
+    std::atomic<uint64_t> fd_pressure_pauses_;
+    std::atomic<uint64_t> fd_exhausted_;
+
+    double tcp_info_interval_; // seconds, 0 for no sampling
+    Timer::Id tcp_info_timer_id_;
+
+    struct MigrationCounters
+    {
+        std::atomic<uint64_t> migrations {0};
+        std::atomic<uint64_t> refused {0};
+    };
+    std::shared_ptr<MigrationCounters> migration_counters_; // shared with the migrations in flight
+
+    // in base loop
+    struct LoadSample
+    {
+        double seconds; // busy or in the message callback, since the start
+        Timestamp when;
+    };
+    double rebalance_interval_; // seconds, 0 for no rebalancing
+    double rebalance_imbalance_;
+    Timer::Id rebalance_timer_id_;
+    std::unordered_map<EventLoop*, LoadSample> loop_busy_samples_;
+    std::unordered_map<std::string, LoadSample> conn_callback_samples_; // of the connections seen in the busiest loop
+
+    /**
+     * @brief the registry's metrics of the servers named like this one
+     */
+    struct Metrics
+    {
+        Cot::Counter& accepted;
+        Cot::Counter& closed;
+        Cot::Gauge& connections;
+        Cot::Counter& rejected_max_connections;
+        Cot::Counter& shed_overloaded;
+        Cot::Counter& fd_exhausted;
+        Cot::Counter& migrated;
+    };
+    const Metrics metrics_;
+    Cot::MetricsRegistry::CallbackHandle loop_lag_gauge_; // from start(), reads the io loops: removed first
 public:
     TcpServer(EventLoop* loop,
               const InetAddress& listenAddr,
               std::string nameArg,
               Option option = kNoReusePort);
+    /**
+     * @brief serve on an already bound listening socket, e.g. one inherited by HotRestart, the server owns it then
+     */
+    TcpServer(EventLoop* loop,
+              int listenFd,
+              std::string nameArg);
     ~TcpServer();
 
     TcpServer(const TcpServer&)                    = delete;
@@ -111,7 +220,7 @@ public:
      - 1 means all I/O in another thread.
      - N means a thread pool with N threads, new connections
        are assigned on a round-robin basis.
-     * @todo: limit the connection number
+     * @see setMaxConnections() to limit the connection number
      */
     void setThreadNum(int numThreads);
 
@@ -121,7 +230,181 @@ public:
      */
     void start();
 
+    /**
+     * @brief read rate limits of every new connection, see TcpConnection::setReadRateLimits()
+     * @attention before start()
+     */
+    void setConnectionRateLimits(RateLimit bytesPerSecond, RateLimit messagesPerSecond);
+
+    /**
+     * @brief accept at most that many connections per second, the others wait in the listen backlog meanwhile
+     * @attention before start()
+     */
+    void setAcceptRateLimit(RateLimit connectionsPerSecond);
+
+    /**
+     * @brief limit the bytes read per second over all the connections together, those reading when the budget runs
+     * out pause like over their own limit
+     * @attention before start()
+     */
+    void setInboundBandwidthLimit(RateLimit bytesPerSecond);
+
+    /**
+     * @thread safe
+     */
+    [[nodiscard]] auto getRateLimitStats() const
+        -> RateLimitStats;
+
+    /**
+     * @brief close the connections accepted while @c maxConnections are open, 0 for no limit
+     * @attention before start()
+     */
+    void setMaxConnections(size_t maxConnections);
+
+    /**
+     * @brief pause accepting once the accepted fds reach @c ratio of RLIMIT_NOFILE, until a connection closes or a
+     * short while passes; without it accepting only pauses after accept failed with EMFILE or ENFILE
+     * @details the kernel hands out the lowest free fd, an accepted fd n means n fds are open already
+     * @attention before start()
+     */
+    void setFdPressureThreshold(double ratio);
+
+    /**
+     * @brief shed load: close the connections accepted for an io loop whose task lag, see EventLoop::getTaskLagSeconds(),
+     * is over @c lagThresholdSeconds, 0 to accept whatever the lag
+     * @param probeIntervalSeconds how often a no-op task is queued to every io loop to keep their lag current
+     * @attention before start()
+     */
+    void setOverloadShedding(double lagThresholdSeconds, double probeIntervalSeconds = 0.05);
+
+    /**
+     * @thread safe after start()
+     */
+    [[nodiscard]] auto getAdmissionStats() const
+        -> AdmissionStats;
+
+    /**
+     * @brief read TCP_INFO of every connection each @c intervalSeconds, see TcpConnection::sampleTcpInfo(), 0 to never
+     * @details one task per io loop samples the connections of that loop
+     * @attention before start()
+     */
+    void setTcpInfoSampling(double intervalSeconds);
+
+    /**
+     * @brief snapshot the stats of every connection, e.g. to find the busiest or the slowest peers
+     * @details each io loop copies the stats of its own connections in a task of its own, @c statsCb gets them all
+     * once every loop has answered, the connections closed meanwhile left out
+     * @param statsCb called in base loop
+     * @thread safe
+     */
+    void collectConnectionStats(ConnectionStatsCallback statsCb);
+
+    /**
+     * @brief send @c payload to every connection @c filter accepts, all of them if there is no filter
+     * @details one task per io loop sends it to the connections of that loop by TcpConnection::sendShared(): they all
+     * queue the same payload, which is freed once the last of them has written it
+     * @param onWritten called in the loop of each connection, once that connection has written the whole payload
+     * @thread safe
+     */
+    void broadcast(SharedPayload payload, BroadcastFilter filter = {}, WriteCompleteCallback onWritten = {});
+
+    /**
+     * @brief move @c conn to the io loop @c target, see setRebalancing() to do it by the load of the loops
+     * @details done in the loop owning the connection, only while it is quiescent: connected, not pinned by
+     * TcpConnection::pinLoop(), reading not paused by the limits, nothing left to write nor zero-copy sends in flight. Its channel is unregistered from that loop and
+     * registered with @c target, what arrives meanwhile is read there. The tasks queued to the former loop for the
+     * connection follow it to the new one
+     * @param target one of the io loops of the server
+     * @param migratedCb called in the new loop once it owns the connection, or in the former one with @c migrated
+     * false if it was not quiescent
+     * @thread safe
+     */
+    void migrateConnection(const TcpConnectionPtr& conn, EventLoop* target, TcpConnection::MigratedCallback migratedCb = {});
+
+    /**
+     * @brief the loops serving the connections, the base loop if there is no io thread
+     * @attention after start()
+     */
+    [[nodiscard]] auto getIoLoops() const
+        -> std::vector<EventLoop*> { return threadpool_->getAllLoops(); }
+
+    /**
+     * @brief e.g. to run the work on some key in the loop owning it, see EventLoopThreadPool::runOnLoopFor()
+     */
+    [[nodiscard]] auto getThreadPool() const
+        -> const std::shared_ptr<EventLoopThreadPool>& { return threadpool_; }
+
+    /**
+     * @brief every @c intervalSeconds, move a connection from the busiest io loop to the idlest one when their busy
+     * ratios, see EventLoop::getBusySeconds(), differ by more than @c imbalance
+     * @details the moved one is the connection of the busiest loop that spent the most time in the message callback
+     * over the last interval, yet less than the gap, so that moving it narrows the gap instead of swapping the loops.
+     * A connection is moved once it was seen in two rounds, one at most per round
+     * @attention before start()
+     */
+    void setRebalancing(double intervalSeconds, double imbalance = 0.2);
+
+    /**
+     * @thread safe
+     */
+    [[nodiscard]] auto getRebalanceStats() const
+        -> RebalanceStats;
+
+    [[nodiscard]] auto getName() const
+        -> const std::string& { return name_; }
+
+    [[nodiscard]] auto getListenFd() const
+        -> int { return acceptor_->getListenFd(); }
+
+    /**
+     * @brief stop accepting and wait for the existing connections to close by themselves,
+     * those still open after @c timeoutSeconds are closed forcibly
+     * @param drainedCb called in base loop once no connection is left
+     * @thread safe
+     */
+    void drain(double timeoutSeconds, std::function<void()> drainedCb);
+
+    /**
+     * @attention must be called in base loop
+     */
+    [[nodiscard]] auto getConnectionCount() const
+        -> size_t { return connections_.size(); }
+
 private:
+    void drainInOwnerThread_(double timeoutSeconds, std::function<void()> drainedCb);
+    void notifyDrainedIfDone_();
+    /**
+     * @brief take the accepted connection from the accept bucket, stop accepting while it is in debt
+     */
+    void chargeAccept_();
+    void pauseAccepting_(uint8_t reason);
+    void resumeAccepting_(uint8_t reason);
+    /**
+     * @brief pause for a while once fds run short, resumed earlier when a connection closes
+     */
+    void pauseForFdPressure_();
+    /**
+     * @brief whether to close the accepted connection instead of serving it, counted if so
+     */
+    [[nodiscard]] auto shouldReject_(const EventLoop* ioLoop)
+        -> bool;
+
+    /**
+     * @brief the connections grouped by the loop they belong to, @attention in base loop
+     */
+    [[nodiscard]] auto groupConnectionsByLoop_() const
+        -> std::unordered_map<EventLoop*, std::vector<TcpConnectionPtr>>;
+    void sampleTcpInfo_();
+    void rebalance_();
+    /**
+     * @param loads the connections of the busiest loop with their message callback seconds so far
+     */
+    void migrateHeaviest_(std::vector<std::pair<TcpConnectionPtr, double>> loads, EventLoop* idlest, double gap);
+    static auto makeMetrics_(const std::string& name)
+        -> Metrics;
+    void collectConnectionStatsInOwnerThread_(ConnectionStatsCallback statsCb);
+    void broadcastInOwnerThread_(SharedPayload payload, BroadcastFilter filter, WriteCompleteCallback onWritten);
+
     /**
      * @brief
      * @details Not thread safe, but in loop
@@ -51,11 +51,26 @@ private:
     ActiveTimerMap active_timers_;            // 存储所有活跃的 Timer，用于高效取消
     std::atomic<bool> calling_expired_timers_; /* atomic */
     std::set<Timer::Id> canceling_timers_;         // 存储在调用已到期定时器回调期间，请求取消的定时器
+
+    // the loop wakes up by its poll timeout instead of the timerfd, see setPollTimeoutDriven()
+    bool poll_timeout_driven_;
+    int64_t slack_us_;
     void addTimerInOwnerLoop_(std::unique_ptr<Timer, TimerDeleter> timer);
     void cancelInOwnerLoop_(Timer::Id timerId);
 
     // called when timerfd alarms
     void timerChannelReadCB_();
+    /**
+     * @brief when the loop should wake up for the earliest timer: its expiration delayed by the slack, so that the
+     * timers expiring within the slack after it run in the same wakeup
+     */
+    [[nodiscard]] auto getWakeupTime_() const
+        -> Timestamp;
+    /**
+     * @brief arm the timerfd for the earliest timer by a fresh read of the clock, nothing to do when the poll timeout
+     * wakes the loop
+     */
+    void arm_();
     // move out all expired timers
     auto getExpired_(Timestamp now) -> std::vector<Entry>;
     void reset_(std::vector<Entry>& expired, Timestamp now);
@@ -85,4 +100,34 @@ public:
         -> Timer::Id;
 
     void cancel(Timer::Id timerId);
+
+    /**
+     * @brief drive the timers by the poll timeout of the loop instead of the timerfd, which saves the timerfd_settime()
+     * for every new earliest timer and the read() for every expiry
+     * @details the loop gets its poll timeout from getPollTimeoutMs() and calls runExpired() after the active channels,
+     * the timers then fire at a resolution of 1ms, which the epoll_wait() timeout has
+     * @attention in the owner thread
+     */
+    void setPollTimeoutDriven(bool on);
+    [[nodiscard]] auto isPollTimeoutDriven() const
+        -> bool { return poll_timeout_driven_; }
+
+    /**
+     * @brief let the timers fire up to @c seconds late, so that those expiring close to each other share a wakeup
+     * @attention in the owner thread
+     */
+    void setSlack(double seconds);
+
+    /**
+     * @brief the poll timeout up to the wakeup for the earliest timer, in ms rounded up, at most @c maxMs
+     * @attention from the loop time, the loop refreshes it right before asking
+     */
+    [[nodiscard]] auto getPollTimeoutMs(int maxMs) const
+        -> int;
+
+    /**
+     * @brief run the expired timers and re-arm the repeating ones
+     * @attention in the owner thread
+     */
+    void runExpired();
 };
\ No newline at end of file
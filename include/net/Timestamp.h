@@ -16,6 +16,12 @@ public:
     static auto now()
         -> Timestamp;
 
+    /**
+     * @brief now() from CLOCK_REALTIME_COARSE: cheaper, but as old as the last scheduler tick (1-4ms)
+     */
+    static auto nowCoarse()
+        -> Timestamp;
+
     /**
      * @brief format the micro_seconds_since_epoch_ to string like "seconds.microseconds"
      */
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net/EventLoopThreadpool.h"
+#include "net/InetAddress.h"
+#include "net/UdpSocket.h"
+
+class EventLoop;
+
+/**
+ * @brief serves one UDP address from every loop of its thread pool
+ * @details each loop owns a UdpSocket bound to the same address with SO_REUSEPORT, the kernel hashes the peers
+ * across the sockets so that a peer is always served by the same loop. With 0 threads the base loop serves alone.
+ * @attention UdpServer 和 其 baseloop 必须在同一个线程中
+ */
+class UdpServer {
+private:
+    EventLoop* const base_loop_;
+    const InetAddress listen_addr_;
+    const std::string name_;
+    std::shared_ptr<EventLoopThreadPool> threadpool_;
+    std::vector<UdpSocketPtr> sockets_; // one per loop
+    DatagramCallback msg_callback_;
+    size_t batch_size_;
+    size_t slot_size_;
+    std::atomic_int started_;
+
+public:
+    UdpServer(EventLoop* loop,
+              const InetAddress& listenAddr,
+              std::string nameArg);
+    ~UdpServer();
+
+    UdpServer(const UdpServer&)                    = delete;
+    auto operator=(const UdpServer&) -> UdpServer& = delete;
+    UdpServer(UdpServer&&)                         = delete;
+    auto operator=(UdpServer&&) -> UdpServer&      = delete;
+
+    /**
+     * @brief user-level callback for every batch of datagrams, runs in the loop of the receiving socket
+     * @not thread safe
+     */
+    void setMessageCallback(const DatagramCallback& cb) { msg_callback_ = cb; }
+
+    /**
+     * @brief datagrams per recvmmsg and the max datagram size, larger ones are truncated
+     * @attention must be called before start()
+     */
+    void setBatchSize(size_t batchSize, size_t slotSize = UdpSocket::c_default_slot_size)
+    {
+        batch_size_ = batchSize;
+        slot_size_  = slotSize;
+    }
+
+    /**
+     * @brief number of loop threads, each gets its own socket
+     * @attention must be called before start()
+     */
+    void setThreadNum(int numThreads);
+
+    /**
+     * @brief bind the sockets and start reading. It's harmless to call it multiple times.
+     * @thread safe
+     */
+    void start();
+
+    [[nodiscard]] auto getName() const
+        -> const std::string& { return name_; }
+
+    /**
+     * @brief valid after start()
+     */
+    [[nodiscard]] auto getSockets() const
+        -> const std::vector<UdpSocketPtr>& { return sockets_; }
+
+    /**
+     * @brief sum of the stats of all the sockets
+     * @thread safe after start()
+     */
+    [[nodiscard]] auto getStats() const
+        -> UdpSocket::Stats;
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "net/InetAddress.h"
+#include "net/Socket.h"
+#include "net/Timestamp.h"
+
+class Channel;
+class EventLoop;
+class UdpSocket;
+
+using UdpSocketPtr = std::shared_ptr<UdpSocket>;
+
+/**
+ * @brief one received datagram
+ * @attention the payload points into the socket's preallocated receive slot, only valid inside the callback
+ */
+struct Datagram
+{
+    InetAddress peer;
+    std::string_view payload;
+    bool truncated; // larger than the slot, the tail was dropped by the kernel
+};
+
+/**
+ * @brief called with every batch read by one recvmmsg
+ */
+using DatagramCallback = std::function<void(const UdpSocketPtr&,
+                                            std::span<const Datagram>,
+                                            Timestamp)>;
+
+/**
+ * @brief a bound non-blocking UDP socket driven by one EventLoop
+ * @details
+ * 1. reads with recvmmsg into @c batchSize preallocated slots of @c slotSize bytes, no allocation on the receive path
+ * 2. send() only appends to the pending queue, all the datagrams queued in one loop iteration leave with one sendmmsg
+ *    after the current events are handled. On EAGAIN the queue waits for EPOLLOUT, beyond c_max_pending_datagrams
+ *    new datagrams are dropped, as the kernel would do
+ * 3. with reusePort several sockets can bind the same address, the kernel spreads the peers across them, see UdpServer
+ */
+class UdpSocket : public std::enable_shared_from_this<UdpSocket> {
+public:
+    inline static constexpr size_t c_default_batch_size    = 64;
+    inline static constexpr size_t c_default_slot_size     = 2048;
+    inline static constexpr size_t c_max_pending_datagrams = 64 * 1024;
+    // bound the recvmmsg calls per read event, so that one busy socket can't starve the others in the loop
+    inline static constexpr int c_max_reads_per_event = 16;
+
+    /**
+     * @brief counters, can be read from any thread
+     */
+    struct Stats
+    {
+        uint64_t rx_datagrams;
+        uint64_t rx_bytes;
+        uint64_t rx_truncated;
+        uint64_t rx_syscalls;
+        uint64_t tx_datagrams;
+        uint64_t tx_bytes;
+        uint64_t tx_syscalls;
+        uint64_t tx_dropped;
+    };
+
+private:
+    struct PendingDatagram
+    {
+        InetAddress peer;
+        size_t offset; // in pending_bytes_
+        size_t len;
+    };
+
+    EventLoop* const loop_;
+    Socket socket_;
+    InetAddress local_addr_;
+    std::unique_ptr<Channel> channel_;
+    DatagramCallback message_callback_;
+    std::atomic<bool> started_;
+    bool stopped_; // in loop thread, the channel has been removed
+
+    // 接收: 一次 recvmmsg 的所有 slot, 构造时一次性分配好
+    const size_t batch_size_;
+    const size_t slot_size_;
+    std::vector<char> rx_buffer_;
+    std::vector<sockaddr_storage> rx_addrs_;
+    std::vector<iovec> rx_iovecs_;
+    std::vector<mmsghdr> rx_msgs_;
+    std::vector<Datagram> rx_datagrams_;
+
+    // 发送: 数据依次追加到 pending_bytes_, pending_head_ 之前的已经发出
+    std::string pending_bytes_;
+    std::vector<PendingDatagram> pending_;
+    size_t pending_head_;
+    bool flush_queued_;
+    std::vector<iovec> tx_iovecs_;
+    std::vector<mmsghdr> tx_msgs_;
+
+    std::atomic<uint64_t> rx_datagrams_count_;
+    std::atomic<uint64_t> rx_bytes_count_;
+    std::atomic<uint64_t> rx_truncated_count_;
+    std::atomic<uint64_t> rx_syscalls_count_;
+    std::atomic<uint64_t> tx_datagrams_count_;
+    std::atomic<uint64_t> tx_bytes_count_;
+    std::atomic<uint64_t> tx_syscalls_count_;
+    std::atomic<uint64_t> tx_dropped_count_;
+
+    void startInOwnerThread_();
+    void stopInOwnerThread_();
+    void socketReadableCB_(Timestamp receiveTime);
+    void socketWritableCB_();
+    /**
+     * @brief append to the pending queue and make sure a flush is queued
+     */
+    void sendInOwnerThread_(const InetAddress& peer, std::string_view data);
+    /**
+     * @brief sendmmsg the pending datagrams until the queue is empty or the socket would block
+     */
+    void flushPending_();
+
+public:
+    UdpSocket(EventLoop* loop,
+              const InetAddress& localAddr,
+              bool reusePort   = false,
+              size_t batchSize = c_default_batch_size,
+              size_t slotSize  = c_default_slot_size);
+    /**
+     * @brief must call stop() and let it finish before the destruction if started
+     */
+    ~UdpSocket();
+
+    UdpSocket(const UdpSocket&)                    = delete;
+    auto operator=(const UdpSocket&) -> UdpSocket& = delete;
+    UdpSocket(UdpSocket&&)                         = delete;
+    auto operator=(UdpSocket&&) -> UdpSocket&      = delete;
+
+    /**
+     * @brief not thread safe, must be called before start()
+     */
+    void setMessageCallback(DatagramCallback cb) { message_callback_ = std::move(cb); }
+
+    /**
+     * @brief start reading in the loop thread
+     * @thread safe
+     */
+    void start();
+
+    /**
+     * @brief stop reading and remove the channel in the loop thread, pending datagrams are discarded
+     * @thread safe
+     */
+    void stop();
+
+    /**
+     * @brief queue a datagram to @c peer, it leaves with the other datagrams queued in the same loop iteration
+     * @thread safe, the data is copied
+     */
+    void send(const InetAddress& peer, std::string_view data);
+
+    /**
+     * @brief send the queued datagrams now instead of after the current loop iteration
+     * @attention must be called in loop thread
+     */
+    void flush();
+
+    [[nodiscard]] auto getLoop() const
+        -> EventLoop* { return loop_; }
+
+    [[nodiscard]] auto getFd() const
+        -> int { return socket_.GetFd(); }
+
+    /**
+     * @brief the bound address, with the kernel chosen port if bound to port 0
+     */
+    [[nodiscard]] auto getLocalAddress() const
+        -> const InetAddress& { return local_addr_; }
+
+    [[nodiscard]] auto getStats() const
+        -> Stats;
+};
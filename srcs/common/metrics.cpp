@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cassert>
+#include <format>
+#include <iterator>
+#include <utility>
+
+#include "common/metrics.h"
+
+namespace Cot {
+
+namespace {
+
+/**
+ * @brief @c name{labels} with @c extra appended to the labels, e.g. le="0.5" of a histogram bucket
+ */
+void AppendSeries(std::string& out, std::string_view name, std::string_view suffix, std::string_view labels, std::string_view extra)
+{
+    out.append(name).append(suffix);
+    if (not labels.empty() or not extra.empty())
+    {
+        out.push_back('{');
+        out.append(labels);
+        if (not labels.empty() and not extra.empty())
+        {
+            out.push_back(',');
+        }
+        out.append(extra);
+        out.push_back('}');
+    }
+    out.push_back(' ');
+}
+
+} // namespace
+
+auto Counter::Value() const
+    -> uint64_t
+{
+    auto sum = uint64_t {0};
+    for (const auto& shard : shards_)
+    {
+        sum += shard.value.load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+Histogram::Histogram(std::vector<double> bounds)
+    : bounds_ {std::move(bounds)}
+{
+    assert(std::ranges::is_sorted(bounds_));
+    for (auto& shard : shards_)
+    {
+        shard.counts = std::make_unique<std::atomic<uint64_t>[]>(bounds_.size() + 1);
+    }
+}
+
+void Histogram::Observe(double value)
+{
+    auto& shard = shards_[MetricsDetail::ShardIndex()];
+    auto bucket = static_cast<size_t>(std::ranges::lower_bound(bounds_, value) - bounds_.begin());
+    shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+auto Histogram::TakeSnapshot() const
+    -> Snapshot
+{
+    auto snapshot = Snapshot {.bounds = bounds_, .cumulative_counts = std::vector<uint64_t>(bounds_.size() + 1), .sum = 0};
+    for (const auto& shard : shards_)
+    {
+        for (size_t i = 0; i <= bounds_.size(); ++i)
+        {
+            snapshot.cumulative_counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        snapshot.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 1; i < snapshot.cumulative_counts.size(); ++i)
+    {
+        snapshot.cumulative_counts[i] += snapshot.cumulative_counts[i - 1];
+    }
+    return snapshot;
+}
+
+auto Histogram::LatencyBounds()
+    -> std::vector<double>
+{
+    return {1e-6, 1e-5, 1e-4, 5e-4, 1e-3, 5e-3, 1e-2, 5e-2, 0.1, 0.5, 1, 10};
+}
+
+MetricsRegistry::CallbackHandle::CallbackHandle(MetricsRegistry* registry, std::string name, uint64_t id)
+    : registry_ {registry}
+    , name_ {std::move(name)}
+    , id_ {id}
+{
+}
+
+MetricsRegistry::CallbackHandle::~CallbackHandle()
+{
+    if (registry_ != nullptr)
+    {
+        registry_->RemoveCallbackGauge_(name_, id_);
+    }
+}
+
+MetricsRegistry::CallbackHandle::CallbackHandle(CallbackHandle&& other) noexcept
+    : registry_ {std::exchange(other.registry_, nullptr)}
+    , name_ {std::move(other.name_)}
+    , id_ {other.id_}
+{
+}
+
+auto MetricsRegistry::CallbackHandle::operator=(CallbackHandle&& other) noexcept
+    -> CallbackHandle&
+{
+    if (this != &other)
+    {
+        if (registry_ != nullptr)
+        {
+            registry_->RemoveCallbackGauge_(name_, id_);
+        }
+        registry_ = std::exchange(other.registry_, nullptr);
+        name_     = std::move(other.name_);
+        id_       = other.id_;
+    }
+    return *this;
+}
+
+auto MetricsRegistry::GetInstance()
+    -> MetricsRegistry&
+{
+    // never destructed: static objects of other translation units may still record while the process exits
+    static auto* s_registry = new MetricsRegistry {};
+    return *s_registry;
+}
+
+auto MetricsRegistry::TypeName_(Type type)
+    -> std::string_view
+{
+    switch (type)
+    {
+        case Type::Counter:
+            return "counter";
+        case Type::Gauge:
+            return "gauge";
+        case Type::Histogram:
+            return "histogram";
+    }
+    return "untyped";
+}
+
+auto MetricsRegistry::GetFamily_(std::string_view name, std::string_view help, Type type)
+    -> Family&
+{
+    auto it = families_.find(name);
+    if (it == families_.end())
+    {
+        it = families_.emplace(std::string {name}, Family {.type = type, .help = std::string {help}, .counters = {}, .gauges = {}, .histograms = {}, .callbacks = {}}).first;
+    }
+    assert(it->second.type == type);
+    return it->second;
+}
+
+auto MetricsRegistry::GetCounter(std::string_view name, std::string_view help, std::string_view labels)
+    -> Counter&
+{
+    auto _       = std::lock_guard<std::mutex> {mtx_};
+    auto& family = GetFamily_(name, help, Type::Counter);
+    auto it      = family.counters.find(labels);
+    if (it == family.counters.end())
+    {
+        it = family.counters.emplace(std::string {labels}, std::make_unique<Counter>()).first;
+    }
+    return *it->second;
+}
+
+auto MetricsRegistry::GetGauge(std::string_view name, std::string_view help, std::string_view labels)
+    -> Gauge&
+{
+    auto _       = std::lock_guard<std::mutex> {mtx_};
+    auto& family = GetFamily_(name, help, Type::Gauge);
+    auto it      = family.gauges.find(labels);
+    if (it == family.gauges.end())
+    {
+        it = family.gauges.emplace(std::string {labels}, std::make_unique<Gauge>()).first;
+    }
+    return *it->second;
+}
+
+auto MetricsRegistry::GetHistogram(std::string_view name, std::string_view help, std::vector<double> bounds, std::string_view labels)
+    -> Histogram&
+{
+    auto _       = std::lock_guard<std::mutex> {mtx_};
+    auto& family = GetFamily_(name, help, Type::Histogram);
+    auto it      = family.histograms.find(labels);
+    if (it == family.histograms.end())
+    {
+        it = family.histograms.emplace(std::string {labels}, std::make_unique<Histogram>(std::move(bounds))).first;
+    }
+    return *it->second;
+}
+
+auto MetricsRegistry::AddCallbackGauge(std::string_view name, std::string_view help, std::string_view labels, GaugeFunction fn)
+    -> CallbackHandle
+{
+    auto _       = std::lock_guard<std::mutex> {mtx_};
+    auto& family = GetFamily_(name, help, Type::Gauge);
+    auto id      = next_callback_id_++;
+    family.callbacks.emplace(id, CallbackGauge {.labels = std::string {labels}, .fn = std::move(fn)});
+    return CallbackHandle {this, std::string {name}, id};
+}
+
+void MetricsRegistry::RemoveCallbackGauge_(const std::string& name, uint64_t id)
+{
+    auto _ = std::lock_guard<std::mutex> {mtx_};
+    if (auto it = families_.find(name); it != families_.end())
+    {
+        it->second.callbacks.erase(id);
+    }
+}
+
+auto MetricsRegistry::RenderPrometheus() const
+    -> std::string
+{
+    auto out = std::string {};
+    auto _   = std::lock_guard<std::mutex> {mtx_};
+    for (const auto& [name, family] : families_)
+    {
+        std::format_to(std::back_inserter(out), "# HELP {} {}\n# TYPE {} {}\n", name, family.help, name, TypeName_(family.type));
+        for (const auto& [labels, counter] : family.counters)
+        {
+            AppendSeries(out, name, "", labels, "");
+            std::format_to(std::back_inserter(out), "{}\n", counter->Value());
+        }
+        for (const auto& [labels, gauge] : family.gauges)
+        {
+            AppendSeries(out, name, "", labels, "");
+            std::format_to(std::back_inserter(out), "{}\n", gauge->Value());
+        }
+        for (const auto& [id, callback] : family.callbacks)
+        {
+            AppendSeries(out, name, "", callback.labels, "");
+            std::format_to(std::back_inserter(out), "{}\n", callback.fn());
+        }
+        for (const auto& [labels, histogram] : family.histograms)
+        {
+            auto snapshot = histogram->TakeSnapshot();
+            for (size_t i = 0; i < snapshot.cumulative_counts.size(); ++i)
+            {
+                auto le = i < snapshot.bounds.size() ? std::format("le=\"{}\"", snapshot.bounds[i]) : std::string {"le=\"+Inf\""};
+                AppendSeries(out, name, "_bucket", labels, le);
+                std::format_to(std::back_inserter(out), "{}\n", snapshot.cumulative_counts[i]);
+            }
+            AppendSeries(out, name, "_sum", labels, "");
+            std::format_to(std::back_inserter(out), "{}\n", snapshot.sum);
+            AppendSeries(out, name, "_count", labels, "");
+            std::format_to(std::back_inserter(out), "{}\n", snapshot.cumulative_counts.back());
+        }
+    }
+    return out;
+}
+
+auto MetricsRegistry::Label(std::string_view key, std::string_view value)
+    -> std::string
+{
+    auto label = std::string {key};
+    label.append("=\"");
+    for (auto c : value)
+    {
+        switch (c)
+        {
+            case '\\':
+                label.append("\\\\");
+                break;
+            case '"':
+                label.append("\\\"");
+                break;
+            case '\n':
+                label.append("\\n");
+                break;
+            default:
+                label.push_back(c);
+        }
+    }
+    label.push_back('"');
+    return label;
+}
+
+} // namespace Cot
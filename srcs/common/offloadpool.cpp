@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <utility>
+
+#include "common/offloadpool.h"
+
+namespace Cot {
+
+namespace {
+
+// the pool and the deque of the calling worker thread, to keep what a task submits on that worker
+thread_local const OffloadPool* t_Pool = nullptr;
+thread_local size_t t_WorkerIndex      = 0;
+
+} // namespace
+
+OffloadPool::OffloadPool(std::string name, size_t threadCount, size_t capacity)
+    : name_ {std::move(name)}
+    , capacity_ {capacity}
+    , queued_ {0}
+    , next_worker_ {0}
+    , sleeping_ {0}
+    , stopping_ {false}
+    , submitted_ {MetricsRegistry::GetInstance().GetCounter("offload_tasks_total", "tasks submitted to the offload pool", MetricsRegistry::Label("pool", name_))}
+    , refused_ {MetricsRegistry::GetInstance().GetCounter("offload_refused_total", "tasks refused, the offload pool was full", MetricsRegistry::Label("pool", name_))}
+    , steals_ {MetricsRegistry::GetInstance().GetCounter("offload_steals_total", "tasks a worker took from the deque of another", MetricsRegistry::Label("pool", name_))}
+    , queue_wait_ {MetricsRegistry::GetInstance().GetHistogram("offload_queue_wait_seconds", "wait of the tasks before a worker took them", Histogram::LatencyBounds(), MetricsRegistry::Label("pool", name_))}
+    , run_time_ {MetricsRegistry::GetInstance().GetHistogram("offload_run_seconds", "run time of the offloaded tasks", Histogram::LatencyBounds(), MetricsRegistry::Label("pool", name_))}
+{
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    depth_gauge_ = MetricsRegistry::GetInstance().AddCallbackGauge("offload_queue_depth", "tasks waiting for a worker", MetricsRegistry::Label("pool", name_),
+                                                                   [this] { return static_cast<double>(GetQueueDepth()); });
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        threads_.emplace_back([this, i] { WorkerMain_(i); });
+    }
+}
+
+OffloadPool::~OffloadPool()
+{
+    {
+        auto _    = std::lock_guard<std::mutex> {sleep_mtx_};
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    threads_.clear();
+}
+
+auto OffloadPool::GetDefault()
+    -> const std::shared_ptr<OffloadPool>&
+{
+    static const auto s_pool = std::make_shared<OffloadPool>("default", std::max(std::thread::hardware_concurrency(), 2U) - 1);
+    return s_pool;
+}
+
+auto OffloadPool::TrySubmit(Task& task)
+    -> bool
+{
+    if (queued_.fetch_add(1) >= capacity_)
+    {
+        queued_.fetch_sub(1);
+        refused_.Inc();
+        return false;
+    }
+    auto index = t_Pool == this ? t_WorkerIndex : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    {
+        auto& worker = *workers_[index];
+        auto _       = std::lock_guard<std::mutex> {worker.mtx};
+        worker.entries.push_back(Entry {.task = std::move(task), .queued = Clock::now()});
+    }
+    submitted_.Inc();
+    // pairs with the increment of a worker going to sleep: either it sees the task counted or it is seen sleeping
+    if (sleeping_.load() > 0)
+    {
+        {
+            auto _ = std::lock_guard<std::mutex> {sleep_mtx_};
+        }
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void OffloadPool::WorkerMain_(size_t index)
+{
+    t_Pool        = this;
+    t_WorkerIndex = index;
+    auto entry    = Entry {};
+    while (true)
+    {
+        if (TakeOwn_(index, entry) or Steal_(index, entry))
+        {
+            Run_(entry);
+            continue;
+        }
+        auto lock = std::unique_lock<std::mutex> {sleep_mtx_};
+        sleeping_.fetch_add(1);
+        wake_.wait(lock, [this] { return stopping_ or queued_.load() > 0; });
+        sleeping_.fetch_sub(1);
+        if (stopping_ and queued_.load() == 0)
+        {
+            return;
+        }
+    }
+}
+
+auto OffloadPool::TakeOwn_(size_t index, Entry& entry)
+    -> bool
+{
+    auto& worker = *workers_[index];
+    auto _       = std::lock_guard<std::mutex> {worker.mtx};
+    if (worker.entries.empty())
+    {
+        return false;
+    }
+    entry = std::move(worker.entries.front());
+    worker.entries.pop_front();
+    queued_.fetch_sub(1);
+    return true;
+}
+
+auto OffloadPool::Steal_(size_t index, Entry& entry)
+    -> bool
+{
+    for (size_t i = 1; i < workers_.size(); ++i)
+    {
+        auto& victim = *workers_[(index + i) % workers_.size()];
+        auto _       = std::lock_guard<std::mutex> {victim.mtx};
+        if (not victim.entries.empty())
+        {
+            entry = std::move(victim.entries.back());
+            victim.entries.pop_back();
+            queued_.fetch_sub(1);
+            steals_.Inc();
+            return true;
+        }
+    }
+    return false;
+}
+
+void OffloadPool::Run_(Entry& entry)
+{
+    auto start = Clock::now();
+    queue_wait_.Observe(std::chrono::duration<double>(start - entry.queued).count());
+    entry.task();
+    entry.task = nullptr;
+    run_time_.Observe(std::chrono::duration<double>(Clock::now() - start).count());
+}
+
+} // namespace Cot
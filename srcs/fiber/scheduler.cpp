@@ -48,6 +48,12 @@ Scheduler::Scheduler(std::uint32_t max_worker_thread_num,
     , name_ {std::move(name)}
     , root_thread_id_ {CurThr::GetId()}
     , use_root_thread_ {use_root_thread}
+    , scheduled_metric_ {MetricsRegistry::GetInstance().GetCounter("fiber_tasks_scheduled_total", "fibers and callbacks scheduled", MetricsRegistry::Label("scheduler", name_))}
+    , run_metric_ {MetricsRegistry::GetInstance().GetCounter("fiber_tasks_run_total", "fibers and callbacks taken by a scheduler thread", MetricsRegistry::Label("scheduler", name_))}
+    , active_threads_gauge_ {MetricsRegistry::GetInstance().AddCallbackGauge("fiber_active_threads", "scheduler threads running a task", MetricsRegistry::Label("scheduler", name_),
+                                                                             [this] { return static_cast<double>(active_thread_count_.load()); })}
+    , idle_threads_gauge_ {MetricsRegistry::GetInstance().AddCallbackGauge("fiber_idle_threads", "scheduler threads waiting for a task", MetricsRegistry::Label("scheduler", name_),
+                                                                           [this] { return static_cast<double>(idle_thread_count_.load()); })}
 {
 #ifndef NO_DEBUG
     LOG_DEBUG(s_Logger) << "Schduler:Schduler()";
@@ -199,6 +205,7 @@ auto Scheduler::Run()
                 task = *it;
                 tasks_.erase(it++);     // 出队
                 ++active_thread_count_; // 当前线程变为活跃
+                run_metric_.Inc();
                 break;
             }
             // 当前线程拿完一个任务后，发现任务队列还有剩余，那么tickle一下其他线程
@@ -20,8 +20,19 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     , listenning_ {false}
     , idle_fd_ {::open("/dev/null", O_RDONLY | O_CLOEXEC)} // 打开一个文件描述符，防止文件描述符耗尽
 {
-    accept_socket_.setReuseAddr(true);
-    accept_socket_.setReusePort(reuseport);
+    if (listenAddr.isUnix())
+    {
+        // a stale socket file left by the last run makes bind fail with EADDRINUSE, abstract names have no file
+        if (auto path = listenAddr.getUnixPath(); not path.empty() and path.front() != '@')
+        {
+            ::unlink(path.c_str());
+        }
+    }
+    else
+    {
+        accept_socket_.setReuseAddr(true);
+        accept_socket_.setReusePort(reuseport);
+    }
     accept_socket_.bindAddress(listenAddr);
     // TcpServer::start() => Acceptor.listen() 如果有新用户连接 要执行一个回调(accept => connfd => 打包成Channel => 唤醒subloop)
     // baseloop监听到有事件发生 => accept_channel_(listenfd) => 执行该回调函数
@@ -31,6 +42,21 @@ Acceptor::Acceptor(EventLoop* loop, const InetAddress& listenAddr, bool reusepor
     });
 }
 
+Acceptor::Acceptor(EventLoop* loop, int listenFd)
+    : owner_loop_ {loop}
+    , accept_socket_ {listenFd}
+    , listen_channel_ {loop, listenFd}
+    , listenning_ {false}
+    , idle_fd_ {::open("/dev/null", O_RDONLY | O_CLOEXEC)}
+{
+    // the previous owner may have used a blocking socket
+    ::fcntl(listenFd, F_SETFL, ::fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+    ::fcntl(listenFd, F_SETFD, FD_CLOEXEC);
+    listen_channel_.setReadCallback([acceptor = this](Timestamp) {
+        acceptor->socketChannelReadCB_();
+    });
+}
+
 Acceptor::~Acceptor()
 {
 
@@ -54,6 +80,26 @@ void Acceptor::listenInOwnerThread()
     listen_channel_.enableReading();
 }
 
+void Acceptor::stopListeningInOwnerThread()
+{
+    owner_loop_->assertInOwnerThread();
+    if (listenning_)
+    {
+        listenning_ = false;
+        listen_channel_.diableReading();
+    }
+}
+
+void Acceptor::resumeListeningInOwnerThread()
+{
+    owner_loop_->assertInOwnerThread();
+    if (not listenning_)
+    {
+        listenning_ = true;
+        listen_channel_.enableReading();
+    }
+}
+
 // listenfd有事件发生了，就是有新用户连接了
 void Acceptor::socketChannelReadCB_()
 {
@@ -75,7 +121,7 @@ void Acceptor::socketChannelReadCB_()
     };
     auto error_do = [this](const std::error_code& ec)
         -> std::expected<void, std::error_code> {
-        if (ec == std::errc::too_many_files_open) // 使用 std::errc 枚举更类型安全
+        if (ec == std::errc::too_many_files_open or ec == std::errc::too_many_files_open_in_system) // 使用 std::errc 枚举更类型安全
         {
             // todo:log
             //  执行与原来完全相同的 EMFILE 错误恢复逻辑
@@ -83,6 +129,10 @@ void Acceptor::socketChannelReadCB_()
             idle_fd_ = ::accept4(accept_socket_.GetFd(), nullptr, nullptr, SOCK_CLOEXEC);
             ::close(idle_fd_);
             idle_fd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+            if (fd_exhausted_callback_)
+            {
+                fd_exhausted_callback_();
+            }
         }
         // 对于其他错误，我们什么也不做，和原逻辑一致
 
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
 #include <unistd.h>
 #include <array>
@@ -182,6 +183,99 @@ auto Buffer::writeFd(int fd, int* saveErrno)
     return n;
 }
 
+namespace {
+
+// 一次 sendmsg/recvmsg 最多传递的 fd 个数, 内核上限 SCM_MAX_FD 为 253
+constexpr size_t c_max_fds_per_msg = 64;
+
+} // namespace
+
+auto Buffer::readFdWithRights(int fd, int* saveErrno, std::vector<int>* fds)
+    -> ssize_t
+{
+    auto extrabuf = std::array<char, 65536> {};
+    struct iovec vec[2];
+    const auto writable = getWritableBytesCount();
+    vec[0].iov_base     = begin_() + writer_idx_;
+    vec[0].iov_len      = writable;
+    vec[1].iov_base     = extrabuf.data();
+    vec[1].iov_len      = sizeof(extrabuf);
+
+    alignas(cmsghdr) auto control = std::array<char, CMSG_SPACE(sizeof(int) * c_max_fds_per_msg)> {};
+    auto msg                      = msghdr {};
+    msg.msg_iov                   = vec;
+    msg.msg_iovlen                = (writable < sizeof(extrabuf)) ? 2 : 1;
+    msg.msg_control               = control.data();
+    msg.msg_controllen            = control.size();
+
+    const auto n = ::recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+    for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET and cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto passed_fd = 0;
+                ::memcpy(&passed_fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+                fds->push_back(passed_fd);
+            }
+        }
+    }
+    // MSG_CTRUNC: the fds beyond control are closed by the kernel, nothing to clean up
+
+    if (static_cast<size_t>(n) <= writable)
+    {
+        hasWritten_(n);
+    }
+    else
+    {
+        hasWritten_(writable);
+        append(extrabuf.data(), n - writable);
+    }
+    return n;
+}
+
+auto Buffer::writeFdWithRights(int fd, size_t maxBytes, std::span<const int> fds, int* saveErrno)
+    -> ssize_t
+{
+    assert(fds.size() <= c_max_fds_per_msg);
+    auto vec     = iovec {};
+    vec.iov_base = getReadPos_();
+    vec.iov_len  = std::min(maxBytes, getReadableBytesCount());
+
+    alignas(cmsghdr) auto control = std::array<char, CMSG_SPACE(sizeof(int) * c_max_fds_per_msg)> {};
+    auto msg                      = msghdr {};
+    msg.msg_iov                   = &vec;
+    msg.msg_iovlen                = 1;
+    if (not fds.empty())
+    {
+        msg.msg_control    = control.data();
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        auto* cmsg         = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level   = SOL_SOCKET;
+        cmsg->cmsg_type    = SCM_RIGHTS;
+        cmsg->cmsg_len     = CMSG_LEN(sizeof(int) * fds.size());
+        ::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    auto n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else if (n > 0)
+    {
+        retrieveN_(n);
+    }
+    return n;
+}
+
 void Buffer::makeSpace_(size_t len)
 {
     /**
@@ -14,6 +14,8 @@ Channel::Channel(EventLoop* loop, int fd)
     , received_events_ {EventEnum::NoneEvent}
     , state_ {State::New}
     , tied_ {false}
+    , event_handler_ {nullptr}
+    , handler_owner_ {nullptr}
 {
 }
 
@@ -45,6 +47,11 @@ void Channel::remove()
 
 void Channel::handleEvent(Timestamp receiveTime)
 {
+    if (event_handler_ != nullptr)
+    {
+        event_handler_(handler_owner_, received_events_, receiveTime);
+        return;
+    }
     // 如果 Channel 与某个对象（通常是 TcpConnection）绑定了生命周期
     if (tied_)
     {
@@ -72,7 +79,7 @@ void Channel::HandleEventWithGuard_(Timestamp receiveTime)
     // POLLHUP 表示 对端完全关闭了连接, 如果同时有 POLLIN，说明还有数据没读完，本端先就不急着处理关闭。
     // 优先读数据（因为有 POLLIN），等读完再交给上层决定是否关闭。
     // 当TcpConnection对应Channel 通过shutdown 关闭写端 epoll触发EPOLLHUP
-    if ((received_events_ & EPOLLHUP) != NoneEvent and !((received_events_ & EPOLLIN) != NoneEvent))
+    if (isCloseEvent(received_events_))
     {
         if (close_callback_)
         {
@@ -95,7 +102,7 @@ void Channel::HandleEventWithGuard_(Timestamp receiveTime)
 
     // 错误事件
     // POLLERR 表示发生了错误（如peer send rst连接重置、local写失败等）
-    if ((received_events_ & EPOLLERR) != NoneEvent)
+    if (isErrorEvent(received_events_))
     {
         if (error_callback_)
         {
@@ -106,7 +113,7 @@ void Channel::HandleEventWithGuard_(Timestamp receiveTime)
     // POLLIN：普通可读事件（socket buffer 里有数据）。
     // POLLPRI：紧急数据可读（如 TCP OOB 数据）。
     // POLLRDHUP：对端关闭了写端（半关闭，常用于检测 TCP 连接断开）。
-    if ((received_events_ & (EPOLLIN | EPOLLPRI | EPOLLRDHUP)) != NoneEvent)
+    if (isReadEvent(received_events_))
     {
         if (read_callback_)
         {
@@ -114,7 +121,7 @@ void Channel::HandleEventWithGuard_(Timestamp receiveTime)
         }
     }
     // 写
-    if ((received_events_ & EPOLLOUT) != NoneEvent)
+    if (isWriteEvent(received_events_))
     {
         if (write_callback_)
         {
@@ -0,0 +1,341 @@
+#include <algorithm>
+#include <format>
+#include <utility>
+
+#include "net/ConnectionPool.h"
+#include "net/EventLoop.h"
+#include "net/TcpConnection.h"
+#include "net/Timestamp.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+/**
+ * @brief xorshift64, p2c only needs a cheap and thread local random source
+ */
+auto nextRandom()
+    -> uint64_t
+{
+    thread_local auto t_state = static_cast<uint64_t>(Timestamp::now().microSecondsSinceEpoch()) | 1;
+    t_state ^= t_state << 13;
+    t_state ^= t_state >> 7;
+    t_state ^= t_state << 17;
+    return t_state;
+}
+
+} // namespace
+
+/* ======================== Lease ======================== */
+
+ConnectionPool::Lease::Lease(std::shared_ptr<Slot> slot, TcpConnectionPtr conn)
+    : slot_ {std::move(slot)}
+    , conn_ {std::move(conn)}
+{
+    slot_->outstanding.fetch_add(1, std::memory_order_relaxed);
+}
+
+ConnectionPool::Lease::~Lease()
+{
+    release();
+}
+
+ConnectionPool::Lease::Lease(Lease&& rhs) noexcept
+    : slot_ {std::move(rhs.slot_)}
+    , conn_ {std::move(rhs.conn_)}
+{
+}
+
+auto ConnectionPool::Lease::operator=(Lease&& rhs) noexcept
+    -> Lease&
+{
+    if (this != &rhs)
+    {
+        release();
+        slot_ = std::move(rhs.slot_);
+        conn_ = std::move(rhs.conn_);
+    }
+    return *this;
+}
+
+void ConnectionPool::Lease::release()
+{
+    if (slot_ != nullptr)
+    {
+        slot_->outstanding.fetch_sub(1, std::memory_order_relaxed);
+        slot_.reset();
+    }
+    conn_.reset();
+}
+
+/* ======================== ConnectionPool ======================== */
+
+ConnectionPool::ConnectionPool(EventLoop* baseLoop,
+                               std::vector<InetAddress> upstreams,
+                               std::string nameArg,
+                               Options options)
+    : base_loop_ {baseLoop}
+    , name_ {std::move(nameArg)}
+    , options_ {options}
+    , threadpool_ {new EventLoopThreadPool(baseLoop, name_)}
+    , connection_callback_ {defaultConnectionCallback}
+    , conn_close_callback_ {defaultConnectionCallback}
+    , msg_callback_ {defaultMessageCallback}
+    , started_ {false}
+{
+    upstreams_.reserve(upstreams.size());
+    for (const auto& addr : upstreams)
+    {
+        upstreams_.push_back(std::make_unique<Upstream>(addr));
+    }
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    LOG_DEBUG_FMT(log, "ConnectionPool::~ConnectionPool[{}]", name_);
+}
+
+void ConnectionPool::start()
+{
+    base_loop_->assertInOwnerThread();
+    if (started_.exchange(true))
+    {
+        return;
+    }
+    threadpool_->start();
+
+    auto weak_pool = weak_from_this();
+    auto conns     = std::max(options_.conns_per_upstream, 1);
+    slots_.reserve(upstreams_.size() * conns);
+    {
+        auto _ = std::lock_guard<std::mutex> {ready_mutex_};
+        ready_.reserve(upstreams_.size() * conns);
+    }
+    for (auto& upstream : upstreams_)
+    {
+        for (auto i = 0; i < conns; ++i)
+        {
+            auto slot      = std::make_shared<Slot>();
+            slot->upstream = upstream.get();
+            slot->client   = std::make_shared<TcpClient>(threadpool_->getNextLoop(),
+                                                       upstream->addr,
+                                                       std::format("{}-{}#{}", name_, upstream->addr.toIpPortRepr(), i));
+            auto index     = slots_.size();
+            slot->client->setConnetionCallback([weak_pool, upstream = upstream.get(), index, user_cb = connection_callback_](const TcpConnectionPtr& conn) {
+                if (auto pool = weak_pool.lock(); pool != nullptr)
+                {
+                    pool->onConnected_(upstream);
+                    pool->markReady_(index, conn);
+                }
+                user_cb(conn);
+            });
+            slot->client->setConnectionCloseCallback([weak_pool, index, user_cb = conn_close_callback_](const TcpConnectionPtr& conn) {
+                if (auto pool = weak_pool.lock(); pool != nullptr)
+                {
+                    pool->markDown_(index);
+                }
+                user_cb(conn);
+            });
+            slot->client->setMessageCallback(msg_callback_);
+            slot->client->setWriteCompleteCallback(write_complete_callback_);
+            slot->client->setConnectFailedCallback([weak_pool, upstream = upstream.get()](int savedErrno) {
+                if (auto pool = weak_pool.lock(); pool != nullptr)
+                {
+                    pool->onConnectFailed_(upstream, savedErrno);
+                }
+            });
+            // 连接断开后自动重连
+            slot->client->enableRetry();
+            slots_.push_back(std::move(slot));
+        }
+    }
+
+    // warm up: 启动时即建立所有连接, 而不是等到第一次 acquire
+    std::ranges::for_each(slots_, [](const auto& slot) {
+        slot->client->connect();
+    });
+    LOG_INFO_FMT(log, "ConnectionPool[{}] - pre-connecting {} connections to {} upstreams", name_, slots_.size(), upstreams_.size());
+}
+
+void ConnectionPool::stop()
+{
+    base_loop_->assertInOwnerThread();
+    if (not started_.exchange(false))
+    {
+        return;
+    }
+    {
+        auto _ = std::lock_guard<std::mutex> {ready_mutex_};
+        for (auto& slot : ready_)
+        {
+            slot->conn.reset();
+        }
+        ready_.clear();
+    }
+    std::ranges::for_each(slots_, [](const auto& slot) {
+        slot->client->stop();
+        slot->client->disconnect();
+        // not a graceful shutdown, the loops end right after
+        if (auto conn = slot->client->getConnection(); conn != nullptr)
+        {
+            conn->forceClose();
+        }
+    });
+    // the closes and the connector stops queued above run before the io loops end
+    threadpool_->stop();
+    LOG_INFO_FMT(log, "ConnectionPool[{}] - stopped", name_);
+}
+
+void ConnectionPool::markReady_(size_t index, const TcpConnectionPtr& conn)
+{
+    const auto& slot = slots_[index];
+    auto _           = std::lock_guard<std::mutex> {ready_mutex_};
+    if (not started_.load(std::memory_order_relaxed))
+    {
+        return; // stopped meanwhile
+    }
+    if (slot->conn == nullptr)
+    {
+        ready_.push_back(slot);
+    }
+    slot->conn = conn;
+}
+
+void ConnectionPool::markDown_(size_t index)
+{
+    const auto& slot = slots_[index];
+    auto _           = std::lock_guard<std::mutex> {ready_mutex_};
+    if (auto it = std::ranges::find(ready_, slot); it != ready_.end())
+    {
+        *it = std::move(ready_.back()); // the order of the ready slots doesn't matter
+        ready_.pop_back();
+    }
+    slot->conn.reset();
+}
+
+void ConnectionPool::onConnectFailed_(Upstream* upstream, int savedErrno)
+{
+    auto failures = upstream->consecutive_failures.fetch_add(1, std::memory_order_relaxed) + 1;
+    LOG_WARN_FMT(log, "ConnectionPool[{}] - connect to {} failed, errno {}, {} times in a row", name_, upstream->addr.toIpPortRepr(), savedErrno, failures);
+    if (failures < options_.eject_after_failures)
+    {
+        return;
+    }
+    auto now_us = Timestamp::now().microSecondsSinceEpoch();
+    if (not isEjected_(*upstream, now_us))
+    {
+        auto until = addTime(Timestamp {static_cast<uint64_t>(now_us)}, options_.eject_seconds);
+        upstream->ejected_until_us.store(until.microSecondsSinceEpoch(), std::memory_order_relaxed);
+        upstream->ejection_count.fetch_add(1, std::memory_order_relaxed);
+        LOG_WARN_FMT(log, "ConnectionPool[{}] - eject upstream {} for {} seconds", name_, upstream->addr.toIpPortRepr(), options_.eject_seconds);
+    }
+}
+
+void ConnectionPool::onConnected_(Upstream* upstream)
+{
+    upstream->consecutive_failures.store(0, std::memory_order_relaxed);
+    if (upstream->ejected_until_us.exchange(0, std::memory_order_relaxed) != 0)
+    {
+        LOG_INFO_FMT(log, "ConnectionPool[{}] - upstream {} is back", name_, upstream->addr.toIpPortRepr());
+    }
+}
+
+auto ConnectionPool::isEjected_(const Upstream& upstream, int64_t nowUs) const
+    -> bool
+{
+    return upstream.ejected_until_us.load(std::memory_order_relaxed) > nowUs;
+}
+
+auto ConnectionPool::isCandidate_(const Slot& slot, int64_t nowUs, bool healthyOnly) const
+    -> bool
+{
+    return not healthyOnly or not isEjected_(*slot.upstream, nowUs);
+}
+
+auto ConnectionPool::nthCandidate_(size_t n, int64_t nowUs, bool healthyOnly) const
+    -> const std::shared_ptr<Slot>&
+{
+    if (not healthyOnly)
+    {
+        return ready_[n];
+    }
+    for (const auto& slot : ready_)
+    {
+        if (isCandidate_(*slot, nowUs, healthyOnly) and n-- == 0)
+        {
+            return slot;
+        }
+    }
+    std::unreachable();
+}
+
+auto ConnectionPool::pickLeastOutstanding_(int64_t nowUs, bool healthyOnly) const
+    -> const std::shared_ptr<Slot>&
+{
+    const auto* best = static_cast<const std::shared_ptr<Slot>*>(nullptr);
+    for (const auto& slot : ready_)
+    {
+        if (isCandidate_(*slot, nowUs, healthyOnly)
+            and (best == nullptr or slot->outstanding.load(std::memory_order_relaxed) < (*best)->outstanding.load(std::memory_order_relaxed)))
+        {
+            best = &slot;
+        }
+    }
+    return *best;
+}
+
+auto ConnectionPool::pickPowerOfTwo_(int64_t nowUs, bool healthyOnly, size_t count) const
+    -> const std::shared_ptr<Slot>&
+{
+    if (count == 1)
+    {
+        return nthCandidate_(0, nowUs, healthyOnly);
+    }
+    auto first  = nextRandom() % count;
+    auto second = nextRandom() % count;
+    if (second == first)
+    {
+        second = (first + 1) % count;
+    }
+    const auto& lhs = nthCandidate_(first, nowUs, healthyOnly);
+    const auto& rhs = nthCandidate_(second, nowUs, healthyOnly);
+    return lhs->outstanding.load(std::memory_order_relaxed) <= rhs->outstanding.load(std::memory_order_relaxed) ? lhs : rhs;
+}
+
+auto ConnectionPool::acquire()
+    -> Lease
+{
+    auto now_us = Timestamp::now().microSecondsSinceEpoch();
+    auto _      = std::lock_guard<std::mutex> {ready_mutex_};
+    if (ready_.empty())
+    {
+        return Lease {};
+    }
+    auto healthy = static_cast<size_t>(std::ranges::count_if(ready_, [this, now_us](const auto& slot) {
+        return not isEjected_(*slot->upstream, now_us);
+    }));
+    // every upstream ejected: fall back to any live connection
+    auto healthy_only = healthy != 0;
+    const auto& chosen = options_.policy == Policy::LeastOutstanding
+                             ? pickLeastOutstanding_(now_us, healthy_only)
+                             : pickPowerOfTwo_(now_us, healthy_only, healthy_only ? healthy : ready_.size());
+    return Lease {chosen, chosen->conn};
+}
+
+auto ConnectionPool::getLiveConnectionCount() const
+    -> size_t
+{
+    auto _ = std::lock_guard<std::mutex> {ready_mutex_};
+    return ready_.size();
+}
+
+auto ConnectionPool::getEjectedUpstreamCount() const
+    -> size_t
+{
+    auto now_us = Timestamp::now().microSecondsSinceEpoch();
+    return std::ranges::count_if(upstreams_, [this, now_us](const auto& upstream) {
+        return isEjected_(*upstream, now_us);
+    });
+}
@@ -20,28 +20,43 @@
 #include <errno.h>
 #include <string.h>
 
+#include <algorithm>
 #include <memory>
 #include <utility>
 
 static auto log = GET_ROOT_LOGGER();
 
 Connector::Connector(EventLoop* loop, const InetAddress& peerAddr, std::weak_ptr<TcpClient> owner)
+    : Connector(loop, std::vector<InetAddress> {peerAddr}, std::move(owner))
+{
+}
+
+Connector::Connector(EventLoop* loop, std::vector<InetAddress> peerAddrs, std::weak_ptr<TcpClient> owner)
     : loop_ {loop}
-    , peer_addr_ {peerAddr}
+    , peer_addrs_ {std::move(peerAddrs)}
+    , winner_idx_ {0}
     , onwner_ {std::move(owner)}
     , is_connect_canceled_ {true}
     , state_ {Disconnected}
+    , next_addr_idx_ {0}
     , retry_delay_ms_ {c_init_retry_delay_ms}
+    , attempt_delay_ms_ {c_default_attempt_delay_ms}
     , retry_timer_id_ {0}
+    , attempt_timer_id_ {0}
 // 数据成员中其实是有Channel对象的,但却并没有初始化,因为在连接成功的时候才能有一个有效的fd,那时才可以创建一个有效的Channel
 {
+    assert(not peer_addrs_.empty());
+    stats_.reserve(peer_addrs_.size());
+    std::ranges::for_each(peer_addrs_, [this](const auto& addr) {
+        stats_.push_back(AddressStats {.addr = addr});
+    });
     LOG_DEBUG_FMT(log, "ctor[{}]", std::bit_cast<uint64_t>(this));
 }
 
 Connector::~Connector()
 {
     LOG_DEBUG_FMT(log, "dtor[{}]", std::bit_cast<uint64_t>(this));
-    assert(channel_ == nullptr);
+    assert(attempts_.empty());
 }
 
 void Connector::start()
@@ -61,10 +76,11 @@ void Connector::startInLoop_()
     loop_->assertInOwnerThread();
     assert(state_ == Disconnected);
 
-    // connectPeer_();
     if (not is_connect_canceled_)
     {
-        connectPeer_();
+        setState_(Connecting);
+        next_addr_idx_ = 0;
+        startNextAttempt_();
     }
     else
     {
@@ -94,60 +110,92 @@ void Connector::stopInLoop_()
         loop_->cancelTimer(retry_timer_id_);
         retry_timer_id_ = 0;
     }
+    cancelAttemptTimer_();
 
     if (state_ == Connecting) // 如果正在连接
     {
         setState_(Disconnected);
-        auto sockfd = removeAndResetChannel_();
-
-        Sock::close(sockfd);
+        cancelAttempts_(-1);
         LOG_DEBUG_FMT(log, "stoping");
     }
 }
 
-void Connector::connectPeer_()
+void Connector::startNextAttempt_()
 {
-    auto sockfd = Sock::createNonblockingOrDie(peer_addr_.getFamily());
-    // 这里是非阻塞的
-    auto ret         = Sock::connect(sockfd, *peer_addr_.getSockAddr());
-    auto saved_errno = (ret == 0) ? 0 : errno;
-    switch (saved_errno)
+    loop_->assertInOwnerThread();
+    while (next_addr_idx_ < peer_addrs_.size())
     {
-        // 可继续连接的情况
-        case 0:
-        case EINPROGRESS:
-        case EINTR:
-        case EISCONN:
-            LOG_INFO_FMT(log, "SockConnect established in Connector:startInLoop [sockfd-{}]", sockfd);
-            postSocketConnected_(sockfd);
-            break;
-
-        // 可重试的错误
-        case EAGAIN:
-        case EADDRINUSE:
-        case EADDRNOTAVAIL:
-        case ECONNREFUSED:
-        case ENETUNREACH:
-            retry_(sockfd);
-            break;
-
-        // 程序/权限/参数错误
-        case EACCES:
-        case EPERM:
-        case EAFNOSUPPORT:
-        case EALREADY:
-        case EBADF:
-        case EFAULT:
-        case ENOTSOCK:
-            LOG_SYSERR_FMT(log, "connect error in Connector::startInLoop {} {}", saved_errno, strerror(saved_errno));
-            Sock::close(sockfd);
-            break;
+        auto addr_idx    = next_addr_idx_++;
+        const auto& addr = peer_addrs_[addr_idx];
+        recordAttempt_(addr_idx);
 
-        default:
-            LOG_SYSERR_FMT(log, "Unexpected error in Connector::startInLoop {}", saved_errno);
-            Sock::close(sockfd);
-            // connectErrorCallback_();
-            break;
+        auto sockfd = Sock::createNonblockingOrDie(addr.getFamily());
+        // 这里是非阻塞的
+        auto ret         = Sock::connect(sockfd, *addr.getSockAddr());
+        auto saved_errno = (ret == 0) ? 0 : errno;
+        switch (saved_errno)
+        {
+            // 可继续连接的情况
+            case 0:
+            case EINPROGRESS:
+            case EINTR:
+            case EISCONN:
+                LOG_INFO_FMT(log, "connecting to {} in Connector::startNextAttempt_ [sockfd-{}]", addr.toIpPortRepr(), sockfd);
+                watchAttempt_(sockfd, addr_idx);
+                // 若该地址在 attempt delay 内没有结果, 不等待它, 并行尝试下一个地址
+                if (next_addr_idx_ < peer_addrs_.size())
+                {
+                    if (attempt_delay_ms_ <= 0)
+                    {
+                        continue; // 无延迟: 同时尝试所有地址
+                    }
+                    attempt_timer_id_ = loop_->runAfter(attempt_delay_ms_ / 1000.0,
+                                                        [this, weakOwner = onwner_] {
+                                                            if (auto owner = weakOwner.lock(); owner != nullptr)
+                                                            {
+                                                                this->attempt_timer_id_ = 0;
+                                                                if (this->state_ == Connecting)
+                                                                {
+                                                                    this->startNextAttempt_();
+                                                                }
+                                                            }
+                                                        });
+                }
+                return;
+
+            // 可重试的错误
+            case EAGAIN:
+            case EADDRINUSE:
+            case EADDRNOTAVAIL:
+            case ECONNREFUSED:
+            case ENETUNREACH:
+                LOG_WARN_FMT(log, "connect to {} error in Connector::startNextAttempt_ {} {}", addr.toIpPortRepr(), saved_errno, strerror(saved_errno));
+                break;
+
+            // 程序/权限/参数错误
+            case EACCES:
+            case EPERM:
+            case EAFNOSUPPORT:
+            case EALREADY:
+            case EBADF:
+            case EFAULT:
+            case ENOTSOCK:
+                LOG_SYSERR_FMT(log, "connect error in Connector::startNextAttempt_ {} {}", saved_errno, strerror(saved_errno));
+                break;
+
+            default:
+                LOG_SYSERR_FMT(log, "Unexpected error in Connector::startNextAttempt_ {}", saved_errno);
+                break;
+        }
+        // 同步失败: 关闭并立即尝试下一个地址
+        Sock::close(sockfd);
+        recordFailure_(addr_idx);
+        notifyConnectFailed_(saved_errno);
+    }
+
+    if (attempts_.empty())
+    {
+        raceFailed_();
     }
 }
 
@@ -156,116 +204,217 @@ void Connector::restart()
     loop_->assertInOwnerThread();
     setState_(Disconnected);
     retry_delay_ms_      = c_init_retry_delay_ms;
-    is_connect_canceled_ = true;
+    is_connect_canceled_ = false;
     startInLoop_();
 }
 
-void Connector::postSocketConnected_(int sockfd)
+void Connector::resume()
 {
-    setState_(Connecting);
-    assert(channel_ == nullptr);
-    channel_ = std::make_unique<Channel>(loop_, sockfd);
-    channel_->setWriteCallback(
-        [this, weakOwner = onwner_] {
+    loop_->assertInOwnerThread();
+    if (state_ == Disconnected)
+    {
+        startInLoop_();
+    }
+}
+
+auto Connector::setServerAddresses(std::vector<InetAddress> peerAddrs)
+    -> bool
+{
+    loop_->assertInOwnerThread();
+    if (not attempts_.empty() or peerAddrs.empty())
+    {
+        return false;
+    }
+    auto winner = peer_addrs_[winner_idx_].toIpPortRepr();
+    auto stats  = std::vector<AddressStats> {};
+    stats.reserve(peerAddrs.size());
+    winner_idx_ = 0;
+    {
+        auto _ = std::lock_guard<std::mutex> {stats_mutex_};
+        for (size_t i = 0; i < peerAddrs.size(); ++i)
+        {
+            auto repr = peerAddrs[i].toIpPortRepr();
+            auto it   = std::ranges::find_if(stats_, [&repr](const auto& kept) { return kept.addr.toIpPortRepr() == repr; });
+            stats.push_back(it != stats_.end() ? *it : AddressStats {.addr = peerAddrs[i]});
+            winner_idx_ = repr == winner ? i : winner_idx_;
+        }
+        stats_ = std::move(stats);
+    }
+    peer_addrs_    = std::move(peerAddrs);
+    next_addr_idx_ = 0;
+    return true;
+}
+
+void Connector::watchAttempt_(int sockfd, size_t addrIdx)
+{
+    auto channel = std::make_unique<Channel>(loop_, sockfd);
+    channel->setWriteCallback(
+        [this, weakOwner = onwner_, sockfd] {
             if (auto owner = weakOwner.lock(); owner != nullptr)
             {
-
-                this->channelWriteCB_();
+                this->attemptWritableCB_(sockfd);
             }
         });
-    channel_->setErrorCallback(
-        [this, weakOwner = onwner_] {
+    channel->setErrorCallback(
+        [this, weakOwner = onwner_, sockfd] {
             if (auto owner = weakOwner.lock(); owner != nullptr)
             {
-                this->channelErrorCB_();
+                this->attemptErrorCB_(sockfd);
             }
         });
 
     // channel_->tie(shared_from_this());
-    channel_->enableWriting();
+    channel->enableWriting();
+    attempts_.push_back(Attempt {addrIdx, Timestamp::now(), std::move(channel)});
 }
 
-auto Connector::removeAndResetChannel_()
-    -> int
+auto Connector::hasAttempt_(int sockfd) const
+    -> bool
 {
-    channel_->unregisterAllEvent();
-    channel_->remove();
-    auto sockfd = channel_->getFd();
-    // Can't reset channel_ here, because we are inside Channel::handleEvent
-    // 为什么这里可以这样做，因为 eventloop will doPendingTask after handleEvent in same poll
-    loop_->queueTask([this] { this->resetChannel_(); });
-    return sockfd;
+    return std::ranges::any_of(attempts_, [sockfd](const auto& attempt) {
+        return attempt.channel->getFd() == sockfd;
+    });
 }
 
-void Connector::resetChannel_()
+auto Connector::removeAttempt_(int sockfd)
+    -> Attempt
 {
-    channel_.reset();
+    auto it = std::ranges::find_if(attempts_, [sockfd](const auto& attempt) {
+        return attempt.channel->getFd() == sockfd;
+    });
+    assert(it != attempts_.end());
+    auto attempt = std::move(*it);
+    attempts_.erase(it);
+
+    attempt.channel->unregisterAllEvent();
+    attempt.channel->remove();
+    // Can't reset channel here, because we are inside Channel::handleEvent
+    // 为什么这里可以这样做，因为 eventloop will doPendingTask after handleEvent in same poll
+    loop_->queueTask([channel = std::shared_ptr<Channel> {std::move(attempt.channel)}] {});
+    return attempt;
 }
 
-void Connector::channelWriteCB_()
+void Connector::cancelAttempts_(int winnerFd)
 {
-    LOG_TRACE_FMT(log, "Connector::channelWriteCB_ {}", static_cast<int>(state_));
-
-    if (state_ == Connecting)
+    auto loser_fds = std::vector<int> {};
+    for (const auto& attempt : attempts_)
     {
-        auto sockfd = removeAndResetChannel_();
-        auto err    = Sock::getSocketError(sockfd);
-        if (err)
+        if (attempt.channel->getFd() != winnerFd)
         {
-            LOG_WARN_FMT(log, "Connector::handleWrite - SO_ERROR = {} {}", err, strerror(err));
-            retry_(sockfd);
+            loser_fds.push_back(attempt.channel->getFd());
         }
-        else if (Sock::isSelfConnect(sockfd))
+    }
+    for (auto fd : loser_fds)
+    {
+        auto attempt = removeAttempt_(fd);
+        recordCanceled_(attempt.addr_idx);
+        Sock::close(fd);
+    }
+}
+
+void Connector::cancelAttemptTimer_()
+{
+    if (attempt_timer_id_ != 0)
+    {
+        loop_->cancelTimer(attempt_timer_id_);
+        attempt_timer_id_ = 0;
+    }
+}
+
+void Connector::attemptWritableCB_(int sockfd)
+{
+    LOG_TRACE_FMT(log, "Connector::attemptWritableCB_ {}", static_cast<int>(state_));
+
+    if (state_ != Connecting or not hasAttempt_(sockfd))
+    {
+        // canceled earlier in this poll, e.g. lost the race to an attempt writable in the same poll
+        return;
+    }
+
+    auto err = Sock::getSocketError(sockfd);
+    if (err)
+    {
+        LOG_WARN_FMT(log, "Connector::handleWrite - SO_ERROR = {} {}", err, strerror(err));
+        attemptFailed_(sockfd, err);
+    }
+    else if (Sock::isSelfConnect(sockfd))
+    {
+        LOG_WARN_FMT(log, "Connector::handleWrite - Self connect");
+        attemptFailed_(sockfd, ECONNREFUSED);
+    }
+    else
+    {
+        auto attempt = removeAttempt_(sockfd);
+        recordSuccess_(attempt.addr_idx, attempt.started_at);
+        cancelAttemptTimer_();
+        cancelAttempts_(sockfd);
+        winner_idx_ = attempt.addr_idx;
+        setState_(Connected);
+        // 是否用户已经取消连接
+        if (not is_connect_canceled_)
         {
-            LOG_WARN_FMT(log, "Connector::handleWrite - Self connect");
-            retry_(sockfd);
+            new_connection_callback_(sockfd);
         }
-        else
+        else // 防止幽灵连接
         {
-            setState_(Connected);
-            // 是否用户已经取消连接
-            if (not is_connect_canceled_)
-            {
-                new_connection_callback_(sockfd);
-            }
-            else // 防止幽灵连接
-            {
-                Sock::close(sockfd);
-            }
+            Sock::close(sockfd);
         }
     }
-    else
-    {
-        // what happened?
-        assert(state_ == Disconnected);
-    }
 }
 
-void Connector::channelErrorCB_()
+void Connector::attemptErrorCB_(int sockfd)
 {
     LOG_ERROR_FMT(log, "Connector::handleError state={}", static_cast<int>(state_.load()));
-    if (state_ == Connecting)
+    if (state_ == Connecting and hasAttempt_(sockfd))
     {
-        auto sockfd = removeAndResetChannel_();
-        auto err    = Sock::getSocketError(sockfd);
+        auto err = Sock::getSocketError(sockfd);
         LOG_TRACE_FMT(log, "Connector::handleError - SO_ERROR = {} {}", err, strerror(err));
-        retry_(sockfd);
+        attemptFailed_(sockfd, err);
     }
 }
 
-void Connector::retry_(int sockfd)
+void Connector::attemptFailed_(int sockfd, int savedErrno)
 {
+    auto attempt = removeAttempt_(sockfd);
     Sock::close(sockfd);
+    recordFailure_(attempt.addr_idx);
+    notifyConnectFailed_(savedErrno);
+
+    // 不必等 attempt delay, 立即尝试下一个地址
+    cancelAttemptTimer_();
+    if (next_addr_idx_ < peer_addrs_.size())
+    {
+        startNextAttempt_();
+    }
+    else if (attempts_.empty())
+    {
+        raceFailed_();
+    }
+}
+
+void Connector::raceFailed_()
+{
+    assert(attempts_.empty());
     setState_(Disconnected);
-    if (is_connect_canceled_)
+    retry_();
+}
+
+void Connector::retry_()
+{
+    if (not is_connect_canceled_)
     {
         // 一定间隔后充实
-        LOG_TRACE_FMT(log, "Connector::retry - Retry connecting to {} in {} milliseconds.", peer_addr_.toIpPortRepr(), retry_delay_ms_);
+        LOG_TRACE_FMT(log, "Connector::retry - Retry connecting to {} in {} milliseconds.", getServerAddress().toIpPortRepr(), retry_delay_ms_);
         retry_timer_id_ = loop_->runAfter(retry_delay_ms_ / 1000.0,
                                           [this, weakOwner = onwner_] {
                                               if (auto owner = weakOwner.lock(); owner != nullptr)
                                               {
-
+                                                  this->retry_timer_id_ = 0;
+                                                  if (this->retry_callback_)
+                                                  {
+                                                      this->retry_callback_();
+                                                      return;
+                                                  }
                                                   this->startInLoop_();
                                               }
                                           });
@@ -276,3 +425,51 @@ void Connector::retry_(int sockfd)
         LOG_DEBUG_FMT(log, "do not connecting");
     }
 }
+
+void Connector::notifyConnectFailed_(int savedErrno)
+{
+    if (connect_failed_callback_)
+    {
+        connect_failed_callback_(savedErrno);
+    }
+}
+
+/* ======================== statistics ======================== */
+
+void Connector::recordAttempt_(size_t addrIdx)
+{
+    auto _ = std::lock_guard<std::mutex> {stats_mutex_};
+    ++stats_[addrIdx].attempts;
+}
+
+void Connector::recordSuccess_(size_t addrIdx, Timestamp startedAt)
+{
+    auto latency_ms = timeDifference(Timestamp::now(), startedAt) * 1000.0;
+    auto _          = std::lock_guard<std::mutex> {stats_mutex_};
+    auto& stats     = stats_[addrIdx];
+    stats.min_latency_ms  = stats.successes == 0 ? latency_ms : std::min(stats.min_latency_ms, latency_ms);
+    stats.max_latency_ms  = std::max(stats.max_latency_ms, latency_ms);
+    stats.last_latency_ms = latency_ms;
+    stats.total_latency_ms += latency_ms;
+    ++stats.successes;
+    LOG_DEBUG_FMT(log, "Connector - connected to {} in {} ms", stats.addr.toIpPortRepr(), latency_ms);
+}
+
+void Connector::recordFailure_(size_t addrIdx)
+{
+    auto _ = std::lock_guard<std::mutex> {stats_mutex_};
+    ++stats_[addrIdx].failures;
+}
+
+void Connector::recordCanceled_(size_t addrIdx)
+{
+    auto _ = std::lock_guard<std::mutex> {stats_mutex_};
+    ++stats_[addrIdx].canceled;
+}
+
+auto Connector::getConnectStats() const
+    -> std::vector<AddressStats>
+{
+    auto _ = std::lock_guard<std::mutex> {stats_mutex_};
+    return stats_;
+}
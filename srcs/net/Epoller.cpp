@@ -37,7 +37,7 @@ auto EPollPoller::poll(int timeoutMs, ChannelList& activeChannels)
 
     auto save_errno = errno;
 
-    auto now = Timestamp::now();
+    auto now = owner_loop_->refreshNow();
 
     if (num_events > 0)
     {
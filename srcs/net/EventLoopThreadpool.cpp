@@ -1,10 +1,12 @@
 #include <algorithm>
 #include <format>
+#include <latch>
 #include <memory>
 #include <ranges>
 
 #include "net/EventLoopThreadpool.h"
 #include "net/EventLoopThread.h"
+#include "net/LoopLink.h"
 
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop,  std::string nameArg)
     : base_loop_{ baseLoop }
@@ -15,6 +17,28 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop,  std::string nameA
 {
 }
 
+EventLoopThreadPool::~EventLoopThreadPool()
+{
+    stop();
+}
+
+void EventLoopThreadPool::stop()
+{
+    // the io loops end with their threads, the base loop outlives the pool: it must let go of the links first
+    threads_.clear();
+    sub_loops_.clear();
+    next_ = 0;
+    for (const auto &link : links_)
+    {
+        if (link != nullptr)
+        {
+            base_loop_->detachLink_(link.get());
+        }
+    }
+    links_.clear();
+    link_ends_.clear();
+}
+
 void EventLoopThreadPool::start()
 {
     started_ = true;
@@ -27,6 +51,10 @@ void EventLoopThreadPool::start()
         // 底层创建线程 绑定一个新的EventLoop 并返回该loop的地址
         sub_loops_.push_back(t->startLoop());
     }
+    if (not sub_loops_.empty())
+    {
+        makeLinks_();
+    }
 
     // if(num_threads_ == 0 && cb)                                      // 整个服务端只有一个线程运行baseLoop
     // {
@@ -66,3 +94,133 @@ auto EventLoopThreadPool::getAllLoops()
 }
 auto EventLoopThreadPool::getName() const
     -> const std::string& { return name_; }
+
+void EventLoopThreadPool::makeLinks_()
+{
+    base_loop_->assertInOwnerThread();
+    link_ends_.push_back(base_loop_);
+    std::ranges::copy(sub_loops_, std::back_inserter(link_ends_));
+    auto size = link_ends_.size();
+    links_.resize(size * size);
+    for (size_t from = 0; from < size; ++from)
+    {
+        for (size_t to = 0; to < size; ++to)
+        {
+            if (from != to)
+            {
+                links_[from * size + to] = std::make_unique<LoopLink>(link_ends_[from], link_ends_[to], c_link_capacity);
+            }
+        }
+    }
+    for (size_t from = 0; from < size; ++from)
+    {
+        for (size_t to = 0; to < size; ++to)
+        {
+            if (from != to)
+            {
+                links_[from * size + to]->setReverse(links_[to * size + from].get());
+            }
+        }
+    }
+
+    // each loop reads its links in its own thread, the io loops are already looping
+    auto attached = std::latch {static_cast<std::ptrdiff_t>(size)};
+    for (auto *loop : link_ends_)
+    {
+        loop->runTask([this, loop, &attached] {
+            for (const auto &link : links_)
+            {
+                if (link != nullptr and (link->getFrom() == loop or link->getTo() == loop))
+                {
+                    loop->attachLink_(link.get());
+                }
+            }
+            attached.count_down();
+        });
+    }
+    attached.wait();
+}
+
+auto EventLoopThreadPool::findLink_(const EventLoop *from, const EventLoop *to) const
+    -> LoopLink *
+{
+    auto from_it = std::ranges::find(link_ends_, from);
+    auto to_it   = std::ranges::find(link_ends_, to);
+    if (from_it == link_ends_.end() or to_it == link_ends_.end())
+    {
+        return nullptr;
+    }
+    auto size = link_ends_.size();
+    return links_[static_cast<size_t>(from_it - link_ends_.begin()) * size + static_cast<size_t>(to_it - link_ends_.begin())].get();
+}
+
+auto EventLoopThreadPool::jumpConsistentHash(uint64_t key, int32_t buckets)
+    -> int32_t
+{
+    auto b = int64_t {-1};
+    auto j = int64_t {0};
+    while (j < buckets)
+    {
+        b   = j;
+        key = key * 2862933555777941757ULL + 1;
+        j   = static_cast<int64_t>(static_cast<double>(b + 1) * (static_cast<double>(1LL << 31) / static_cast<double>((key >> 33) + 1)));
+    }
+    return static_cast<int32_t>(b);
+}
+
+auto EventLoopThreadPool::getLoopForKey(uint64_t key) const
+    -> EventLoop *
+{
+    if (sub_loops_.empty())
+    {
+        return base_loop_;
+    }
+    return sub_loops_[static_cast<size_t>(jumpConsistentHash(key, static_cast<int32_t>(sub_loops_.size())))];
+}
+
+auto EventLoopThreadPool::getLoopForKey(std::string_view key) const
+    -> EventLoop *
+{
+    return getLoopForKey(static_cast<uint64_t>(std::hash<std::string_view> {}(key)));
+}
+
+void EventLoopThreadPool::runOnLoopFor(uint64_t key, EventLoop::Task task, EventLoop::Task done)
+{
+    auto *target  = getLoopForKey(key);
+    auto *current = EventLoop::getEventLoopOfCurrentThread();
+    if (current == target)
+    {
+        task();
+        if (done)
+        {
+            done();
+        }
+        return;
+    }
+    if (auto *link = current != nullptr ? findLink_(current, target) : nullptr; link != nullptr)
+    {
+        link->post(std::move(task), std::move(done));
+        return;
+    }
+    if (not done)
+    {
+        target->queueTask(std::move(task));
+        return;
+    }
+    // not a loop of the pool: done goes back to the calling loop by its task queue, or runs right after the task in
+    // the owning loop when the calling thread has no loop
+    target->queueTask([task = std::move(task), done = std::move(done), current]() mutable {
+        task();
+        if (current == nullptr)
+        {
+            done();
+            return;
+        }
+        current->queueTask(std::move(done));
+    });
+}
+
+void EventLoopThreadPool::runOnLoopFor(std::string_view key, EventLoop::Task task, EventLoop::Task done)
+{
+    runOnLoopFor(static_cast<uint64_t>(std::hash<std::string_view> {}(key)), std::move(task), std::move(done));
+}
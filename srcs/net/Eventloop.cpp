@@ -13,11 +13,15 @@
 #include <signal.h>
 
 #include "net/EventLoop.h"
+#include "common/coarseclock.h"
 #include "common/curthread.h"
+#include "common/metrics.h"
+#include "common/offloadpool.h"
 #include "logger/LogLevel.h"
 #include "net/EventLoopErrc.h"
 #include "net/Channel.h"
 #include "net/Epoller.h"
+#include "net/LoopLink.h"
 #include "net/Timestamp.h"
 #include "logger/Logger.h"
 #include "logger/LoggerManager.h"
@@ -41,6 +45,8 @@ thread_local EventLoop* t_event_loop = nullptr;
 
 // 定义默认的Poller IO复用接口的超时时间
 const int kPollTimeMs = 10000; // 10000毫秒 = 10秒钟
+// rounds of queued tasks still run once quit, the tasks queued by those included
+constexpr int c_exit_task_rounds = 8;
 
 class IgnoreSigPipe {
 public:
@@ -54,6 +60,30 @@ public:
 
 IgnoreSigPipe initObj;
 
+struct LoopMetrics
+{
+    Cot::Gauge& loops;
+    Cot::Counter& iterations;
+    Cot::Counter& events;
+    Cot::Counter& tasks;
+    Cot::Histogram& task_lag;
+};
+
+// shared by the loops, each thread records into its own shard
+auto loopMetrics()
+    -> LoopMetrics&
+{
+    auto& registry      = Cot::MetricsRegistry::GetInstance();
+    static auto metrics = LoopMetrics {
+        .loops      = registry.GetGauge("net_loops", "EventLoops alive"),
+        .iterations = registry.GetCounter("net_loop_iterations_total", "poll returns of all the loops"),
+        .events     = registry.GetCounter("net_loop_events_total", "active channels handled by all the loops"),
+        .tasks      = registry.GetCounter("net_loop_tasks_total", "queued tasks run by all the loops"),
+        .task_lag   = registry.GetHistogram("net_loop_task_lag_seconds", "wait of the queued tasks before a loop ran them, per batch", Cot::Histogram::LatencyBounds()),
+    };
+    return metrics;
+}
+
 } // namespace
 
 /* 创建线程之后主线程和子线程谁先运行是不确定的。
@@ -80,10 +110,17 @@ EventLoop::EventLoop()
     , calling_pending_tasks_ {false}
     , iteration_count_ {0}
     , owner_tid_ {CurThr::GetId()}
+    , clock_source_ {ClockSource::Precise}
+    , cached_now_ {Timestamp::now()}
+    , clock_reads_ {0}
+    , busy_us_ {0}
     , poller_ {std::make_unique<EPollPoller>(this)}
     , timer_queue_ {new TimerQueue {this}}
     , wakeup_fd_ {createEventfd()}
     , wakeup_channel_ {new Channel {this, wakeup_fd_}}
+    , pending_since_us_ {0}
+    , task_lag_us_ {0}
+    , links_signalled_ {false}
 {
     LOG_DEBUG_FMT(log, "EventLoop created {} in thread {}", std::bit_cast<uint64_t>(this), owner_tid_);
     // only one loop per thread
@@ -101,6 +138,7 @@ EventLoop::EventLoop()
 
     // 每一个EventLoop都将监听wakeupChannel_的EPOLL读事件了
     wakeup_channel_->enableReading();
+    loopMetrics().loops.Add(1);
 }
 
 EventLoop::~EventLoop()
@@ -111,6 +149,7 @@ EventLoop::~EventLoop()
     wakeup_channel_->remove();
     ::close(wakeup_fd_);
     t_event_loop = nullptr;
+    loopMetrics().loops.Add(-1);
 }
 
 void EventLoop::loop()
@@ -141,14 +180,30 @@ void EventLoop::loop(std::error_code& ec)
     {
         active_channels_.clear();
         // 1. 等待事件发生
-        last_poll_return_time_ = poller_->poll(kPollTimeMs, active_channels_);
+        // read after the tasks of the iteration, they are counted too, and before the first poll as well: the poll
+        // timeout counts from it, and the loop time is the construction time until then
+        auto iteration_end = refreshNow();
+        if (iteration_count_ != 0)
+        {
+            busy_us_.fetch_add(static_cast<uint64_t>(std::max<int64_t>(0, iteration_end.microSecondsSinceEpoch() - last_poll_return_time_.microSecondsSinceEpoch())),
+                               std::memory_order_relaxed);
+        }
+        auto timeout_ms        = timer_queue_->isPollTimeoutDriven() ? timer_queue_->getPollTimeoutMs(kPollTimeMs) : kPollTimeMs;
+        last_poll_return_time_ = poller_->poll(timeout_ms, active_channels_);
         ++iteration_count_;
+        auto& metrics = loopMetrics();
+        metrics.iterations.Inc();
+        metrics.events.Inc(active_channels_.size());
 
         // 2. 处理活跃 Channel 的事件
         std::ranges::for_each(active_channels_, [this](auto* channel) {
             // Poller监听哪些channel发生了事件 然后上报给EventLoop 通知channel处理相应的事件
             channel->handleEvent(last_poll_return_time_);
         });
+        if (timer_queue_->isPollTimeoutDriven())
+        {
+            timer_queue_->runExpired();
+        }
         /**
          * 执行当前EventLoop事件循环需要处理的回调操作 对于线程数 >=2 的情况 IO线程 mainloop(mainReactor) 主要工作：
          * accept接收连接 => 将accept返回的connfd打包为Channel => TcpServer::newConnection通过轮询将TcpConnection对象分配给subloop处理
@@ -156,6 +211,12 @@ void EventLoop::loop(std::error_code& ec)
          * mainloop调用QueueInOwnerLoop将回调加入subloop（该回调需要subloop执行 但subloop还在poller_->poll处阻塞） queueInLoop通过wakeup将subloop唤醒
          **/
         // 3. 执行 EventLoop 内部任务队列中的任务
+        runLinks_();
+        runPendingTasks_();
+    }
+    // the tasks queued by the last iteration, e.g. the release of the connections closed in it, are not dropped
+    for (auto round = 0; round < c_exit_task_rounds and hasPendingTasks_(); ++round)
+    {
         runPendingTasks_();
     }
     LOG_INFO_FMT(log,"EventLoop %p stop looping.\n", std::bit_cast<uint64_t>(this));
@@ -222,6 +283,10 @@ void EventLoop::queueTask(Task task)
 {
     {
         auto _ = std::unique_lock<std::mutex> {mutex_};
+        if (pending_tasks_.empty())
+        {
+            pending_since_us_.store(readClock_().microSecondsSinceEpoch(), std::memory_order_relaxed);
+        }
         pending_tasks_.emplace_back(std::move(task));
     }
 
@@ -264,14 +329,14 @@ auto EventLoop::runAt(Timestamp time, TimerCallback cb)
 auto EventLoop::runAfter(double delay, TimerCallback cb)
     -> Timer::Id
 {
-    Timestamp time(addTime(Timestamp::now(), delay));
+    Timestamp time(addTime(loopTimeOrClock_(), delay));
     return runAt(time, std::move(cb));
 }
 
 auto EventLoop::runEvery(double interval, TimerCallback cb)
     -> Timer::Id
 {
-    Timestamp time(addTime(Timestamp::now(), interval));
+    Timestamp time(addTime(loopTimeOrClock_(), interval));
     return timer_queue_->addTimer(std::move(cb), time, interval);
 }
 
@@ -280,6 +345,36 @@ void EventLoop::cancelTimer(Timer::Id timerId)
     return timer_queue_->cancel(timerId);
 }
 
+void EventLoop::setTimerMode(TimerMode mode)
+{
+    runTask([this, mode] {
+        timer_queue_->setPollTimeoutDriven(mode == TimerMode::PollTimeout);
+    });
+}
+
+void EventLoop::setTimerSlack(double seconds)
+{
+    runTask([this, seconds] {
+        timer_queue_->setSlack(seconds);
+    });
+}
+
+void EventLoop::setOffloadPool(std::shared_ptr<Cot::OffloadPool> pool)
+{
+    runTask([this, pool = std::move(pool)]() mutable {
+        offload_pool_ = std::move(pool);
+    });
+}
+
+void EventLoop::offload_(Task job)
+{
+    const auto& pool = offload_pool_ != nullptr ? offload_pool_ : Cot::OffloadPool::GetDefault();
+    if (not pool->TrySubmit(job))
+    {
+        job();
+    }
+}
+
 // EventLoop的方法 => Poller的方法
 void EventLoop::updateChannel(Channel* channel)
 {
@@ -298,6 +393,13 @@ auto EventLoop::hasChannel(Channel* channel)
     return poller_->hasChannel(channel);
 }
 
+auto EventLoop::hasPendingTasks_()
+    -> bool
+{
+    auto _ = std::unique_lock<std::mutex>(mutex_);
+    return not pending_tasks_.empty();
+}
+
 void EventLoop::runPendingTasks_()
 {
     auto tasks             = std::vector<Task> {};
@@ -305,6 +407,17 @@ void EventLoop::runPendingTasks_()
     {
         auto _ = std::unique_lock<std::mutex>(mutex_);
         tasks.swap(pending_tasks_); // 交换的方式减少了锁的临界区范围 提升效率 同时避免了死锁 如果执行functor()在临界区内 且functor()中调用QueueInOwnerLoop()就会产生死锁
+        if (not tasks.empty())
+        {
+            auto since = pending_since_us_.exchange(0, std::memory_order_relaxed);
+            task_lag_us_.store(refreshNow().microSecondsSinceEpoch() - since, std::memory_order_relaxed);
+        }
+    }
+    if (not tasks.empty())
+    {
+        auto& metrics = loopMetrics();
+        metrics.tasks.Inc(tasks.size());
+        metrics.task_lag.Observe(static_cast<double>(task_lag_us_.load(std::memory_order_relaxed)) / 1e6);
     }
     std::ranges::for_each(tasks, [](const auto& task) {
         task();
@@ -312,6 +425,101 @@ void EventLoop::runPendingTasks_()
     calling_pending_tasks_ = false;
 }
 
+void EventLoop::notifyLinks_()
+{
+    if (not links_signalled_.exchange(true, std::memory_order_acq_rel))
+    {
+        wakeupOwnerThread_();
+    }
+}
+
+void EventLoop::runLinks_()
+{
+    for (auto* link : outbound_links_)
+    {
+        link->flushOverflow();
+    }
+    // the exchange pairs with the one of notifyLinks_(): what was posted before it is seen by the drain below
+    if (inbound_links_.empty() or not links_signalled_.exchange(false, std::memory_order_acq_rel))
+    {
+        return;
+    }
+    refreshNow();
+    for (auto* link : inbound_links_)
+    {
+        link->drain();
+    }
+}
+
+void EventLoop::attachLink_(LoopLink* link)
+{
+    assertInOwnerThread();
+    if (link->getFrom() == this)
+    {
+        outbound_links_.push_back(link);
+    }
+    if (link->getTo() == this)
+    {
+        inbound_links_.push_back(link);
+    }
+}
+
+void EventLoop::detachLink_(LoopLink* link)
+{
+    assertInOwnerThread();
+    std::erase(outbound_links_, link);
+    std::erase(inbound_links_, link);
+}
+
+auto EventLoop::getTaskLagSeconds() const
+    -> double
+{
+    auto lag   = task_lag_us_.load(std::memory_order_relaxed);
+    auto since = pending_since_us_.load(std::memory_order_relaxed);
+    if (since != 0)
+    {
+        lag = std::max(lag, readClock_().microSecondsSinceEpoch() - since);
+    }
+    return static_cast<double>(lag) / 1e6;
+}
+
+void EventLoop::setClockSource(ClockSource source)
+{
+    clock_source_.store(source, std::memory_order_relaxed);
+}
+
+auto EventLoop::readClock_() const
+    -> Timestamp
+{
+    return getClockSource() == ClockSource::Coarse ? Timestamp::nowCoarse() : Timestamp::now();
+}
+
+auto EventLoop::loopTimeOrClock_() const
+    -> Timestamp
+{
+    // the loop time is only kept up to date while looping, nor can another thread read it
+    return inOwnerThread() and looping_.load(std::memory_order_relaxed) ? cached_now_ : readClock_();
+}
+
+auto EventLoop::refreshNow()
+    -> Timestamp
+{
+    ++clock_reads_;
+    cached_now_ = readClock_();
+    return cached_now_;
+}
+
+auto EventLoop::getClockResolution() const
+    -> double
+{
+    if (getClockSource() == ClockSource::Coarse)
+    {
+        static const auto s_resolution = std::chrono::duration<double>(Cot::CoarseSystemClock::Resolution()).count();
+        return s_resolution;
+    }
+    return 1.0 / Timestamp::c_micro_seconds_per_second;
+}
+
 void EventLoop::AbortNotInLoopThread_() const
 {
     // todo
@@ -320,7 +528,7 @@ void EventLoop::AbortNotInLoopThread_() const
     //              << ", current thread id = " <<  CurrentThread::tid();
 }
 
-auto getEventLoopOfCurrentThread()
+auto EventLoop::getEventLoopOfCurrentThread()
     -> EventLoop*
 {
     return t_event_loop;
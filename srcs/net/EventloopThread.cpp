@@ -21,9 +21,9 @@ EventLoopThread::EventLoopThread()
 EventLoopThread::~EventLoopThread()
 {
     exiting_ = true;
-    if (loop_ != nullptr)
+    if (auto *loop = loop_.load(); loop != nullptr)
     {
-        loop_->quit();
+        loop->quit();
     }
 }
 
@@ -33,26 +33,17 @@ auto EventLoopThread::startLoop()
     thread_ = NamedJThread{getDefaultName_(),[this]() {
         this->threadFunc_();
     }};
-    auto st = thread_.getStopToken();
-
-    EventLoop *loop = nullptr;
-    {
-        while (!st.stop_requested())
-        {
-            // busy-waiting
-        }
-        loop = loop_;
-    }
-    return loop;
+    // thread_ is being assigned while the new thread starts, so it can't be used to signal the readiness
+    loop_.wait(nullptr);
+    return loop_.load();
 }
 
 // 下面这个方法 是在单独的新线程里运行的
 void EventLoopThread::threadFunc_()
 {
     EventLoop loop; // 1.在新线程的栈上创建 EventLoop 对象
-    loop_ = &loop;
-    thread_.getStopSource().request_stop();
-        // 通知 startLoop() 方法 可以返回了
+    loop_.store(&loop);
+    loop_.notify_one(); // 通知 startLoop() 方法 可以返回了
     loop.loop();
     // 4. 执行EventLoop的loop() 开启了底层的Poller的poll()
     
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/HotRestart.h"
+#include "net/SignalHandler.h"
+#include "net/TcpConnection.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+HotRestart::HotRestart(EventLoop* loop, InetAddress handoffAddr)
+    : loop_ {loop}
+    , handoff_addr_ {std::move(handoffAddr)}
+    , predecessor_pid_ {0}
+    , drain_signal_ {c_default_drain_signal}
+    , drain_timeout_seconds_ {c_default_drain_timeout_seconds}
+    , drained_callback_ {[loop] { loop->quit(); }}
+    , draining_ {false}
+    , servers_draining_ {0}
+{
+    assert(handoff_addr_.isUnix());
+}
+
+HotRestart::~HotRestart()
+{
+    for (const auto& [_, fd] : inherited_fds_)
+    {
+        ::close(fd);
+    }
+}
+
+auto HotRestart::inheritFromPredecessor(int timeoutMs)
+    -> bool
+{
+    auto sockfd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_SYSERR_FMT(log, "HotRestart::inheritFromPredecessor - socket");
+        return false;
+    }
+    // blocking, the loop isn't running yet
+    auto timeout = timeval {.tv_sec = timeoutMs / 1000, .tv_usec = (timeoutMs % 1000) * 1000};
+    ::setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    ::setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+    if (::connect(sockfd, handoff_addr_.getSockAddr(), handoff_addr_.getSockLen()) < 0)
+    {
+        // ENOENT, ECONNREFUSED: nobody to inherit from
+        LOG_INFO_FMT(log, "HotRestart::inheritFromPredecessor - no predecessor on {}, errno {}", handoff_addr_.toIpPortRepr(), errno);
+        ::close(sockfd);
+        return false;
+    }
+
+    auto buf = Buffer {};
+    auto fds = std::vector<int> {};
+    auto ok  = ::write(sockfd, c_handoff_request.data(), c_handoff_request.size()) == static_cast<ssize_t>(c_handoff_request.size());
+    while (ok and buf.findEol() == nullptr)
+    {
+        auto saved_errno = 0;
+        auto n           = buf.readFdWithRights(sockfd, &saved_errno, &fds);
+        if (n <= 0)
+        {
+            LOG_ERROR_FMT(log, "HotRestart::inheritFromPredecessor - handoff interrupted, errno {}", n < 0 ? saved_errno : 0);
+            ok = false;
+        }
+    }
+    ::close(sockfd);
+
+    // "<pid> <name>...\n", one fd per name
+    auto names = std::vector<std::string> {};
+    auto pid   = pid_t {0};
+    if (ok)
+    {
+        auto reply = std::string_view {buf.getReadableSV().data(), buf.findEol()};
+        auto pos   = reply.find(' ');
+        std::from_chars(reply.data(), reply.data() + std::min(pos, reply.size()), pid);
+        while (pos != std::string_view::npos)
+        {
+            auto next = reply.find(' ', pos + 1);
+            names.emplace_back(reply.substr(pos + 1, next == std::string_view::npos ? next : next - pos - 1));
+            pos = next;
+        }
+        ok = pid > 0 and names.size() == fds.size();
+    }
+    if (not ok)
+    {
+        LOG_ERROR_FMT(log, "HotRestart::inheritFromPredecessor - bad handoff reply, {} fds", fds.size());
+        std::ranges::for_each(fds, ::close);
+        return false;
+    }
+
+    predecessor_pid_ = pid;
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        inherited_fds_.emplace(std::move(names[i]), fds[i]);
+    }
+    LOG_INFO_FMT(log, "HotRestart::inheritFromPredecessor - {} listening sockets from pid {}", fds.size(), pid);
+    return true;
+}
+
+auto HotRestart::takeInheritedFd(const std::string& name)
+    -> int
+{
+    auto node = inherited_fds_.extract(name);
+    return node.empty() ? -1 : node.mapped();
+}
+
+auto HotRestart::makeServer(const InetAddress& listenAddr,
+                            std::string name,
+                            TcpServer::Option option)
+    -> std::shared_ptr<TcpServer>
+{
+    auto fd     = takeInheritedFd(name);
+    auto server = fd >= 0
+                      ? std::make_shared<TcpServer>(loop_, fd, std::move(name))
+                      : std::make_shared<TcpServer>(loop_, listenAddr, std::move(name), option);
+    addServer(server);
+    return server;
+}
+
+void HotRestart::addServer(std::shared_ptr<TcpServer> server)
+{
+    assert(server->getName() != c_handoff_fd_name and server->getName().find(' ') == std::string::npos);
+    servers_.push_back(std::move(server));
+}
+
+void HotRestart::watchSignal(SignalHandler& signals)
+{
+    signals.addSignal(drain_signal_, [this](int signo) {
+        LOG_INFO_FMT(log, "HotRestart - signal {}, draining", signo);
+        this->drain();
+    });
+}
+
+void HotRestart::start()
+{
+    loop_->assertInOwnerThread();
+    auto fd         = takeInheritedFd(std::string {c_handoff_fd_name});
+    handoff_server_ = fd >= 0
+                          ? std::make_shared<TcpServer>(loop_, fd, std::string {c_handoff_fd_name})
+                          : std::make_shared<TcpServer>(loop_, handoff_addr_, std::string {c_handoff_fd_name});
+    handoff_server_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        this->handoffMessageCB_(conn, buf);
+    });
+    handoff_server_->start();
+
+    for (const auto& [name, inherited_fd] : inherited_fds_)
+    {
+        LOG_WARN_FMT(log, "HotRestart::start - inherited socket of server {} not taken, closed", name);
+        ::close(inherited_fd);
+    }
+    inherited_fds_.clear();
+
+    if (predecessor_pid_ > 0)
+    {
+        LOG_INFO_FMT(log, "HotRestart::start - telling pid {} to drain", predecessor_pid_);
+        if (::kill(predecessor_pid_, drain_signal_) < 0)
+        {
+            LOG_SYSERR_FMT(log, "HotRestart::start - kill {}", predecessor_pid_);
+        }
+    }
+}
+
+void HotRestart::handoffMessageCB_(const TcpConnectionPtr& conn, Buffer& buf)
+{
+    const auto* eol = buf.findEol();
+    if (eol == nullptr)
+    {
+        return;
+    }
+    auto request = buf.readNAsString(static_cast<size_t>(eol - buf.getReadableSV().data()) + 1);
+    if (request != c_handoff_request)
+    {
+        LOG_WARN_FMT(log, "HotRestart - unknown request on the handoff socket");
+        conn->shutdown();
+        return;
+    }
+    handOff_(conn);
+}
+
+void HotRestart::handOff_(const TcpConnectionPtr& conn)
+{
+    auto reply = std::to_string(::getpid());
+    auto fds   = std::vector<int> {};
+    for (const auto& server : servers_)
+    {
+        reply.append(" ").append(server->getName());
+        fds.push_back(server->getListenFd());
+    }
+    reply.append(" ").append(c_handoff_fd_name).append("\n");
+    fds.push_back(handoff_server_->getListenFd());
+
+    LOG_INFO_FMT(log, "HotRestart - handing {} listening sockets over to {}", fds.size(), conn->getPeerAddress().toIpPortRepr());
+    conn->sendFds(reply, fds);
+    conn->shutdown();
+}
+
+void HotRestart::drain()
+{
+    loop_->assertInOwnerThread();
+    if (draining_)
+    {
+        return;
+    }
+    draining_         = true;
+    servers_draining_ = servers_.size() + (handoff_server_ != nullptr ? 1 : 0);
+    auto on_drained   = [this] { this->serverDrained_(); };
+    for (const auto& server : servers_)
+    {
+        server->drain(drain_timeout_seconds_, on_drained);
+    }
+    if (handoff_server_ != nullptr)
+    {
+        handoff_server_->drain(drain_timeout_seconds_, on_drained);
+    }
+    if (servers_draining_ == 0)
+    {
+        loop_->queueTask(drained_callback_);
+    }
+}
+
+void HotRestart::serverDrained_()
+{
+    assert(servers_draining_ > 0);
+    if (--servers_draining_ == 0)
+    {
+        LOG_INFO_FMT(log, "HotRestart - every server drained");
+        if (drained_callback_)
+        {
+            drained_callback_();
+        }
+    }
+}
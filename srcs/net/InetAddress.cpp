@@ -5,6 +5,7 @@
 // that can be found in the License file.
 
 // Author: Shuo Chen (chenshuo at chenshuo dot com)
+#include <algorithm>
 #include <array>
 
 #include "net/InetAddress.h"
@@ -91,9 +92,50 @@ InetAddress::InetAddress(std::string ip, uint16_t port, bool ipv6)
     }
 }
 
+auto InetAddress::fromUnixPath(std::string_view path)
+    -> InetAddress
+{
+    auto addr       = sockaddr_un {};
+    addr.sun_family = AF_UNIX;
+    // 超长的路径会被截断, 保留结尾的 '\0'
+    auto len = std::min(path.size(), sizeof(addr.sun_path) - 1);
+    ::memcpy(addr.sun_path, path.data(), len);
+    if (not path.empty() and path.front() == '@')
+    {
+        addr.sun_path[0] = '\0';
+    }
+    return InetAddress {addr};
+}
+
+auto InetAddress::getUnixPath() const
+    -> std::string
+{
+    if (not isUnix())
+    {
+        return {};
+    }
+    const auto& addr = std::get<sockaddr_un>(addr_);
+    if (addr.sun_path[0] != '\0')
+    {
+        return std::string(addr.sun_path, ::strnlen(addr.sun_path, sizeof(addr.sun_path)));
+    }
+    // abstract: the name is padded with '\0', see fromUnixPath
+    const auto* name = addr.sun_path + 1;
+    auto name_len    = ::strnlen(name, sizeof(addr.sun_path) - 1);
+    if (name_len == 0)
+    {
+        return {}; // unnamed, e.g. the peer of an accepted connection
+    }
+    return "@" + std::string(name, name_len);
+}
+
 auto InetAddress::toIpPortRepr() const
     -> std::string
 {
+    if (isUnix())
+    {
+        return "unix:" + getUnixPath();
+    }
     auto buf = std::array<char, 256> {};
     buf.fill('\0');
     Sock::toIpPortRepr(buf.data(), buf.size(), getSockAddr());
@@ -103,6 +145,10 @@ auto InetAddress::toIpPortRepr() const
 auto InetAddress::toIpRepr() const
     -> std::string
 {
+    if (isUnix())
+    {
+        return getUnixPath();
+    }
     auto buf = std::string(64, '\0');
     Sock::toIp(buf.data(), buf.length(), getSockAddr());
     return buf;
@@ -162,8 +208,9 @@ auto InetAddress::getSockAddr() const
 {
     if (addr_.index() == 0)
         return Sock::sockaddrCast<sockaddr>(&std::get<sockaddr_in>(addr_));
-
-    return Sock::sockaddrCast<sockaddr>(&std::get<sockaddr_in6>(addr_));
+    if (addr_.index() == 1)
+        return Sock::sockaddrCast<sockaddr>(&std::get<sockaddr_in6>(addr_));
+    return Sock::sockaddrCast<sockaddr>(&std::get<sockaddr_un>(addr_));
 }
 
 auto InetAddress::GetLocalInetAddress(int sockfd)
@@ -0,0 +1,120 @@
+#include <utility>
+#include <vector>
+
+#include "common/metrics.h"
+#include "net/LoopLink.h"
+
+namespace {
+
+struct LinkMetrics
+{
+    Cot::Counter& tasks;
+    Cot::Counter& overflows;
+};
+
+auto linkMetrics()
+    -> LinkMetrics&
+{
+    auto& registry      = Cot::MetricsRegistry::GetInstance();
+    static auto metrics = LinkMetrics {
+        .tasks     = registry.GetCounter("net_loop_link_tasks_total", "tasks handed between the loops of a pool over their rings"),
+        .overflows = registry.GetCounter("net_loop_link_overflows_total", "tasks kept aside by the posting loop, the ring to the other one was full"),
+    };
+    return metrics;
+}
+
+} // namespace
+
+LoopLink::LoopLink(EventLoop* from, EventLoop* to, size_t capacity)
+    : from_ {from}
+    , to_ {to}
+    , reverse_ {nullptr}
+    , ring_ {capacity}
+    , overflowed_ {false}
+{
+}
+
+void LoopLink::post(EventLoop::Task task, EventLoop::Task done)
+{
+    from_->assertInOwnerThread();
+    auto item = Item {.task = std::move(task), .done = std::move(done)};
+    if (overflow_.empty() and ring_.tryPush(item))
+    {
+        to_->notifyLinks_();
+        return;
+    }
+    linkMetrics().overflows.Inc();
+    overflow_.push_back(std::move(item));
+    flushOverflow();
+}
+
+void LoopLink::flushOverflow()
+{
+    if (overflow_.empty())
+    {
+        return;
+    }
+    auto pushed = false;
+    auto push   = [this, &pushed] {
+        while (not overflow_.empty() and ring_.tryPush(overflow_.front()))
+        {
+            overflow_.pop_front();
+            pushed = true;
+        }
+    };
+    push();
+    if (not overflow_.empty())
+    {
+        // a drain done before the flag is set has made room the second try sees, one done after it wakes this loop
+        overflowed_.exchange(true, std::memory_order_acq_rel);
+        push();
+    }
+    if (pushed)
+    {
+        to_->notifyLinks_();
+    }
+}
+
+auto LoopLink::drain()
+    -> size_t
+{
+    auto count       = size_t {0};
+    auto completions = std::vector<EventLoop::Task> {};
+    while (count < ring_.getCapacity())
+    {
+        auto item = ring_.tryPop();
+        if (not item)
+        {
+            break;
+        }
+        ++count;
+        item->task();
+        if (item->done)
+        {
+            completions.push_back(std::move(item->done));
+        }
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    linkMetrics().tasks.Inc(count);
+    if (overflowed_.exchange(false, std::memory_order_acq_rel))
+    {
+        from_->wakeupOwnerThread_();
+    }
+    if (count == ring_.getCapacity())
+    {
+        to_->notifyLinks_(); // more may be waiting, after the other channels and tasks
+    }
+    if (not completions.empty())
+    {
+        reverse_->post([completions = std::move(completions)] {
+            for (const auto& done : completions)
+            {
+                done();
+            }
+        });
+    }
+    return count;
+}
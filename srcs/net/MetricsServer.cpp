@@ -0,0 +1,73 @@
+#include <array>
+#include <format>
+#include <string_view>
+
+#include "common/metrics.h"
+#include "net/Buffer.h"
+#include "net/MetricsServer.h"
+#include "net/TcpConnection.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+// a request head longer than that is not a scrape
+constexpr size_t c_max_request_head = 8 * 1024;
+
+void respond(const TcpConnectionPtr& conn, std::string_view status, std::string_view contentType, std::string_view body)
+{
+    auto head = std::format("HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+                            status, contentType, body.size());
+    auto pieces = std::array<std::string_view, 2> {head, body};
+    conn->sendGathered(pieces);
+    conn->shutdown();
+}
+
+} // namespace
+
+MetricsServer::MetricsServer(EventLoop* loop, const InetAddress& listenAddr, std::string name)
+    : server_ {std::make_shared<TcpServer>(loop, listenAddr, std::move(name))}
+    , scrapes_ {Cot::MetricsRegistry::GetInstance().GetCounter("net_metrics_scrapes_total", "metrics requests answered")}
+{
+    server_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        this->onMessage_(conn, buf);
+    });
+}
+
+void MetricsServer::onMessage_(const TcpConnectionPtr& conn, Buffer& buf)
+{
+    auto request  = buf.getReadableSV();
+    auto head_end = request.find("\r\n\r\n");
+    if (head_end == std::string_view::npos)
+    {
+        if (request.size() > c_max_request_head)
+        {
+            buf.readAllAndDiscard();
+            respond(conn, "431 Request Header Fields Too Large", "text/plain", "");
+        }
+        return;
+    }
+
+    // request line: METHOD SP TARGET SP VERSION
+    auto line   = request.substr(0, request.find("\r\n"));
+    auto method = line.substr(0, line.find(' '));
+    auto target = line.substr(method.size() + (method.size() < line.size() ? 1 : 0));
+    target      = target.substr(0, target.find(' '));
+    buf.readAllAndDiscard();
+
+    if (method != "GET")
+    {
+        respond(conn, "405 Method Not Allowed", "text/plain", "");
+        return;
+    }
+    if (target != "/metrics")
+    {
+        respond(conn, "404 Not Found", "text/plain", "");
+        return;
+    }
+    scrapes_.Inc();
+    LOG_DEBUG_FMT(log, "MetricsServer - scrape from {}", conn->getPeerAddress().toIpPortRepr());
+    respond(conn, "200 OK", "text/plain; version=0.0.4; charset=utf-8", Cot::MetricsRegistry::GetInstance().RenderPrometheus());
+}
@@ -0,0 +1,267 @@
+#include <algorithm>
+
+#include "net/EventLoop.h"
+#include "net/PubSubHub.h"
+#include "net/TcpConnection.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+PubSubHub::PubSubHub(Options options)
+    : options_ {options}
+    , published_ {0}
+{
+}
+
+PubSubHub::~PubSubHub() = default;
+
+auto PubSubHub::shardOf_(EventLoop* loop)
+    -> LoopShard&
+{
+    {
+        auto _ = std::shared_lock<std::shared_mutex> {registry_mutex_};
+        if (auto it = shard_index_.find(loop); it != shard_index_.end())
+        {
+            return *shards_[it->second];
+        }
+    }
+    auto _     = std::unique_lock<std::shared_mutex> {registry_mutex_};
+    auto index = shard_index_.try_emplace(loop, shards_.size()).first->second;
+    if (index == shards_.size())
+    {
+        auto shard     = std::make_shared<LoopShard>();
+        shard->loop    = loop;
+        shard->index   = index;
+        shard->options = options_;
+        shards_.push_back(std::move(shard));
+        for (auto& [topic, counts] : topic_loops_)
+        {
+            counts.resize(shards_.size(), 0);
+        }
+    }
+    return *shards_[index];
+}
+
+void PubSubHub::countSubscriber_(const std::string& topic, size_t shard, bool added)
+{
+    auto _       = std::unique_lock<std::shared_mutex> {registry_mutex_};
+    auto& counts = topic_loops_[topic];
+    counts.resize(shards_.size(), 0);
+    if (added)
+    {
+        ++counts[shard];
+        return;
+    }
+    --counts[shard];
+    if (std::ranges::all_of(counts, [](auto count) { return count == 0; }))
+    {
+        topic_loops_.erase(topic);
+    }
+}
+
+auto PubSubHub::subscribe(const TcpConnectionPtr& conn, std::string_view topic)
+    -> bool
+{
+    conn->getLoop()->assertInOwnerThread();
+    auto& shard  = shardOf_(conn->getLoop());
+    auto& topics = shard.topics_of[conn.get()];
+    if (std::ranges::find(topics, topic) != topics.end())
+    {
+        return false;
+    }
+    if (topics.empty())
+    {
+        conn->pinLoop(); // the subscriptions live in the shard of this loop
+    }
+    topics.emplace_back(topic);
+    shard.subscribers[topics.back()].push_back(conn);
+    countSubscriber_(topics.back(), shard.index, true);
+    return true;
+}
+
+void PubSubHub::removeSubscriber_(LoopShard& shard, const TcpConnectionPtr& conn, const std::string& topic)
+{
+    auto it = shard.subscribers.find(topic);
+    if (auto sub = std::ranges::find(it->second, conn); sub != it->second.end())
+    {
+        *sub = std::move(it->second.back()); // the order of the subscribers doesn't matter
+        it->second.pop_back();
+    }
+    if (it->second.empty())
+    {
+        shard.subscribers.erase(it);
+    }
+    countSubscriber_(topic, shard.index, false);
+}
+
+auto PubSubHub::unsubscribe(const TcpConnectionPtr& conn, std::string_view topic)
+    -> bool
+{
+    conn->getLoop()->assertInOwnerThread();
+    auto& shard = shardOf_(conn->getLoop());
+    auto it     = shard.topics_of.find(conn.get());
+    if (it == shard.topics_of.end())
+    {
+        return false;
+    }
+    auto pos = std::ranges::find(it->second, topic);
+    if (pos == it->second.end())
+    {
+        return false;
+    }
+    auto name = std::move(*pos);
+    it->second.erase(pos);
+    if (it->second.empty())
+    {
+        shard.topics_of.erase(it);
+        conn->unpinLoop();
+    }
+    removeSubscriber_(shard, conn, name);
+    return true;
+}
+
+void PubSubHub::unsubscribeAll(const TcpConnectionPtr& conn)
+{
+    conn->getLoop()->assertInOwnerThread();
+    auto& shard = shardOf_(conn->getLoop());
+    auto topics = shard.topics_of.extract(conn.get());
+    if (topics.empty())
+    {
+        return;
+    }
+    conn->unpinLoop();
+    for (const auto& topic : topics.mapped())
+    {
+        removeSubscriber_(shard, conn, topic);
+    }
+}
+
+auto PubSubHub::publish(std::string_view topic, SharedPayload payload)
+    -> size_t
+{
+    auto publication = std::make_shared<const Publication>(Publication {.topic = std::string {topic}, .payload = std::move(payload)});
+    published_.fetch_add(1, std::memory_order_relaxed);
+
+    auto targets = std::vector<std::shared_ptr<LoopShard>> {};
+    {
+        auto _  = std::shared_lock<std::shared_mutex> {registry_mutex_};
+        auto it = topic_loops_.find(publication->topic);
+        if (it == topic_loops_.end())
+        {
+            return 0;
+        }
+        for (size_t i = 0; i < it->second.size(); ++i)
+        {
+            if (it->second[i] > 0)
+            {
+                targets.push_back(shards_[i]);
+            }
+        }
+    }
+
+    for (const auto& shard : targets)
+    {
+        auto wake = false;
+        {
+            auto _ = std::lock_guard<std::mutex> {shard->inbox_mutex};
+            shard->inbox.push_back(publication);
+            wake = not std::exchange(shard->drain_queued, true);
+        }
+        if (wake)
+        {
+            // not the hub nor the shard, the loop may outlive them
+            shard->loop->queueTask([weak = std::weak_ptr<LoopShard> {shard}] {
+                if (auto alive = weak.lock())
+                {
+                    drainInbox_(*alive);
+                }
+            });
+        }
+    }
+    return targets.size();
+}
+
+void PubSubHub::drainInbox_(LoopShard& shard)
+{
+    {
+        auto _ = std::lock_guard<std::mutex> {shard.inbox_mutex};
+        std::swap(shard.inbox, shard.draining);
+        shard.drain_queued = false;
+    }
+    shard.loop_batches.fetch_add(1, std::memory_order_relaxed);
+    for (const auto& publication : shard.draining)
+    {
+        deliver_(shard, *publication);
+    }
+    shard.draining.clear(); // keeps the capacity for the next batch
+}
+
+void PubSubHub::deliver_(LoopShard& shard, const Publication& publication)
+{
+    auto it = shard.subscribers.find(publication.topic);
+    if (it == shard.subscribers.end())
+    {
+        return;
+    }
+    auto payload    = std::string_view {*publication.payload};
+    auto deliveries = uint64_t {0};
+    auto dropped    = uint64_t {0};
+    for (const auto& conn : it->second)
+    {
+        if (not conn->isConnected())
+        {
+            continue; // closing, unsubscribeAll is on its way
+        }
+        if (conn->getOutputBufferedBytes() + payload.size() > shard.options.max_pending_bytes)
+        {
+            if (shard.options.policy == Policy::Disconnect)
+            {
+                LOG_WARN_FMT(log, "PubSubHub - disconnecting slow subscriber {}, {} bytes pending", conn->getName(), conn->getOutputBufferedBytes());
+                shard.disconnected.fetch_add(1, std::memory_order_relaxed);
+                conn->forceClose(); // queued, the subscriber list is not modified under our feet
+            }
+            else
+            {
+                ++dropped;
+            }
+            continue;
+        }
+        conn->sendShared(publication.payload);
+        ++deliveries;
+    }
+    shard.deliveries.fetch_add(deliveries, std::memory_order_relaxed);
+    shard.dropped.fetch_add(dropped, std::memory_order_relaxed);
+}
+
+auto PubSubHub::getSubscriberCount(std::string_view topic) const
+    -> size_t
+{
+    auto _  = std::shared_lock<std::shared_mutex> {registry_mutex_};
+    auto it = topic_loops_.find(std::string {topic});
+    if (it == topic_loops_.end())
+    {
+        return 0;
+    }
+    auto count = size_t {0};
+    for (auto n : it->second)
+    {
+        count += n;
+    }
+    return count;
+}
+
+auto PubSubHub::getStats() const
+    -> Stats
+{
+    auto stats = Stats {.published = published_.load(std::memory_order_relaxed)};
+    auto _     = std::shared_lock<std::shared_mutex> {registry_mutex_};
+    for (const auto& shard : shards_)
+    {
+        stats.loop_batches += shard->loop_batches.load(std::memory_order_relaxed);
+        stats.deliveries += shard->deliveries.load(std::memory_order_relaxed);
+        stats.dropped += shard->dropped.load(std::memory_order_relaxed);
+        stats.disconnected += shard->disconnected.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
@@ -0,0 +1,40 @@
+#include <algorithm>
+#include <chrono>
+
+#include "net/RateLimit.h"
+
+TokenBucket::TokenBucket(RateLimit limit)
+    : ns_per_token_ {1e9 / limit.rate}
+    , burst_ns_ {static_cast<int64_t>(std::max(limit.burst, 1.0) * 1e9 / limit.rate)}
+    , full_at_ns_ {0}
+{
+}
+
+auto TokenBucket::nowNs_()
+    -> int64_t
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+auto TokenBucket::consume(double tokens)
+    -> double
+{
+    auto now     = nowNs_();
+    auto cost    = static_cast<int64_t>(tokens * ns_per_token_);
+    auto full_at = full_at_ns_.load(std::memory_order_relaxed);
+    auto next    = int64_t {0};
+    do
+    {
+        // a bucket full for a while doesn't save up more than the burst
+        next = std::max(full_at, now) + cost;
+    } while (not full_at_ns_.compare_exchange_weak(full_at, next, std::memory_order_relaxed));
+    auto debt = next - now - burst_ns_;
+    return debt > 0 ? static_cast<double>(debt) / 1e9 : 0.0;
+}
+
+auto TokenBucket::getWaitSeconds() const
+    -> double
+{
+    auto debt = full_at_ns_.load(std::memory_order_relaxed) - nowNs_() - burst_ns_;
+    return debt > 0 ? static_cast<double>(debt) / 1e9 : 0.0;
+}
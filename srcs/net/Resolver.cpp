@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <netdb.h>
+#include <ranges>
+#include <sys/socket.h>
+
+#include "net/Resolver.h"
+#include "net/EventLoop.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+class GaiErrcCategory : public std::error_category {
+    [[nodiscard]] auto name() const noexcept
+        -> const char* override
+    {
+        return "getaddrinfo";
+    }
+
+    [[nodiscard]] auto message(int ev) const
+        -> std::string override
+    {
+        return ::gai_strerror(ev);
+    }
+};
+
+} // namespace
+
+auto gaiErrorCategory()
+    -> const std::error_category&
+{
+    static auto s_category = GaiErrcCategory {};
+    return s_category;
+}
+
+Resolver::Resolver(int numThreads)
+    : cache_ttl_ {c_default_cache_ttl}
+    , negative_ttl_ {c_default_negative_ttl}
+{
+    numThreads = std::max(numThreads, 1);
+    workers_.reserve(numThreads);
+    for (auto i : std::views::iota(0, numThreads))
+    {
+        workers_.emplace_back(std::format("Resolver-{}", i), [this](std::stop_token st) {
+            this->workerFunc_(st);
+        });
+    }
+}
+
+Resolver::~Resolver()
+{
+    std::ranges::for_each(workers_, [](auto& worker) {
+        worker.requestStop();
+    });
+    cond_.notify_all();
+    // NamedJThread joins in its destructor
+}
+
+auto Resolver::makeKey_(const std::string& hostname, uint16_t port, bool ipv6)
+    -> std::string
+{
+    return std::format("{}:{}{}", hostname, port, ipv6 ? "/6" : "");
+}
+
+void Resolver::resolve(std::string hostname, uint16_t port, EventLoop* loop, ResolveCallback cb, bool ipv6)
+{
+    auto key = makeKey_(hostname, port, ipv6);
+    {
+        auto _ = std::unique_lock<std::mutex> {mutex_};
+        if (auto it = cache_.find(key); it != cache_.end())
+        {
+            if (Clock::now() < it->second.expire_at)
+            {
+                auto result = it->second.result;
+                _.unlock();
+                deliver_(loop, std::move(cb), std::move(result));
+                return;
+            }
+            cache_.erase(it);
+        }
+
+        auto& waiters = inflight_[key];
+        waiters.push_back(Waiter {loop, std::move(cb)});
+        if (waiters.size() > 1) // 已经有线程在解析同一个 key
+        {
+            return;
+        }
+        requests_.push_back(Request {std::move(hostname), port, ipv6});
+    }
+    cond_.notify_one();
+}
+
+auto Resolver::lookupCache(const std::string& hostname, uint16_t port, bool ipv6) const
+    -> std::optional<ResolveResult>
+{
+    auto key = makeKey_(hostname, port, ipv6);
+    auto _   = std::lock_guard<std::mutex> {mutex_};
+    if (auto it = cache_.find(key); it != cache_.end() and Clock::now() < it->second.expire_at)
+    {
+        return it->second.result;
+    }
+    return std::nullopt;
+}
+
+void Resolver::setCacheTtl(double seconds)
+{
+    auto _     = std::lock_guard<std::mutex> {mutex_};
+    cache_ttl_ = std::chrono::duration<double> {seconds};
+}
+
+void Resolver::setNegativeTtl(double seconds)
+{
+    auto _        = std::lock_guard<std::mutex> {mutex_};
+    negative_ttl_ = std::chrono::duration<double> {seconds};
+}
+
+void Resolver::clearCache()
+{
+    auto _ = std::lock_guard<std::mutex> {mutex_};
+    cache_.clear();
+}
+
+void Resolver::setLookupFunction(LookupFunction lookup)
+{
+    auto _  = std::lock_guard<std::mutex> {mutex_};
+    lookup_ = std::move(lookup);
+}
+
+void Resolver::workerFunc_(std::stop_token st)
+{
+    while (not st.stop_requested())
+    {
+        auto request = Request {};
+        auto lookup  = LookupFunction {};
+        {
+            auto lock = std::unique_lock<std::mutex> {mutex_};
+            if (not cond_.wait(lock, st, [this] { return not requests_.empty(); }))
+            {
+                return; // stop requested
+            }
+            request = std::move(requests_.front());
+            requests_.pop_front();
+            lookup = lookup_;
+        }
+
+        auto result = lookup ? lookup(request.hostname, request.port, request.ipv6) : doResolve_(request);
+        auto key    = makeKey_(request.hostname, request.port, request.ipv6);
+
+        auto waiters = std::vector<Waiter> {};
+        {
+            auto _ = std::lock_guard<std::mutex> {mutex_};
+            auto ttl = result.has_value() ? cache_ttl_ : negative_ttl_;
+            cache_[key] = CacheEntry {result, Clock::now() + std::chrono::duration_cast<Clock::duration>(ttl)};
+            if (auto it = inflight_.find(key); it != inflight_.end())
+            {
+                waiters.swap(it->second);
+                inflight_.erase(it);
+            }
+        }
+        for (auto& waiter : waiters)
+        {
+            deliver_(waiter.loop, std::move(waiter.callback), result);
+        }
+    }
+}
+
+auto Resolver::doResolve_(const Request& request)
+    -> ResolveResult
+{
+    auto hints        = addrinfo {};
+    hints.ai_family   = request.ipv6 ? AF_INET6 : AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    auto port_str  = std::to_string(request.port);
+    addrinfo* head = nullptr;
+    auto ret       = ::getaddrinfo(request.hostname.c_str(), port_str.c_str(), &hints, &head);
+    if (ret != 0)
+    {
+        LOG_WARN_FMT(log, "Resolver - resolve {} failed: {}", request.hostname, ::gai_strerror(ret));
+        if (ret == EAI_SYSTEM)
+        {
+            return std::unexpected {std::error_code {errno, std::system_category()}};
+        }
+        return std::unexpected {std::error_code {ret, gaiErrorCategory()}};
+    }
+
+    auto addrs = AddressList {};
+    for (auto* ai = head; ai != nullptr; ai = ai->ai_next)
+    {
+        if (ai->ai_family == AF_INET or ai->ai_family == AF_INET6)
+        {
+            addrs.emplace_back(ai->ai_addr);
+        }
+    }
+    ::freeaddrinfo(head);
+    LOG_DEBUG_FMT(log, "Resolver - {} resolved to {} addresses", request.hostname, addrs.size());
+    if (addrs.empty())
+    {
+        return std::unexpected {std::error_code {EAI_NONAME, gaiErrorCategory()}};
+    }
+    return addrs;
+}
+
+void Resolver::deliver_(EventLoop* loop, ResolveCallback cb, ResolveResult result)
+{
+    // queueTask rather than runTask for a cache hit in the loop thread, so that the callback never reenters the caller
+    loop->queueTask([cb = std::move(cb), result = std::move(result)] {
+        cb(result);
+    });
+}
@@ -0,0 +1,443 @@
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <limits>
+
+#include "net/Buffer.h"
+#include "net/Resp.h"
+
+namespace {
+
+template <typename Number>
+auto parseNumber(std::string_view text, Number& value)
+    -> bool
+{
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return not text.empty() and ec == std::errc {} and end == text.data() + text.size();
+}
+
+/**
+ * @brief "<prefix><number>\r\n", the header of most RESP values
+ */
+void appendHeader(std::string& out, char prefix, int64_t number)
+{
+    auto digits = std::array<char, 24> {};
+    auto* end   = std::to_chars(digits.begin(), digits.end(), number).ptr;
+    out.push_back(prefix);
+    out.append(digits.data(), end);
+    out.append("\r\n");
+}
+
+} // namespace
+
+auto respErrorToString(RespError error)
+    -> std::string_view
+{
+    switch (error)
+    {
+        case RespError::Protocol:
+            return "Protocol error";
+        case RespError::TooLarge:
+            return "Protocol error: too large";
+        case RespError::TooDeep:
+            return "Protocol error: nested too deep";
+    }
+    return "Protocol error";
+}
+
+/* ======================== RespParser ======================== */
+
+RespParser::RespParser()
+    : bulk_len_ {-1}
+    , bulk_type_ {RespType::BulkString}
+    , max_line_ {c_default_max_line}
+    , max_bulk_ {c_default_max_bulk}
+    , max_elements_ {c_default_max_elements}
+    , max_depth_ {c_default_max_depth}
+{
+}
+
+void RespParser::reset()
+{
+    stack_.clear();
+    bulk_len_ = -1;
+}
+
+auto RespParser::complete_(RespValue value)
+    -> std::optional<RespValue>
+{
+    while (not stack_.empty())
+    {
+        auto& frame = stack_.back();
+        frame.value.elements.push_back(std::move(value));
+        if (--frame.remaining > 0)
+        {
+            return std::nullopt;
+        }
+        auto attribute = frame.attribute;
+        value          = std::move(frame.value);
+        stack_.pop_back();
+        if (attribute)
+        {
+            return std::nullopt; // it annotates the next value, which is not counted as an element by itself
+        }
+    }
+    return value;
+}
+
+auto RespParser::parseLine_(std::string_view line)
+    -> std::expected<std::optional<RespValue>, RespError>
+{
+    if (line.empty())
+    {
+        if (stack_.empty())
+        {
+            return std::nullopt; // an empty inline command
+        }
+        return std::unexpected {RespError::Protocol};
+    }
+
+    auto body = line.substr(1);
+    auto type = static_cast<RespType>(line[0]);
+    switch (line[0])
+    {
+        case '+':
+        case '-':
+        case '(':
+            return RespValue {.type = type, .str = std::string {body}};
+        case ':':
+        {
+            auto value = RespValue {.type = type};
+            if (not parseNumber(body, value.integer))
+            {
+                return std::unexpected {RespError::Protocol};
+            }
+            return value;
+        }
+        case '#':
+            if (body != "t" and body != "f")
+            {
+                return std::unexpected {RespError::Protocol};
+            }
+            return RespValue {.type = type, .integer = body == "t" ? 1 : 0};
+        case ',':
+        {
+            auto value = RespValue {.type = type};
+            if (body == "inf" or body == "-inf" or body == "nan")
+            {
+                value.number = body == "nan"   ? std::numeric_limits<double>::quiet_NaN()
+                               : body == "inf" ? std::numeric_limits<double>::infinity()
+                                               : -std::numeric_limits<double>::infinity();
+            }
+            else if (not parseNumber(body, value.number))
+            {
+                return std::unexpected {RespError::Protocol};
+            }
+            return value;
+        }
+        case '_':
+            return RespValue {.type = RespType::Null};
+        case '$':
+        case '!':
+        case '=':
+        {
+            auto len = int64_t {0};
+            if (not parseNumber(body, len) or len < -1 or (len == -1 and line[0] != '$'))
+            {
+                return std::unexpected {RespError::Protocol};
+            }
+            if (len == -1)
+            {
+                return RespValue {.type = RespType::Null};
+            }
+            if (len > max_bulk_)
+            {
+                return std::unexpected {RespError::TooLarge};
+            }
+            bulk_len_  = len;
+            bulk_type_ = type;
+            return std::nullopt;
+        }
+        case '*':
+        case '%':
+        case '~':
+        case '>':
+        case '|':
+        {
+            auto count = int64_t {0};
+            if (not parseNumber(body, count) or count < -1 or (count == -1 and line[0] != '*'))
+            {
+                return std::unexpected {RespError::Protocol};
+            }
+            if (count == -1)
+            {
+                return RespValue {.type = RespType::Null};
+            }
+            auto attribute = line[0] == '|';
+            auto pairs     = line[0] == '%' or attribute;
+            // compared before doubling, a huge pair count would overflow
+            if (count > (pairs ? max_elements_ / 2 : max_elements_))
+            {
+                return std::unexpected {RespError::TooLarge};
+            }
+            count *= pairs ? 2 : 1;
+            if (count == 0)
+            {
+                if (attribute)
+                {
+                    return std::nullopt;
+                }
+                return RespValue {.type = type};
+            }
+            if (stack_.size() >= max_depth_)
+            {
+                return std::unexpected {RespError::TooDeep};
+            }
+            auto& frame = stack_.emplace_back(Frame {.value = RespValue {.type = attribute ? RespType::Map : type},
+                                                     .remaining = count,
+                                                     .attribute = attribute});
+            frame.value.elements.reserve(static_cast<size_t>(std::min<int64_t>(count, 1024)));
+            return std::nullopt;
+        }
+        default:
+            break;
+    }
+
+    if (not stack_.empty())
+    {
+        return std::unexpected {RespError::Protocol};
+    }
+    // inline command
+    auto command = RespValue {.type = RespType::Array};
+    auto pos     = line.find_first_not_of(' ');
+    while (pos != std::string_view::npos)
+    {
+        auto end = line.find(' ', pos);
+        command.elements.push_back(RespValue {.type = RespType::BulkString,
+                                              .str  = std::string {line.substr(pos, end == std::string_view::npos ? end : end - pos)}});
+        pos = line.find_first_not_of(' ', end);
+    }
+    if (command.elements.empty())
+    {
+        return std::nullopt;
+    }
+    return command;
+}
+
+auto RespParser::parse(Buffer& buf)
+    -> std::expected<std::optional<RespValue>, RespError>
+{
+    while (true)
+    {
+        if (bulk_len_ >= 0)
+        {
+            auto len = static_cast<size_t>(bulk_len_);
+            if (buf.getReadableBytesCount() < len + 2)
+            {
+                return std::nullopt;
+            }
+            auto data = buf.getReadableSV();
+            if (data.substr(len, 2) != "\r\n")
+            {
+                return std::unexpected {RespError::Protocol};
+            }
+            auto value = RespValue {.type = bulk_type_, .str = std::string {data.substr(0, len)}};
+            buf.readNAndDiscard(len + 2);
+            bulk_len_ = -1;
+            if (auto done = complete_(std::move(value)); done.has_value())
+            {
+                return done;
+            }
+            continue;
+        }
+
+        const auto* crlf = reinterpret_cast<const char*>(buf.findCrLf());
+        if (crlf == nullptr)
+        {
+            if (buf.getReadableBytesCount() > max_line_)
+            {
+                return std::unexpected {RespError::TooLarge};
+            }
+            return std::nullopt;
+        }
+        auto line = std::string_view {buf.getReadableSV().data(), crlf};
+        if (line.size() > max_line_)
+        {
+            return std::unexpected {RespError::TooLarge};
+        }
+        auto value = parseLine_(line);
+        buf.readNAndDiscard(line.size() + 2);
+        if (not value.has_value())
+        {
+            return std::unexpected {value.error()};
+        }
+        if (value->has_value())
+        {
+            if (auto done = complete_(std::move(**value)); done.has_value())
+            {
+                return done;
+            }
+        }
+    }
+}
+
+/* ======================== RespWriter ======================== */
+
+void RespWriter::appendCommand(std::span<const std::string_view> args)
+{
+    appendHeader(buf_, '*', static_cast<int64_t>(args.size()));
+    for (auto arg : args)
+    {
+        appendBulkString(arg);
+    }
+}
+
+void RespWriter::appendSimpleString(std::string_view str)
+{
+    buf_.push_back('+');
+    buf_.append(str);
+    buf_.append("\r\n");
+}
+
+void RespWriter::appendError(std::string_view message)
+{
+    buf_.push_back('-');
+    buf_.append(message);
+    buf_.append("\r\n");
+}
+
+void RespWriter::appendInteger(int64_t value)
+{
+    appendHeader(buf_, ':', value);
+}
+
+void RespWriter::appendBulkString(std::string_view str)
+{
+    appendHeader(buf_, '$', static_cast<int64_t>(str.size()));
+    buf_.append(str);
+    buf_.append("\r\n");
+}
+
+void RespWriter::appendNull()
+{
+    buf_.append(protocol_ >= 3 ? "_\r\n" : "$-1\r\n");
+}
+
+void RespWriter::appendBoolean(bool value)
+{
+    if (protocol_ >= 3)
+    {
+        buf_.append(value ? "#t\r\n" : "#f\r\n");
+        return;
+    }
+    appendInteger(value ? 1 : 0);
+}
+
+void RespWriter::appendDouble(double value)
+{
+    auto digits = std::array<char, 32> {};
+    auto* end   = std::to_chars(digits.begin(), digits.end(), value).ptr;
+    auto text   = std::string_view {digits.data(), end};
+    if (protocol_ >= 3)
+    {
+        buf_.push_back(',');
+        buf_.append(text);
+        buf_.append("\r\n");
+        return;
+    }
+    appendBulkString(text);
+}
+
+void RespWriter::appendArrayHeader(size_t count)
+{
+    appendHeader(buf_, '*', static_cast<int64_t>(count));
+}
+
+void RespWriter::appendMapHeader(size_t count)
+{
+    if (protocol_ >= 3)
+    {
+        appendHeader(buf_, '%', static_cast<int64_t>(count));
+        return;
+    }
+    appendHeader(buf_, '*', static_cast<int64_t>(count * 2));
+}
+
+void RespWriter::appendSetHeader(size_t count)
+{
+    appendHeader(buf_, protocol_ >= 3 ? '~' : '*', static_cast<int64_t>(count));
+}
+
+void RespWriter::appendValue(const RespValue& value)
+{
+    switch (value.type)
+    {
+        case RespType::SimpleString:
+            appendSimpleString(value.str);
+            return;
+        case RespType::Error:
+            appendError(value.str);
+            return;
+        case RespType::Integer:
+            appendInteger(value.integer);
+            return;
+        case RespType::BulkString:
+            appendBulkString(value.str);
+            return;
+        case RespType::Null:
+            appendNull();
+            return;
+        case RespType::Boolean:
+            appendBoolean(value.integer != 0);
+            return;
+        case RespType::Double:
+            appendDouble(value.number);
+            return;
+        case RespType::BigNumber:
+            if (protocol_ >= 3)
+            {
+                buf_.push_back('(');
+                buf_.append(value.str);
+                buf_.append("\r\n");
+                return;
+            }
+            appendBulkString(value.str);
+            return;
+        case RespType::BulkError:
+            if (protocol_ >= 3)
+            {
+                appendHeader(buf_, '!', static_cast<int64_t>(value.str.size()));
+                buf_.append(value.str);
+                buf_.append("\r\n");
+                return;
+            }
+            appendError(value.str);
+            return;
+        case RespType::VerbatimString:
+            if (protocol_ >= 3)
+            {
+                appendHeader(buf_, '=', static_cast<int64_t>(value.str.size()));
+                buf_.append(value.str);
+                buf_.append("\r\n");
+                return;
+            }
+            appendBulkString(std::string_view {value.str}.substr(std::min<size_t>(value.str.size(), 4))); // "txt:"
+            return;
+        case RespType::Map:
+            appendMapHeader(value.elements.size() / 2);
+            break;
+        case RespType::Set:
+            appendSetHeader(value.elements.size());
+            break;
+        case RespType::Push:
+            appendHeader(buf_, protocol_ >= 3 ? '>' : '*', static_cast<int64_t>(value.elements.size()));
+            break;
+        case RespType::Array:
+            appendArrayHeader(value.elements.size());
+            break;
+    }
+    for (const auto& element : value.elements)
+    {
+        appendValue(element);
+    }
+}
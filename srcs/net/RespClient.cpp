@@ -0,0 +1,150 @@
+#include <string>
+#include <vector>
+
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/RespClient.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+RespClient::RespClient(EventLoop* loop, const InetAddress& serverAddr, std::string name)
+    : loop_ {loop}
+    , client_ {std::make_shared<TcpClient>(loop, serverAddr, std::move(name))}
+    , flush_queued_ {false}
+    , writes_ {0}
+{
+    client_->setConnetionCallback([this](const TcpConnectionPtr& conn) { this->onConnection_(conn); });
+    client_->setConnectionCloseCallback([this](const TcpConnectionPtr& conn) { this->onClose_(conn); });
+    client_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        this->onMessage_(conn, buf);
+    });
+}
+
+RespClient::RespClient(EventLoop* loop, std::string host, uint16_t port, std::string name)
+    : loop_ {loop}
+    , client_ {std::make_shared<TcpClient>(loop, std::move(host), port, std::move(name))}
+    , flush_queued_ {false}
+    , writes_ {0}
+{
+    client_->setConnetionCallback([this](const TcpConnectionPtr& conn) { this->onConnection_(conn); });
+    client_->setConnectionCloseCallback([this](const TcpConnectionPtr& conn) { this->onClose_(conn); });
+    client_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        this->onMessage_(conn, buf);
+    });
+}
+
+RespClient::~RespClient() = default;
+
+void RespClient::connect()
+{
+    client_->connect();
+}
+
+void RespClient::disconnect()
+{
+    client_->disconnect();
+}
+
+void RespClient::command(std::span<const std::string_view> args, RespReplyCallback cb)
+{
+    if (loop_->inOwnerThread())
+    {
+        commandInOwnerLoop_(args, std::move(cb));
+        return;
+    }
+    loop_->runTask([this, copied = std::vector<std::string>(args.begin(), args.end()), cb = std::move(cb)]() mutable {
+        auto views = std::vector<std::string_view>(copied.begin(), copied.end());
+        this->commandInOwnerLoop_(views, std::move(cb));
+    });
+}
+
+void RespClient::commandInOwnerLoop_(std::span<const std::string_view> args, RespReplyCallback cb)
+{
+    loop_->assertInOwnerThread();
+    out_.appendCommand(args);
+    pending_.push_back(std::move(cb));
+    if (conn_ != nullptr and not flush_queued_)
+    {
+        // after the events of this iteration, which may issue more commands
+        flush_queued_ = true;
+        loop_->queueTask([this] { this->flush_(); });
+    }
+}
+
+void RespClient::flush_()
+{
+    flush_queued_ = false;
+    if (conn_ == nullptr or out_.empty())
+    {
+        return;
+    }
+    conn_->send(out_.getBuffer());
+    out_.clear();
+    ++writes_;
+}
+
+void RespClient::failPending_(std::string_view reason)
+{
+    auto pending = std::exchange(pending_, {});
+    for (auto& cb : pending)
+    {
+        cb(RespValue {.type = RespType::Error, .str = std::string {reason}});
+    }
+}
+
+void RespClient::onConnection_(const TcpConnectionPtr& conn)
+{
+    if (conn->isConnected())
+    {
+        conn->setTcpNoDelay(true);
+        conn_ = conn;
+        parser_.reset();
+        flush_(); // the commands issued while connecting
+    }
+    if (connection_callback_)
+    {
+        connection_callback_(conn);
+    }
+}
+
+void RespClient::onClose_(const TcpConnectionPtr& conn)
+{
+    conn_.reset();
+    out_.clear();
+    failPending_("ERR connection closed");
+    if (connection_callback_)
+    {
+        connection_callback_(conn);
+    }
+}
+
+void RespClient::onMessage_(const TcpConnectionPtr& conn, Buffer& buf)
+{
+    while (true)
+    {
+        auto value = parser_.parse(buf);
+        if (not value.has_value())
+        {
+            LOG_ERROR_FMT(log, "RespClient::onMessage_ - {} from {}", respErrorToString(value.error()), conn->getPeerAddress().toIpPortRepr());
+            buf.readAllAndDiscard();
+            conn->forceClose();
+            return;
+        }
+        if (not value->has_value())
+        {
+            return;
+        }
+        if ((*value)->type == RespType::Push or pending_.empty())
+        {
+            LOG_DEBUG_FMT(log, "RespClient::onMessage_ - out of band reply dropped");
+            continue;
+        }
+        auto cb = std::move(pending_.front());
+        pending_.pop_front();
+        cb(std::move(**value));
+    }
+}
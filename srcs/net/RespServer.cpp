@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <any>
+#include <cctype>
+#include <format>
+#include <vector>
+
+#include "net/Buffer.h"
+#include "net/RespServer.h"
+#include "net/TcpConnection.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+// only used inside a message callback, one per loop thread
+thread_local RespWriter t_reply;
+thread_local std::vector<std::string_view> t_args;
+thread_local std::string t_name;
+
+auto toLower(std::string_view name, std::string& out)
+    -> const std::string&
+{
+    out.assign(name);
+    std::ranges::transform(out, out.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return out;
+}
+
+} // namespace
+
+RespServer::RespServer(EventLoop* loop, const InetAddress& listenAddr, std::string name)
+    : server_ {std::make_shared<TcpServer>(loop, listenAddr, std::move(name))}
+    , commands_processed_ {0}
+{
+    registerBuiltins_();
+    server_->setConnectionEstablishedCallback([this](const TcpConnectionPtr& conn) {
+        this->onConnection_(conn);
+    });
+    server_->setMessageCallback([this](const TcpConnectionPtr& conn, Buffer& buf, Timestamp receiveTime) {
+        this->onMessage_(conn, buf, receiveTime);
+    });
+}
+
+void RespServer::registerCommand(std::string_view name, RespCommandHandler handler)
+{
+    auto key = std::string {};
+    commands_[toLower(name, key)] = std::move(handler);
+}
+
+void RespServer::registerBuiltins_()
+{
+    registerCommand("ping", [](const TcpConnectionPtr&, std::span<const std::string_view> args, RespWriter& reply) {
+        if (args.size() > 2)
+        {
+            reply.appendError("ERR wrong number of arguments for 'ping' command");
+        }
+        else if (args.size() == 2)
+        {
+            reply.appendBulkString(args[1]);
+        }
+        else
+        {
+            reply.appendSimpleString("PONG");
+        }
+    });
+    registerCommand("echo", [](const TcpConnectionPtr&, std::span<const std::string_view> args, RespWriter& reply) {
+        if (args.size() != 2)
+        {
+            reply.appendError("ERR wrong number of arguments for 'echo' command");
+            return;
+        }
+        reply.appendBulkString(args[1]);
+    });
+    registerCommand("command", [](const TcpConnectionPtr&, std::span<const std::string_view>, RespWriter& reply) {
+        reply.appendArrayHeader(0); // no command docs, clients cope with an empty table
+    });
+}
+
+void RespServer::onConnection_(const TcpConnectionPtr& conn)
+{
+    conn->setTcpNoDelay(true);
+    conn->setContext(std::make_shared<Session>());
+}
+
+void RespServer::onMessage_(const TcpConnectionPtr& conn, Buffer& buf, Timestamp)
+{
+    auto& session = *std::any_cast<const std::shared_ptr<Session>&>(conn->getContext());
+    auto& reply   = t_reply;
+    auto& args    = t_args;
+    reply.clear();
+    reply.setProtocol(session.protocol);
+
+    while (not session.closing)
+    {
+        auto value = session.parser.parse(buf);
+        if (not value.has_value())
+        {
+            reply.appendError(std::format("ERR {}", respErrorToString(value.error())));
+            session.closing = true;
+            break;
+        }
+        if (not value->has_value())
+        {
+            break;
+        }
+        auto& command = **value;
+        args.clear();
+        if (command.type == RespType::Array)
+        {
+            for (const auto& element : command.elements)
+            {
+                if (element.type != RespType::BulkString and element.type != RespType::SimpleString)
+                {
+                    args.clear();
+                    break;
+                }
+                args.push_back(element.str);
+            }
+        }
+        if (args.empty())
+        {
+            reply.appendError("ERR Protocol error: expected an array of bulk strings");
+            session.closing = true;
+            break;
+        }
+        commands_processed_.fetch_add(1, std::memory_order_relaxed);
+        dispatch_(conn, session, args, reply);
+    }
+
+    if (not reply.empty())
+    {
+        conn->send(reply.getBuffer());
+    }
+    if (session.closing)
+    {
+        buf.readAllAndDiscard();
+        conn->shutdown();
+    }
+}
+
+void RespServer::dispatch_(const TcpConnectionPtr& conn,
+                           Session& session,
+                           std::span<const std::string_view> args,
+                           RespWriter& reply)
+{
+    const auto& name = toLower(args[0], t_name);
+    if (auto it = commands_.find(name); it != commands_.end())
+    {
+        it->second(conn, args, reply);
+        return;
+    }
+
+    if (name == "hello")
+    {
+        // HELLO [protover [AUTH username password] [SETNAME clientname]], only the version is honoured
+        auto protocol = session.protocol;
+        if (args.size() >= 2)
+        {
+            if (args[1] != "2" and args[1] != "3")
+            {
+                reply.appendError("NOPROTO unsupported protocol version");
+                return;
+            }
+            protocol = args[1][0] - '0';
+        }
+        session.protocol = protocol;
+        reply.setProtocol(protocol);
+        reply.appendMapHeader(3);
+        reply.appendBulkString("server");
+        reply.appendBulkString(server_->getName());
+        reply.appendBulkString("proto");
+        reply.appendInteger(protocol);
+        reply.appendBulkString("mode");
+        reply.appendBulkString("standalone");
+    }
+    else if (name == "quit")
+    {
+        reply.appendSimpleString("OK");
+        session.closing = true;
+    }
+    else
+    {
+        LOG_DEBUG_FMT(log, "RespServer[{}] - unknown command '{}' from {}", server_->getName(), args[0], conn->getPeerAddress().toIpPortRepr());
+        reply.appendError(std::format("ERR unknown command '{}'", args[0]));
+    }
+}
@@ -26,6 +26,12 @@ void SignalHandler::addSignal(int signo)
     sigaddset(&mask_, signo);
 }
 
+void SignalHandler::addSignal(int signo, SignalCallback cb)
+{
+    sigaddset(&mask_, signo);
+    signal_callbacks_[signo] = std::move(cb);
+}
+
 void SignalHandler::setCallback(SignalCallback cb)
 {
     signal_callback_ = std::move(cb);
@@ -68,7 +74,11 @@ void SignalHandler::signalChannelReadCB_()
             auto signo = si.ssi_signo;
             EASY_DEBUG("Received signal: {}:{}", strsignal(signo),signo);
 
-            if (signal_callback_)
+            if (auto it = signal_callbacks_.find(static_cast<int>(signo)); it != signal_callbacks_.end())
+            {
+                it->second(static_cast<int>(signo));
+            }
+            else if (signal_callback_)
             {
                 signal_callback_(signo);
             }
@@ -19,10 +19,7 @@ Socket::~Socket()
 
 void Socket::bindAddress(const InetAddress &localaddr) const
 {
-    auto sock_addr_size = localaddr.getFamily() == AF_INET
-                              ? sizeof(sockaddr_in)
-                              : sizeof(sockaddr_in6);
-    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), sock_addr_size))
+    if (0 != ::bind(sockfd_, localaddr.getSockAddr(), localaddr.getSockLen()))
     {
         // LOG_FATAL("bind sockfd:%d fail\n", sockfd_);
     }
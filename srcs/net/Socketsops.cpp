@@ -33,7 +33,8 @@ namespace Sock {
 auto createNonblockingOrDie(sa_family_t family)
     -> int
 {
-    auto sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+    auto protocol = family == AF_UNIX ? 0 : IPPROTO_TCP;
+    auto sockfd   = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
     if (sockfd < 0)
     {
         LOG_SYSFATAL_FMT(log, "createNonblockingOrDie");
@@ -41,9 +42,20 @@ auto createNonblockingOrDie(sa_family_t family)
     return sockfd;
 }
 
+auto createNonblockingDgramOrDie(sa_family_t family)
+    -> int
+{
+    auto sockfd = ::socket(family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (sockfd < 0)
+    {
+        LOG_SYSFATAL_FMT(log, "createNonblockingDgramOrDie");
+    }
+    return sockfd;
+}
+
 void BindOrDie(int sockfd, const struct sockaddr* addr)
 {
-    auto ret = ::bind(sockfd, addr, static_cast<socklen_t>(sizeof(struct sockaddr_in6)));
+    auto ret = ::bind(sockfd, addr, sockaddrLen(addr));
     if (ret < 0)
     {
         // todo: log and exit
@@ -103,7 +115,7 @@ auto Accept(int sockfd, struct sockaddr_in6* addr)
 auto connect(int sockfd, const struct sockaddr& peer_addr)
     -> int
 {
-    return ::connect(sockfd, &peer_addr, static_cast<socklen_t>(sizeof(struct sockaddr_storage)));
+    return ::connect(sockfd, &peer_addr, sockaddrLen(&peer_addr));
 }
 
 auto Read(int sockfd, void* buf, size_t count)
@@ -117,6 +129,18 @@ ssize_t Readv(int sockfd, const struct iovec* iov, int iovcnt)
     return ::readv(sockfd, iov, iovcnt);
 }
 
+auto RecvMmsg(int sockfd, struct mmsghdr* msgs, unsigned int vlen)
+    -> int
+{
+    return ::recvmmsg(sockfd, msgs, vlen, MSG_DONTWAIT, nullptr);
+}
+
+auto SendMmsg(int sockfd, struct mmsghdr* msgs, unsigned int vlen)
+    -> int
+{
+    return ::sendmmsg(sockfd, msgs, vlen, MSG_DONTWAIT);
+}
+
 ssize_t Write(int sockfd, const void* buf, size_t count)
 {
     return ::write(sockfd, buf, count);
@@ -208,6 +232,22 @@ auto getSocketError(int sockfd) -> int
     return optval;
 }
 
+auto sockaddrLen(const struct sockaddr* addr)
+    -> socklen_t
+{
+    switch (addr->sa_family)
+    {
+        case AF_INET:
+            return static_cast<socklen_t>(sizeof(struct sockaddr_in));
+        case AF_INET6:
+            return static_cast<socklen_t>(sizeof(struct sockaddr_in6));
+        case AF_UNIX:
+            return static_cast<socklen_t>(sizeof(struct sockaddr_un));
+        default:
+            return static_cast<socklen_t>(sizeof(struct sockaddr_storage));
+    }
+}
+
 auto getLocalAddr(int sockfd)
     -> struct sockaddr_storage
 {
@@ -13,13 +13,17 @@
 #include "net/Connector.h"
 #include "net/EventLoop.h"
 #include "net/InetAddress.h"
+#include "net/Resolver.h"
 #include "net/Socketsops.h"
 #include "net/TcpConnection.h"
 #include "net/TcpClient.h"
 #include "logger/Logger.h"
 #include "logger/LoggerManager.h"
 
+#include <algorithm>
 #include <bit>
+#include <cassert>
+#include <cerrno>
 #include <memory>
 
 static auto log = GET_ROOT_LOGGER();
@@ -35,36 +39,197 @@ TcpClient::TcpClient(EventLoop* loop,
     , retry_(false)
     , willing_to_connect_ {true}
     , next_conn_id_(1)
-    , server_addr_ {serverAddr}
+    , server_addrs_ {serverAddr}
+    , server_port_ {serverAddr.GetPort()}
+    , resolving_ {false}
+    , attempt_delay_ms_ {-1}
+    , published_connector_ {nullptr}
+    , resolve_retry_delay_ms_ {Connector::c_init_retry_delay_ms}
 {
-    // FIXME setConnectFailedCallback
     LOG_TRACE_FMT(log, "TcpClient::TcpClient[{}] - connector {}", name_, std::bit_cast<uint64_t>(connector_.get()));
 }
 
+TcpClient::TcpClient(EventLoop* loop,
+                     std::vector<InetAddress> serverAddrs,
+                     std::string nameArg)
+    : loop_ {loop}
+    , name_ {std::move(nameArg)}
+    , connection_callback_ {defaultConnectionCallback}
+    , conn_close_callback_ {defaultConnectionCallback}
+    , message_callback_ {defaultMessageCallback}
+    , retry_(false)
+    , willing_to_connect_ {true}
+    , next_conn_id_(1)
+    , server_addrs_ {std::move(serverAddrs)}
+    , server_port_ {server_addrs_.empty() ? uint16_t {0} : server_addrs_.front().GetPort()}
+    , resolving_ {false}
+    , attempt_delay_ms_ {-1}
+    , published_connector_ {nullptr}
+    , resolve_retry_delay_ms_ {Connector::c_init_retry_delay_ms}
+{
+    assert(not server_addrs_.empty());
+    LOG_TRACE_FMT(log, "TcpClient::TcpClient[{}] - {} server addresses", name_, server_addrs_.size());
+}
+
+TcpClient::TcpClient(EventLoop* loop,
+                     std::string host,
+                     uint16_t port,
+                     std::string nameArg)
+    : loop_ {loop}
+    , name_ {std::move(nameArg)}
+    , connection_callback_ {defaultConnectionCallback}
+    , conn_close_callback_ {defaultConnectionCallback}
+    , message_callback_ {defaultMessageCallback}
+    , retry_(false)
+    , willing_to_connect_ {true}
+    , next_conn_id_(1)
+    , server_host_ {std::move(host)}
+    , server_port_ {port}
+    , resolving_ {false}
+    , attempt_delay_ms_ {-1}
+    , published_connector_ {nullptr}
+    , resolve_retry_delay_ms_ {Connector::c_init_retry_delay_ms}
+{
+    LOG_TRACE_FMT(log, "TcpClient::TcpClient[{}] - host {}:{}", name_, server_host_, server_port_);
+}
+
 TcpClient::~TcpClient()
 {
     LOG_TRACE_FMT(log, "TcpClient::~TcpClient[{}]", name_);
     willing_to_connect_ = false;
+    // not closed otherwise, its close callback only reaches us through a weak_ptr
+    if (auto conn = getConnection(); conn != nullptr)
+    {
+        conn->forceClose();
+    }
 }
 
 void TcpClient::connect()
 {
     willing_to_connect_ = true;
     // FIXME: check state
+    if (not server_host_.empty())
+    {
+        resolveAndConnect_();
+        return;
+    }
+    startConnector_();
+}
+
+void TcpClient::startConnector_()
+{
     if (connector_ == nullptr)
     {
-        connector_ = std::make_unique<Connector>(loop_, server_addr_, weak_from_this());
+        connector_ = std::make_unique<Connector>(loop_, server_addrs_, weak_from_this());
+        published_connector_.store(connector_.get(), std::memory_order_release);
+        if (attempt_delay_ms_ >= 0)
+        {
+            connector_->setAttemptDelayMs(attempt_delay_ms_);
+        }
         connector_->setNewConnectionCallback([weak_this = weak_from_this()](int sockfd) {
             if (auto server = weak_this.lock(); server != nullptr)
             {
                 server->initTcpConnection_(sockfd);
             }
         });
-        LOG_INFO_FMT(log, "TcpClient::connect[{}] - connecting to {}", name_, connector_->getServerAddress().toIpPortRepr());
+        if (connect_failed_callback_)
+        {
+            connector_->setConnectFailedCallback(connect_failed_callback_);
+        }
+        if (not server_host_.empty())
+        {
+            // the host may have moved meanwhile, the cache of the Resolver makes it cheap otherwise
+            connector_->setRetryCallback([weak_this = weak_from_this()] {
+                if (auto client = weak_this.lock(); client != nullptr)
+                {
+                    client->resolve_([weak_this](bool) {
+                        if (auto client = weak_this.lock(); client != nullptr and client->willing_to_connect_)
+                        {
+                            client->connector_->resume();
+                        }
+                    });
+                }
+            });
+        }
+        LOG_INFO_FMT(log, "TcpClient::connect[{}] - connecting to {} ({} addresses)", name_, connector_->getServerAddress().toIpPortRepr(), server_addrs_.size());
     }
     connector_->start();
 }
 
+void TcpClient::resolve_(std::function<void(bool resolved)> next)
+{
+    LOG_INFO_FMT(log, "TcpClient::connect[{}] - resolving {}", name_, server_host_);
+    ResolverMgr::GetInstance().resolve(
+        server_host_, server_port_, loop_,
+        [weak_this = weak_from_this(), next = std::move(next)](const Resolver::ResolveResult& result) {
+            auto client = weak_this.lock();
+            if (client == nullptr)
+            {
+                return;
+            }
+            if (not result.has_value())
+            {
+                LOG_ERROR_FMT(log, "TcpClient::connect[{}] - resolve {} failed: {}", client->name_, client->server_host_, result.error().message());
+                if (client->willing_to_connect_ and client->connect_failed_callback_)
+                {
+                    // a negative EAI_* code, or the errno of EAI_SYSTEM
+                    client->connect_failed_callback_(result.error().value());
+                }
+                next(false);
+                return;
+            }
+            client->resolve_retry_delay_ms_ = Connector::c_init_retry_delay_ms;
+            // race every resolved address rather than trusting the first one
+            client->server_addrs_ = *result;
+            if (client->connector_ != nullptr and not client->connector_->setServerAddresses(*result))
+            {
+                LOG_DEBUG_FMT(log, "TcpClient::connect[{}] - connecting, the new addresses are raced next time", client->name_);
+            }
+            next(true);
+        });
+}
+
+void TcpClient::resolveAndConnect_()
+{
+    if (resolving_.exchange(true))
+    {
+        return;
+    }
+    resolve_([weak_this = weak_from_this()](bool resolved) {
+        auto client = weak_this.lock();
+        if (client == nullptr)
+        {
+            return;
+        }
+        client->resolving_ = false;
+        if (not client->willing_to_connect_)
+        {
+            return;
+        }
+        // once connected before, the former addresses are better than none
+        if (not resolved and client->connector_ == nullptr)
+        {
+            client->retryResolve_();
+            return;
+        }
+        client->startConnector_();
+    });
+}
+
+void TcpClient::retryResolve_()
+{
+    loop_->assertInOwnerThread();
+    LOG_INFO_FMT(log, "TcpClient::connect[{}] - resolving {} again in {} ms", name_, server_host_, resolve_retry_delay_ms_);
+    loop_->runAfter(resolve_retry_delay_ms_ / 1000.0, [weak_this = weak_from_this()] {
+        auto client = weak_this.lock();
+        if (client != nullptr and client->willing_to_connect_ and client->connector_ == nullptr)
+        {
+            client->resolveAndConnect_();
+        }
+    });
+    resolve_retry_delay_ms_ = std::min(resolve_retry_delay_ms_ * 2, Connector::c_max_retry_delay_ms);
+}
+
 void TcpClient::disconnect()
 {
 
@@ -81,7 +246,22 @@ void TcpClient::disconnect()
 void TcpClient::stop()
 {
     willing_to_connect_ = false;
-    connector_->stop();
+    if (auto* connector = published_connector_.load(std::memory_order_acquire); connector != nullptr)
+    {
+        connector->stop();
+    }
+}
+
+auto TcpClient::getConnectStats() const
+    -> std::vector<ConnectAddressStats>
+{
+    // connector_ is created in loop thread, possibly after a resolve, and lives as long as the client
+    auto* connector = published_connector_.load(std::memory_order_acquire);
+    if (connector == nullptr)
+    {
+        return {};
+    }
+    return connector->getConnectStats();
 }
 
 void TcpClient::initTcpConnection_(int sockfd)
@@ -133,7 +313,18 @@ void TcpClient::removeConnection_(const TcpConnectionPtr& conn)
 
     if (retry_ && willing_to_connect_.load())
     {
-        LOG_INFO_FMT(log, "TcpClient::connect[{}] - Reconnecting to {}", name_, connector_->getServerAddress().toIpPortRepr());
-        connector_->restart();
+        if (server_host_.empty())
+        {
+            LOG_INFO_FMT(log, "TcpClient::connect[{}] - Reconnecting to {}", name_, connector_->getServerAddress().toIpPortRepr());
+            connector_->restart();
+            return;
+        }
+        LOG_INFO_FMT(log, "TcpClient::connect[{}] - Reconnecting to {}", name_, server_host_);
+        resolve_([weak_this = weak_from_this()](bool) {
+            if (auto client = weak_this.lock(); client != nullptr and client->retry_ and client->willing_to_connect_)
+            {
+                client->connector_->restart();
+            }
+        });
     }
 }
\ No newline at end of file
@@ -1,12 +1,23 @@
+#include <array>
 #include <cassert>
 #include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <exception>
+#include <algorithm>
+#include <fcntl.h>
 #include <functional>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "net/Buffer.h"
 #include "net/Channel.h"
@@ -62,33 +73,50 @@ TcpConnection::TcpConnection(EventLoop* loop,
     , local_addr_ {localAddr}
     , peer_addr_ {peerAddr}
     , high_watermark_ {c_highwater_mark} // 64M
+    , is_unix_ {localAddr.isUnix()}
+    , output_bytes_sent_ {0}
+    , zerocopy_threshold_ {0}
+    , output_buf_appended_ {0}
+    , payload_queue_bytes_ {0}
+    , zc_next_seq_ {0}
+    , zc_stats_ {}
+    , spill_threshold_ {0}
+    , spill_fd_ {-1}
+    , spill_written_ {0}
+    , spill_sent_ {0}
+    , spill_stats_ {}
+    , throttled_ {false}
+    , messages_charged_ {false}
+    , throttles_ {0}
+    , throttled_us_ {0}
+    , created_ {Timestamp::now()}
+    , bytes_received_ {0}
+    , reads_ {0}
+    , writes_ {0}
+    , message_callbacks_ {0}
+    , callback_us_ {0}
+    , tcp_info_sample_ {}
+    , loop_pins_ {0}
 {
 
     // 注册读写等事件的回调
     // 这里直接捕获 this 是因为其生命周期要长于socket_channel for it`s TcpConnection`s member
-    socket_channel_->setReadCallback([this](Timestamp) {
-        this->socketChannelReadCB_(Timestamp::now());
-    });
-
-    socket_channel_->setWriteCallback([this]() {
-        this->socketChannelWriteCB_();
-    });
-    socket_channel_->setErrorCallback([this]() {
-        this->socketChannelErrorCB_();
-    });
-    socket_channel_->setCloseCallback([this]() {
-        this->socketChannelCloseCB_();
-    });
+    socket_channel_->setEventHandler(this, &TcpConnection::socketChannelEventHandler_);
 
     // todo: log
     //  LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+    if (not is_unix_)
+    {
+        socket_->setKeepAlive(true);
+    }
 }
 
 TcpConnection::~TcpConnection()
 {
     // LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d\n", name_.c_str(), channel_->GetFd(), (int)state_);
     assert(state_ == Disconnected);
+    closeUntakenFds_();
+    closeSpill_();
 }
 auto TcpConnection::getTcpInfo(struct tcp_info* tcpi) const
     -> bool
@@ -105,6 +133,53 @@ auto TcpConnection::getTcpInfoString() const
     return buf.data();
 }
 
+auto TcpConnection::sampleTcpInfo()
+    -> bool
+{
+    getLoop()->assertInOwnerThread();
+    auto tcpi = tcp_info {};
+    if (is_unix_ or not socket_->getTcpInfo(&tcpi))
+    {
+        return false;
+    }
+    tcp_info_sample_ = TcpInfoSample {
+        .sampled       = getLoop()->now(),
+        .rtt_us        = tcpi.tcpi_rtt,
+        .rttvar_us     = tcpi.tcpi_rttvar,
+        .snd_cwnd      = tcpi.tcpi_snd_cwnd,
+        .unacked       = tcpi.tcpi_unacked,
+        .lost          = tcpi.tcpi_lost,
+        .total_retrans = tcpi.tcpi_total_retrans,
+    };
+    return true;
+}
+
+auto TcpConnection::getTrafficStats() const
+    -> TrafficStats
+{
+    return TrafficStats {
+        .created           = created_,
+        .last_receive      = last_receive_,
+        .last_send         = last_send_,
+        .bytes_received    = bytes_received_,
+        .bytes_sent        = output_bytes_sent_,
+        .reads             = reads_,
+        .writes            = writes_,
+        .message_callbacks = message_callbacks_,
+        .callback_seconds  = static_cast<double>(callback_us_) / 1e6,
+    };
+}
+
+void TcpConnection::noteWritten_(ssize_t n)
+{
+    ++writes_;
+    if (n > 0)
+    {
+        output_bytes_sent_ += static_cast<uint64_t>(n);
+        last_send_ = getLoop()->now();
+    }
+}
+
 void TcpConnection::send(std::span<char> data)
 {
     send(std::string_view {data.data(), data.size()});
@@ -115,7 +190,7 @@ void TcpConnection::send(std::string_view message)
     // only send when connected
     if (state_ == Connected)
     {
-        if (owner_loop_->inOwnerThread())
+        if (getLoop()->inOwnerThread())
         {
             sendInOwnerLoop_(message);
         }
@@ -124,7 +199,7 @@ void TcpConnection::send(std::string_view message)
             auto send_msg_task = [tcpconn = this, message = std::string {message}]() {
                 tcpconn->sendInOwnerLoop_(message);
             };
-            owner_loop_->runTask(send_msg_task);
+            runInOwnerLoop_(send_msg_task);
         }
     }
 }
@@ -133,7 +208,7 @@ void TcpConnection::send(Buffer buf)
 {
     if (state_ == Connected)
     {
-        if (owner_loop_->inOwnerThread())
+        if (getLoop()->inOwnerThread())
         {
             sendInOwnerLoop_(buf.getReadableSV());
         }
@@ -142,7 +217,7 @@ void TcpConnection::send(Buffer buf)
             auto send_data_task = [tcp_conn = shared_from_this(), buf = std::move(buf)]() {
                 tcp_conn->sendInOwnerLoop_(buf.getReadableSV());
             };
-            owner_loop_->runTask(send_data_task);
+            runInOwnerLoop_(send_data_task);
         }
     }
 }
@@ -151,7 +226,7 @@ void TcpConnection::send(std::string message)
 {
     if (state_ == Connected)
     {
-        if (owner_loop_->inOwnerThread())
+        if (getLoop()->inOwnerThread())
         {
             sendInOwnerLoop_(message);
         }
@@ -160,7 +235,7 @@ void TcpConnection::send(std::string message)
             auto send_msg_task = [tcp_conn = shared_from_this(), message = std::move(message)]() -> void {
                 tcp_conn->sendInOwnerLoop_(message);
             };
-            owner_loop_->runTask(send_msg_task);
+            runInOwnerLoop_(send_msg_task);
         }
     }
 }
@@ -174,7 +249,7 @@ void TcpConnection::sendInOwnerLoop_(std::string_view message)
  **/
 void TcpConnection::sendInOwnerLoop_(const void* data, size_t len)
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
 
     // 之前调用过该connection的shutdown 不能再进行发送了
     if (state_ == Disconnected)
@@ -191,13 +266,14 @@ void TcpConnection::sendInOwnerLoop_(const void* data, size_t len)
     if (not socket_channel_->isWriting() and output_buf_.getReadableBytesCount() == 0)
     {
         nwrote = ::write(socket_channel_->getFd(), data, len);
+        noteWritten_(nwrote);
         if (nwrote >= 0)
         {
             remaining = len - nwrote;
             if (remaining == 0 && write_complete_callback_) // 全部发送完毕
             {
                 // 既然在这里数据全部发送完成，就不用再给channel设置epollout事件了
-                owner_loop_->queueTask([tcpconn = shared_from_this()]() {
+                queueInOwnerLoop_([tcpconn = shared_from_this()]() {
                     // here the "tcp->write..." make tcpconn will be valid in write_complete_callback_ unless the write_complete_callback_ will delete the tcpconn stupidly
                     tcpconn->write_complete_callback_(tcpconn);
                 });
@@ -226,20 +302,8 @@ void TcpConnection::sendInOwnerLoop_(const void* data, size_t len)
      **/
     if (not fault_error && remaining > 0)
     {
-        // 目前发送缓冲区剩余的待发送的数据的长度
-        auto in_obuf = output_buf_.getReadableBytesCount();
-        // 第二个条件用于判断，第二次send时再次达到highWaterMark
-        // 同时保证一次send只能触发一次highWaterMark
-        if (in_obuf + remaining >= high_watermark_
-            and in_obuf < high_watermark_
-            and high_watermark_callback_) // 待发送数据超过了高水位
-        {
-            owner_loop_->queueTask([tcpconn = shared_from_this(), watermark_now = in_obuf + remaining](){
-                tcpconn->high_watermark_callback_(tcpconn, watermark_now);
-            });
-        }
-
-        output_buf_.append((char*)data + nwrote, remaining);
+        checkHighWatermark_(remaining);
+        appendOutput_(static_cast<const char*>(data) + nwrote, remaining);
         if (not socket_channel_->isWriting())
         {
             // 注册 channel 的写事件
@@ -248,12 +312,603 @@ void TcpConnection::sendInOwnerLoop_(const void* data, size_t len)
     }
 }
 
+void TcpConnection::checkHighWatermark_(size_t appending)
+{
+    // 目前发送缓冲区剩余的待发送的数据的长度
+    auto in_obuf = getOutputBufferedBytes();
+    // 第二个条件用于判断，第二次send时再次达到highWaterMark
+    // 同时保证一次send只能触发一次highWaterMark
+    if (in_obuf + appending >= high_watermark_
+        and in_obuf < high_watermark_
+        and high_watermark_callback_) // 待发送数据超过了高水位
+    {
+        queueInOwnerLoop_([tcpconn = shared_from_this(), watermark_now = in_obuf + appending]() {
+            tcpconn->high_watermark_callback_(tcpconn, watermark_now);
+        });
+    }
+}
+
+void TcpConnection::sendGathered(std::span<const std::string_view> pieces)
+{
+    if (state_ != Connected)
+    {
+        return;
+    }
+    if (getLoop()->inOwnerThread())
+    {
+        sendGatheredInOwnerLoop_(pieces);
+    }
+    else
+    {
+        auto message = std::string {};
+        for (auto piece : pieces)
+        {
+            message.append(piece);
+        }
+        runInOwnerLoop_([tcp_conn = shared_from_this(), message = std::move(message)]() {
+            tcp_conn->sendInOwnerLoop_(message);
+        });
+    }
+}
+
+void TcpConnection::sendGatheredInOwnerLoop_(std::span<const std::string_view> pieces)
+{
+    getLoop()->assertInOwnerThread();
+    if (state_ == Disconnected)
+    {
+        LOG_WARN_FMT(log, "disconnected, give up writing");
+        return;
+    }
+
+    auto total = size_t {0};
+    for (auto piece : pieces)
+    {
+        total += piece.size();
+    }
+    auto nwrote = size_t {0};
+    // nothing queued, try writing the pieces directly with one writev
+    if (not socket_channel_->isWriting() and output_buf_.getReadableBytesCount() == 0)
+    {
+        auto iov   = std::array<iovec, c_max_gathered_iovecs> {};
+        auto count = std::min(pieces.size(), iov.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            iov[i].iov_base = const_cast<char*>(pieces[i].data());
+            iov[i].iov_len  = pieces[i].size();
+        }
+        auto n = ::writev(socket_channel_->getFd(), iov.data(), static_cast<int>(count));
+        noteWritten_(n);
+        if (n >= 0)
+        {
+            nwrote = static_cast<size_t>(n);
+            if (nwrote == total and write_complete_callback_)
+            {
+                queueInOwnerLoop_([tcpconn = shared_from_this()]() {
+                    tcpconn->write_complete_callback_(tcpconn);
+                });
+            }
+        }
+        else if (errno == EPIPE or errno == ECONNRESET)
+        {
+            return;
+        }
+    }
+    if (nwrote == total)
+    {
+        return;
+    }
+
+    // the rest goes through the output buffer
+    checkHighWatermark_(total - nwrote);
+    for (auto piece : pieces)
+    {
+        if (nwrote >= piece.size())
+        {
+            nwrote -= piece.size();
+            continue;
+        }
+        appendOutput_(piece.data() + nwrote, piece.size() - nwrote);
+        nwrote = 0;
+    }
+    if (not socket_channel_->isWriting())
+    {
+        socket_channel_->enableWriting();
+    }
+}
+
+void TcpConnection::sendFds(std::string_view message, std::span<const int> fds)
+{
+    assert(not message.empty());
+    if (state_ != Connected)
+    {
+        return;
+    }
+    if (not is_unix_)
+    {
+        LOG_ERROR_FMT(log, "TcpConnection::sendFds [{}] - not a unix domain connection", name_);
+        return;
+    }
+    // dup now, the caller may close its fds right after returning
+    auto dups = std::vector<int> {};
+    dups.reserve(fds.size());
+    for (auto fd : fds)
+    {
+        auto dup_fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dup_fd < 0)
+        {
+            LOG_SYSERR_FMT(log, "TcpConnection::sendFds [{}] - dup fd {} failed", name_, fd);
+            std::ranges::for_each(dups, ::close);
+            return;
+        }
+        dups.push_back(dup_fd);
+    }
+
+    if (getLoop()->inOwnerThread())
+    {
+        sendFdsInOwnerLoop_(message, std::move(dups));
+    }
+    else
+    {
+        runInOwnerLoop_([tcp_conn = shared_from_this(), message = std::string {message}, dups = std::move(dups)]() mutable {
+            tcp_conn->sendFdsInOwnerLoop_(message, std::move(dups));
+        });
+    }
+}
+
+void TcpConnection::sendFdsInOwnerLoop_(std::string_view message, std::vector<int> fds)
+{
+    getLoop()->assertInOwnerThread();
+    if (state_ == Disconnected)
+    {
+        LOG_WARN_FMT(log, "disconnected, give up writing");
+        std::ranges::for_each(fds, ::close);
+        return;
+    }
+    // 总是经过输出缓冲区, 由 socketChannelWriteCB_ 在 fds 所在的边界上用 sendmsg 发送
+    pending_rights_.push_back(PendingRights {
+        .stream_offset = output_bytes_sent_ + output_buf_.getReadableBytesCount(),
+        .fds           = std::move(fds),
+    });
+    output_buf_.append(message);
+    output_buf_appended_ += message.size();
+    if (not socket_channel_->isWriting())
+    {
+        socket_channel_->enableWriting();
+    }
+}
+
+auto TcpConnection::writeOutputWithRights_(int* savedErrno)
+    -> ssize_t
+{
+    auto& front = pending_rights_.front();
+    assert(front.stream_offset >= output_bytes_sent_);
+    auto n = ssize_t {0};
+    if (front.stream_offset == output_bytes_sent_)
+    {
+        // stop before the byte the next fds belong to
+        auto limit = pending_rights_.size() > 1
+                         ? static_cast<size_t>(pending_rights_[1].stream_offset - output_bytes_sent_)
+                         : output_buf_.getReadableBytesCount();
+        n = output_buf_.writeFdWithRights(socket_channel_->getFd(), limit, front.fds, savedErrno);
+        if (n > 0)
+        {
+            std::ranges::for_each(front.fds, ::close);
+            pending_rights_.pop_front();
+        }
+    }
+    else
+    {
+        auto limit = static_cast<size_t>(front.stream_offset - output_bytes_sent_);
+        n          = output_buf_.writeFdWithRights(socket_channel_->getFd(), limit, {}, savedErrno);
+    }
+    noteWritten_(n);
+    return n;
+}
+
+auto TcpConnection::enableZeroCopy(size_t threshold)
+    -> bool
+{
+    getLoop()->assertInOwnerThread();
+    if (is_unix_)
+    {
+        return false;
+    }
+    auto on = 1;
+    if (::setsockopt(socket_channel_->getFd(), SOL_SOCKET, SO_ZEROCOPY, &on, sizeof on) < 0)
+    {
+        LOG_WARN_FMT(log, "TcpConnection::enableZeroCopy [{}] - SO_ZEROCOPY unsupported, errno {}", name_, errno);
+        return false;
+    }
+    zerocopy_threshold_ = std::max<size_t>(threshold, 1);
+    return true;
+}
+
+void TcpConnection::sendZeroCopy(SharedPayload payload)
+{
+    assert(payload != nullptr);
+    if (state_ != Connected or payload->empty())
+    {
+        return;
+    }
+    if (getLoop()->inOwnerThread())
+    {
+        sendZeroCopyInOwnerLoop_(std::move(payload));
+    }
+    else
+    {
+        runInOwnerLoop_([tcp_conn = shared_from_this(), payload = std::move(payload)]() mutable {
+            tcp_conn->sendZeroCopyInOwnerLoop_(std::move(payload));
+        });
+    }
+}
+
+void TcpConnection::sendZeroCopyInOwnerLoop_(SharedPayload payload)
+{
+    getLoop()->assertInOwnerThread();
+    if (zerocopy_threshold_ == 0 or payload->size() < zerocopy_threshold_)
+    {
+        ++zc_stats_.fallback_sends;
+        sendInOwnerLoop_(payload->data(), payload->size());
+        return;
+    }
+    if (state_ == Disconnected)
+    {
+        LOG_WARN_FMT(log, "disconnected, give up writing");
+        return;
+    }
+    // 总是等可写事件再发送, 与输出缓冲区中已有的数据保持顺序
+    checkHighWatermark_(payload->size());
+    queuePayload_(std::move(payload), 0, true, {});
+}
+
+void TcpConnection::sendShared(SharedPayload payload, WriteCompleteCallback onWritten)
+{
+    assert(payload != nullptr);
+    if (state_ != Connected or payload->empty())
+    {
+        return;
+    }
+    if (getLoop()->inOwnerThread())
+    {
+        sendSharedInOwnerLoop_(std::move(payload), std::move(onWritten));
+    }
+    else
+    {
+        runInOwnerLoop_([tcp_conn = shared_from_this(), payload = std::move(payload), onWritten = std::move(onWritten)]() mutable {
+            tcp_conn->sendSharedInOwnerLoop_(std::move(payload), std::move(onWritten));
+        });
+    }
+}
+
+void TcpConnection::sendSharedInOwnerLoop_(SharedPayload payload, WriteCompleteCallback onWritten)
+{
+    getLoop()->assertInOwnerThread();
+    if (state_ == Disconnected)
+    {
+        LOG_WARN_FMT(log, "disconnected, give up writing");
+        return;
+    }
+    auto zerocopy = zerocopy_threshold_ != 0 and payload->size() >= zerocopy_threshold_;
+    auto sent     = size_t {0};
+    // nothing queued, the payload queue being written only while writing is enabled
+    if (not zerocopy and not socket_channel_->isWriting() and output_buf_.getReadableBytesCount() == 0)
+    {
+        auto nwrote = ::write(socket_channel_->getFd(), payload->data(), payload->size());
+        noteWritten_(nwrote);
+        if (nwrote < 0)
+        {
+            if (errno == EPIPE or errno == ECONNRESET)
+            {
+                return;
+            }
+            nwrote = 0;
+        }
+        sent = static_cast<size_t>(nwrote);
+    }
+    if (sent == payload->size())
+    {
+        queueInOwnerLoop_([tcpconn = shared_from_this(), onWritten = std::move(onWritten)] {
+            if (onWritten)
+            {
+                onWritten(tcpconn);
+            }
+            if (tcpconn->write_complete_callback_)
+            {
+                tcpconn->write_complete_callback_(tcpconn);
+            }
+        });
+        return;
+    }
+    checkHighWatermark_(payload->size() - sent);
+    queuePayload_(std::move(payload), sent, zerocopy, std::move(onWritten));
+}
+
+void TcpConnection::queuePayload_(SharedPayload payload, size_t sent, bool zerocopy, WriteCompleteCallback onWritten)
+{
+    if (spill_fd_ >= 0)
+    {
+        // behind the spilled output, copied after it
+        if (spill_(payload->data() + sent, payload->size() - sent) and onWritten)
+        {
+            spill_callbacks_.emplace_back(spill_written_, std::move(onWritten));
+        }
+        return;
+    }
+    payload_queue_bytes_ += payload->size() - sent;
+    payload_queue_.push_back(PayloadSegment {
+        .payload    = std::move(payload),
+        .sent       = sent,
+        .buf_offset = output_buf_appended_,
+        .zerocopy   = zerocopy,
+        .on_written = std::move(onWritten),
+    });
+    if (not socket_channel_->isWriting())
+    {
+        socket_channel_->enableWriting();
+    }
+}
+
+auto TcpConnection::writeOutputWithPayloads_(int* savedErrno)
+    -> ssize_t
+{
+    auto& front      = payload_queue_.front();
+    auto buf_written = output_buf_appended_ - output_buf_.getReadableBytesCount();
+    auto n           = ssize_t {0};
+    if (buf_written < front.buf_offset)
+    {
+        // the bytes sent before the payload go first
+        auto limit = static_cast<size_t>(front.buf_offset - buf_written);
+        n          = output_buf_.writeFdWithRights(socket_channel_->getFd(), limit, {}, savedErrno);
+    }
+    else
+    {
+        const auto* data = front.payload->data() + front.sent;
+        auto len         = front.payload->size() - front.sent;
+        if (not front.zerocopy)
+        {
+            n = ::send(socket_channel_->getFd(), data, len, MSG_NOSIGNAL);
+        }
+        else
+        {
+            auto vec       = iovec {.iov_base = const_cast<char*>(data), .iov_len = len};
+            auto msg       = msghdr {};
+            msg.msg_iov    = &vec;
+            msg.msg_iovlen = 1;
+            n              = ::sendmsg(socket_channel_->getFd(), &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+            if (n >= 0)
+            {
+                // every successful MSG_ZEROCOPY call gets the next sequence number, even if partial
+                zc_inflight_.push_back(ZeroCopyInflight {.seq = zc_next_seq_++, .payload = front.payload});
+                ++zc_stats_.zerocopy_sends;
+            }
+            else if (errno == ENOBUFS)
+            {
+                // out of optmem for the page pinning, copy this time
+                ++zc_stats_.fallback_sends;
+                n = ::send(socket_channel_->getFd(), data, len, MSG_NOSIGNAL);
+            }
+        }
+        if (n < 0)
+        {
+            *savedErrno = errno;
+        }
+        else
+        {
+            front.sent += static_cast<size_t>(n);
+            payload_queue_bytes_ -= static_cast<size_t>(n);
+            if (front.sent == front.payload->size())
+            {
+                if (front.on_written)
+                {
+                    queueInOwnerLoop_([tcpconn = shared_from_this(), onWritten = std::move(front.on_written)] {
+                        onWritten(tcpconn);
+                    });
+                }
+                payload_queue_.pop_front();
+            }
+        }
+    }
+    noteWritten_(n);
+    return n;
+}
+
+void TcpConnection::appendOutput_(const char* data, size_t len)
+{
+    // the queued shared payloads are pending output held in memory as well
+    auto spilling = spill_fd_ >= 0
+                    or (spill_threshold_ != 0 and getOutputBufferedBytes() + len > spill_threshold_ and startSpill_());
+    if (spilling)
+    {
+        spill_(data, len);
+        return;
+    }
+    output_buf_.append(data, len);
+    output_buf_appended_ += len;
+}
+
+auto TcpConnection::startSpill_()
+    -> bool
+{
+    // unlinked from the start, the space is given back with the fd whatever happens to the process
+    auto fd = ::open(spill_dir_.c_str(), O_TMPFILE | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0 and (errno == EOPNOTSUPP or errno == EISDIR))
+    {
+        // no O_TMPFILE on this file system
+        auto path = spill_dir_ + "/cotweb-spill-XXXXXX";
+        fd        = ::mkostemp(path.data(), O_CLOEXEC);
+        if (fd >= 0)
+        {
+            ::unlink(path.c_str());
+        }
+    }
+    if (fd < 0)
+    {
+        LOG_WARN_FMT(log, "TcpConnection::startSpill_ [{}] - cannot create a spill file in {}, errno {}, output kept in memory", name_, spill_dir_, errno);
+        spill_threshold_ = 0;
+        return false;
+    }
+    spill_fd_ = fd;
+    ++spill_stats_.spills;
+    LOG_DEBUG_FMT(log, "TcpConnection::startSpill_ [{}] - {} bytes pending, spilling to disk", name_, getOutputBufferedBytes());
+    return true;
+}
+
+auto TcpConnection::spill_(const char* data, size_t len)
+    -> bool
+{
+    // a blocking write in the loop thread, normally absorbed by the page cache, capped so that one syscall stays short
+    while (len > 0)
+    {
+        auto n = ::write(spill_fd_, data, std::min(len, c_max_spill_write));
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            LOG_ERROR_FMT(log, "TcpConnection::spill_ [{}] - writing the spill file failed, errno {}, closing", name_, errno);
+            closeSpill_();
+            spill_threshold_ = 0;
+            forceClose();
+            return false;
+        }
+        data += n;
+        len -= static_cast<size_t>(n);
+        spill_written_ += static_cast<uint64_t>(n);
+        spill_stats_.spilled_bytes += static_cast<uint64_t>(n);
+    }
+    if (not socket_channel_->isWriting())
+    {
+        socket_channel_->enableWriting();
+    }
+    return true;
+}
+
+auto TcpConnection::writeOutputFromSpill_(int* savedErrno)
+    -> ssize_t
+{
+    auto offset = static_cast<off_t>(spill_sent_);
+    auto n      = ::sendfile(socket_channel_->getFd(), spill_fd_, &offset, static_cast<size_t>(spill_written_ - spill_sent_));
+    noteWritten_(n);
+    if (n < 0)
+    {
+        *savedErrno = errno;
+        return n;
+    }
+    spill_sent_ += static_cast<uint64_t>(n);
+    while (not spill_callbacks_.empty() and spill_callbacks_.front().first <= spill_sent_)
+    {
+        queueInOwnerLoop_([tcpconn = shared_from_this(), onWritten = std::move(spill_callbacks_.front().second)] {
+            onWritten(tcpconn);
+        });
+        spill_callbacks_.pop_front();
+    }
+    if (spill_sent_ == spill_written_)
+    {
+        // drained, the output sent from now on goes to memory again
+        closeSpill_();
+    }
+    return n;
+}
+
+void TcpConnection::closeSpill_()
+{
+    if (spill_fd_ < 0)
+    {
+        return;
+    }
+    ::close(spill_fd_);
+    spill_fd_      = -1;
+    spill_written_ = 0;
+    spill_sent_    = 0;
+    spill_callbacks_.clear();
+}
+
+auto TcpConnection::enableOutputSpill(size_t threshold, std::string dir)
+    -> bool
+{
+    getLoop()->assertInOwnerThread();
+    if (is_unix_)
+    {
+        return false;
+    }
+    spill_threshold_ = threshold;
+    spill_dir_       = std::move(dir);
+    return true;
+}
+
+auto TcpConnection::getSpillStats() const
+    -> SpillStats
+{
+    auto stats          = spill_stats_;
+    stats.pending_bytes = spill_written_ - spill_sent_;
+    return stats;
+}
+
+void TcpConnection::readZeroCopyCompletions_()
+{
+    auto control = std::array<char, CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))> {};
+    while (true)
+    {
+        auto msg           = msghdr {};
+        msg.msg_control    = control.data();
+        msg.msg_controllen = control.size();
+        if (::recvmsg(socket_channel_->getFd(), &msg, MSG_ERRQUEUE) < 0)
+        {
+            return; // EAGAIN: drained
+        }
+        for (auto* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            auto is_recverr = (cmsg->cmsg_level == SOL_IP and cmsg->cmsg_type == IP_RECVERR)
+                              or (cmsg->cmsg_level == SOL_IPV6 and cmsg->cmsg_type == IPV6_RECVERR);
+            if (not is_recverr)
+            {
+                continue;
+            }
+            auto err = sock_extended_err {};
+            std::memcpy(&err, CMSG_DATA(cmsg), sizeof err);
+            if (err.ee_errno != 0 or err.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            // [ee_info, ee_data] are done, the range may wrap around
+            auto hi     = err.ee_data;
+            auto done   = uint64_t {hi - err.ee_info} + 1;
+            auto copied = (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+            zc_stats_.completions += done;
+            zc_stats_.copied += copied ? done : 0;
+            while (not zc_inflight_.empty() and static_cast<int32_t>(zc_inflight_.front().seq - hi) <= 0)
+            {
+                zc_inflight_.pop_front();
+            }
+        }
+    }
+}
+
+auto TcpConnection::takeReceivedFds()
+    -> std::vector<int>
+{
+    getLoop()->assertInOwnerThread();
+    return std::exchange(received_fds_, {});
+}
+
+void TcpConnection::closeUntakenFds_()
+{
+    std::ranges::for_each(received_fds_, ::close);
+    received_fds_.clear();
+    for (auto& pending : pending_rights_)
+    {
+        std::ranges::for_each(pending.fds, ::close);
+    }
+    pending_rights_.clear();
+}
+
 void TcpConnection::shutdown()
 {
 
     if (auto expected = Connected; state_.compare_exchange_strong(expected, Disconnecting))
     {
-        owner_loop_->runTask([tcpconn = shared_from_this()] {
+        runInOwnerLoop_([tcpconn = shared_from_this()] {
             tcpconn->shutdownInOwnerLoop_();
         });
     }
@@ -261,7 +916,7 @@ void TcpConnection::shutdown()
 
 void TcpConnection::shutdownInOwnerLoop_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     // if 当前outputBuffer_中没有待发送的数据了 则直接关闭写端
     if (not socket_channel_->isWriting())
     {
@@ -271,17 +926,19 @@ void TcpConnection::shutdownInOwnerLoop_()
 
 void TcpConnection::postConnectionCreate_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     assert(state_ == Connecting);
     setState_(Connected);
-    socket_channel_->tie(shared_from_this());
+    self_ = shared_from_this();
     socket_channel_->enableReading();
-    connection_callback_(shared_from_this());
+    connection_callback_(self_);
 }
 
 void TcpConnection::destructConnectionInOnwerLoop_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
+    // queued after the close, its event handling is over; not left to the task queued by the close alone
+    self_.reset();
 }
 // 连接建立
 
@@ -291,7 +948,7 @@ void TcpConnection::forceClose()
     if (state_ == Connected || state_ == Disconnecting)
     {
         setState_(Disconnecting);
-        owner_loop_->queueTask([tcpconn = shared_from_this()] { tcpconn->forceCloseInOwnerLoop_(); });
+        queueInOwnerLoop_([tcpconn = shared_from_this()] { tcpconn->forceCloseInOwnerLoop_(); });
     }
 }
 
@@ -302,7 +959,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
     if (state_ == Connected || state_ == Disconnecting)
     {
         setState_(Disconnecting);
-        owner_loop_->runAfter(
+        getLoop()->runAfter(
             seconds,
             makeWeakCallback(shared_from_this(),
                              &TcpConnection::forceClose)); // not forceCloseInLoop to avoid race condition
@@ -311,7 +968,7 @@ void TcpConnection::forceCloseWithDelay(double seconds)
 
 void TcpConnection::forceCloseInOwnerLoop_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     if (state_ == Connected || state_ == Disconnecting)
     {
         // as if we received 0 byte in handleRead();
@@ -344,12 +1001,17 @@ void TcpConnection::setTcpNoDelay(bool on)
 
 void TcpConnection::startRead()
 {
-    owner_loop_->runTask([this] { startReadInOwnerLoop_(); });
+    runInOwnerLoop_([this] { startReadInOwnerLoop_(); });
 }
 
 void TcpConnection::startReadInOwnerLoop_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
+    if (throttled_)
+    {
+        reading_ = true; // resumed with the throttling
+        return;
+    }
     if (!reading_ || !socket_channel_->isReading())
     {
         socket_channel_->enableReading();
@@ -359,12 +1021,12 @@ void TcpConnection::startReadInOwnerLoop_()
 
 void TcpConnection::stopRead()
 {
-    owner_loop_->runTask([this] { stopReadInOwnerLoop_(); });
+    runInOwnerLoop_([this] { stopReadInOwnerLoop_(); });
 }
 
 void TcpConnection::stopReadInOwnerLoop_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     if (reading_ || socket_channel_->isReading())
     {
         socket_channel_->diableReading();
@@ -372,17 +1034,119 @@ void TcpConnection::stopReadInOwnerLoop_()
     }
 }
 
+void TcpConnection::pinLoop()
+{
+    getLoop()->assertInOwnerThread();
+    ++loop_pins_;
+}
+
+void TcpConnection::unpinLoop()
+{
+    getLoop()->assertInOwnerThread();
+    assert(loop_pins_ > 0);
+    --loop_pins_;
+}
+
+void TcpConnection::setReadRateLimits(RateLimit bytesPerSecond, RateLimit messagesPerSecond)
+{
+    getLoop()->assertInOwnerThread();
+    read_bytes_bucket_    = bytesPerSecond.isLimited() ? std::make_unique<TokenBucket>(bytesPerSecond) : nullptr;
+    read_messages_bucket_ = messagesPerSecond.isLimited() ? std::make_unique<TokenBucket>(messagesPerSecond) : nullptr;
+}
+
+void TcpConnection::chargeMessages(size_t count)
+{
+    getLoop()->assertInOwnerThread();
+    messages_charged_ = true;
+    if (read_messages_bucket_ != nullptr and count > 0)
+    {
+        read_messages_bucket_->consume(static_cast<double>(count));
+    }
+}
+
+void TcpConnection::chargeRead_(size_t bytes)
+{
+    auto wait = 0.0;
+    if (read_bytes_bucket_ != nullptr)
+    {
+        wait = std::max(wait, read_bytes_bucket_->consume(static_cast<double>(bytes)));
+    }
+    if (shared_inbound_bucket_ != nullptr)
+    {
+        wait = std::max(wait, shared_inbound_bucket_->consume(static_cast<double>(bytes)));
+    }
+    if (read_messages_bucket_ != nullptr)
+    {
+        wait = std::max(wait, std::exchange(messages_charged_, false) ? read_messages_bucket_->getWaitSeconds() : read_messages_bucket_->consume(1));
+    }
+    // closed by the message callback, or paused already by an earlier read of this iteration
+    if (wait <= 0 or throttled_ or state_ == Disconnected)
+    {
+        return;
+    }
+    throttled_       = true;
+    throttled_since_ = getLoop()->now();
+    ++throttles_;
+    if (shared_throttle_counters_ != nullptr)
+    {
+        shared_throttle_counters_->throttles.fetch_add(1, std::memory_order_relaxed);
+    }
+    socket_channel_->diableReading();
+    LOG_DEBUG_FMT(log, "TcpConnection::chargeRead_ [{}] - over the read rate limit, paused for {:.3f}s", name_, wait);
+    getLoop()->runAfter(wait, makeWeakCallback(shared_from_this(), &TcpConnection::resumeThrottled_));
+}
+
+void TcpConnection::resumeThrottled_()
+{
+    getLoop()->assertInOwnerThread();
+    if (not throttled_ or state_ == Disconnected)
+    {
+        return;
+    }
+    // a shared bucket may have been drained further by the other connections meanwhile
+    auto wait = shared_inbound_bucket_ != nullptr ? shared_inbound_bucket_->getWaitSeconds() : 0.0;
+    if (wait > 0)
+    {
+        getLoop()->runAfter(wait, makeWeakCallback(shared_from_this(), &TcpConnection::resumeThrottled_));
+        return;
+    }
+    throttled_ = false;
+    auto us    = static_cast<uint64_t>(getLoop()->now().microSecondsSinceEpoch() - throttled_since_.microSecondsSinceEpoch());
+    throttled_us_ += us;
+    if (shared_throttle_counters_ != nullptr)
+    {
+        shared_throttle_counters_->throttled_us.fetch_add(us, std::memory_order_relaxed);
+    }
+    if (reading_)
+    {
+        socket_channel_->enableReading();
+    }
+}
+
 // 读是相对服务器而言的 当对端客户端有数据到达 服务器端检测到EPOLLIN 就会触发该fd上的回调 handleRead 取读走对端发来的数据
 void TcpConnection::socketChannelReadCB_(Timestamp receiveTime)
 {
 
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     auto saved_errno = 0;
-    auto n           = input_buf_.readFd(socket_channel_->getFd(), &saved_errno);
+    auto n           = is_unix_
+                           ? input_buf_.readFdWithRights(socket_channel_->getFd(), &saved_errno, &received_fds_)
+                           : input_buf_.readFd(socket_channel_->getFd(), &saved_errno);
+    ++reads_;
     if (n > 0) // 有数据到达
     {
+        bytes_received_ += static_cast<uint64_t>(n);
+        last_receive_ = receiveTime;
+        ++message_callbacks_;
         // 调用用户 TcpServer 设置的回调操作设置的 MessageCallback
-        msg_callback_(shared_from_this(), input_buf_, receiveTime);
+        // timed from the loop time, the read of the clock after the callback refreshes it for the handlers after this one
+        auto callback_start = getLoop()->now();
+        msg_callback_(self_, input_buf_, receiveTime);
+        callback_us_ += static_cast<uint64_t>(getLoop()->refreshNow().microSecondsSinceEpoch() - callback_start.microSecondsSinceEpoch());
+        if (isRateLimited_())
+        {
+            chargeRead_(static_cast<size_t>(n));
+        }
     }
     else if (n == 0) //  socket对端关闭
     {
@@ -398,14 +1162,31 @@ void TcpConnection::socketChannelReadCB_(Timestamp receiveTime)
 
 void TcpConnection::socketChannelWriteCB_()
 {
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     if (socket_channel_->isWriting())
     {
         auto saved_errno = 0;
-        auto n           = output_buf_.writeFd(socket_channel_->getFd(), &saved_errno);
+        auto n           = ssize_t {0};
+        if (not payload_queue_.empty())
+        {
+            n = writeOutputWithPayloads_(&saved_errno);
+        }
+        else if (spill_fd_ >= 0 and output_buf_.getReadableBytesCount() == 0)
+        {
+            n = writeOutputFromSpill_(&saved_errno);
+        }
+        else if (pending_rights_.empty())
+        {
+            n = output_buf_.writeFd(socket_channel_->getFd(), &saved_errno);
+            noteWritten_(n);
+        }
+        else
+        {
+            n = writeOutputWithRights_(&saved_errno);
+        }
         if (n > 0)
         {
-            if (output_buf_.getReadableBytesCount() == 0) // 输出缓冲区发送完毕
+            if (output_buf_.getReadableBytesCount() == 0 and payload_queue_.empty() and spill_fd_ < 0) // 输出缓冲区发送完毕
             {
                 // 不再关注写事件,否则造成poller忙等待
                 socket_channel_->diableWriting();
@@ -414,7 +1195,7 @@ void TcpConnection::socketChannelWriteCB_()
                     // TcpConnection对象在其所在的subloop中 向 pendingFunctors_ 中加入回调
                     // why not handle it right now?
                     // make sure that tcpconnection only handle the IO, and unify call time of all callback in the eventloop
-                    owner_loop_->queueTask([tcpconn = shared_from_this()]() {
+                    queueInOwnerLoop_([tcpconn = shared_from_this()]() {
                         tcpconn->write_complete_callback_(tcpconn);
                     });
                 }
@@ -439,10 +1220,11 @@ void TcpConnection::socketChannelWriteCB_()
 void TcpConnection::socketChannelCloseCB_()
 {
      LOG_INFO_FMT(log, "TcpConnection::handleClose fd=%d state=%d", socket_channel_->getFd(), (int)state_);
-    owner_loop_->assertInOwnerThread();
+    getLoop()->assertInOwnerThread();
     assert(state_ == Disconnecting or state_ == Connected);
     // we don't close fd, leave it to dtor, so we can find leaks easily.
     setState_(Disconnected);
+    closeSpill_();
 
     socket_channel_->unregisterAllEvent();
     socket_channel_->remove();
@@ -450,10 +1232,108 @@ void TcpConnection::socketChannelCloseCB_()
     // so must be the last line
     auto guard_this = shared_from_this();
     close_callback_(guard_this);
+    // not before the events of this iteration are handled, the callbacks running may still refer to self_
+    queueInOwnerLoop_([guard_this] { guard_this->self_.reset(); });
+}
+
+void TcpConnection::runInOwnerLoop_(EventLoop::Task task)
+{
+    if (getLoop()->inOwnerThread())
+    {
+        task();
+        return;
+    }
+    queueInOwnerLoop_(std::move(task));
+}
+
+void TcpConnection::queueInOwnerLoop_(EventLoop::Task task)
+{
+    getLoop()->queueTask([self = shared_from_this(), task = std::move(task)]() mutable {
+        self->runInOwnerLoop_(std::move(task));
+    });
+}
+
+auto TcpConnection::isQuiescent_() const
+    -> bool
+{
+    return state_ == Connected and loop_pins_ == 0 and not throttled_
+           and not socket_channel_->isWriting() and output_buf_.getReadableBytesCount() == 0
+           and payload_queue_.empty() and spill_fd_ < 0 and zc_inflight_.empty() and pending_rights_.empty()
+           and socket_channel_->hasEventHandler();
+}
+
+auto TcpConnection::isRelayable_() const
+    -> bool
+{
+    return state_ == Connected and payload_queue_.empty() and spill_fd_ < 0 and zc_inflight_.empty()
+           and pending_rights_.empty() and socket_channel_->hasEventHandler();
+}
+
+void TcpConnection::migrateInOwnerLoop_(EventLoop* target, MigratedCallback cb)
+{
+    auto* loop = getLoop();
+    loop->assertInOwnerThread();
+    if (target == loop or not isQuiescent_())
+    {
+        if (cb)
+        {
+            cb(shared_from_this(), false);
+        }
+        return;
+    }
+    // the channel is bound to its loop, a new one is registered with the target's poller; level triggered, whatever
+    // arrives meanwhile is reported there
+    if (not socket_channel_->isNoneEvent())
+    {
+        socket_channel_->unregisterAllEvent();
+    }
+    socket_channel_->remove();
+    socket_channel_ = std::make_unique<Channel>(target, socket_->GetFd());
+    socket_channel_->setEventHandler(this, &TcpConnection::socketChannelEventHandler_);
+    // from here the tasks posted to the old loop follow the connection, see runInOwnerLoop_()
+    owner_loop_.store(target, std::memory_order_release);
+    target->runTask([self = self_, cb = std::move(cb)] {
+        if (self->reading_)
+        {
+            self->socket_channel_->enableReading();
+        }
+        LOG_DEBUG_FMT(log, "TcpConnection::migrateInOwnerLoop_ [{}] - migrated", self->name_);
+        if (cb)
+        {
+            cb(self, true);
+        }
+    });
+}
+
+void TcpConnection::socketChannelEventHandler_(void* self, uint32_t events, Timestamp receiveTime)
+{
+    // the order of Channel::handleEvent()
+    auto* conn = static_cast<TcpConnection*>(self);
+    if (Channel::isCloseEvent(events))
+    {
+        conn->socketChannelCloseCB_();
+    }
+    if (Channel::isErrorEvent(events))
+    {
+        conn->socketChannelErrorCB_();
+    }
+    if (Channel::isReadEvent(events))
+    {
+        conn->socketChannelReadCB_(receiveTime);
+    }
+    if (Channel::isWriteEvent(events))
+    {
+        conn->socketChannelWriteCB_();
+    }
 }
 
 void TcpConnection::socketChannelErrorCB_()
 {
+    // zerocopy completions are reported by EPOLLERR as well, they are not errors
+    if (zerocopy_threshold_ != 0)
+    {
+        readZeroCopyCompletions_();
+    }
     int optval;
     socklen_t optlen = sizeof(optval);
     auto err         = 0;
@@ -465,5 +1345,8 @@ void TcpConnection::socketChannelErrorCB_()
     {
         err = optval;
     }
-     LOG_ERROR_FMT(log,"TcpConnection::handleError name:{} - SO_ERROR:{}\n", name_, err);
+    if (err != 0)
+    {
+        LOG_ERROR_FMT(log, "TcpConnection::handleError name:{} - SO_ERROR:{}\n", name_, err);
+    }
 }
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include <cassert>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/Socket.h"
+#include "net/TcpConnection.h"
+#include "net/TcpRelay.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+static void closePipe(std::array<int, 2>& pipe)
+{
+    for (auto& fd : pipe)
+    {
+        if (fd >= 0)
+        {
+            ::close(fd);
+            fd = -1;
+        }
+    }
+}
+
+TcpRelay::TcpRelay(const TcpConnectionPtr& a, const TcpConnectionPtr& b, Options options)
+    : options_ {options}
+    , a_ {a}
+    , b_ {b}
+    , directions_ {Direction {.from = a.get(), .to = b.get()}, Direction {.from = b.get(), .to = a.get()}}
+    , splices_ {0}
+    , started_ {false}
+    , finished_ {false}
+{
+    assert(a->getLoop() == b->getLoop());
+}
+
+TcpRelay::~TcpRelay()
+{
+    for (auto& dir : directions_)
+    {
+        closePipe(dir.pipe);
+    }
+}
+
+auto TcpRelay::start()
+    -> bool
+{
+    auto a = a_.lock();
+    auto b = b_.lock();
+    assert(a != nullptr and b != nullptr and not started_);
+    a->getLoop()->assertInOwnerThread();
+    if (not a->isRelayable_() or not b->isRelayable_())
+    {
+        LOG_DEBUG_FMT(log, "TcpRelay::start [{} <-> {}] - output still pending, not relayed", a->getName(), b->getName());
+        return false;
+    }
+
+    for (auto& dir : directions_)
+    {
+        if (::pipe2(dir.pipe.data(), O_NONBLOCK | O_CLOEXEC) < 0)
+        {
+            LOG_SYSERR_FMT(log, "TcpRelay::start [{} <-> {}] - pipe2 failed", a->getName(), b->getName());
+            for (auto& created : directions_)
+            {
+                closePipe(created.pipe);
+            }
+            return false;
+        }
+        // above /proc/sys/fs/pipe-max-size for an unprivileged process, the default 64K stays
+        if (::fcntl(dir.pipe[1], F_SETPIPE_SZ, static_cast<int>(options_.pipe_size)) < 0)
+        {
+            LOG_DEBUG_FMT(log, "TcpRelay::start - F_SETPIPE_SZ {} failed, errno {}", options_.pipe_size, errno);
+        }
+    }
+    started_ = true;
+
+    auto self = shared_from_this();
+    for (size_t i = 0; i < directions_.size(); ++i)
+    {
+        auto& outgoing = directions_[i];
+        auto& incoming = directions_[1 - i];
+        auto* conn     = outgoing.from;
+        // what was read before the relay started goes first, behind what the destination had queued already
+        if (auto pending = conn->input_buf_.getReadableBytesCount(); pending > 0)
+        {
+            outgoing.to->output_buf_.append(conn->input_buf_.getReadableSV());
+            outgoing.to->output_buf_appended_ += pending;
+            outgoing.bytes += pending;
+            conn->input_buf_.readAllAndDiscard();
+        }
+        conn->socket_channel_->setReadCallback([self, &outgoing](Timestamp) { self->onReadable_(outgoing); });
+        conn->socket_channel_->setWriteCallback([self, &incoming] { self->onWritable_(incoming); });
+        conn->socket_channel_->setCloseCallback([self, conn] { self->onClose_(conn); });
+        // the callbacks replace the event handler of the connection, its error handling stays
+        conn->socket_channel_->setErrorCallback([conn] { conn->socketChannelErrorCB_(); });
+    }
+    for (auto& dir : directions_)
+    {
+        pump_(dir);
+    }
+    return true;
+}
+
+void TcpRelay::onReadable_(Direction& dir)
+{
+    if (not finished_)
+    {
+        pump_(dir);
+    }
+}
+
+void TcpRelay::onWritable_(Direction& dir)
+{
+    if (not finished_ and dir.to->socket_channel_->isWriting())
+    {
+        pump_(dir);
+    }
+}
+
+void TcpRelay::onClose_(TcpConnection* conn)
+{
+    if (finished_)
+    {
+        if (not conn->isDisconnected())
+        {
+            conn->socketChannelCloseCB_();
+        }
+        return;
+    }
+    // EPOLLHUP without EPOLLIN: both halves of the socket are shut down. If the peer's bytes are still waiting behind
+    // a backpressured direction, they are forwarded first, the HUP keeps being reported until then
+    auto& outgoing = directions_[conn == directions_[0].from ? 0 : 1];
+    if (not outgoing.done)
+    {
+        pump_(outgoing);
+        return;
+    }
+    finish_();
+}
+
+void TcpRelay::pump_(Direction& dir)
+{
+    for (auto i = 0; i < c_max_splices_per_event; ++i)
+    {
+        if (not drainPipe_(dir))
+        {
+            setInterest_(dir, false, true);
+            return;
+        }
+        if (dir.eof)
+        {
+            if (not dir.done)
+            {
+                dir.done = true;
+                dir.to->socket_->shutdownWrite();
+                LOG_DEBUG_FMT(log, "TcpRelay - {} half-closed, forwarded to {}", dir.from->getName(), dir.to->getName());
+            }
+            setInterest_(dir, false, false);
+            if (directions_[0].done and directions_[1].done)
+            {
+                finish_();
+            }
+            return;
+        }
+        auto n = ::splice(dir.from->socket_channel_->getFd(), nullptr, dir.pipe[1], nullptr, options_.pipe_size, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        ++dir.from->reads_;
+        if (n > 0)
+        {
+            dir.in_pipe += static_cast<size_t>(n);
+            dir.from->bytes_received_ += static_cast<uint64_t>(n);
+            dir.from->last_receive_ = dir.from->getLoop()->now();
+            ++splices_;
+        }
+        else if (n == 0)
+        {
+            dir.eof = true;
+        }
+        else if (errno == EAGAIN)
+        {
+            break;
+        }
+        else if (errno != EINTR)
+        {
+            LOG_DEBUG_FMT(log, "TcpRelay - splice from {} failed, errno {}", dir.from->getName(), errno);
+            finish_();
+            return;
+        }
+    }
+    setInterest_(dir, true, false);
+}
+
+auto TcpRelay::drainPipe_(Direction& dir)
+    -> bool
+{
+    auto* to  = dir.to;
+    auto fd   = to->socket_channel_->getFd();
+    auto& buf = to->output_buf_;
+    if (buf.getReadableBytesCount() > 0)
+    {
+        auto saved_errno = 0;
+        auto n           = buf.writeFd(fd, &saved_errno);
+        to->noteWritten_(n);
+        if (n <= 0 and saved_errno != EAGAIN)
+        {
+            finish_();
+            return false;
+        }
+        if (buf.getReadableBytesCount() > 0)
+        {
+            return false;
+        }
+    }
+    while (dir.in_pipe > 0)
+    {
+        auto n = ::splice(dir.pipe[0], nullptr, fd, nullptr, dir.in_pipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        to->noteWritten_(n);
+        if (n > 0)
+        {
+            dir.in_pipe -= static_cast<size_t>(n);
+            dir.bytes += static_cast<uint64_t>(n);
+            ++splices_;
+            continue;
+        }
+        if (errno == EAGAIN)
+        {
+            return false;
+        }
+        if (errno != EINTR)
+        {
+            LOG_DEBUG_FMT(log, "TcpRelay - splice to {} failed, errno {}", to->getName(), errno);
+            finish_();
+            return false;
+        }
+    }
+    return true;
+}
+
+void TcpRelay::setInterest_(Direction& dir, bool reading, bool writing)
+{
+    if (finished_)
+    {
+        return;
+    }
+    auto& source = *dir.from->socket_channel_;
+    if (reading and not source.isReading())
+    {
+        source.enableReading();
+    }
+    else if (not reading and source.isReading())
+    {
+        source.diableReading();
+    }
+    auto& destination = *dir.to->socket_channel_;
+    if (writing and not destination.isWriting())
+    {
+        destination.enableWriting();
+    }
+    else if (not writing and destination.isWriting())
+    {
+        destination.diableWriting();
+    }
+}
+
+void TcpRelay::finish_()
+{
+    if (finished_)
+    {
+        return;
+    }
+    finished_ = true;
+    if (finish_callback_)
+    {
+        finish_callback_();
+    }
+    for (auto& dir : directions_)
+    {
+        closePipe(dir.pipe);
+    }
+    // queued, the channel of the connection in hand may still be dispatching this event
+    for (const auto& weak : {a_, b_})
+    {
+        if (auto conn = weak.lock(); conn != nullptr)
+        {
+            conn->forceClose();
+        }
+    }
+}
@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <iterator>
 #include <latch>
 #include <memory>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <utility>
 
 #include "net/TcpServer.h"
 #include "net/Callbacks.h"
@@ -9,6 +14,18 @@
 
 static auto log = GET_ROOT_LOGGER();
 
+namespace {
+constexpr double c_fd_pressure_retry_seconds = 0.1;
+
+void sendIfAccepted(const TcpConnectionPtr& conn, const SharedPayload& payload, const TcpServer::BroadcastFilter& filter, const WriteCompleteCallback& onWritten)
+{
+    if (conn->isConnected() and (not filter or filter(conn)))
+    {
+        conn->sendShared(payload, onWritten);
+    }
+}
+} // namespace
+
 static auto requiresNonNull(EventLoop* loop)
     -> EventLoop*
 {
@@ -33,18 +50,104 @@ TcpServer::TcpServer(EventLoop* loop,
     , msg_callback_ {defaultMessageCallback}
     , started_ {0}
     , next_conn_id_ {1}
+    , draining_ {false}
+    , throttle_counters_ {std::make_shared<ThrottleCounters>()}
+    , accept_throttles_ {0}
+    , accept_throttled_us_ {0}
+    , accept_paused_ {0}
+    , max_connections_ {0}
+    , fd_pressure_ratio_ {0}
+    , fd_pressure_fd_ {0}
+    , lag_threshold_ {0}
+    , lag_probe_interval_ {0}
+    , lag_probe_timer_id_ {0}
+    , rejected_max_connections_ {0}
+    , shed_overloaded_ {0}
+    , fd_pressure_pauses_ {0}
+    , fd_exhausted_ {0}
+    , tcp_info_interval_ {0}
+    , tcp_info_timer_id_ {0}
+    , migration_counters_ {std::make_shared<MigrationCounters>()}
+    , rebalance_interval_ {0}
+    , rebalance_imbalance_ {0}
+    , rebalance_timer_id_ {0}
+    , metrics_ {makeMetrics_(name_)}
 {
     // there tcpserver* was captured by value, cause acceptor is a member of tcpserver
     // 当有新用户连接时，Acceptor类中绑定的acceptChannel_会有读事件发生，执行handleRead()调用TcpServer::newConnection回调
     acceptor_->setNewConnectionCallback([this](int sockfd, const InetAddress& peerAddr) {
         this->initNewConnInOwnerThread_(sockfd, peerAddr);
     });
+    acceptor_->setFdExhaustedCallback([this] {
+        this->fd_exhausted_.fetch_add(1, std::memory_order_relaxed);
+        this->metrics_.fd_exhausted.Inc();
+        this->pauseForFdPressure_();
+    });
+}
+
+TcpServer::TcpServer(EventLoop* loop,
+                     int listenFd,
+                     std::string nameArg)
+    : base_loop_ {requiresNonNull(loop)}
+    , ipport_repr_ {InetAddress::GetLocalInetAddress(listenFd).toIpPortRepr()}
+    , name_ {std::move(nameArg)}
+    , acceptor_ {new Acceptor {loop, listenFd}}
+    , threadpool_ {new EventLoopThreadPool(loop, name_)}
+    , conn_established_callback_(defaultConnectionCallback)
+    , conn_close_callback_(defaultConnectionCallback)
+    , msg_callback_ {defaultMessageCallback}
+    , started_ {0}
+    , next_conn_id_ {1}
+    , draining_ {false}
+    , throttle_counters_ {std::make_shared<ThrottleCounters>()}
+    , accept_throttles_ {0}
+    , accept_throttled_us_ {0}
+    , accept_paused_ {0}
+    , max_connections_ {0}
+    , fd_pressure_ratio_ {0}
+    , fd_pressure_fd_ {0}
+    , lag_threshold_ {0}
+    , lag_probe_interval_ {0}
+    , lag_probe_timer_id_ {0}
+    , rejected_max_connections_ {0}
+    , shed_overloaded_ {0}
+    , fd_pressure_pauses_ {0}
+    , fd_exhausted_ {0}
+    , tcp_info_interval_ {0}
+    , tcp_info_timer_id_ {0}
+    , migration_counters_ {std::make_shared<MigrationCounters>()}
+    , rebalance_interval_ {0}
+    , rebalance_imbalance_ {0}
+    , rebalance_timer_id_ {0}
+    , metrics_ {makeMetrics_(name_)}
+{
+    acceptor_->setNewConnectionCallback([this](int sockfd, const InetAddress& peerAddr) {
+        this->initNewConnInOwnerThread_(sockfd, peerAddr);
+    });
+    acceptor_->setFdExhaustedCallback([this] {
+        this->fd_exhausted_.fetch_add(1, std::memory_order_relaxed);
+        this->metrics_.fd_exhausted.Inc();
+        this->pauseForFdPressure_();
+    });
 }
 
 TcpServer::~TcpServer()
 {
     base_loop_->assertInOwnerThread();
     LOG_DEBUG_FMT(log, "TcpServer::~TcpServer[{}] destructing", name_);
+    metrics_.connections.Add(-static_cast<int64_t>(connections_.size()));
+    if (lag_probe_timer_id_ != 0)
+    {
+        base_loop_->cancelTimer(lag_probe_timer_id_);
+    }
+    if (tcp_info_timer_id_ != 0)
+    {
+        base_loop_->cancelTimer(tcp_info_timer_id_);
+    }
+    if (rebalance_timer_id_ != 0)
+    {
+        base_loop_->cancelTimer(rebalance_timer_id_);
+    }
 
     for (auto& item : connections_)
     {
@@ -52,7 +155,7 @@ TcpServer::~TcpServer()
         // 把原始的智能指针复位 让栈空间的TcpConnectionPtr conn指向该对象 当conn出了其作用域 即可释放智能指针指向的对象
         // 销毁连接
         item.second.reset();
-        conn->getLoop()->runTask([guard_conn = conn] {
+        conn->runInOwnerLoop_([guard_conn = conn] {
             if (guard_conn->state_ != TcpConnection::Disconnected)
             {
                 guard_conn->socketChannelCloseCB_();
@@ -75,6 +178,46 @@ void TcpServer::start()
         // 1. 启动底层的loop线程池
         threadpool_->start();
 
+        if (fd_pressure_ratio_ > 0)
+        {
+            auto limit = rlimit {};
+            ::getrlimit(RLIMIT_NOFILE, &limit);
+            fd_pressure_fd_ = static_cast<int>(static_cast<double>(limit.rlim_cur) * fd_pressure_ratio_);
+        }
+        if (lag_threshold_ > 0)
+        {
+            lag_probe_timer_id_ = base_loop_->runEvery(lag_probe_interval_, [weak_self = weak_from_this()] {
+                if (auto self = weak_self.lock(); self != nullptr)
+                {
+                    for (auto* io_loop : self->threadpool_->getAllLoops())
+                    {
+                        io_loop->queueTask([] {});
+                    }
+                }
+            });
+        }
+        loop_lag_gauge_ = Cot::MetricsRegistry::GetInstance().AddCallbackGauge(
+            "net_tcp_server_loop_lag_seconds", "worst task lag of the io loops of the server", Cot::MetricsRegistry::Label("server", name_),
+            [this] { return this->getAdmissionStats().loop_lag_seconds; });
+        if (tcp_info_interval_ > 0)
+        {
+            tcp_info_timer_id_ = base_loop_->runEvery(tcp_info_interval_, [weak_self = weak_from_this()] {
+                if (auto self = weak_self.lock(); self != nullptr)
+                {
+                    self->sampleTcpInfo_();
+                }
+            });
+        }
+        if (rebalance_interval_ > 0)
+        {
+            rebalance_timer_id_ = base_loop_->runEvery(rebalance_interval_, [weak_self = weak_from_this()] {
+                if (auto self = weak_self.lock(); self != nullptr)
+                {
+                    self->rebalance_();
+                }
+            });
+        }
+
         // 2.将 Acceptor::listen 任务提交到主 EventLoop 执行以启动监听
         base_loop_->runTask([this]() -> void {
             this->acceptor_->listenInOwnerThread();
@@ -92,6 +235,17 @@ void TcpServer::initNewConnInOwnerThread_(int sockfd, const InetAddress& peerAdd
     // 1. 轮询算法 选择一个subLoop 来管理 connfd 对应的 channel
     auto* choosen_io_loop = threadpool_->getNextLoop();
 
+    if (shouldReject_(choosen_io_loop))
+    {
+        LOG_DEBUG_FMT(log, "TcpServer::newConnection [{}] - rejected connection from {}", name_, peerAddr.toIpPortRepr());
+        ::close(sockfd);
+        return;
+    }
+    if (fd_pressure_fd_ > 0 and sockfd >= fd_pressure_fd_)
+    {
+        pauseForFdPressure_();
+    }
+
     // 2. 创建并初始化新连接
     // 2.1 build the new connection name
     auto buf        = std::array<char, 256> {};
@@ -116,6 +270,8 @@ void TcpServer::initNewConnInOwnerThread_(int sockfd, const InetAddress& peerAdd
                                                     peerAddr);
     // 3. 保存连接, 并设置新连接的事件回调
     connections_[new_conn_name] = new_conn;
+    metrics_.accepted.Inc();
+    metrics_.connections.Add(1);
 
     // new_conn->SetCloseCallback(
     //     std::bind(&TcpServer::RemoveConnection_, this, std::placeholders::_1));
@@ -137,6 +293,18 @@ void TcpServer::initNewConnInOwnerThread_(int sockfd, const InetAddress& peerAdd
     new_conn->setMessageCallback(msg_callback_);
     new_conn->setWriteCompleteCallback(write_complete_callback_);
 
+    // not in its loop yet, the connection is only handed over below
+    if (conn_bytes_limit_.isLimited())
+    {
+        new_conn->read_bytes_bucket_ = std::make_unique<TokenBucket>(conn_bytes_limit_);
+    }
+    if (conn_messages_limit_.isLimited())
+    {
+        new_conn->read_messages_bucket_ = std::make_unique<TokenBucket>(conn_messages_limit_);
+    }
+    new_conn->shared_inbound_bucket_    = inbound_bucket_;
+    new_conn->shared_throttle_counters_ = throttle_counters_;
+
     // 让subloop执行新连接的建立 回调TcpConnection::connectEstablished
 
     // 将连接建立的后续操作交给 ioLoop 执行
@@ -144,6 +312,417 @@ void TcpServer::initNewConnInOwnerThread_(int sockfd, const InetAddress& peerAdd
         new_conn->postConnectionCreate_();
     };
     choosen_io_loop->runTask(connnect_established_task);
+
+    if (accept_bucket_ != nullptr)
+    {
+        chargeAccept_();
+    }
+}
+
+void TcpServer::setConnectionRateLimits(RateLimit bytesPerSecond, RateLimit messagesPerSecond)
+{
+    conn_bytes_limit_    = bytesPerSecond;
+    conn_messages_limit_ = messagesPerSecond;
+}
+
+void TcpServer::setAcceptRateLimit(RateLimit connectionsPerSecond)
+{
+    accept_bucket_ = connectionsPerSecond.isLimited() ? std::make_unique<TokenBucket>(connectionsPerSecond) : nullptr;
+}
+
+void TcpServer::setInboundBandwidthLimit(RateLimit bytesPerSecond)
+{
+    inbound_bucket_ = bytesPerSecond.isLimited() ? std::make_shared<TokenBucket>(bytesPerSecond) : nullptr;
+}
+
+void TcpServer::chargeAccept_()
+{
+    auto wait = accept_bucket_->consume(1);
+    if (wait <= 0 or (accept_paused_ & c_paused_by_rate) != 0)
+    {
+        return;
+    }
+    accept_throttled_since_ = Timestamp::now();
+    accept_throttles_.fetch_add(1, std::memory_order_relaxed);
+    pauseAccepting_(c_paused_by_rate);
+    LOG_DEBUG_FMT(log, "TcpServer::chargeAccept_ [{}] - over the accept rate, paused for {:.3f}s", name_, wait);
+    base_loop_->runAfter(wait, [weak_self = weak_from_this()] {
+        if (auto self = weak_self.lock(); self != nullptr)
+        {
+            auto us = Timestamp::now().microSecondsSinceEpoch() - self->accept_throttled_since_.microSecondsSinceEpoch();
+            self->accept_throttled_us_.fetch_add(static_cast<uint64_t>(us), std::memory_order_relaxed);
+            self->resumeAccepting_(c_paused_by_rate);
+        }
+    });
+}
+
+void TcpServer::pauseAccepting_(uint8_t reason)
+{
+    base_loop_->assertInOwnerThread();
+    accept_paused_ |= reason;
+    acceptor_->stopListeningInOwnerThread();
+}
+
+void TcpServer::resumeAccepting_(uint8_t reason)
+{
+    base_loop_->assertInOwnerThread();
+    accept_paused_ &= static_cast<uint8_t>(~reason);
+    if (accept_paused_ == 0 and not draining_)
+    {
+        acceptor_->resumeListeningInOwnerThread();
+    }
+}
+
+void TcpServer::pauseForFdPressure_()
+{
+    if ((accept_paused_ & c_paused_by_fds) != 0)
+    {
+        return;
+    }
+    fd_pressure_pauses_.fetch_add(1, std::memory_order_relaxed);
+    pauseAccepting_(c_paused_by_fds);
+    LOG_WARN_FMT(log, "TcpServer::pauseForFdPressure_ [{}] - running short of fds with {} connections, accepting paused", name_, connections_.size());
+    // the fds may be freed by something else than the connections
+    base_loop_->runAfter(c_fd_pressure_retry_seconds, [weak_self = weak_from_this()] {
+        if (auto self = weak_self.lock(); self != nullptr)
+        {
+            self->resumeAccepting_(c_paused_by_fds);
+        }
+    });
+}
+
+auto TcpServer::shouldReject_(const EventLoop* ioLoop)
+    -> bool
+{
+    if (max_connections_ != 0 and connections_.size() >= max_connections_)
+    {
+        rejected_max_connections_.fetch_add(1, std::memory_order_relaxed);
+        metrics_.rejected_max_connections.Inc();
+        return true;
+    }
+    if (lag_threshold_ > 0 and ioLoop->getTaskLagSeconds() > lag_threshold_)
+    {
+        shed_overloaded_.fetch_add(1, std::memory_order_relaxed);
+        metrics_.shed_overloaded.Inc();
+        return true;
+    }
+    return false;
+}
+
+void TcpServer::setMaxConnections(size_t maxConnections)
+{
+    max_connections_ = maxConnections;
+}
+
+void TcpServer::setFdPressureThreshold(double ratio)
+{
+    fd_pressure_ratio_ = ratio;
+}
+
+void TcpServer::setOverloadShedding(double lagThresholdSeconds, double probeIntervalSeconds)
+{
+    lag_threshold_      = lagThresholdSeconds;
+    lag_probe_interval_ = probeIntervalSeconds;
+}
+
+auto TcpServer::getAdmissionStats() const
+    -> AdmissionStats
+{
+    auto lag = 0.0;
+    for (const auto* io_loop : threadpool_->getAllLoops())
+    {
+        lag = std::max(lag, io_loop->getTaskLagSeconds());
+    }
+    return AdmissionStats {
+        .rejected_max_connections = rejected_max_connections_.load(std::memory_order_relaxed),
+        .shed_overloaded          = shed_overloaded_.load(std::memory_order_relaxed),
+        .fd_pressure_pauses       = fd_pressure_pauses_.load(std::memory_order_relaxed),
+        .fd_exhausted             = fd_exhausted_.load(std::memory_order_relaxed),
+        .loop_lag_seconds         = lag,
+    };
+}
+
+auto TcpServer::getRateLimitStats() const
+    -> RateLimitStats
+{
+    return RateLimitStats {
+        .accept_throttles         = accept_throttles_.load(std::memory_order_relaxed),
+        .accept_throttled_seconds = static_cast<double>(accept_throttled_us_.load(std::memory_order_relaxed)) / 1e6,
+        .read_throttles           = throttle_counters_->throttles.load(std::memory_order_relaxed),
+        .read_throttled_seconds   = static_cast<double>(throttle_counters_->throttled_us.load(std::memory_order_relaxed)) / 1e6,
+    };
+}
+
+auto TcpServer::makeMetrics_(const std::string& name)
+    -> Metrics
+{
+    auto& registry = Cot::MetricsRegistry::GetInstance();
+    auto server    = Cot::MetricsRegistry::Label("server", name);
+    auto rejected  = [&](std::string_view reason) -> Cot::Counter& {
+        return registry.GetCounter("net_tcp_connections_rejected_total", "connections closed right after accept",
+                                   server + "," + Cot::MetricsRegistry::Label("reason", reason));
+    };
+    return Metrics {
+        .accepted                 = registry.GetCounter("net_tcp_connections_accepted_total", "connections accepted and served", server),
+        .closed                   = registry.GetCounter("net_tcp_connections_closed_total", "connections removed after closing", server),
+        .connections              = registry.GetGauge("net_tcp_connections", "connections open", server),
+        .rejected_max_connections = rejected("max_connections"),
+        .shed_overloaded          = rejected("overloaded"),
+        .fd_exhausted             = rejected("fd_exhausted"),
+        .migrated                 = registry.GetCounter("net_tcp_connections_migrated_total", "connections moved to another io loop", server),
+    };
+}
+
+void TcpServer::setTcpInfoSampling(double intervalSeconds)
+{
+    tcp_info_interval_ = intervalSeconds;
+}
+
+auto TcpServer::groupConnectionsByLoop_() const
+    -> std::unordered_map<EventLoop*, std::vector<TcpConnectionPtr>>
+{
+    auto by_loop = std::unordered_map<EventLoop*, std::vector<TcpConnectionPtr>> {};
+    for (const auto& [_, conn] : connections_)
+    {
+        by_loop[conn->getLoop()].push_back(conn);
+    }
+    return by_loop;
+}
+
+void TcpServer::sampleTcpInfo_()
+{
+    base_loop_->assertInOwnerThread();
+    for (auto& [io_loop, conns] : groupConnectionsByLoop_())
+    {
+        io_loop->runTask([conns = std::move(conns)] {
+            for (const auto& conn : conns)
+            {
+                // may have been migrated meanwhile
+                if (conn->isConnected() and conn->getLoop()->inOwnerThread())
+                {
+                    conn->sampleTcpInfo();
+                }
+            }
+        });
+    }
+}
+
+void TcpServer::migrateConnection(const TcpConnectionPtr& conn, EventLoop* target, TcpConnection::MigratedCallback migratedCb)
+{
+    auto done = [counters = migration_counters_, &migrated_total = metrics_.migrated, migratedCb = std::move(migratedCb)](const TcpConnectionPtr& migratedConn, bool migrated) {
+        if (migrated)
+        {
+            counters->migrations.fetch_add(1, std::memory_order_relaxed);
+            migrated_total.Inc();
+        }
+        else
+        {
+            counters->refused.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (migratedCb)
+        {
+            migratedCb(migratedConn, migrated);
+        }
+    };
+    // queued: never in the middle of handling an event of the connection
+    conn->queueInOwnerLoop_([conn, target, done = std::move(done)]() mutable {
+        conn->migrateInOwnerLoop_(target, std::move(done));
+    });
+}
+
+void TcpServer::setRebalancing(double intervalSeconds, double imbalance)
+{
+    rebalance_interval_  = intervalSeconds;
+    rebalance_imbalance_ = imbalance;
+}
+
+auto TcpServer::getRebalanceStats() const
+    -> RebalanceStats
+{
+    return RebalanceStats {
+        .migrations = migration_counters_->migrations.load(std::memory_order_relaxed),
+        .refused    = migration_counters_->refused.load(std::memory_order_relaxed),
+    };
+}
+
+void TcpServer::rebalance_()
+{
+    base_loop_->assertInOwnerThread();
+    auto now      = base_loop_->now();
+    auto* busiest = static_cast<EventLoop*>(nullptr);
+    auto* idlest  = static_cast<EventLoop*>(nullptr);
+    auto max      = 0.0;
+    auto min      = 0.0;
+    for (auto* io_loop : threadpool_->getAllLoops())
+    {
+        auto sample = LoadSample {.seconds = io_loop->getBusySeconds(), .when = now};
+        auto it     = loop_busy_samples_.find(io_loop);
+        if (it == loop_busy_samples_.end())
+        {
+            loop_busy_samples_.emplace(io_loop, sample);
+            continue;
+        }
+        auto elapsed = timeDifference(now, it->second.when);
+        if (elapsed <= 0)
+        {
+            continue;
+        }
+        auto ratio = (sample.seconds - it->second.seconds) / elapsed;
+        it->second = sample;
+        if (busiest == nullptr or ratio > max)
+        {
+            busiest = io_loop;
+            max     = ratio;
+        }
+        if (idlest == nullptr or ratio < min)
+        {
+            idlest = io_loop;
+            min    = ratio;
+        }
+    }
+    if (busiest == idlest or max - min <= rebalance_imbalance_)
+    {
+        return;
+    }
+    auto by_loop = groupConnectionsByLoop_();
+    auto it      = by_loop.find(busiest);
+    if (it == by_loop.end())
+    {
+        return;
+    }
+    LOG_DEBUG_FMT(log, "TcpServer::rebalance_ [{}] - busy ratios {:.2f} and {:.2f}, looking for a connection to move", name_, max, min);
+    busiest->runTask([weak_self = weak_from_this(), base_loop = base_loop_, conns = std::move(it->second), idlest, gap = max - min] {
+        auto loads = std::vector<std::pair<TcpConnectionPtr, double>> {};
+        loads.reserve(conns.size());
+        for (const auto& conn : conns)
+        {
+            if (conn->isConnected() and conn->getLoop()->inOwnerThread() and not conn->isLoopPinned())
+            {
+                loads.emplace_back(conn, conn->getTrafficStats().callback_seconds);
+            }
+        }
+        base_loop->runTask([weak_self, loads = std::move(loads), idlest, gap]() mutable {
+            if (auto self = weak_self.lock(); self != nullptr)
+            {
+                self->migrateHeaviest_(std::move(loads), idlest, gap);
+            }
+        });
+    });
+}
+
+void TcpServer::migrateHeaviest_(std::vector<std::pair<TcpConnectionPtr, double>> loads, EventLoop* idlest, double gap)
+{
+    base_loop_->assertInOwnerThread();
+    auto now        = base_loop_->now();
+    auto heaviest   = TcpConnectionPtr {};
+    auto heaviest_r = 0.0;
+    for (auto& [conn, seconds] : loads)
+    {
+        auto sample = LoadSample {.seconds = seconds, .when = now};
+        auto it     = conn_callback_samples_.find(conn->getName());
+        if (it == conn_callback_samples_.end())
+        {
+            conn_callback_samples_.emplace(conn->getName(), sample);
+            continue;
+        }
+        auto elapsed = timeDifference(now, it->second.when);
+        auto ratio   = elapsed > 0 ? (seconds - it->second.seconds) / elapsed : 0.0;
+        it->second   = sample;
+        if (ratio < gap and ratio > heaviest_r)
+        {
+            heaviest   = conn;
+            heaviest_r = ratio;
+        }
+    }
+    if (heaviest == nullptr)
+    {
+        return;
+    }
+    LOG_INFO_FMT(log, "TcpServer::rebalance_ [{}] - moving {}, {:.2f} of its loop", name_, heaviest->getName(), heaviest_r);
+    migrateConnection(heaviest, idlest);
+}
+
+void TcpServer::broadcast(SharedPayload payload, BroadcastFilter filter, WriteCompleteCallback onWritten)
+{
+    assert(payload != nullptr);
+    base_loop_->runTask([this, payload = std::move(payload), filter = std::move(filter), onWritten = std::move(onWritten)]() mutable {
+        this->broadcastInOwnerThread_(std::move(payload), std::move(filter), std::move(onWritten));
+    });
+}
+
+void TcpServer::broadcastInOwnerThread_(SharedPayload payload, BroadcastFilter filter, WriteCompleteCallback onWritten)
+{
+    base_loop_->assertInOwnerThread();
+    for (auto& [io_loop, conns] : groupConnectionsByLoop_())
+    {
+        io_loop->runTask([payload, filter, onWritten, conns = std::move(conns)] {
+            for (const auto& conn : conns)
+            {
+                if (conn->getLoop()->inOwnerThread())
+                {
+                    sendIfAccepted(conn, payload, filter, onWritten);
+                    continue;
+                }
+                // migrated meanwhile, the filter runs in the new loop
+                conn->runInOwnerLoop_([conn, payload, filter, onWritten] {
+                    sendIfAccepted(conn, payload, filter, onWritten);
+                });
+            }
+        });
+    }
+}
+
+void TcpServer::collectConnectionStats(ConnectionStatsCallback statsCb)
+{
+    base_loop_->runTask([this, statsCb = std::move(statsCb)]() mutable {
+        this->collectConnectionStatsInOwnerThread_(std::move(statsCb));
+    });
+}
+
+void TcpServer::collectConnectionStatsInOwnerThread_(ConnectionStatsCallback statsCb)
+{
+    base_loop_->assertInOwnerThread();
+    auto by_loop = groupConnectionsByLoop_();
+    if (by_loop.empty())
+    {
+        statsCb({});
+        return;
+    }
+
+    struct Collecting
+    {
+        std::vector<ConnectionStats> stats;
+        size_t loops_left;
+        ConnectionStatsCallback stats_cb;
+    };
+    auto collecting = std::make_shared<Collecting>(Collecting {.stats = {}, .loops_left = by_loop.size(), .stats_cb = std::move(statsCb)});
+    collecting->stats.reserve(connections_.size());
+    for (auto& [io_loop, conns] : by_loop)
+    {
+        io_loop->runTask([base_loop = base_loop_, collecting, conns = std::move(conns)] {
+            auto part = std::vector<ConnectionStats> {};
+            part.reserve(conns.size());
+            for (const auto& conn : conns)
+            {
+                if (conn->isConnected() and conn->getLoop()->inOwnerThread())
+                {
+                    part.push_back(ConnectionStats {
+                        .name     = conn->getName(),
+                        .peer     = conn->getPeerAddress(),
+                        .traffic  = conn->getTrafficStats(),
+                        .tcp_info = conn->getTcpInfoSample(),
+                    });
+                }
+            }
+            base_loop->runTask([collecting, part = std::move(part)]() mutable {
+                std::ranges::move(part, std::back_inserter(collecting->stats));
+                if (--collecting->loops_left == 0)
+                {
+                    collecting->stats_cb(std::move(collecting->stats));
+                }
+            });
+        });
+    }
 }
 
 void TcpServer::removeConnection_(const TcpConnectionPtr& conn)
@@ -161,7 +740,60 @@ void TcpServer::removeConnectionInOwnerThread_(const TcpConnectionPtr& conn)
 
     LOG_INFO_FMT(log, "TcpServer::removeConnectionInLoop [{}] - connection {}", name_, conn->getName());
     connections_.erase(conn->getName());
-    auto* io_loop = conn->getLoop();
+    metrics_.closed.Inc();
+    metrics_.connections.Add(-1);
+    if ((accept_paused_ & c_paused_by_fds) != 0 and fd_pressure_fd_ > 0)
+    {
+        // its fd is only closed once the connection is destructed, the headroom under the threshold covers that;
+        // after EMFILE there is none, an accept too early would cost a connection, the retry timer resumes then
+        resumeAccepting_(c_paused_by_fds);
+    }
+    conn_callback_samples_.erase(conn->getName());
     // make sure tcpconn destruct in owner loop thread, 单一职责，线程安全
-    io_loop->queueTask([tcpconn = conn] { tcpconn->destructConnectionInOnwerLoop_(); });
+    conn->queueInOwnerLoop_([tcpconn = conn] { tcpconn->destructConnectionInOnwerLoop_(); });
+    notifyDrainedIfDone_();
+}
+
+void TcpServer::drain(double timeoutSeconds, std::function<void()> drainedCb)
+{
+    base_loop_->runTask([this, timeoutSeconds, drainedCb = std::move(drainedCb)]() mutable {
+        this->drainInOwnerThread_(timeoutSeconds, std::move(drainedCb));
+    });
+}
+
+void TcpServer::drainInOwnerThread_(double timeoutSeconds, std::function<void()> drainedCb)
+{
+    base_loop_->assertInOwnerThread();
+    if (draining_)
+    {
+        return;
+    }
+    draining_         = true;
+    drained_callback_ = std::move(drainedCb);
+    acceptor_->stopListeningInOwnerThread();
+    LOG_INFO_FMT(log, "TcpServer::drain [{}] - {} connections left, deadline {}s", name_, connections_.size(), timeoutSeconds);
+
+    base_loop_->runAfter(timeoutSeconds, [weak_self = weak_from_this()] {
+        auto self = weak_self.lock();
+        if (self == nullptr or self->connections_.empty())
+        {
+            return;
+        }
+        LOG_WARN_FMT(log, "TcpServer::drain [{}] - deadline reached, closing {} connections", self->name_, self->connections_.size());
+        for (const auto& [_, conn] : self->connections_)
+        {
+            conn->forceClose();
+        }
+    });
+    notifyDrainedIfDone_();
+}
+
+void TcpServer::notifyDrainedIfDone_()
+{
+    if (draining_ and connections_.empty() and drained_callback_)
+    {
+        LOG_INFO_FMT(log, "TcpServer::drain [{}] - drained", name_);
+        // the callback may destroy the server
+        base_loop_->queueTask(std::exchange(drained_callback_, nullptr));
+    }
 }
\ No newline at end of file
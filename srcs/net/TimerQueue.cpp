@@ -30,11 +30,11 @@ auto createTimerfd()
 /**
  * @brief 计算从现在到指定时间戳之间的相对时间间隔
  */
-auto howMuchTimeFromNow(Timestamp when)
+auto howMuchTimeFromNow(Timestamp when, Timestamp now)
     -> struct timespec
 {
     auto microseconds = when.microSecondsSinceEpoch()
-                        - Timestamp::now().microSecondsSinceEpoch();
+                        - now.microSecondsSinceEpoch();
     // 最小超时设为 100 微秒，避免过于频繁或立即触发
     microseconds = microseconds < 100 ? 100 : microseconds;
     struct timespec ts;
@@ -63,14 +63,14 @@ readTimerfd(int timerfd, [[maybe_unused]] Timestamp now)
 /**
  * @brief 设置或重置 timerfd 的下一次到期时间
  */
-void resetTimerfd(int timerfd, Timestamp expiration)
+void resetTimerfd(int timerfd, Timestamp expiration, Timestamp now)
 {
     // wake up loop by timerfd_settime()
     auto new_value = itimerspec {};
     auto old_value = itimerspec {};
 
     // 计算相对超时时间
-    new_value.it_value = howMuchTimeFromNow(expiration);
+    new_value.it_value = howMuchTimeFromNow(expiration, now);
 
     // flag = 0 new_value 中的时间是相对时间，不关心 oldValue
     auto ret = ::timerfd_settime(timerfd, 0, &new_value, &old_value);
@@ -85,6 +85,8 @@ TimerQueue::TimerQueue(EventLoop* loop)
     , timerfd_ {createTimerfd()}
     , timerfd_channel_ {loop, timerfd_}
     , calling_expired_timers_ {false}
+    , poll_timeout_driven_ {false}
+    , slack_us_ {0}
 {
 
     timerfd_channel_.setReadCallback([timerqueue = this](Timestamp) { timerqueue->timerChannelReadCB_(); });
@@ -133,7 +135,7 @@ void TimerQueue::addTimerInOwnerLoop_(std::unique_ptr<Timer, TimerDeleter> timer
     if (is_earliest) // 如果新插入的定时器成为了最早到期的
     {
         // 重置 timerfd 的超时时间为这个新定时器的到期时间
-        resetTimerfd(timerfd_,  next_expire_time);
+        arm_();
     }
 }
 
@@ -173,10 +175,18 @@ void TimerQueue::timerChannelReadCB_()
 {
     owner_loop_->assertInOwnerThread();
 
-    auto now = Timestamp::now();
-
     // 1. 读取 timerfd，清空事件，避免重复触发
-    readTimerfd(timerfd_, now);
+    readTimerfd(timerfd_, owner_loop_->now());
+
+    runExpired();
+}
+
+void TimerQueue::runExpired()
+{
+    owner_loop_->assertInOwnerThread();
+
+    // the loop time of this poll return, a coarse clock lags the timerfd by up to a tick: what is due within it is due
+    auto now = addTime(owner_loop_->now(), owner_loop_->getClockResolution());
 
     // 2. 获取所有在 'now' 时刻之前或同时到期的定时器
     auto expired = getExpired_(now);
@@ -256,16 +266,68 @@ void TimerQueue::reset_(std::vector<Entry>& expired, Timestamp now)
         }
     }
 
-    auto next_expire = Timestamp {};
-    if (not timers_.empty()) // 如果还有未到期的定时器
+    // 如果还有未到期的定时器 设置下一次到期时间
+    arm_();
+}
+
+auto TimerQueue::getWakeupTime_() const
+    -> Timestamp
+{
+    assert(not timers_.empty());
+    return Timestamp {static_cast<uint64_t>(timers_.begin()->first.microSecondsSinceEpoch() + slack_us_)};
+}
+
+void TimerQueue::arm_()
+{
+    if (poll_timeout_driven_ or timers_.empty())
+    {
+        return;
+    }
+    // a relative alarm: from the loop time, stale by whatever ran since it was read, it would go off that much later
+    resetTimerfd(timerfd_, getWakeupTime_(), owner_loop_->readClock_());
+}
+
+void TimerQueue::setPollTimeoutDriven(bool on)
+{
+    owner_loop_->assertInOwnerThread();
+    if (on == poll_timeout_driven_)
+    {
+        return;
+    }
+    poll_timeout_driven_ = on;
+    if (on)
+    {
+        // an alarm still armed only makes the fd readable, nobody polls it any more
+        timerfd_channel_.unregisterAllEvent();
+    }
+    else
     {
-        next_expire = timers_.begin()->second->getExpiration();
+        timerfd_channel_.enableReading();
+        arm_();
     }
+}
 
-    if (next_expire.valid()) // 如果存在下一个有效到期时间
+void TimerQueue::setSlack(double seconds)
+{
+    owner_loop_->assertInOwnerThread();
+    slack_us_ = static_cast<int64_t>(std::max(seconds, 0.0) * Timestamp::c_micro_seconds_per_second);
+    arm_();
+}
+
+auto TimerQueue::getPollTimeoutMs(int maxMs) const
+    -> int
+{
+    if (timers_.empty())
+    {
+        return maxMs;
+    }
+    auto us = getWakeupTime_().microSecondsSinceEpoch() - owner_loop_->now().microSecondsSinceEpoch();
+    if (us <= 0)
     {
-        resetTimerfd(timerfd_, next_expire);
+        return 0;
     }
+    // rounded up, waking before the timer is due would only poll again
+    return static_cast<int>(std::min<int64_t>((us + 999) / 1000, maxMs));
 }
 
 auto TimerQueue::insert_(std::unique_ptr<Timer, TimerDeleter> timer)
@@ -2,6 +2,7 @@
 
 #include "net/Timestamp.h"
 #include "common/alias.h"
+#include "common/coarseclock.h"
 #include "sys/time.h"
 #include <array>
 #include <format>
@@ -27,6 +28,13 @@ auto Timestamp::now()
     return Timestamp{ seconds * c_micro_seconds_per_second + tv.tv_usec };
 }
 
+auto Timestamp::nowCoarse()
+    -> Timestamp
+{
+    auto since_epoch = Cot::CoarseSystemClock::now().time_since_epoch();
+    return Timestamp{ static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(since_epoch).count()) };
+}
+
 auto Timestamp::toString() const
     -> std::string
 {
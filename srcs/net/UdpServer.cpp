@@ -0,0 +1,78 @@
+#include "net/UdpServer.h"
+#include "net/EventLoop.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+UdpServer::UdpServer(EventLoop* loop,
+                     const InetAddress& listenAddr,
+                     std::string nameArg)
+    : base_loop_ {loop}
+    , listen_addr_ {listenAddr}
+    , name_ {std::move(nameArg)}
+    , threadpool_ {new EventLoopThreadPool(loop, name_)}
+    , batch_size_ {UdpSocket::c_default_batch_size}
+    , slot_size_ {UdpSocket::c_default_slot_size}
+    , started_ {0}
+{
+}
+
+UdpServer::~UdpServer()
+{
+    base_loop_->assertInOwnerThread();
+    LOG_DEBUG_FMT(log, "UdpServer::~UdpServer[{}] destructing", name_);
+    for (auto& socket : sockets_)
+    {
+        socket->stop();
+    }
+}
+
+void UdpServer::setThreadNum(int numThreads)
+{
+    threadpool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start()
+{
+    if (started_++ == 0)
+    {
+        threadpool_->start();
+        auto loops = threadpool_->getAllLoops();
+        // 只有一个 socket 时不需要 SO_REUSEPORT, 避免与其他进程意外共享端口
+        auto reuse_port = loops.size() > 1;
+        auto bind_addr  = listen_addr_;
+        for (auto* loop : loops)
+        {
+            auto socket = std::make_shared<UdpSocket>(loop, bind_addr, reuse_port, batch_size_, slot_size_);
+            // port 0: the rest must join the port the kernel picked for the first one
+            bind_addr = socket->getLocalAddress();
+            socket->setMessageCallback(msg_callback_);
+            sockets_.push_back(socket);
+        }
+        for (auto& socket : sockets_)
+        {
+            socket->start();
+        }
+        LOG_INFO_FMT(log, "UdpServer[{}] - serving {} with {} sockets", name_, bind_addr.toIpPortRepr(), sockets_.size());
+    }
+}
+
+auto UdpServer::getStats() const
+    -> UdpSocket::Stats
+{
+    auto total = UdpSocket::Stats {};
+    for (const auto& socket : sockets_)
+    {
+        auto stats = socket->getStats();
+        total.rx_datagrams += stats.rx_datagrams;
+        total.rx_bytes += stats.rx_bytes;
+        total.rx_truncated += stats.rx_truncated;
+        total.rx_syscalls += stats.rx_syscalls;
+        total.tx_datagrams += stats.tx_datagrams;
+        total.tx_bytes += stats.tx_bytes;
+        total.tx_syscalls += stats.tx_syscalls;
+        total.tx_dropped += stats.tx_dropped;
+    }
+    return total;
+}
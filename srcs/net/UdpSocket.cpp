@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+
+#include "net/UdpSocket.h"
+#include "net/Channel.h"
+#include "net/EventLoop.h"
+#include "net/Socketsops.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+// sendmmsg(2) takes at most UIO_MAXIOV messages per call
+constexpr size_t c_max_send_batch = 1024;
+
+} // namespace
+
+UdpSocket::UdpSocket(EventLoop* loop,
+                     const InetAddress& localAddr,
+                     bool reusePort,
+                     size_t batchSize,
+                     size_t slotSize)
+    : loop_ {loop}
+    , socket_ {Sock::createNonblockingDgramOrDie(localAddr.getFamily())}
+    , local_addr_ {localAddr}
+    , channel_ {std::make_unique<Channel>(loop, socket_.GetFd())}
+    , started_ {false}
+    , stopped_ {false}
+    , batch_size_ {std::max<size_t>(batchSize, 1)}
+    , slot_size_ {std::max<size_t>(slotSize, 1)}
+    , rx_buffer_(batch_size_ * slot_size_)
+    , rx_addrs_(batch_size_)
+    , rx_iovecs_(batch_size_)
+    , rx_msgs_(batch_size_)
+    , pending_head_ {0}
+    , flush_queued_ {false}
+    , rx_datagrams_count_ {0}
+    , rx_bytes_count_ {0}
+    , rx_truncated_count_ {0}
+    , rx_syscalls_count_ {0}
+    , tx_datagrams_count_ {0}
+    , tx_bytes_count_ {0}
+    , tx_syscalls_count_ {0}
+    , tx_dropped_count_ {0}
+{
+    socket_.setReuseAddr(true);
+    socket_.setReusePort(reusePort);
+    socket_.bindAddress(localAddr);
+    local_addr_ = InetAddress {Sock::getLocalAddr(socket_.GetFd())};
+
+    // the slots never move, the msghdrs point at them once for all
+    for (size_t i = 0; i < batch_size_; ++i)
+    {
+        rx_iovecs_[i].iov_base = rx_buffer_.data() + i * slot_size_;
+        rx_iovecs_[i].iov_len  = slot_size_;
+        auto& hdr              = rx_msgs_[i].msg_hdr;
+        hdr.msg_name           = &rx_addrs_[i];
+        hdr.msg_iov            = &rx_iovecs_[i];
+        hdr.msg_iovlen         = 1;
+    }
+    rx_datagrams_.reserve(batch_size_);
+
+    channel_->setReadCallback([this](Timestamp receiveTime) {
+        this->socketReadableCB_(receiveTime);
+    });
+    channel_->setWriteCallback([this] {
+        this->socketWritableCB_();
+    });
+    LOG_DEBUG_FMT(log, "UdpSocket::UdpSocket bound to {} [fd-{}]", local_addr_.toIpPortRepr(), socket_.GetFd());
+}
+
+UdpSocket::~UdpSocket()
+{
+    LOG_DEBUG_FMT(log, "UdpSocket::~UdpSocket {} [fd-{}]", local_addr_.toIpPortRepr(), socket_.GetFd());
+    // Socket closes the fd
+}
+
+void UdpSocket::start()
+{
+    if (not started_.exchange(true))
+    {
+        loop_->runTask([weak_self = weak_from_this()] {
+            if (auto self = weak_self.lock(); self != nullptr)
+            {
+                self->startInOwnerThread_();
+            }
+        });
+    }
+}
+
+void UdpSocket::startInOwnerThread_()
+{
+    loop_->assertInOwnerThread();
+    channel_->tie(shared_from_this());
+    channel_->enableReading();
+}
+
+void UdpSocket::stop()
+{
+    if (started_.exchange(false))
+    {
+        loop_->runTask([self = shared_from_this()] {
+            self->stopInOwnerThread_();
+        });
+    }
+}
+
+void UdpSocket::stopInOwnerThread_()
+{
+    loop_->assertInOwnerThread();
+    stopped_ = true;
+    channel_->unregisterAllEvent();
+    channel_->remove();
+    pending_.clear();
+    pending_bytes_.clear();
+    pending_head_ = 0;
+}
+
+void UdpSocket::socketReadableCB_(Timestamp receiveTime)
+{
+    loop_->assertInOwnerThread();
+    auto self = shared_from_this();
+    for (auto round = 0; round < c_max_reads_per_event; ++round)
+    {
+        for (auto& msg : rx_msgs_)
+        {
+            // recvmmsg overwrites them
+            msg.msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+            msg.msg_hdr.msg_flags   = 0;
+        }
+        auto n = Sock::RecvMmsg(socket_.GetFd(), rx_msgs_.data(), static_cast<unsigned int>(batch_size_));
+        rx_syscalls_count_.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0)
+        {
+            auto saved_errno = errno;
+            if (saved_errno != EAGAIN and saved_errno != EWOULDBLOCK and saved_errno != EINTR)
+            {
+                // e.g. ECONNREFUSED reported by ICMP for an earlier send, the socket is still usable
+                LOG_WARN_FMT(log, "UdpSocket::socketReadableCB_ {} {}", saved_errno, strerror(saved_errno));
+            }
+            return;
+        }
+
+        rx_datagrams_.clear();
+        auto bytes = uint64_t {0};
+        for (auto i = 0; i < n; ++i)
+        {
+            const auto& msg = rx_msgs_[i];
+            auto truncated  = (msg.msg_hdr.msg_flags & MSG_TRUNC) != 0;
+            auto len        = std::min<size_t>(msg.msg_len, slot_size_);
+            rx_datagrams_.push_back(Datagram {
+                .peer      = InetAddress {rx_addrs_[i]},
+                .payload   = std::string_view {static_cast<const char*>(rx_iovecs_[i].iov_base), len},
+                .truncated = truncated,
+            });
+            bytes += len;
+            if (truncated)
+            {
+                rx_truncated_count_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        rx_datagrams_count_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        rx_bytes_count_.fetch_add(bytes, std::memory_order_relaxed);
+
+        if (message_callback_ and n > 0)
+        {
+            message_callback_(self, std::span<const Datagram> {rx_datagrams_}, receiveTime);
+        }
+        if (stopped_ or static_cast<size_t>(n) < batch_size_) // stopped in the callback or drained
+        {
+            return;
+        }
+    }
+}
+
+void UdpSocket::socketWritableCB_()
+{
+    loop_->assertInOwnerThread();
+    flushPending_();
+}
+
+void UdpSocket::send(const InetAddress& peer, std::string_view data)
+{
+    if (loop_->inOwnerThread())
+    {
+        sendInOwnerThread_(peer, data);
+    }
+    else
+    {
+        loop_->runTask([weak_self = weak_from_this(), peer, data = std::string {data}] {
+            if (auto self = weak_self.lock(); self != nullptr)
+            {
+                self->sendInOwnerThread_(peer, data);
+            }
+        });
+    }
+}
+
+void UdpSocket::sendInOwnerThread_(const InetAddress& peer, std::string_view data)
+{
+    if (stopped_ or pending_.size() - pending_head_ >= c_max_pending_datagrams)
+    {
+        tx_dropped_count_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    pending_.push_back(PendingDatagram {peer, pending_bytes_.size(), data.size()});
+    pending_bytes_.append(data);
+
+    // 正在等待可写事件时, 由 socketWritableCB_ 发送
+    if (not flush_queued_ and not channel_->isWriting())
+    {
+        flush_queued_ = true;
+        loop_->queueTask([weak_self = weak_from_this()] {
+            if (auto self = weak_self.lock(); self != nullptr)
+            {
+                self->flush_queued_ = false;
+                if (not self->stopped_)
+                {
+                    self->flushPending_();
+                }
+            }
+        });
+    }
+}
+
+void UdpSocket::flush()
+{
+    loop_->assertInOwnerThread();
+    if (not stopped_)
+    {
+        flushPending_();
+    }
+}
+
+void UdpSocket::flushPending_()
+{
+    while (pending_head_ < pending_.size())
+    {
+        auto count = std::min(pending_.size() - pending_head_, c_max_send_batch);
+        tx_iovecs_.resize(count);
+        tx_msgs_.assign(count, mmsghdr {});
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto& datagram   = pending_[pending_head_ + i];
+            tx_iovecs_[i].iov_base = pending_bytes_.data() + datagram.offset;
+            tx_iovecs_[i].iov_len  = datagram.len;
+            auto& hdr              = tx_msgs_[i].msg_hdr;
+            hdr.msg_name           = const_cast<sockaddr*>(datagram.peer.getSockAddr());
+            hdr.msg_namelen        = datagram.peer.getSockLen();
+            hdr.msg_iov            = &tx_iovecs_[i];
+            hdr.msg_iovlen         = 1;
+        }
+
+        auto n = Sock::SendMmsg(socket_.GetFd(), tx_msgs_.data(), static_cast<unsigned int>(count));
+        tx_syscalls_count_.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0)
+        {
+            auto saved_errno = errno;
+            if (saved_errno == EAGAIN or saved_errno == EWOULDBLOCK or saved_errno == ENOBUFS)
+            {
+                if (not channel_->isWriting())
+                {
+                    channel_->enableWriting();
+                }
+                return;
+            }
+            if (saved_errno == EINTR)
+            {
+                continue;
+            }
+            // the first datagram is rejected (e.g. EMSGSIZE, ECONNREFUSED), drop it and go on with the rest
+            LOG_WARN_FMT(log, "UdpSocket::flushPending_ to {} - {} {}", pending_[pending_head_].peer.toIpPortRepr(), saved_errno, strerror(saved_errno));
+            tx_dropped_count_.fetch_add(1, std::memory_order_relaxed);
+            ++pending_head_;
+            continue;
+        }
+
+        auto bytes = uint64_t {0};
+        for (auto i = 0; i < n; ++i)
+        {
+            bytes += tx_iovecs_[i].iov_len;
+        }
+        tx_datagrams_count_.fetch_add(static_cast<uint64_t>(n), std::memory_order_relaxed);
+        tx_bytes_count_.fetch_add(bytes, std::memory_order_relaxed);
+        pending_head_ += static_cast<size_t>(n);
+    }
+
+    // 全部发出, 复用缓冲区
+    pending_.clear();
+    pending_bytes_.clear();
+    pending_head_ = 0;
+    if (channel_->isWriting())
+    {
+        channel_->diableWriting();
+    }
+}
+
+auto UdpSocket::getStats() const
+    -> Stats
+{
+    return Stats {
+        .rx_datagrams = rx_datagrams_count_.load(std::memory_order_relaxed),
+        .rx_bytes     = rx_bytes_count_.load(std::memory_order_relaxed),
+        .rx_truncated = rx_truncated_count_.load(std::memory_order_relaxed),
+        .rx_syscalls  = rx_syscalls_count_.load(std::memory_order_relaxed),
+        .tx_datagrams = tx_datagrams_count_.load(std::memory_order_relaxed),
+        .tx_bytes     = tx_bytes_count_.load(std::memory_order_relaxed),
+        .tx_syscalls  = tx_syscalls_count_.load(std::memory_order_relaxed),
+        .tx_dropped   = tx_dropped_count_.load(std::memory_order_relaxed),
+    };
+}
@@ -0,0 +1,141 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr int c_backlogged = 5;
+
+auto connectBlocking(uint16_t port)
+    -> int
+{
+    auto fd   = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    auto addr = sockaddr_in {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0);
+    return fd;
+}
+
+} // namespace
+
+// three servers in one loop, one after the other:
+// 1. at most 2 connections, three clients connect: one of them is closed
+// 2. shedding over 50ms of lag, the io thread sleeps 0.3s in the first connection's callback: a client connecting
+//    meanwhile is closed, one connecting after is served
+// 3. RLIMIT_NOFILE lowered under the fds the queued connections need: the acceptor drops the ones it can't take, the
+//    server pauses accepting meanwhile
+auto main()
+    -> int
+{
+    auto loop    = EventLoop {};
+    auto port    = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto clients = std::vector<std::shared_ptr<TcpClient>> {};
+    auto connect = [&](uint16_t to, const ConnectionCallback& onClose) {
+        auto client = std::make_shared<TcpClient>(&loop, InetAddress {to, true}, "Admittee");
+        client->setConnectionCloseCallback(onClose);
+        client->connect();
+        clients.push_back(client);
+    };
+
+    auto full_server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Full");
+    full_server->setMaxConnections(2);
+    auto full_established = 0;
+    auto full_closed      = 0;
+    full_server->setConnectionEstablishedCallback([&](const TcpConnectionPtr&) { ++full_established; });
+    full_server->start();
+    for (auto i = 0; i < 3; ++i)
+    {
+        connect(port, [&](const TcpConnectionPtr&) { ++full_closed; });
+    }
+
+    auto lag_port   = static_cast<uint16_t>(port + 1);
+    auto lag_server = std::make_shared<TcpServer>(&loop, InetAddress {lag_port, true}, "Shedding");
+    lag_server->setThreadNum(1);
+    lag_server->setOverloadShedding(0.05, 0.01);
+    auto lag_established = std::atomic<int> {0};
+    lag_server->setConnectionEstablishedCallback([&](const TcpConnectionPtr&) {
+        if (++lag_established == 1)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds {300});
+        }
+    });
+    lag_server->start();
+    auto shed_closed = 0;
+    connect(lag_port, [](const TcpConnectionPtr&) {});
+    loop.runAfter(0.1, [&] {
+        connect(lag_port, [&](const TcpConnectionPtr&) { ++shed_closed; });
+    });
+    loop.runAfter(0.6, [&] {
+        connect(lag_port, [](const TcpConnectionPtr&) {});
+    });
+
+    auto fd_port   = static_cast<uint16_t>(port + 2);
+    auto fd_server = std::make_shared<TcpServer>(&loop, InetAddress {fd_port, true}, "Exhausted");
+    auto fd_established = 0;
+    fd_server->setConnectionEstablishedCallback([&](const TcpConnectionPtr&) { ++fd_established; });
+    auto backlogged = std::vector<int> {};
+    auto saved      = rlimit {};
+    loop.runAfter(0.9, [&] {
+        assert(full_established == 2 and full_closed == 1);
+        assert(full_server->getAdmissionStats().rejected_max_connections == 1);
+        assert(lag_established == 2 and shed_closed == 1);
+        auto stats = lag_server->getAdmissionStats();
+        assert(stats.shed_overloaded == 1 and stats.loop_lag_seconds < 0.05);
+        for (auto& client : clients)
+        {
+            client->disconnect();
+        }
+    });
+    loop.runAfter(1.2, [&] {
+        // the fds of the connections above are closed by now, queued by the kernel before the server gets to accept them
+        fd_server->start();
+        for (auto i = 0; i < c_backlogged; ++i)
+        {
+            backlogged.push_back(connectBlocking(fd_port));
+        }
+        auto lowest_free = ::dup(0);
+        ::close(lowest_free);
+        ::getrlimit(RLIMIT_NOFILE, &saved);
+        auto lowered     = saved;
+        lowered.rlim_cur = static_cast<rlim_t>(lowest_free + 1);
+        assert(::setrlimit(RLIMIT_NOFILE, &lowered) == 0);
+    });
+    loop.runAfter(2.2, [&] {
+        ::setrlimit(RLIMIT_NOFILE, &saved);
+        auto stats = fd_server->getAdmissionStats();
+        LOG_INFO_FMT(log, "{} accepted, {} dropped, {} pauses", fd_established, stats.fd_exhausted, stats.fd_pressure_pauses);
+        assert(fd_established >= 1 and stats.fd_exhausted >= 1);
+        assert(fd_established + static_cast<int>(stats.fd_exhausted) == c_backlogged);
+        assert(stats.fd_pressure_pauses == stats.fd_exhausted);
+        for (auto fd : backlogged)
+        {
+            ::close(fd);
+        }
+        loop.runAfter(0.2, [&loop] { loop.quit(); });
+    });
+    loop.loop();
+
+    assert(full_server->getConnectionCount() == 0 and fd_server->getConnectionCount() == 0);
+    LOG_INFO_FMT(log, "testadmission passed");
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <any>
+#include <atomic>
+#include <cassert>
+#include <map>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr int c_clients    = 6;
+constexpr size_t c_payload = 4000000; // far more than a socket takes at once, a multiple of 10
+const auto c_excluded      = std::string {"Listener1"};
+const auto c_end           = std::string {"END"};
+
+} // namespace
+
+// a server on two io threads, six clients saying their name:
+// 1. a 4MB payload broadcast to all the connections but one reaches each of them whole, by reference: freed once the
+//    last one has written it, the write callback of the payload called once per connection, in its loop
+// 2. a second broadcast, to all, is received after the first one
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+
+    auto server    = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Broadcast");
+    auto written   = std::atomic<int> {0};
+    auto weak      = std::weak_ptr<const std::string> {};
+    auto hellos    = 0;
+    auto broadcast = [&] {
+        auto payload = std::make_shared<std::string>(c_payload, '\0');
+        for (size_t i = 0; i < c_payload; ++i)
+        {
+            (*payload)[i] = static_cast<char>('0' + i % 10);
+        }
+        weak = payload;
+        // 1.
+        server->broadcast(
+            std::move(payload),
+            [](const TcpConnectionPtr& conn) {
+                assert(conn->getLoop()->inOwnerThread());
+                return std::any_cast<std::string>(conn->getContext()) != c_excluded;
+            },
+            [&](const TcpConnectionPtr& conn) {
+                assert(conn->getLoop()->inOwnerThread());
+                written.fetch_add(1);
+            });
+        // 2.
+        server->broadcast(std::make_shared<const std::string>(c_end));
+    };
+    server->setThreadNum(2);
+    server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        conn->setContext(buf.readAllAsString());
+        loop.runTask([&] {
+            if (++hellos == c_clients)
+            {
+                broadcast();
+            }
+        });
+    });
+    server->start();
+
+    auto clients  = std::vector<std::shared_ptr<TcpClient>> {};
+    auto received = std::map<std::string, std::string> {}; // by client
+    auto finished = 0;
+    auto check    = [&] {
+        if (++finished < c_clients)
+        {
+            return;
+        }
+        for (const auto& [name, data] : received)
+        {
+            if (name == c_excluded)
+            {
+                assert(data == c_end);
+                continue;
+            }
+            assert(data.size() == c_payload + c_end.size());
+            assert(data.starts_with("0123456789") and data.ends_with("789" + c_end));
+        }
+        assert(written.load() == c_clients - 1);
+        LOG_INFO_FMT(log, "{} clients got the broadcast", c_clients);
+        for (auto& client : clients)
+        {
+            client->getConnection()->forceClose();
+        }
+        loop.runAfter(0.2, [&] {
+            assert(weak.expired());
+            loop.quit();
+        });
+    };
+    for (auto i = 0; i < c_clients; ++i)
+    {
+        auto name   = "Listener" + std::to_string(i);
+        auto client = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, name);
+        client->setConnetionCallback([name](const TcpConnectionPtr& conn) {
+            if (conn->isConnected())
+            {
+                conn->send(name);
+            }
+        });
+        client->setMessageCallback([&, name](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+            auto& data = received[name];
+            data += buf.readAllAsString();
+            if (data.ends_with(c_end))
+            {
+                check();
+            }
+        });
+        client->connect();
+        clients.push_back(client);
+    }
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testbroadcast passed");
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <cassert>
+#include <memory>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+// a client racing two listeners which both accept, with no attempt delay: both connects complete before the loop
+// polls, so both attempts are reported writable by the same poll. The first one wins, the other one, canceled by
+// then, is ignored: one connection, one success and one cancellation
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+
+    auto servers = std::vector<std::shared_ptr<TcpServer>> {};
+    auto addrs   = std::vector<InetAddress> {};
+    for (auto i = 0; i < 2; ++i)
+    {
+        auto addr   = InetAddress {static_cast<uint16_t>(port + i), true};
+        auto server = std::make_shared<TcpServer>(&loop, addr, "Racer" + std::to_string(i));
+        server->start();
+        servers.push_back(server);
+        addrs.push_back(addr);
+    }
+
+    auto connected = 0;
+    auto client    = std::make_shared<TcpClient>(&loop, addrs, "Racing");
+    client->setConnectAttemptDelayMs(0);
+    client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+        if (not conn->isConnected())
+        {
+            return;
+        }
+        ++connected;
+        loop.runAfter(0.2, [&] {
+            assert(connected == 1);
+            auto successes = uint64_t {0};
+            auto canceled  = uint64_t {0};
+            for (const auto& stats : client->getConnectStats())
+            {
+                assert(stats.attempts == 1);
+                successes += stats.successes;
+                canceled += stats.canceled;
+            }
+            assert(successes == 1 and canceled == 1);
+            client->getConnection()->forceClose();
+            loop.runAfter(0.1, [&] { loop.quit(); });
+        });
+    });
+    // both attempts started here, in the loop thread, and completed by the kernel before the first poll
+    client->connect();
+    ::usleep(100 * 1000);
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testconnectrace passed");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/ConnectionPool.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+// a pool of two connections to each of two echo servers and to an address nobody listens on:
+// 1. the four connections of the live upstreams become ready, the dead upstream is ejected
+// 2. four leases held at once by least-outstanding land on four different connections, one of them echoes
+// 3. stop() closes everything and stops the io threads, acquire() returns an empty lease
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+
+    auto servers   = std::vector<std::shared_ptr<TcpServer>> {};
+    auto upstreams = std::vector<InetAddress> {};
+    for (auto i = 0; i < 2; ++i)
+    {
+        auto addr   = InetAddress {static_cast<uint16_t>(port + i), true};
+        auto server = std::make_shared<TcpServer>(&loop, addr, "Upstream" + std::to_string(i));
+        server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+            conn->send(buf.readAllAsString());
+        });
+        server->start();
+        servers.push_back(server);
+        upstreams.push_back(addr);
+    }
+    upstreams.emplace_back(static_cast<uint16_t>(port + 2), true); // refused
+
+    auto echoed = std::atomic<bool> {false};
+    auto pool   = std::make_shared<ConnectionPool>(&loop, upstreams, "Pool",
+                                                 ConnectionPoolOptions {
+                                                     .conns_per_upstream   = 2,
+                                                     .policy               = ConnectionPoolPolicy::LeastOutstanding,
+                                                     .eject_after_failures = 2,
+                                                     .eject_seconds        = 10.0,
+                                                 });
+    pool->setThreadNum(2);
+    pool->setMessageCallback([&](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+        assert(buf.readAllAsString() == "ping");
+        echoed = true;
+    });
+    pool->start();
+
+    auto check = [&] {
+        // 1.
+        assert(pool->getLiveConnectionCount() == 4 and pool->getEjectedUpstreamCount() == 1);
+        // 2.
+        auto leases = std::vector<ConnectionPool::Lease> {};
+        auto conns  = std::set<TcpConnection*> {};
+        for (auto i = 0; i < 4; ++i)
+        {
+            leases.push_back(pool->acquire());
+            assert(leases.back());
+            conns.insert(leases.back().getConnection().get());
+        }
+        assert(conns.size() == 4);
+        leases.front().getConnection()->send(std::string {"ping"});
+        loop.runAfter(0.2, [&] {
+            assert(echoed);
+            // 3.
+            pool->stop();
+            assert(pool->getLiveConnectionCount() == 0 and not pool->acquire());
+            loop.quit();
+        });
+    };
+    // the refused connects are retried after 0.5s, the second failures eject the dead upstream
+    loop.runAfter(1.5, check);
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testconnpool passed");
+    return 0;
+}
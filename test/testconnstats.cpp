@@ -0,0 +1,89 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr size_t c_hot_bytes  = 512 * 1024;
+constexpr size_t c_cold_bytes = 16;
+
+} // namespace
+
+// an echo server on two io threads sampling TCP_INFO, a hot client sends 512KB and a cold one 16 bytes:
+// the snapshot taken once both got their echo tells them apart
+auto main()
+    -> int
+{
+    auto loop   = EventLoop {};
+    auto port   = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Stats");
+    server->setThreadNum(2);
+    server->setTcpInfoSampling(0.02);
+    server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        conn->send(buf.readAllAsString());
+    });
+    server->start();
+
+    auto clients = std::vector<std::shared_ptr<TcpClient>> {};
+    auto echoed  = 0;
+    auto snapshot = [&] {
+        server->collectConnectionStats([&](std::vector<TcpServer::ConnectionStats> stats) {
+            assert(stats.size() == 2);
+            std::ranges::sort(stats, std::ranges::greater {}, [](const auto& s) { return s.traffic.bytes_received; });
+            const auto& hot  = stats[0];
+            const auto& cold = stats[1];
+            LOG_INFO_FMT(log, "hot {}: {} bytes in {} reads, {:.6f}s in callbacks, rtt {}us cwnd {}",
+                         hot.name, hot.traffic.bytes_received, hot.traffic.reads, hot.traffic.callback_seconds,
+                         hot.tcp_info.rtt_us, hot.tcp_info.snd_cwnd);
+            assert(hot.traffic.bytes_received == c_hot_bytes and hot.traffic.bytes_sent == c_hot_bytes);
+            assert(cold.traffic.bytes_received == c_cold_bytes and cold.traffic.bytes_sent == c_cold_bytes);
+            assert(hot.traffic.reads >= hot.traffic.message_callbacks and hot.traffic.message_callbacks > 1);
+            assert(cold.traffic.message_callbacks == 1 and cold.traffic.writes == 1);
+            assert(hot.traffic.last_receive.valid() and not(hot.traffic.last_receive < hot.traffic.created));
+            assert(hot.tcp_info.sampled.valid() and cold.tcp_info.sampled.valid() and hot.tcp_info.snd_cwnd > 0);
+            for (auto& client : clients)
+            {
+                client->disconnect();
+            }
+            loop.runAfter(0.1, [&loop] { loop.quit(); });
+        });
+    };
+    auto connect = [&](size_t bytes) {
+        auto client   = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Peer");
+        auto received = std::make_shared<size_t>(0);
+        client->setConnetionCallback([bytes](const TcpConnectionPtr& conn) {
+            conn->send(std::string(bytes, 'x'));
+        });
+        client->setMessageCallback([&, bytes, received](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+            *received += buf.getReadableBytesCount();
+            buf.readAllAndDiscard();
+            if (*received == bytes and ++echoed == 2)
+            {
+                // let a sample be taken after the traffic
+                loop.runAfter(0.05, snapshot);
+            }
+        });
+        client->connect();
+        clients.push_back(client);
+    };
+    connect(c_hot_bytes);
+    connect(c_cold_bytes);
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testconnstats passed");
+    return 0;
+}
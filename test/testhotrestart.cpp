@@ -0,0 +1,115 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/HotRestart.h"
+#include "net/InetAddress.h"
+#include "net/SignalHandler.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr uint16_t c_port = 23460;
+
+void echo(const TcpConnectionPtr& conn, Buffer& buf, Timestamp)
+{
+    conn->send(buf.readAllAsString());
+}
+
+// the new process: inherits the echo server's listening socket, binding the port again would fail
+auto runSuccessor(const InetAddress& handoffAddr)
+    -> int
+{
+    auto loop = EventLoop {};
+    auto hot  = HotRestart {&loop, handoffAddr};
+    for (auto i = 0; i < 50 and not hot.inheritFromPredecessor(500); ++i)
+    {
+        ::usleep(100 * 1000); // the predecessor is still starting
+    }
+    assert(hot.hasPredecessor());
+
+    auto server = hot.makeServer(InetAddress {c_port, true}, "echo");
+    server->setMessageCallback(echo);
+    server->start();
+    hot.start();
+
+    auto client = std::make_shared<TcpClient>(&loop, InetAddress {c_port, true}, "Successor");
+    client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            conn->send(std::string {"ping"});
+        }
+    });
+    auto echoed = std::string {};
+    client->setMessageCallback([&](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+        echoed += buf.readAllAsString();
+        if (echoed == "ping")
+        {
+            client->disconnect();
+            loop.runAfter(0.1, [&loop] { loop.quit(); });
+        }
+    });
+    client->connect();
+    loop.loop();
+    LOG_INFO_FMT(log, "successor echoed {}", echoed);
+    return echoed == "ping" ? 0 : 1;
+}
+
+} // namespace
+
+// the parent serves echo with an idle client connected, the forked child takes over the listening socket
+// and tells the parent to drain, the idle connection is closed at the drain deadline
+auto main()
+    -> int
+{
+    auto handoff_addr = InetAddress::fromUnixPath("@cotweb-testhotrestart-" + std::to_string(::getpid()));
+    auto child        = ::fork();
+    assert(child >= 0);
+    if (child == 0)
+    {
+        return runSuccessor(handoff_addr);
+    }
+
+    auto loop = EventLoop {};
+    auto hot  = HotRestart {&loop, handoff_addr};
+    assert(not hot.hasPredecessor());
+    auto signals = SignalHandler {&loop};
+    hot.watchSignal(signals);
+    signals.start();
+
+    hot.setDrainTimeout(0.5);
+    auto drained = false;
+    hot.setDrainedCallback([&] {
+        drained = true;
+        loop.runAfter(0.1, [&loop] { loop.quit(); });
+    });
+    auto server = hot.makeServer(InetAddress {c_port, true}, "echo");
+    server->setMessageCallback(echo);
+    server->start();
+    hot.start();
+
+    auto idle_closed = false;
+    auto idle_client = std::make_shared<TcpClient>(&loop, InetAddress {c_port, true}, "Idle");
+    idle_client->setConnectionCloseCallback([&](const TcpConnectionPtr&) {
+        idle_closed = true;
+    });
+    idle_client->connect();
+    loop.loop();
+    assert(drained and idle_closed);
+
+    auto status = 0;
+    assert(::waitpid(child, &status, 0) == child);
+    assert(WIFEXITED(status) and WEXITSTATUS(status) == 0);
+    LOG_INFO_FMT(log, "testhotrestart passed");
+    return 0;
+}
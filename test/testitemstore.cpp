@@ -0,0 +1,141 @@
+#include "ItemStore.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+
+#include <cassert>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <thread>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+using Mode   = ItemStore::StoreMode;
+using Result = ItemStore::StoreResult;
+
+auto keyOf(size_t i)
+    -> std::string
+{
+    return "key:" + std::to_string(i);
+}
+
+auto valueOf(ItemStore& store, std::string_view key)
+    -> std::string
+{
+    auto ref = store.get(key);
+    return ref ? std::string {ref->valueWithCrLf()} : std::string {};
+}
+
+} // namespace
+
+// an ItemStore of two pages in one shard, then a larger one:
+// 1. under the cap the least recently used item of the class is evicted, a get makes an item recent again
+// 2. a referenced item outlives its removal and its replacement, unchanged
+// 3. once both pages are spent on one class, a value of another class takes a page over, not the referenced one's
+// 4. add / replace / cas conditions, flags kept
+// 5. incr wraps around, decr stops at 0, a shorter number is padded by spaces in place, a longer one reallocated
+// 6. expired items are gone, relative and absolute exptime
+auto main()
+    -> int
+{
+    auto lru           = ItemStore {2 * ItemStore::c_page_size, 1};
+    const auto payload = std::string(1000, 'v');
+
+    // 1.
+    auto inserted = size_t {0};
+    while (lru.getStats().evictions == 0)
+    {
+        auto result = lru.store(Mode::Set, keyOf(inserted++), 0, 0, payload);
+        assert(result == Result::Stored);
+    }
+    auto capacity = lru.getStats().items;
+    assert(capacity == inserted - 1 and lru.getStats().pages == 2);
+    assert(valueOf(lru, keyOf(0)).empty());
+    assert(valueOf(lru, keyOf(1)) == payload + "\r\n"); // now the most recent
+    auto result = lru.store(Mode::Set, keyOf(inserted++), 0, 0, payload);
+    assert(result == Result::Stored);
+    assert(valueOf(lru, keyOf(2)).empty() and not valueOf(lru, keyOf(1)).empty() and not valueOf(lru, keyOf(3)).empty());
+    assert(lru.getStats().evictions == 2 and lru.getStats().items == capacity);
+
+    // 2.
+    auto held    = lru.get(keyOf(3));
+    auto removed = lru.remove(keyOf(3));
+    assert(held and removed and valueOf(lru, keyOf(3)).empty());
+    result = lru.store(Mode::Set, keyOf(3), 0, 0, std::string(1000, 'w'));
+    assert(result == Result::Stored);
+    assert(held->valueWithCrLf() == payload + "\r\n" and valueOf(lru, keyOf(3)) == std::string(1000, 'w') + "\r\n");
+
+    // 3.
+    const auto big = std::string(100 * 1024, 'b');
+    result         = lru.store(Mode::Set, "big", 0, 0, big);
+    assert(result == Result::Stored and valueOf(lru, "big") == big + "\r\n");
+    auto stats = lru.getStats();
+    assert(stats.slabs_moved == 1 and stats.pages == 2 and stats.items < capacity);
+    assert(held->valueWithCrLf() == payload + "\r\n");
+
+    // 4.
+    auto store = ItemStore {8 * ItemStore::c_page_size, 2};
+    result     = store.store(Mode::Add, "a", 42, 0, "1");
+    assert(result == Result::Stored);
+    result = store.store(Mode::Add, "a", 0, 0, "x");
+    assert(result == Result::NotStored);
+    result = store.store(Mode::Replace, "b", 0, 0, "x");
+    assert(result == Result::NotStored);
+    result = store.store(Mode::Cas, "b", 0, 0, "x", 1);
+    assert(result == Result::NotFound);
+    auto cas = uint64_t {0};
+    {
+        auto ref = store.get("a");
+        assert(ref and ref->flags == 42);
+        cas = ref->cas;
+    }
+    result = store.store(Mode::Cas, "a", 0, 0, "2", cas + 1);
+    assert(result == Result::Exists);
+    result = store.store(Mode::Cas, "a", 0, 0, "2", cas);
+    assert(result == Result::Stored and valueOf(store, "a") == "2\r\n");
+    result = store.store(Mode::Cas, "a", 0, 0, "3", cas);
+    assert(result == Result::Exists);
+
+    // 5.
+    result = store.store(Mode::Set, "n", 0, 0, "10");
+    assert(result == Result::Stored);
+    auto number = store.incr("n", 3, true);
+    assert(number == 7u and valueOf(store, "n") == "7 \r\n");
+    number = store.incr("n", 5, false);
+    assert(number == 12u and valueOf(store, "n") == "12\r\n");
+    number = store.incr("n", 100, true);
+    assert(number == 0u and valueOf(store, "n") == "0 \r\n");
+    result = store.store(Mode::Set, "max", 0, 0, "18446744073709551615");
+    number = store.incr("max", 2, false);
+    assert(result == Result::Stored and number == 1u and valueOf(store, "max").starts_with("1 "));
+    result = store.store(Mode::Set, "nine", 0, 0, "9");
+    number = store.incr("nine", 1, false);
+    assert(result == Result::Stored and number == 10u and valueOf(store, "nine") == "10\r\n");
+    {
+        // not in place under a reference
+        auto ref = store.get("nine");
+        number   = store.incr("nine", 1, true);
+        assert(number == 9u and ref->valueWithCrLf() == "10\r\n" and valueOf(store, "nine") == "9\r\n");
+    }
+    result = store.store(Mode::Set, "text", 0, 0, "abc");
+    assert(result == Result::Stored);
+    number = store.incr("text", 1, false);
+    assert(not number and number.error() == ItemStore::IncrError::NotNumeric);
+    number = store.incr("missing", 1, false);
+    assert(not number and number.error() == ItemStore::IncrError::NotFound);
+
+    // 6.
+    result = store.store(Mode::Set, "gone", 0, -1, "x");
+    assert(result == Result::Stored and valueOf(store, "gone").empty());
+    result = store.store(Mode::Set, "past", 0, ::time(nullptr) - 10, "x");
+    assert(result == Result::Stored and valueOf(store, "past").empty());
+    result = store.store(Mode::Set, "soon", 0, 1, "x");
+    assert(result == Result::Stored and valueOf(store, "soon") == "x\r\n");
+    std::this_thread::sleep_for(std::chrono::seconds {2});
+    assert(valueOf(store, "soon").empty());
+
+    LOG_INFO_FMT(log, "testitemstore passed");
+    return 0;
+}
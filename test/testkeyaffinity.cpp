@@ -0,0 +1,200 @@
+#include "common/metrics.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/EventLoopThread.h"
+#include "net/EventLoopThreadpool.h"
+
+#include <cassert>
+#include <cstdint>
+#include <latch>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr int c_loops   = 3;
+constexpr int c_keys    = 64;
+constexpr int c_per_key = 100; // 6400 tasks from the base loop at once, far more than a ring holds
+constexpr int c_pings   = 1000;
+
+// the state of a loop, only ever touched by its thread
+struct Shard
+{
+    EventLoop* loop = nullptr;
+    std::unordered_map<uint64_t, int> last_seq; // by key
+};
+
+} // namespace
+
+// a pool of three io loops:
+// 1. the jump hash moves 1/n of the keys, all to the new bucket, when a bucket is added
+// 2. the tasks posted from the base loop for a key run in its loop in order, overflowing the ring, their
+//    completions come back to the base loop
+// 3. the loops post to each other: each io loop sends pings to a key of every other one, the pongs are completions
+// 4. a thread without a loop posts through the mutex queue, the completions run in the owning loops
+// 5. a loop outside the pool posts through the mutex queue too, the completions come back to it
+auto main()
+    -> int
+{
+    auto moved = 0;
+    for (uint64_t key = 0; key < 10000; ++key)
+    {
+        auto before = EventLoopThreadPool::jumpConsistentHash(key, 4);
+        auto after  = EventLoopThreadPool::jumpConsistentHash(key, 5);
+        assert(before >= 0 and before < 4);
+        if (before != after)
+        {
+            assert(after == 4);
+            ++moved;
+        }
+    }
+    LOG_INFO_FMT(log, "4 to 5 buckets moved {} keys out of 10000", moved);
+    assert(moved > 1500 and moved < 2500);
+
+    auto loop = EventLoop {};
+    auto pool = EventLoopThreadPool {&loop, "Affinity"};
+    pool.setThreadNum(c_loops);
+    pool.start();
+
+    auto shards = std::vector<Shard>(c_loops);
+    auto loops  = pool.getAllLoops();
+    for (auto i = 0; i < c_loops; ++i)
+    {
+        shards[i].loop = loops[i];
+    }
+    auto shardOf = [&](EventLoop* owner) -> Shard& {
+        for (auto& shard : shards)
+        {
+            if (shard.loop == owner)
+            {
+                return shard;
+            }
+        }
+        std::terminate();
+    };
+    assert(pool.getLoopForKey(uint64_t {42}) == pool.getLoopForKey(uint64_t {42}));
+    assert(pool.getLoopForKey(std::string_view {"user:42"}) == pool.getLoopForKey(std::string_view {"user:42"}));
+
+    auto completed   = 0;
+    auto pongs       = 0;
+    auto from_thread = 0;
+    auto from_outer  = 0;
+    auto check       = [&] {
+        if (completed < c_keys * c_per_key or pongs < c_loops * (c_loops - 1) * c_pings or from_thread < c_keys
+            or from_outer < c_keys)
+        {
+            return;
+        }
+        loop.quit();
+    };
+
+    // a key owned by each loop
+    auto key_of = std::unordered_map<EventLoop*, uint64_t> {};
+    for (uint64_t key = 1000; key_of.size() < static_cast<size_t>(c_loops); ++key)
+    {
+        key_of.try_emplace(pool.getLoopForKey(key), key);
+    }
+
+    // 2. the io loops are held until everything is posted
+    auto gate = std::latch {1};
+    loop.runTask([&] {
+        for (auto& [_, key] : key_of)
+        {
+            pool.runOnLoopFor(key, [&gate] { gate.wait(); });
+        }
+        for (auto seq = 0; seq < c_per_key; ++seq)
+        {
+            for (uint64_t key = 0; key < c_keys; ++key)
+            {
+                auto* owner = pool.getLoopForKey(key);
+                pool.runOnLoopFor(
+                    key,
+                    [&, owner, key, seq] {
+                        assert(owner->inOwnerThread());
+                        auto& last = shardOf(owner).last_seq[key];
+                        assert(seq == 0 or last == seq - 1);
+                        last = seq;
+                    },
+                    [&] {
+                        assert(loop.inOwnerThread());
+                        ++completed;
+                        check();
+                    });
+            }
+        }
+        gate.count_down();
+    });
+
+    // 3.
+    for (auto* sender : loops)
+    {
+        sender->runTask([&, sender] {
+            for (auto& [receiver, key] : key_of)
+            {
+                if (receiver == sender)
+                {
+                    continue;
+                }
+                for (auto i = 0; i < c_pings; ++i)
+                {
+                    pool.runOnLoopFor(
+                        key,
+                        [receiver] { assert(receiver->inOwnerThread()); },
+                        [&, sender] {
+                            assert(sender->inOwnerThread());
+                            loop.runTask([&] {
+                                ++pongs;
+                                check();
+                            });
+                        });
+                }
+            }
+        });
+    }
+
+    // 4.
+    auto thread = std::jthread {[&] {
+        for (uint64_t key = 0; key < c_keys; ++key)
+        {
+            pool.runOnLoopFor(
+                key,
+                [&, key] { assert(pool.getLoopForKey(key)->inOwnerThread()); },
+                [&, key] {
+                    assert(pool.getLoopForKey(key)->inOwnerThread());
+                    loop.runTask([&] {
+                        ++from_thread;
+                        check();
+                    });
+                });
+        }
+    }};
+
+    // 5.
+    auto outer_thread = EventLoopThread {};
+    auto* outer       = outer_thread.startLoop();
+    outer->runTask([&, outer] {
+        for (uint64_t key = 0; key < c_keys; ++key)
+        {
+            pool.runOnLoopFor(
+                key,
+                [&, key] { assert(pool.getLoopForKey(key)->inOwnerThread()); },
+                [&, outer] {
+                    assert(outer->inOwnerThread());
+                    loop.runTask([&] {
+                        ++from_outer;
+                        check();
+                    });
+                });
+        }
+    });
+
+    loop.loop();
+    assert(Cot::MetricsRegistry::GetInstance().GetCounter("net_loop_link_overflows_total", "").Value() > 0);
+    LOG_INFO_FMT(log, "testkeyaffinity passed");
+    return 0;
+}
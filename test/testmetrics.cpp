@@ -0,0 +1,130 @@
+#include "common/metrics.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/MetricsServer.h"
+#include "net/TcpServer.h"
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <chrono>
+#include <format>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr int c_threads    = 4;
+constexpr int c_increments = 100000;
+
+auto connectLoopback(uint16_t port)
+    -> int
+{
+    auto fd   = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    auto addr = sockaddr_in {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0);
+    return fd;
+}
+
+auto httpGet(uint16_t port, std::string_view target)
+    -> std::string
+{
+    auto fd      = connectLoopback(port);
+    auto request = std::format("GET {} HTTP/1.1\r\nHost: localhost\r\n\r\n", target);
+    assert(::write(fd, request.data(), request.size()) == static_cast<ssize_t>(request.size()));
+    auto response = std::string {};
+    auto chunk    = std::string(4096, '\0');
+    for (auto n = ::read(fd, chunk.data(), chunk.size()); n > 0; n = ::read(fd, chunk.data(), chunk.size()))
+    {
+        response.append(chunk.data(), static_cast<size_t>(n));
+    }
+    ::close(fd);
+    return response;
+}
+
+void testRegistry()
+{
+    auto& registry = Cot::MetricsRegistry::GetInstance();
+    auto& counter  = registry.GetCounter("test_increments_total", "increments of the test threads");
+    assert(&counter == &registry.GetCounter("test_increments_total", "increments of the test threads"));
+    auto threads = std::vector<std::jthread> {};
+    for (auto i = 0; i < c_threads; ++i)
+    {
+        threads.emplace_back([&counter] {
+            for (auto j = 0; j < c_increments; ++j)
+            {
+                counter.Inc();
+            }
+        });
+    }
+    threads.clear();
+    assert(counter.Value() == c_threads * c_increments);
+
+    auto& histogram = registry.GetHistogram("test_seconds", "test observations", {0.001, 0.1}, Cot::MetricsRegistry::Label("case", "a\"b"));
+    histogram.Observe(0.0005);
+    histogram.Observe(0.05);
+    histogram.Observe(3);
+    auto snapshot = histogram.TakeSnapshot();
+    assert((snapshot.cumulative_counts == std::vector<uint64_t> {1, 2, 3}));
+
+    {
+        auto handle = registry.AddCallbackGauge("test_answer", "computed at scrape", "", [] { return 42.0; });
+        assert(registry.RenderPrometheus().contains("test_answer 42\n"));
+    }
+    auto text = registry.RenderPrometheus();
+    assert(not text.contains("test_answer 42\n"));
+    assert(text.contains("# TYPE test_increments_total counter\ntest_increments_total 400000\n"));
+    assert(text.contains("test_seconds_bucket{case=\"a\\\"b\",le=\"0.1\"} 2\n"));
+    assert(text.contains("test_seconds_bucket{case=\"a\\\"b\",le=\"+Inf\"} 3\n"));
+    assert(text.contains("test_seconds_count{case=\"a\\\"b\"} 3\n"));
+}
+
+} // namespace
+
+// the registry on its own, then scraped over the admin endpoint while a server holds one connection
+auto main()
+    -> int
+{
+    testRegistry();
+
+    auto loop          = EventLoop {};
+    auto metrics_port  = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto observed_port = static_cast<uint16_t>(metrics_port + 1);
+    auto metrics       = MetricsServer {&loop, InetAddress {metrics_port, true}};
+    metrics.start();
+    auto observed = std::make_shared<TcpServer>(&loop, InetAddress {observed_port, true}, "Observed");
+    observed->start();
+
+    auto response = std::string {};
+    auto missing  = std::string {};
+    auto scraper  = std::jthread {[&] {
+        auto fd = connectLoopback(observed_port);
+        std::this_thread::sleep_for(std::chrono::milliseconds {100});
+        response = httpGet(metrics_port, "/metrics");
+        missing  = httpGet(metrics_port, "/nothing");
+        ::close(fd);
+        loop.runAfter(0.2, [&loop] { loop.quit(); });
+    }};
+    loop.loop();
+    scraper.join();
+
+    assert(response.starts_with("HTTP/1.1 200 OK\r\n"));
+    assert(response.contains("net_tcp_connections{server=\"Observed\"} 1\n"));
+    assert(response.contains("net_tcp_connections_accepted_total{server=\"Observed\"} 1\n"));
+    assert(response.contains("net_metrics_scrapes_total 1\n"));
+    assert(response.contains("# TYPE net_loop_task_lag_seconds histogram\n"));
+    assert(response.contains("net_loops 1\n"));
+    assert(missing.starts_with("HTTP/1.1 404 Not Found\r\n"));
+    LOG_INFO_FMT(log, "testmetrics passed, {} bytes scraped", response.size());
+    return 0;
+}
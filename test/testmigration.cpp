@@ -0,0 +1,223 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/PubSubHub.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr size_t c_unread_bytes = 64 * 1024 * 1024;
+
+void spin(std::chrono::microseconds duration)
+{
+    auto until = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < until)
+    {
+    }
+}
+
+} // namespace
+
+// two echo servers on two io threads each:
+// 1. an echo connection migrated by hand still echoes, from its new loop
+// 2. a connection with 64MB left to write to a peer not reading is refused
+// 3. the rebalancer moves one of the two hot connections sharing a loop to the idle one
+// 4. a connection subscribed to a PubSubHub is pinned to its loop and refused, once closed it is unsubscribed from
+//    the shard of its loop and released
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Migrate");
+    server->setThreadNum(2);
+    auto io_loops = std::vector<EventLoop*> {};
+    auto other    = [&io_loops](EventLoop* io_loop) {
+        return io_loops[0] == io_loop ? io_loops[1] : io_loops[0];
+    };
+    // 1.
+    auto migrated_to = std::atomic<EventLoop*> {nullptr};
+    server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        assert(conn->getLoop()->inOwnerThread());
+        auto message = buf.readAllAsString();
+        if (message == "after")
+        {
+            assert(conn->getLoop() == migrated_to.load());
+            conn->send(message);
+            return;
+        }
+        // echoed once migrated
+        auto* target = other(conn->getLoop());
+        migrated_to  = target;
+        server->migrateConnection(conn, target, [target, message](const TcpConnectionPtr& migrated_conn, bool migrated) {
+            assert(migrated and migrated_conn->getLoop() == target and target->inOwnerThread());
+            migrated_conn->send(message);
+        });
+    });
+
+    auto clients     = std::vector<std::shared_ptr<TcpClient>> {};
+    auto hot_server  = std::shared_ptr<TcpServer> {};
+    auto mtx         = std::mutex {};
+    auto hot_loops   = std::map<std::string, EventLoop*> {};
+    auto finish      = [&] {
+        for (auto& client : clients)
+        {
+            if (auto conn = client->getConnection(); conn != nullptr)
+            {
+                conn->forceClose();
+            }
+        }
+        loop.runAfter(0.2, [&loop] { loop.quit(); });
+    };
+
+    // 4.
+    auto hub        = PubSubHub {};
+    auto subscriber = std::weak_ptr<TcpConnection> {};
+    auto pinned     = [&] {
+        server->setConnectionEstablishedCallback([&](const TcpConnectionPtr& conn) {
+            if (not conn->isConnected())
+            {
+                return;
+            }
+            hub.subscribe(conn, "news");
+            server->migrateConnection(conn, other(conn->getLoop()), [&](const TcpConnectionPtr& refused, bool migrated) {
+                assert(not migrated and refused->isLoopPinned() and refused->getLoop()->inOwnerThread());
+                refused->forceClose();
+            });
+        });
+        server->setConnectionCloseCallback([&](const TcpConnectionPtr& conn) {
+            if (not conn->isLoopPinned())
+            {
+                return; // the former clients
+            }
+            hub.unsubscribeAll(conn);
+            assert(not conn->isLoopPinned());
+            subscriber = conn;
+            loop.runTask([&] {
+                loop.runAfter(0.2, [&] {
+                    assert(subscriber.expired() and hub.getSubscriberCount("news") == 0);
+                    finish();
+                });
+            });
+        });
+        auto client = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Subscriber");
+        client->connect();
+        clients.push_back(client);
+    };
+
+    // 3.
+    auto rebalance = [&] {
+        hot_server = std::make_shared<TcpServer>(&loop, InetAddress {static_cast<uint16_t>(port + 1), true}, "Rebalance");
+        hot_server->setThreadNum(2);
+        hot_server->setRebalancing(0.1, 0.2);
+        // the connections #1 and #3 land on the same loop, round-robin
+        hot_server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+            auto hot = conn->getName().ends_with("#1") or conn->getName().ends_with("#3");
+            if (hot)
+            {
+                spin(std::chrono::microseconds {2000});
+                auto _                     = std::lock_guard<std::mutex> {mtx};
+                hot_loops[conn->getName()] = conn->getLoop();
+            }
+            conn->send(buf.readAllAsString());
+        });
+        hot_server->start();
+        for (auto i = 0; i < 3; ++i)
+        {
+            auto client = std::make_shared<TcpClient>(&loop, InetAddress {static_cast<uint16_t>(port + 1), true}, "Ping");
+            client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+                if (conn->isConnected())
+                {
+                    conn->send(std::string {"ping"});
+                }
+            });
+            client->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+                conn->send(buf.readAllAsString());
+            });
+            client->connect();
+            clients.push_back(client);
+        }
+        loop.runAfter(1.5, [&] {
+            auto stats = hot_server->getRebalanceStats();
+            LOG_INFO_FMT(log, "rebalancer: {} migrations, {} refused", stats.migrations, stats.refused);
+            assert(stats.migrations >= 1);
+            {
+                auto _ = std::lock_guard<std::mutex> {mtx};
+                assert(hot_loops.size() == 2 and hot_loops.begin()->second != hot_loops.rbegin()->second);
+            }
+            pinned();
+        });
+    };
+
+    // 2.
+    auto refuse = [&] {
+        server->setConnectionEstablishedCallback([&](const TcpConnectionPtr& conn) {
+            if (not conn->isConnected())
+            {
+                return;
+            }
+            conn->send(std::string(c_unread_bytes, 'x'));
+            server->migrateConnection(conn, other(conn->getLoop()), [&](const TcpConnectionPtr& refused, bool migrated) {
+                assert(not migrated and refused->getLoop()->inOwnerThread());
+                loop.runTask([&] {
+                    assert(server->getRebalanceStats().refused == 1);
+                    rebalance();
+                });
+            });
+        });
+        auto client = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Stalled");
+        client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+            if (conn->isConnected())
+            {
+                conn->stopRead();
+            }
+        });
+        client->connect();
+        clients.push_back(client);
+    };
+
+    server->start();
+    io_loops    = server->getIoLoops();
+    auto echoes = 0;
+    auto client = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Echo");
+    client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            conn->send(std::string {"before"});
+        }
+    });
+    client->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        auto echo = buf.readAllAsString();
+        if (++echoes == 1)
+        {
+            assert(echo == "before");
+            conn->send(std::string {"after"});
+            return;
+        }
+        assert(echo == "after" and server->getRebalanceStats().migrations == 1);
+        refuse();
+    });
+    client->connect();
+    clients.push_back(client);
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testmigration passed");
+    return 0;
+}
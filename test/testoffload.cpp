@@ -0,0 +1,156 @@
+#include "common/metrics.h"
+#include "common/offloadpool.h"
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <latch>
+#include <memory>
+#include <string>
+#include <thread>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr int c_jobs = 200;
+
+void spin(std::chrono::milliseconds duration)
+{
+    auto until = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < until)
+    {
+    }
+}
+
+auto fib(int n)
+    -> uint64_t
+{
+    return n < 2 ? n : fib(n - 1) + fib(n - 2);
+}
+
+} // namespace
+
+// 1. a full pool refuses, leaving the task to the caller
+// 2. the tasks a worker submits go to its own deque, the idle workers steal them
+// 3. the continuations of the work offloaded from a loop run in the loop, with the results, while its timer keeps
+//    firing; a loop whose pool is full runs the work itself
+auto main()
+    -> int
+{
+    auto& registry = Cot::MetricsRegistry::GetInstance();
+
+    // 1.
+    {
+        auto pool    = Cot::OffloadPool {"Full", 1, 2};
+        auto release = std::latch {1};
+        auto started = std::latch {1};
+        auto task    = Cot::OffloadPool::Task {[&] {
+            started.count_down();
+            release.wait();
+        }};
+        assert(pool.TrySubmit(task));
+        started.wait();
+        for (auto i = 0; i < 2; ++i)
+        {
+            auto queued = Cot::OffloadPool::Task {[] {}};
+            assert(pool.TrySubmit(queued));
+        }
+        auto refused = Cot::OffloadPool::Task {[] {}};
+        assert(not pool.TrySubmit(refused) and refused != nullptr and pool.GetQueueDepth() == 2);
+        release.count_down();
+    }
+    assert(registry.GetCounter("offload_refused_total", "", Cot::MetricsRegistry::Label("pool", "Full")).Value() == 1);
+
+    // 2.
+    {
+        auto pool = Cot::OffloadPool {"Steal", 4};
+        auto done = std::latch {c_jobs};
+        auto seed = Cot::OffloadPool::Task {[&] {
+            for (auto i = 0; i < c_jobs; ++i)
+            {
+                auto task = Cot::OffloadPool::Task {[&] {
+                    spin(std::chrono::milliseconds {1});
+                    done.count_down();
+                }};
+                assert(pool.TrySubmit(task));
+            }
+        }};
+        assert(pool.TrySubmit(seed));
+        done.wait();
+    }
+    auto steals = registry.GetCounter("offload_steals_total", "", Cot::MetricsRegistry::Label("pool", "Steal")).Value();
+    LOG_INFO_FMT(log, "{} of {} tasks stolen", steals, c_jobs);
+    assert(steals > 0);
+
+    // 3.
+    {
+        auto loop = EventLoop {};
+        loop.setOffloadPool(std::make_shared<Cot::OffloadPool>("Loop", 2));
+        auto ticks   = 0;
+        auto results = 0;
+        auto sum     = uint64_t {0};
+        auto timer   = loop.runEvery(0.01, [&] { ++ticks; });
+        auto check   = [&] {
+            if (results < c_jobs + 1)
+            {
+                return;
+            }
+            LOG_INFO_FMT(log, "{} timer ticks during the offloaded work", ticks);
+            assert(ticks >= 5);
+            assert(sum == c_jobs * fib(20));
+            loop.cancelTimer(timer);
+            loop.quit();
+        };
+        loop.runTask([&] {
+            loop.offload(
+                [] { spin(std::chrono::milliseconds {200}); },
+                [&] {
+                    assert(loop.inOwnerThread());
+                    ++results;
+                    check();
+                });
+            for (auto i = 0; i < c_jobs; ++i)
+            {
+                loop.offload(
+                    [] { return fib(20); },
+                    [&](uint64_t value) {
+                        assert(loop.inOwnerThread());
+                        sum += value;
+                        ++results;
+                        check();
+                    });
+            }
+        });
+        loop.loop();
+        assert(registry.GetCounter("offload_tasks_total", "", Cot::MetricsRegistry::Label("pool", "Loop")).Value() == c_jobs + 1);
+    }
+
+    // 3. again, the pool being full
+    {
+        auto pool      = std::make_shared<Cot::OffloadPool>("Busy", 1, 1);
+        auto release   = std::latch {1};
+        auto inline_id = std::thread::id {};
+        auto full      = EventLoop {};
+        full.setOffloadPool(pool);
+        full.runTask([&] {
+            full.offload([&] { release.wait(); }, [] {});
+            full.offload([] {}, [] {});
+            full.offload([&] { inline_id = std::this_thread::get_id(); }, [&] {
+                assert(inline_id == std::this_thread::get_id());
+                release.count_down();
+                full.quit();
+            });
+        });
+        full.loop();
+        // the workers are joined while the loop they queue to is still there
+        full.setOffloadPool(nullptr);
+        pool.reset();
+    }
+
+    LOG_INFO_FMT(log, "testoffload passed");
+    return 0;
+}
@@ -0,0 +1,198 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/PubSubHub.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <latch>
+#include <memory>
+#include <netinet/in.h>
+#include <optional>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr size_t c_message_size = 4 * 1024;
+constexpr size_t c_messages     = 1000; // 4MB, far more than the kernel keeps for a subscriber not reading
+constexpr size_t c_max_pending  = 256 * 1024;
+const auto c_subscribe          = std::string {"news\n"};
+const auto c_subscribed         = std::string {"ok\n"};
+
+/**
+ * @brief 5. a hub destroyed while its drain task is still queued in the loop, the task finds the shard gone
+ */
+void checkHubDestroyedFirst(uint16_t port)
+{
+    auto loop     = EventLoop {};
+    auto hub      = std::optional<PubSubHub> {std::in_place};
+    auto received = std::string {};
+    auto server   = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Ephemeral");
+    server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        buf.readAllAndDiscard();
+        auto subscribed = hub->subscribe(conn, "news");
+        assert(subscribed);
+        // the drain task is queued, it runs after this callback, once the hub is gone
+        auto loops = hub->publish("news", std::make_shared<const std::string>("late\n"));
+        assert(loops == 1);
+        hub.reset();
+        loop.runAfter(0.2, [&, conn] {
+            assert(received.empty());
+            conn->forceClose();
+            loop.runAfter(0.1, [&loop] { loop.quit(); });
+        });
+    });
+    server->start();
+
+    auto client = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Late");
+    client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            conn->send(c_subscribe);
+        }
+    });
+    client->setMessageCallback([&](const TcpConnectionPtr&, Buffer& buf, Timestamp) { received += buf.readAllAsString(); });
+    client->connect();
+    loop.loop();
+}
+
+} // namespace
+
+// a hub of topic "news" over a server with two io loops, two subscribers reading and a slow one never reading,
+// with the drop policy:
+// 1. the three subscriptions are counted, a topic without subscriber is handed to no loop
+// 2. the messages published from another thread reach the reading subscribers complete and in order
+// 3. the slow subscriber's messages are dropped once its pending output goes over max_pending_bytes
+// 4. the closed subscribers are unsubscribed
+// 5. see checkHubDestroyedFirst()
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+
+    auto hub    = PubSubHub {PubSubHubOptions {.max_pending_bytes = c_max_pending, .policy = SlowSubscriberPolicy::Drop}};
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "PubSub");
+    server->setThreadNum(2);
+    server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        assert(buf.readAllAsString() == c_subscribe);
+        auto subscribed = hub.subscribe(conn, "news");
+        assert(subscribed);
+        conn->send(c_subscribed);
+    });
+    server->setConnectionCloseCallback([&](const TcpConnectionPtr& conn) { hub.unsubscribeAll(conn); });
+    server->start();
+
+    auto ready     = std::latch {2};
+    auto finished  = 0;
+    auto clients   = std::vector<std::shared_ptr<TcpClient>> {};
+    auto publisher = std::jthread {};
+    auto slow_fd   = -1;
+
+    auto check = [&] {
+        publisher.join();
+        auto stats = hub.getStats();
+        LOG_INFO_FMT(log, "{} published in {} loop batches, {} deliveries, {} dropped", stats.published,
+                     stats.loop_batches, stats.deliveries, stats.dropped);
+        // 2.
+        assert(stats.published == c_messages + 1 and stats.loop_batches >= 1 and stats.loop_batches <= 2 * c_messages);
+        assert(stats.deliveries + stats.dropped == 3 * c_messages);
+        // 3.
+        assert(stats.dropped > 0 and stats.disconnected == 0);
+        // 4.
+        ::close(slow_fd);
+        for (auto& client : clients)
+        {
+            client->getConnection()->forceClose();
+        }
+        loop.runAfter(0.3, [&] {
+            assert(hub.getSubscriberCount("news") == 0);
+            loop.quit();
+        });
+    };
+
+    for (auto c = 0; c < 2; ++c)
+    {
+        auto client = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Reader" + std::to_string(c));
+        client->setConnetionCallback([](const TcpConnectionPtr& conn) {
+            if (conn->isConnected())
+            {
+                conn->send(c_subscribe);
+            }
+        });
+        client->setMessageCallback([&, received = std::string {}](const TcpConnectionPtr&, Buffer& buf, Timestamp) mutable {
+            auto subscribed = received.empty();
+            received += buf.readAllAsString();
+            if (subscribed)
+            {
+                assert(received.starts_with(c_subscribed));
+                received.erase(0, c_subscribed.size());
+                ready.count_down();
+            }
+            if (received.size() < c_messages * c_message_size)
+            {
+                return;
+            }
+            // 2.
+            assert(received.size() == c_messages * c_message_size);
+            for (size_t i = 0; i < c_messages; ++i)
+            {
+                auto tag = static_cast<char>('a' + i % 26);
+                assert(received[i * c_message_size] == tag and received[(i + 1) * c_message_size - 1] == tag);
+            }
+            if (++finished == 2)
+            {
+                check();
+            }
+        });
+        client->connect();
+        clients.push_back(client);
+    }
+
+    publisher = std::jthread {[&] {
+        // a tiny receive window, the server's output piles up as soon as the kernel buffers are full
+        slow_fd     = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        auto rcvbuf = 4096;
+        ::setsockopt(slow_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+        auto addr            = sockaddr_in {};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        auto connected       = ::connect(slow_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+        assert(connected == 0);
+        auto written = ::write(slow_fd, c_subscribe.data(), c_subscribe.size());
+        assert(written == static_cast<ssize_t>(c_subscribe.size()));
+        auto reply = std::string(c_subscribed.size(), '\0');
+        auto n     = ::recv(slow_fd, reply.data(), reply.size(), MSG_WAITALL);
+        assert(n == static_cast<ssize_t>(reply.size()) and reply == c_subscribed);
+
+        ready.wait();
+        // 1.
+        assert(hub.getSubscriberCount("news") == 3);
+        assert(hub.publish("sports", std::make_shared<const std::string>("nobody")) == 0);
+        for (size_t i = 0; i < c_messages; ++i)
+        {
+            auto loops = hub.publish("news", std::make_shared<const std::string>(c_message_size, static_cast<char>('a' + i % 26)));
+            assert(loops >= 1 and loops <= 2);
+            // paced, so that only the slow subscriber falls behind
+            ::usleep(500);
+        }
+    }};
+    loop.loop();
+
+    checkHubDestroyedFirst(static_cast<uint16_t>(port + 1));
+
+    LOG_INFO_FMT(log, "testpubsub passed");
+    return 0;
+}
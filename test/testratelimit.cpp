@@ -0,0 +1,133 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/RateLimit.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr size_t c_flood_bytes = 1280 * 1024;
+constexpr int c_accepted       = 4;
+constexpr int c_lines          = 40;
+
+} // namespace
+
+// three servers in one loop, each with one limit:
+// 1. 2MB/s with a 256KB burst per connection, a client floods 1.25MB: the last byte is read after ~0.5s
+// 2. 5 accepts/s with a burst of 1, four clients connect at once: the fourth is accepted after ~0.4s
+// 3. 50 messages/s with a burst of 10, counted by the codec: 40 lines at once make the next line wait ~0.6s
+auto main()
+    -> int
+{
+    auto loop  = EventLoop {};
+    auto port  = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto start = Timestamp::now();
+    auto since = [&start] { return timeDifference(Timestamp::now(), start); };
+    auto clients = std::vector<std::shared_ptr<TcpClient>> {};
+    auto done    = 0;
+    auto check   = [&] {
+        if (++done == 3)
+        {
+            for (auto& client : clients)
+            {
+                client->disconnect();
+            }
+            loop.runAfter(0.1, [&loop] { loop.quit(); });
+        }
+    };
+
+    auto bytes_server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "BytesLimited");
+    bytes_server->setConnectionRateLimits(RateLimit {.rate = 2 * 1024 * 1024, .burst = 256 * 1024}, RateLimit {});
+    auto flooded = size_t {0};
+    bytes_server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        flooded += buf.getReadableBytesCount();
+        buf.readAllAndDiscard();
+        if (flooded == c_flood_bytes)
+        {
+            auto elapsed = since();
+            auto stats   = conn->getThrottleStats();
+            LOG_INFO_FMT(log, "flood read in {:.3f}s, {} throttles", elapsed, stats.throttles);
+            assert(elapsed > 0.4 and elapsed < 2.0);
+            assert(stats.throttles > 0 and not stats.throttled);
+            check();
+        }
+    });
+    bytes_server->start();
+
+    auto accept_server = std::make_shared<TcpServer>(&loop, InetAddress {static_cast<uint16_t>(port + 1), true}, "AcceptLimited");
+    accept_server->setAcceptRateLimit(RateLimit {.rate = 5, .burst = 1});
+    auto accepted = 0;
+    accept_server->setConnectionEstablishedCallback([&](const TcpConnectionPtr&) {
+        if (++accepted == c_accepted)
+        {
+            auto elapsed = since();
+            LOG_INFO_FMT(log, "{} accepted in {:.3f}s", c_accepted, elapsed);
+            assert(elapsed > 0.3 and elapsed < 2.0);
+            assert(accept_server->getRateLimitStats().accept_throttles >= 1);
+            check();
+        }
+    });
+    accept_server->start();
+
+    auto messages_server = std::make_shared<TcpServer>(&loop, InetAddress {static_cast<uint16_t>(port + 2), true}, "MessagesLimited");
+    messages_server->setConnectionRateLimits(RateLimit {}, RateLimit {.rate = 50, .burst = 10});
+    auto lines = 0;
+    messages_server->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        auto text  = buf.readAllAsString();
+        auto count = static_cast<int>(std::ranges::count(text, '\n'));
+        conn->chargeMessages(static_cast<size_t>(count));
+        lines += count;
+        if (lines == c_lines + 1)
+        {
+            auto elapsed = since();
+            LOG_INFO_FMT(log, "last line read after {:.3f}s", elapsed);
+            assert(elapsed > 0.45 and elapsed < 2.0);
+            check();
+        }
+    });
+    messages_server->start();
+
+    auto flooder = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Flooder");
+    flooder->setConnetionCallback([](const TcpConnectionPtr& conn) {
+        conn->send(std::string(c_flood_bytes, 'f'));
+    });
+    clients.push_back(flooder);
+    for (auto i = 0; i < c_accepted; ++i)
+    {
+        clients.push_back(std::make_shared<TcpClient>(&loop, InetAddress {static_cast<uint16_t>(port + 1), true}, "Acceptee"));
+    }
+    auto talker = std::make_shared<TcpClient>(&loop, InetAddress {static_cast<uint16_t>(port + 2), true}, "Talker");
+    talker->setConnetionCallback([&loop](const TcpConnectionPtr& conn) {
+        auto text = std::string {};
+        for (auto i = 0; i < c_lines; ++i)
+        {
+            text += "line\n";
+        }
+        conn->send(text);
+        loop.runAfter(0.05, [conn] { conn->send(std::string {"last\n"}); });
+    });
+    clients.push_back(talker);
+    for (auto& client : clients)
+    {
+        client->connect();
+    }
+    loop.loop();
+
+    auto stats = bytes_server->getRateLimitStats();
+    assert(stats.read_throttles > 0 and stats.read_throttled_seconds > 0.3);
+    LOG_INFO_FMT(log, "testratelimit passed");
+    return 0;
+}
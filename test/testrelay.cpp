@@ -0,0 +1,130 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpRelay.h"
+#include "net/TcpServer.h"
+
+#include <arpa/inet.h>
+#include <cassert>
+#include <memory>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr size_t c_payload_size = 3 * 1000 * 1000;
+
+auto loopbackSocket(uint16_t port, bool listening)
+    -> int
+{
+    auto fd   = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    auto addr = sockaddr_in {};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (listening)
+    {
+        auto on = 1;
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+        assert(::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0);
+        assert(::listen(fd, 1) == 0);
+        return fd;
+    }
+    assert(::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0);
+    return fd;
+}
+
+auto readUntilEof(int fd)
+    -> std::string
+{
+    auto data  = std::string {};
+    auto chunk = std::string(64 * 1024, '\0');
+    for (auto n = ::read(fd, chunk.data(), chunk.size()); n > 0; n = ::read(fd, chunk.data(), chunk.size()))
+    {
+        data.append(chunk.data(), static_cast<size_t>(n));
+    }
+    return data;
+}
+
+auto checksum(std::string_view data)
+    -> uint64_t
+{
+    auto sum = uint64_t {0};
+    for (auto c : data)
+    {
+        sum = sum * 31 + static_cast<unsigned char>(c);
+    }
+    return sum;
+}
+
+} // namespace
+
+// client -> proxy (TcpServer + TcpClient linked by a TcpRelay) -> upstream, blocking sockets on both ends:
+// the upstream reads until the client's half-close reaches it, then replies over the direction still open
+auto main()
+    -> int
+{
+    auto loop       = EventLoop {};
+    auto proxy_port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto up_port    = static_cast<uint16_t>(proxy_port + 1);
+    auto listen_fd  = loopbackSocket(up_port, true);
+
+    auto upstream = std::thread {[listen_fd] {
+        auto fd       = ::accept(listen_fd, nullptr, nullptr);
+        auto received = readUntilEof(fd);
+        auto reply    = std::to_string(received.size()) + " " + std::to_string(checksum(received));
+        assert(::write(fd, reply.data(), reply.size()) == static_cast<ssize_t>(reply.size()));
+        ::close(fd);
+    }};
+
+    auto relay  = std::shared_ptr<TcpRelay> {};
+    auto client = std::shared_ptr<TcpClient> {};
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {proxy_port, true}, "RelayProxy");
+    server->setConnectionEstablishedCallback([&](const TcpConnectionPtr& downstream) {
+        downstream->stopRead();
+        client = std::make_shared<TcpClient>(&loop, InetAddress {up_port, true}, "RelayUpstream");
+        client->setConnetionCallback([&, downstream](const TcpConnectionPtr& up) {
+            relay = std::make_shared<TcpRelay>(downstream, up, TcpRelay::Options {.pipe_size = 64 * 1024});
+            relay->setFinishCallback([&loop] { loop.runAfter(0.05, [&loop] { loop.quit(); }); });
+            assert(relay->start());
+        });
+        client->connect();
+    });
+    server->setMessageCallback([](const TcpConnectionPtr&, Buffer&, Timestamp) {
+        assert(false); // taken over by the relay
+    });
+    server->start();
+
+    auto payload = std::string(c_payload_size, '\0');
+    for (size_t i = 0; i < payload.size(); ++i)
+    {
+        payload[i] = static_cast<char>(i * 7 + i / 1000);
+    }
+    auto reply      = std::string {};
+    auto downstream = std::thread {[&] {
+        auto fd = loopbackSocket(proxy_port, false);
+        assert(::write(fd, payload.data(), payload.size()) == static_cast<ssize_t>(payload.size()));
+        ::shutdown(fd, SHUT_WR);
+        reply = readUntilEof(fd);
+        ::close(fd);
+    }};
+    loop.loop();
+    downstream.join();
+    upstream.join();
+    ::close(listen_fd);
+
+    assert(reply == std::to_string(payload.size()) + " " + std::to_string(checksum(payload)));
+    auto stats = relay->getStats();
+    assert(stats.a_to_b_bytes == payload.size() and stats.b_to_a_bytes == reply.size());
+    assert(relay->isFinished());
+    LOG_INFO_FMT(log, "testrelay passed, {} splices", stats.splices);
+    return 0;
+}
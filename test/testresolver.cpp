@@ -0,0 +1,109 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/Resolver.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <netdb.h>
+#include <string>
+#include <unistd.h>
+
+static auto log = GET_ROOT_LOGGER();
+
+// the lookups go to a fixed table instead of getaddrinfo, so neither a DNS server nor /etc/hosts is needed:
+// localhost is 127.0.0.1, flaky.test fails with EAI_AGAIN twice and then is 127.0.0.1 too, nothing else exists
+// 1. localhost is resolved in the resolver thread and delivered in the loop, the cache hit is delivered asynchronously as well
+// 2. an unknown host fails with the EAI_NONAME code of the gai category
+// 3. a client of flaky.test reports both failed resolves with EAI_AGAIN, retries with backoff and connects to the server
+// 4. flaky.test moves to 127.0.0.2: the client resolves it again on reconnect and follows it
+auto main()
+    -> int
+{
+    auto loop      = EventLoop {};
+    auto port      = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto& resolver = ResolverMgr::GetInstance();
+    auto flaky     = std::atomic<int> {0};
+    auto moved     = std::atomic<bool> {false};
+    resolver.setLookupFunction([&](const std::string& hostname, uint16_t servicePort, bool) -> Resolver::ResolveResult {
+        assert(not loop.inOwnerThread());
+        if (hostname == "flaky.test" and moved)
+        {
+            return Resolver::AddressList {InetAddress {"127.0.0.2", servicePort}};
+        }
+        if (hostname == "localhost" or (hostname == "flaky.test" and ++flaky > 2))
+        {
+            return Resolver::AddressList {InetAddress {servicePort, true}};
+        }
+        auto error = hostname == "flaky.test" ? EAI_AGAIN : EAI_NONAME;
+        return std::unexpected {std::error_code {error, gaiErrorCategory()}};
+    });
+    resolver.setNegativeTtl(0.0); // every retry of flaky.test looks it up again
+    resolver.clearCache();
+
+    auto server = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Flaky");
+    server->start();
+    auto moved_server = std::make_shared<TcpServer>(&loop, InetAddress {"127.0.0.2", port}, "Moved");
+    moved_server->start();
+
+    auto failures    = 0;
+    auto connections = 0;
+    auto client   = std::make_shared<TcpClient>(&loop, "flaky.test", port, "FlakyClient");
+    client->setConnectFailedCallback([&](int error) {
+        assert(error == EAI_AGAIN);
+        ++failures;
+    });
+    client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+        if (not conn->isConnected())
+        {
+            return;
+        }
+        if (++connections == 1)
+        {
+            // 3.
+            assert(failures == 2 and flaky == 3 and conn->getPeerAddress().toIpRepr() == "127.0.0.1");
+            moved = true;
+            resolver.clearCache();
+            client->enableRetry();
+            conn->forceClose();
+            return;
+        }
+        // 4.
+        assert(conn->getPeerAddress().toIpRepr() == "127.0.0.2");
+        client->stop();
+        conn->forceClose();
+        loop.runAfter(0.1, [&] { loop.quit(); });
+    });
+
+    auto resolve_returned = false;
+    resolver.resolve("localhost", 2007, &loop, [&](const Resolver::ResolveResult& result) {
+        // 1.
+        assert(loop.inOwnerThread());
+        assert(result.has_value() and result->size() == 1);
+        LOG_INFO_FMT(log, "localhost -> {}", result->front().toIpPortRepr());
+        assert(result->front().GetPort() == 2007);
+        assert(resolver.lookupCache("localhost", 2007).has_value());
+
+        resolver.resolve("localhost", 2007, &loop, [&](const Resolver::ResolveResult& cached) {
+            assert(resolve_returned);
+            assert(cached.has_value());
+            resolver.resolve("no-such-host.invalid", 80, &loop, [&](const Resolver::ResolveResult& failed) {
+                // 2.
+                assert(not failed.has_value());
+                assert(failed.error().value() == EAI_NONAME and failed.error().category() == gaiErrorCategory());
+                LOG_INFO_FMT(log, "no-such-host.invalid -> {}", failed.error().message());
+                // 3. resolved again after 0.5s and 1s
+                client->connect();
+            });
+        });
+        resolve_returned = true;
+    });
+    loop.loop();
+    LOG_INFO_FMT(log, "testresolver passed");
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/Resp.h"
+#include "net/RespClient.h"
+#include "net/RespServer.h"
+#include "net/TcpConnection.h"
+
+#include <cassert>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+/**
+ * @brief feed @c wire one byte at a time, a value may only come out once its last byte arrived
+ */
+auto parseByteByByte(std::string_view wire)
+    -> std::vector<RespValue>
+{
+    auto parser = RespParser {};
+    auto buf    = Buffer {};
+    auto values = std::vector<RespValue> {};
+    for (auto c : wire)
+    {
+        buf.append(std::string_view {&c, 1});
+        while (true)
+        {
+            auto value = parser.parse(buf);
+            assert(value.has_value());
+            if (not value->has_value())
+            {
+                break;
+            }
+            values.push_back(std::move(**value));
+        }
+    }
+    assert(buf.getReadableBytesCount() == 0);
+    return values;
+}
+
+void testParser()
+{
+    auto values = parseByteByByte("*2\r\n$3\r\nGET\r\n$5\r\nk\r\ney\r\n"
+                                  "+OK\r\n-ERR bad\r\n:-42\r\n$-1\r\n*-1\r\n$0\r\n\r\n"
+                                  "%2\r\n+a\r\n:1\r\n+b\r\n#t\r\n"
+                                  "~1\r\n,3.5\r\n>2\r\n+message\r\n_\r\n"
+                                  "|1\r\n+ttl\r\n:10\r\n(12345678901234567890\r\n"
+                                  "!5\r\nOOPS!\r\n=8\r\ntxt:some\r\n"
+                                  "PING  hello\r\n");
+    assert(values.size() == 14);
+    assert(values[0].type == RespType::Array and values[0].elements.size() == 2);
+    assert(values[0].elements[1].str == "k\r\ney"); // a bulk string may hold "\r\n"
+    assert(values[1].type == RespType::SimpleString and values[1].str == "OK");
+    assert(values[2].isError() and values[2].str == "ERR bad");
+    assert(values[3].type == RespType::Integer and values[3].integer == -42);
+    assert(values[4].isNull() and values[5].isNull());
+    assert(values[6].type == RespType::BulkString and values[6].str.empty());
+    assert(values[7].type == RespType::Map and values[7].elements.size() == 4);
+    assert(values[7].elements[3].type == RespType::Boolean and values[7].elements[3].integer == 1);
+    assert(values[8].type == RespType::Set and values[8].elements[0].number == 3.5);
+    assert(values[9].type == RespType::Push and values[9].elements[1].isNull());
+    assert(values[10].type == RespType::BigNumber); // the attribute before it is dropped
+    assert(values[11].type == RespType::BulkError and values[11].str == "OOPS!");
+    assert(values[12].type == RespType::VerbatimString and values[12].str == "txt:some");
+    assert(values[13].type == RespType::Array and values[13].elements.size() == 2);
+    assert(values[13].elements[1].str == "hello");
+
+    // the writer's output parses back to the same value
+    auto writer = RespWriter {3};
+    writer.appendValue(values[7]);
+    writer.appendValue(values[9]);
+    auto round_trip = parseByteByByte(writer.getBuffer());
+    assert(round_trip.size() == 2 and round_trip[0].elements.size() == 4 and round_trip[1].type == RespType::Push);
+
+    // RESP2 degrades the RESP3 types
+    auto writer2 = RespWriter {2};
+    writer2.appendMapHeader(1);
+    writer2.appendNull();
+    writer2.appendBoolean(true);
+    assert(writer2.getBuffer() == "*2\r\n$-1\r\n:1\r\n");
+
+    auto parser = RespParser {};
+    auto buf    = Buffer {};
+    buf.append(std::string_view {"*1\r\n$x\r\n"});
+    auto malformed = parser.parse(buf);
+    assert(not malformed.has_value() and malformed.error() == RespError::Protocol);
+
+    parser.reset();
+    parser.setMaxDepth(2);
+    buf.readAllAndDiscard();
+    buf.append(std::string_view {"*1\r\n*1\r\n*1\r\n:1\r\n"});
+    assert(parser.parse(buf).error() == RespError::TooDeep);
+
+    // a pair count whose double overflows is too large, not a negative count
+    for (auto header : {"%4611686018427387904\r\n", "|4611686018427387904\r\n", "%9223372036854775807\r\n"})
+    {
+        parser.reset();
+        buf.readAllAndDiscard();
+        buf.append(std::string_view {header});
+        auto huge = parser.parse(buf);
+        assert(not huge.has_value() and huge.error() == RespError::TooLarge);
+    }
+}
+
+} // namespace
+
+// RespServer with a custom command and a RespClient pipelining commands before and after connecting
+auto main()
+    -> int
+{
+    testParser();
+
+    auto loop   = EventLoop {};
+    auto port   = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+    auto server = RespServer {&loop, InetAddress {port, true}, "TestResp"};
+    server.registerCommand("INCRBY", [counter = int64_t {0}](const TcpConnectionPtr&, std::span<const std::string_view> args, RespWriter& reply) mutable {
+        counter += std::stoll(std::string {args[2]});
+        reply.appendInteger(counter);
+    });
+    server.start();
+
+    auto client  = RespClient {&loop, InetAddress {port, true}, "TestRespClient"};
+    auto replies = std::vector<RespValue> {};
+    auto collect = [&](RespValue&& reply) { replies.push_back(std::move(reply)); };
+    // queued before the connection is up, sent in one write once it is
+    client.command({"PING"}, collect);
+    client.command({"incrby", "n", "5"}, collect);
+    client.command({"INCRBY", "n", "7"}, collect);
+    client.command({"HELLO", "3"}, collect);
+    client.command({"NOSUCH"}, collect);
+    client.command({"ECHO", "done"}, [&](RespValue&& reply) {
+        collect(std::move(reply));
+        assert(client.getWriteCount() == 1);
+        client.command({"QUIT"}, collect);
+    });
+    client.setConnectionCallback([&](const TcpConnectionPtr& conn) {
+        if (not conn->isConnected())
+        {
+            loop.runAfter(0.05, [&loop] { loop.quit(); });
+        }
+    });
+    client.connect();
+    loop.loop();
+
+    assert(replies.size() == 7);
+    assert(replies[0].str == "PONG");
+    assert(replies[1].integer == 5 and replies[2].integer == 12);
+    assert(replies[3].type == RespType::Map and replies[3].elements[3].integer == 3);
+    assert(replies[4].isError() and replies[4].str.starts_with("ERR unknown command"));
+    assert(replies[5].type == RespType::BulkString and replies[5].str == "done");
+    assert(replies[6].str == "OK");
+    assert(server.getCommandsProcessed() == 7);
+    LOG_INFO_FMT(log, "testresp passed");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <cassert>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr size_t c_threshold = 64 * 1024;
+constexpr size_t c_message   = 1000;
+constexpr size_t c_messages  = 16000; // 16MB, far more than the socket buffers take
+const auto c_end             = std::string {"END"};
+
+} // namespace
+
+// a server sending 16MB at once to a client, with a 64KB spill threshold:
+// 1. the output beyond the threshold goes to the spill file, at most the threshold is kept in memory
+// 2. a shared payload sent while spilling comes after the spilled output, its write callback once it is sent
+// 3. the client gets every byte in order, the file is drained and closed by the write complete callback
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto port = static_cast<uint16_t>(20000 + ::getpid() % 20000);
+
+    auto server      = std::make_shared<TcpServer>(&loop, InetAddress {port, true}, "Spill");
+    auto end_written = false;
+    server->setConnectionEstablishedCallback([&](const TcpConnectionPtr& conn) {
+        if (not conn->isConnected())
+        {
+            return;
+        }
+        auto enabled = conn->enableOutputSpill(c_threshold);
+        assert(enabled);
+        for (size_t i = 0; i < c_messages; ++i)
+        {
+            conn->send(std::string(c_message, static_cast<char>('a' + i % 26)));
+        }
+        // 1.
+        auto stats = conn->getSpillStats();
+        assert(stats.spills == 1 and stats.pending_bytes > 0);
+        assert(conn->getOutputBufferedBytes() - stats.pending_bytes <= c_threshold);
+        // 2.
+        conn->sendShared(std::make_shared<const std::string>(c_end), [&](const TcpConnectionPtr&) {
+            end_written = true;
+        });
+        conn->setWriteCompleteCallback([&](const TcpConnectionPtr& conn) {
+            // 3.
+            assert(end_written);
+            assert(conn->getSpillStats().pending_bytes == 0 and conn->getOutputBufferedBytes() == 0);
+            LOG_INFO_FMT(log, "{} bytes spilled", conn->getSpillStats().spilled_bytes);
+        });
+    });
+    server->start();
+
+    auto received = std::string {};
+    auto client   = std::make_shared<TcpClient>(&loop, InetAddress {port, true}, "Receiver");
+    client->setMessageCallback([&](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        received += buf.readAllAsString();
+        if (not received.ends_with(c_end))
+        {
+            return;
+        }
+        // 3.
+        assert(received.size() == c_messages * c_message + c_end.size());
+        for (size_t i = 0; i < c_messages; ++i)
+        {
+            assert(received[i * c_message] == 'a' + i % 26 and received[(i + 1) * c_message - 1] == 'a' + i % 26);
+        }
+        conn->forceClose();
+        loop.runAfter(0.2, [&] { loop.quit(); });
+    });
+    client->connect();
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testspill passed");
+    return 0;
+}
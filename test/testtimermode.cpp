@@ -0,0 +1,109 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/Timestamp.h"
+
+#include <cassert>
+#include <thread>
+#include <vector>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr double c_slack = 0.02;
+
+// a loop busy for 0.2s between its construction and loop(), e.g. inheriting listeners: a timer added meanwhile
+// counts from when it is added, not from the construction
+void checkSetupTime(EventLoop::TimerMode mode)
+{
+    auto loop = EventLoop {};
+    loop.setTimerMode(mode);
+    std::this_thread::sleep_for(std::chrono::milliseconds {200});
+    auto added = Timestamp::now();
+    loop.runAfter(0.05, [&] {
+        auto late = timeDifference(Timestamp::now(), added) - 0.05;
+        LOG_INFO_FMT(log, "timer added before loop() fired {}s late", late);
+        assert(late > -0.001 and late < 0.1);
+        loop.quit();
+    });
+    loop.loop();
+}
+
+} // namespace
+
+// one loop, timers driven by the poll timeout with 20ms of slack:
+// 1. three timers 5ms apart fire in one wakeup, none before it is due
+// 2. a timer added from another thread while the loop sleeps wakes it
+// 3. a cancelled repeating timer stops, the one left keeps firing, later each time by the slack
+// 4. back on the timerfd, the slack still coalesces
+// 5. in both modes, a timer added after a long setup and before loop() fires on time
+auto main()
+    -> int
+{
+    // 5.
+    checkSetupTime(EventLoop::TimerMode::Timerfd);
+    checkSetupTime(EventLoop::TimerMode::PollTimeout);
+
+    auto loop = EventLoop {};
+    loop.setTimerMode(EventLoop::TimerMode::PollTimeout);
+    loop.setTimerSlack(c_slack);
+
+    auto coalesced = std::vector<Timestamp> {};
+    for (auto delay : {0.05, 0.055, 0.06})
+    {
+        auto due = addTime(Timestamp::now(), delay);
+        loop.runAfter(delay, [&, due] {
+            assert(not(loop.now() < due));
+            assert(timeDifference(loop.now(), due) < c_slack + 0.05);
+            coalesced.push_back(loop.now());
+        });
+    }
+
+    auto from_thread = false;
+    auto thread      = std::jthread {[&loop, &from_thread] {
+        std::this_thread::sleep_for(std::chrono::milliseconds {150});
+        loop.runAfter(0.01, [&from_thread] { from_thread = true; });
+    }};
+
+    auto cancelled    = 0;
+    auto cancelled_at = 0;
+    auto kept         = 0;
+    auto kept_at      = 0;
+    auto cancelled_id = Timer::Id {};
+    auto kept_id      = Timer::Id {};
+    loop.runAfter(0.12, [&] {
+        cancelled_id = loop.runEvery(0.01, [&cancelled] { ++cancelled; });
+        kept_id      = loop.runEvery(0.01, [&kept] { ++kept; });
+    });
+    loop.runAfter(0.22, [&] {
+        loop.cancelTimer(cancelled_id);
+        cancelled_at = cancelled;
+    });
+
+    auto timerfd_coalesced = std::vector<Timestamp> {};
+    loop.runAfter(0.3, [&] {
+        loop.cancelTimer(kept_id);
+        kept_at = kept;
+        loop.setTimerMode(EventLoop::TimerMode::Timerfd);
+        for (auto delay : {0.01, 0.015})
+        {
+            loop.runAfter(delay, [&] { timerfd_coalesced.push_back(loop.now()); });
+        }
+    });
+    loop.runAfter(0.4, [&] {
+        assert(coalesced.size() == 3 and coalesced[0] == coalesced[1] and coalesced[1] == coalesced[2]);
+        assert(from_thread);
+        // a repeating timer expired in the batch of the one cancelling it still runs once
+        assert(cancelled_at >= 2 and cancelled - cancelled_at <= 1);
+        // 10ms apart, each wakeup up to 20ms late: the repeating one fires less often but keeps going
+        LOG_INFO_FMT(log, "repeating timer fired {} times in 0.18s", kept_at);
+        assert(kept_at >= 3 and kept_at <= 18 and kept - kept_at <= 1);
+        assert(timerfd_coalesced.size() == 2 and timerfd_coalesced[0] == timerfd_coalesced[1]);
+        loop.quit();
+    });
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testtimermode passed");
+    return 0;
+}
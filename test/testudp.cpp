@@ -0,0 +1,82 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/UdpServer.h"
+#include "net/UdpSocket.h"
+
+#include <cassert>
+#include <memory>
+#include <set>
+#include <span>
+#include <string>
+
+static auto log = GET_ROOT_LOGGER();
+
+namespace {
+
+constexpr int c_datagrams    = 100;
+constexpr size_t c_slot_size = 512;
+
+} // namespace
+
+// a UdpServer on a kernel chosen loopback port echoing every datagram, and a client UdpSocket:
+// 1. the datagrams the client queues in one loop iteration leave with fewer sendmmsg than datagrams
+// 2. every datagram comes back once, with its payload and the client as peer
+// 3. a datagram larger than the server's slot is reported truncated and counted
+auto main()
+    -> int
+{
+    auto loop   = EventLoop {};
+    auto server = UdpServer {&loop, InetAddress {0, true}, "Echo"};
+    server.setBatchSize(16, c_slot_size);
+    server.setMessageCallback([](const UdpSocketPtr& socket, std::span<const Datagram> datagrams, Timestamp) {
+        for (const auto& datagram : datagrams)
+        {
+            socket->send(datagram.peer, datagram.truncated ? std::string_view {"truncated"} : datagram.payload);
+        }
+    });
+    server.start();
+    auto server_addr = server.getSockets().front()->getLocalAddress();
+
+    auto received = std::set<std::string> {};
+    auto client   = std::make_shared<UdpSocket>(&loop, InetAddress {0, true});
+    client->setMessageCallback([&](const UdpSocketPtr& socket, std::span<const Datagram> datagrams, Timestamp) {
+        for (const auto& datagram : datagrams)
+        {
+            // 2.
+            assert(not datagram.truncated);
+            assert(datagram.peer.toIpPortRepr() == server_addr.toIpPortRepr());
+            auto inserted = received.insert(std::string {datagram.payload}).second;
+            assert(inserted);
+        }
+        if (received.size() < c_datagrams + 1)
+        {
+            return;
+        }
+        assert(received.contains("truncated"));
+        // 1.
+        auto stats = socket->getStats();
+        assert(stats.tx_datagrams == c_datagrams + 1 and stats.rx_datagrams == c_datagrams + 1);
+        assert(stats.tx_syscalls < stats.tx_datagrams);
+        // 3.
+        auto server_stats = server.getStats();
+        assert(server_stats.rx_truncated == 1 and server_stats.rx_datagrams == c_datagrams + 1);
+        LOG_INFO_FMT(log, "{} datagrams sent by {} sendmmsg", stats.tx_datagrams, stats.tx_syscalls);
+        loop.runAfter(0.1, [&] {
+            client->stop();
+            loop.quit();
+        });
+    });
+    client->start();
+    // queued now, sent together once the loop runs
+    for (auto i = 0; i < c_datagrams; ++i)
+    {
+        client->send(server_addr, "datagram-" + std::to_string(i));
+    }
+    client->send(server_addr, std::string(c_slot_size * 2, 'x'));
+    loop.loop();
+
+    LOG_INFO_FMT(log, "testudp passed");
+    return 0;
+}
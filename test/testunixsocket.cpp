@@ -0,0 +1,65 @@
+#include "logger/Logger.h"
+#include "logger/LoggerManager.h"
+#include "net/Buffer.h"
+#include "net/EventLoop.h"
+#include "net/InetAddress.h"
+#include "net/TcpClient.h"
+#include "net/TcpConnection.h"
+#include "net/TcpServer.h"
+
+#include <array>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+static auto log = GET_ROOT_LOGGER();
+
+// the client passes the write end of a pipe to the server over an abstract unix socket,
+// the server writes through it and the client reads the pipe
+auto main()
+    -> int
+{
+    auto loop = EventLoop {};
+    auto addr = InetAddress::fromUnixPath("@cotweb-testunixsocket-" + std::to_string(::getpid()));
+    assert(addr.isUnix());
+    assert(addr.toIpPortRepr().starts_with("unix:@cotweb-testunixsocket-"));
+
+    auto pipe_fds = std::array<int, 2> {};
+    assert(::pipe(pipe_fds.data()) == 0);
+
+    auto server = std::make_shared<TcpServer>(&loop, addr, "UnixServer");
+    server->setMessageCallback([](const TcpConnectionPtr& conn, Buffer& buf, Timestamp) {
+        assert(conn->isUnix());
+        auto fds = conn->takeReceivedFds();
+        auto msg = buf.readAllAsString();
+        LOG_INFO_FMT(log, "server got {} with {} fds", msg, fds.size());
+        assert(msg == "hello" and fds.size() == 1);
+        assert(::write(fds.front(), "through the pipe", 16) == 16);
+        ::close(fds.front());
+        conn->send(std::string {"done"});
+    });
+    server->start();
+
+    auto client = std::make_shared<TcpClient>(&loop, addr, "UnixClient");
+    client->setConnetionCallback([&](const TcpConnectionPtr& conn) {
+        if (conn->isConnected())
+        {
+            conn->sendFds("hello", std::array<int, 1> {pipe_fds[1]});
+            ::close(pipe_fds[1]); // sendFds dup-ed it
+        }
+    });
+    client->setMessageCallback([&](const TcpConnectionPtr&, Buffer& buf, Timestamp) {
+        assert(buf.readAllAsString() == "done");
+        auto piped = std::array<char, 64> {};
+        auto n     = ::read(pipe_fds[0], piped.data(), piped.size());
+        assert(std::string(piped.data(), static_cast<size_t>(n)) == "through the pipe");
+        client->disconnect();
+        loop.runAfter(0.1, [&loop] { loop.quit(); });
+    });
+    client->connect();
+    loop.loop();
+    ::close(pipe_fds[0]);
+    LOG_INFO_FMT(log, "testunixsocket passed");
+    return 0;
+}
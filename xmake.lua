@@ -131,6 +131,21 @@ target("AllInOne")
     add_syslinks("pthread")
 
 
+target("MemcacheServer")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include", "examples/memcached")
+    add_files("examples/memcached/*.cpp")
+    add_syslinks("pthread")
+
+target("PubSubServer")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include", "examples/pubsub")
+    add_files("examples/pubsub/*.cpp")
+    add_syslinks("pthread")
+
+
 target("DownloadFile")
     set_kind("binary")
     add_deps("muduo-net", "common-lib", "logger")
@@ -141,6 +156,84 @@ target("DownloadFile")
     add_syslinks("pthread")
 
 
+target("udp_pps")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/udp_pps.cpp")
+    add_syslinks("pthread")
+
+target("unix_latency")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/unix_latency.cpp")
+    add_syslinks("pthread")
+
+target("zerocopy_send")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/zerocopy_send.cpp")
+    add_syslinks("pthread")
+
+target("pingpong_server")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/pingpong_server.cpp")
+    add_syslinks("pthread")
+
+target("pingpong_client")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/pingpong_client.cpp")
+    add_syslinks("pthread")
+
+target("latency_loadgen")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/latency_loadgen.cpp")
+    add_syslinks("pthread")
+
+target("memcache_bench")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/memcache_bench.cpp")
+    add_syslinks("pthread")
+
+target("resp_bench")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/resp_bench.cpp")
+    add_syslinks("pthread")
+
+target("pubsub_bench")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/pubsub_bench.cpp")
+    add_syslinks("pthread")
+
+target("relay_bench")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/relay_bench.cpp")
+    add_syslinks("pthread")
+
+target("clock_bench")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_includedirs("include", "/usr/local/include")
+    add_files("bench/clock_bench.cpp")
+    add_syslinks("pthread")
+
+
 
 target("testlogger")
     set_kind("binary")
@@ -175,6 +268,174 @@ target("testscheduler")
     add_syslinks("pthread")
     -- add_defines("NO_DEBUG") //开启调试日志
 
+target("testconnpool")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testconnpool.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testresolver")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testresolver.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testconnectrace")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testconnectrace.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testunixsocket")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testunixsocket.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testhotrestart")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testhotrestart.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testresp")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testresp.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testrelay")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testrelay.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testratelimit")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testratelimit.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testadmission")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testadmission.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testconnstats")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testconnstats.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testmetrics")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testmetrics.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testtimermode")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testtimermode.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testmigration")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testmigration.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testkeyaffinity")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testkeyaffinity.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testoffload")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testoffload.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testbroadcast")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testbroadcast.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testspill")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testspill.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testudp")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testudp.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testzerocopy")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testzerocopy.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testpubsub")
+    set_kind("binary")
+    add_deps("muduo-net", "common-lib", "logger")
+    add_files("test/testpubsub.cpp")
+    add_includedirs("include")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
+target("testitemstore")
+    set_kind("binary")
+    add_deps("common-lib", "logger")
+    add_files("test/testitemstore.cpp", "examples/memcached/ItemStore.cpp")
+    add_includedirs("include", "examples/memcached")
+    add_includedirs("/usr/local/include")
+    add_syslinks("pthread")
+
 target("testyaml")
     set_kind("binary")
     add_files("test/testyaml.cpp")